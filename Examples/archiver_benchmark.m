@@ -0,0 +1,165 @@
+/* Benchmark for NSArchiver encoding of large object graphs.
+
+  Copyright (C) 2026 Free Software Foundation
+
+  Copying and distribution of this file, with or without modification,
+  are permitted in any medium without royalty provided the copyright
+  notice and this notice are preserved.
+
+  Archives a graph of N objects (default 1000000), each of which refers
+  conditionally to an earlier object, so that the archive is written in
+  a single pass, and reports the time, archive size and memory used.  Then archives the same graph with one conditional
+  reference to an object which is encoded later, which makes the
+  archiver fall back to two passes.  Finally reuses one archiver for
+  several snapshots of the graph with -resetArchiver.
+  Run as 'archiver_benchmark N' to choose the graph size. */
+
+#include <Foundation/Foundation.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#define	ENTRIES		1000000
+#define	SNAPSHOTS	5
+
+@interface	Entry : NSObject <NSCoding>
+{
+@public
+  int		number;
+  double	value;
+  Entry		*previous;
+}
+@end
+
+@implementation	Entry
+- (void) dealloc
+{
+  [previous release];
+  [super dealloc];
+}
+
+- (void) encodeWithCoder: (NSCoder*)aCoder
+{
+  [aCoder encodeValueOfObjCType: @encode(int) at: &number];
+  [aCoder encodeValueOfObjCType: @encode(double) at: &value];
+  [aCoder encodeConditionalObject: previous];
+}
+
+- (id) initWithCoder: (NSCoder*)aCoder
+{
+  [aCoder decodeValueOfObjCType: @encode(int) at: &number];
+  [aCoder decodeValueOfObjCType: @encode(double) at: &value];
+  previous = [[aCoder decodeObject] retain];
+  return self;
+}
+@end
+
+static unsigned long
+residentKB()
+{
+  unsigned long	size = 0;
+  unsigned long	resident = 0;
+  FILE		*f = fopen("/proc/self/statm", "r");
+
+  if (f != 0)
+    {
+      if (fscanf(f, "%lu %lu", &size, &resident) != 2)
+	{
+	  resident = 0;
+	}
+      fclose(f);
+    }
+  return resident * (getpagesize() / 1024);
+}
+
+/* Each entry refers to one a tenth of the way along the graph, so the
+ * chains of retained objects stay short when the graph is released.
+ */
+static NSMutableArray *
+makeGraph(int entries)
+{
+  NSMutableArray	*graph;
+  int			i;
+
+  graph = [[NSMutableArray alloc] initWithCapacity: entries];
+  for (i = 0; i < entries; i++)
+    {
+      Entry	*e = [Entry new];
+
+      e->number = i;
+      e->value = i * 0.5;
+      if (i > 0)
+	{
+	  e->previous = [[graph objectAtIndex: i / 10] retain];
+	}
+      [graph addObject: e];
+      [e release];
+    }
+  return graph;
+}
+
+static void
+report(const char *label, NSDate *start, NSUInteger bytes, int count,
+  unsigned long before)
+{
+  double	t = -[start timeIntervalSinceNow];
+
+  printf("%-28s %8.3f s  %10lu bytes  %10.0f objects/s  RSS +%lu KB\n",
+    label, t, (unsigned long)bytes, count / t, residentKB() - before);
+}
+
+int
+main(int argc, char **argv)
+{
+  CREATE_AUTORELEASE_POOL(pool);
+  int			entries = (argc > 1) ? atoi(argv[1]) : ENTRIES;
+  NSMutableArray	*graph = makeGraph(entries);
+  NSMutableData		*md;
+  NSArchiver		*archiver;
+  NSData		*data;
+  NSDate		*start;
+  Entry			*first;
+  unsigned long		before;
+  int			i;
+
+  before = residentKB();
+  start = [NSDate date];
+  data = [NSArchiver archivedDataWithRootObject: graph];
+  report("single pass", start, [data length], entries, before);
+  [pool emptyPool];
+
+  /* Move the first entry to the end, so that the entries which refer
+   * to it conditionally are encoded before it.
+   */
+  first = [[graph objectAtIndex: 0] retain];
+  [graph removeObjectAtIndex: 0];
+  [graph addObject: first];
+  [first release];
+  before = residentKB();
+  start = [NSDate date];
+  data = [NSArchiver archivedDataWithRootObject: graph];
+  report("two passes", start, [data length], entries, before);
+  [pool emptyPool];
+
+  /* Restore the original order so that each snapshot is a single pass.
+   */
+  first = [[graph lastObject] retain];
+  [graph removeLastObject];
+  [graph insertObject: first atIndex: 0];
+  [first release];
+  md = [NSMutableData data];
+  archiver = [[NSArchiver alloc] initForWritingWithMutableData: md];
+  before = residentKB();
+  start = [NSDate date];
+  for (i = 0; i < SNAPSHOTS; i++)
+    {
+      [md setLength: 0];
+      [archiver resetArchiver];
+      [archiver encodeRootObject: graph];
+    }
+  report("reused archiver", start, [md length], entries * SNAPSHOTS, before);
+  [archiver release];
+  [graph release];
+
+  DESTROY(pool);
+  return 0;
+}
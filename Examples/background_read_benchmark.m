@@ -0,0 +1,141 @@
+/* Benchmark for concurrent background reads of large files.
+
+  Copyright (C) 2026 Free Software Foundation
+
+  Copying and distribution of this file, with or without modification,
+  are permitted in any medium without royalty provided the copyright
+  notice and this notice are preserved.
+
+  Creates N files (default 4) of M megabytes (default 128) each in
+  directory D (default the temporary directory), then reads them all at
+  once with -readToEndOfFileInBackgroundAndNotify, reporting the total
+  throughput and how often a 10ms timer managed to fire meanwhile (a
+  low count means the reads held up the run loop).  The files are read
+  twice, as the first pass may have to fetch them from disk.
+  On Linux the reads use an io_uring where the kernel supports one; run
+  with '-GSFileHandleIOURing NO' to have the run loop poll the files
+  instead.
+  Run as 'background_read_benchmark N M D' to choose the parameters. */
+
+#include <Foundation/Foundation.h>
+#include <stdio.h>
+
+@interface	Reader : NSObject
+{
+@public
+  NSUInteger		finished;
+  unsigned long long	total;
+  NSUInteger		ticks;
+}
+- (void) read: (NSNotification*)n;
+- (void) tick: (NSTimer*)t;
+@end
+
+@implementation	Reader
+- (void) read: (NSNotification*)n
+{
+  total += [[[n userInfo] objectForKey: NSFileHandleNotificationDataItem]
+    length];
+  finished++;
+}
+
+- (void) tick: (NSTimer*)t
+{
+  ticks++;
+}
+@end
+
+static void
+readAll(NSArray *paths, const char *label)
+{
+  CREATE_AUTORELEASE_POOL(pool);
+  NSNotificationCenter	*nc = [NSNotificationCenter defaultCenter];
+  Reader		*r = [[Reader new] autorelease];
+  NSUInteger		count = [paths count];
+  NSTimer		*timer;
+  NSDate		*start;
+  NSUInteger		i;
+  double		t;
+
+  start = [NSDate date];
+  for (i = 0; i < count; i++)
+    {
+      NSFileHandle	*fh;
+
+      fh = [NSFileHandle fileHandleForReadingAtPath: [paths objectAtIndex: i]];
+      [nc addObserver: r
+	     selector: @selector(read:)
+		 name: NSFileHandleReadToEndOfFileCompletionNotification
+	       object: fh];
+      [fh readToEndOfFileInBackgroundAndNotify];
+    }
+  timer = [NSTimer scheduledTimerWithTimeInterval: 0.01
+					   target: r
+					 selector: @selector(tick:)
+					 userInfo: nil
+					  repeats: YES];
+  while (r->finished < count)
+    {
+      CREATE_AUTORELEASE_POOL(inner);
+
+      [[NSRunLoop currentRunLoop] runMode: NSDefaultRunLoopMode
+			       beforeDate: [NSDate distantFuture]];
+      DESTROY(inner);
+    }
+  [timer invalidate];
+  [nc removeObserver: r];
+  t = -[start timeIntervalSinceNow];
+  printf("%-12s %8.3f s  %8.1f MB/s  %6lu of %6lu timer ticks\n", label, t,
+    r->total / t / (1024.0 * 1024.0), (unsigned long)r->ticks,
+    (unsigned long)(t * 100));
+  DESTROY(pool);
+}
+
+int
+main(int argc, char **argv)
+{
+  CREATE_AUTORELEASE_POOL(pool);
+  NSFileManager		*mgr = [NSFileManager defaultManager];
+  unsigned		files = (argc > 1) ? atoi(argv[1]) : 4;
+  unsigned		megabytes = (argc > 2) ? atoi(argv[2]) : 128;
+  NSMutableArray	*paths = [NSMutableArray array];
+  NSMutableData		*block;
+  NSString		*dir;
+  unsigned		i;
+  unsigned		j;
+
+  dir = (argc > 3) ? [NSString stringWithUTF8String: argv[3]]
+    : NSTemporaryDirectory();
+
+  block = [NSMutableData dataWithLength: 1024 * 1024];
+  for (i = 0; i < [block length]; i++)
+    {
+      ((uint8_t*)[block mutableBytes])[i] = (uint8_t)(i * 7);
+    }
+  for (i = 0; i < files; i++)
+    {
+      NSString		*path;
+      NSFileHandle	*fh;
+
+      path = [dir stringByAppendingPathComponent:
+	[NSString stringWithFormat: @"background_read_benchmark.%u", i]];
+      [mgr createFileAtPath: path contents: nil attributes: nil];
+      fh = [NSFileHandle fileHandleForWritingAtPath: path];
+      for (j = 0; j < megabytes; j++)
+	{
+	  [fh writeData: block];
+	}
+      [fh closeFile];
+      [paths addObject: path];
+    }
+
+  readAll(paths, "first pass");
+  readAll(paths, "second pass");
+
+  for (i = 0; i < files; i++)
+    {
+      [mgr removeItemAtPath: [paths objectAtIndex: i] error: NULL];
+    }
+  DESTROY(pool);
+  return 0;
+}
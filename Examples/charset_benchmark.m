@@ -0,0 +1,131 @@
+/* Benchmark for character set membership and scanning.
+
+  Copyright (C) 2026 Free Software Foundation
+
+  Copying and distribution of this file, with or without modification,
+  are permitted in any medium without royalty provided the copyright
+  notice and this notice are preserved.
+
+  Times searching large 8-bit and 16-bit strings for members of small
+  and large character sets, splitting them into components, and
+  tokenizing them with NSScanner. */
+
+#include <Foundation/Foundation.h>
+#include <stdio.h>
+
+#define	LOOPS	200
+
+static void
+report(const char *label, NSDate *start, NSUInteger bytes)
+{
+  double	t = -[start timeIntervalSinceNow];
+
+  printf("%-36s %8.3f s  %10.1f MB/s\n", label, t,
+    (double)bytes * LOOPS / t / 1048576.0);
+}
+
+static void
+search(NSString *subject, NSCharacterSet *set, const char *label)
+{
+  CREATE_AUTORELEASE_POOL(pool);
+  NSUInteger	length = [subject length];
+  NSDate	*start;
+  int		i;
+
+  start = [NSDate date];
+  for (i = 0; i < LOOPS; i++)
+    {
+      NSRange	r = NSMakeRange(0, length);
+
+      while (r.length > 0)
+	{
+	  NSRange	found;
+
+	  found = [subject rangeOfCharacterFromSet: set options: 0 range: r];
+	  if (found.length == 0)
+	    {
+	      break;
+	    }
+	  r.location = NSMaxRange(found);
+	  r.length = length - r.location;
+	}
+    }
+  report(label, start, length);
+  DESTROY(pool);
+}
+
+static void
+run(NSString *subject, const char *kind)
+{
+  CREATE_AUTORELEASE_POOL(pool);
+  NSCharacterSet	*punct;
+  NSCharacterSet	*space;
+  NSCharacterSet	*alnum;
+  NSUInteger		length = [subject length];
+  NSDate		*start;
+  int			i;
+
+  punct = [NSCharacterSet characterSetWithCharactersInString: @",;\n"];
+  space = [NSCharacterSet whitespaceAndNewlineCharacterSet];
+  alnum = [NSCharacterSet alphanumericCharacterSet];
+
+  printf("%s subject (%lu characters):\n", kind, (unsigned long)length);
+
+  search(subject, punct, "  rangeOfCharacter small set");
+  search(subject, space, "  rangeOfCharacter large set");
+
+  start = [NSDate date];
+  for (i = 0; i < LOOPS; i++)
+    {
+      [subject componentsSeparatedByCharactersInSet: punct];
+      [pool emptyPool];
+    }
+  report("  componentsSeparatedByCharacters", start, length);
+
+  start = [NSDate date];
+  for (i = 0; i < LOOPS; i++)
+    {
+      NSScanner	*scanner = [NSScanner scannerWithString: subject];
+
+      while ([scanner isAtEnd] == NO)
+	{
+	  if ([scanner scanCharactersFromSet: alnum intoString: NULL] == NO)
+	    {
+	      [scanner scanUpToCharactersFromSet: alnum intoString: NULL];
+	    }
+	}
+      [pool emptyPool];
+    }
+  report("  NSScanner tokenize", start, length);
+
+  DESTROY(pool);
+}
+
+int
+main()
+{
+  CREATE_AUTORELEASE_POOL(pool);
+  NSMutableString	*m = [NSMutableString string];
+  NSString		*s;
+  int			i;
+
+  for (i = 0; i < 4096; i++)
+    {
+      [m appendFormat: @"field%d value_with_some_longer_text%d,", i, i * 7];
+      if (i % 8 == 7)
+	{
+	  [m appendString: @"\n"];
+	}
+    }
+  s = [m copy];
+  run(s, "8-bit");
+  [s release];
+
+  [m appendString: @"\u4E2D"];
+  s = [m copy];
+  run(s, "16-bit");
+  [s release];
+
+  DESTROY(pool);
+  return 0;
+}
@@ -0,0 +1,127 @@
+/* Benchmark for accumulating and queueing data in NSMutableData.
+
+  Copyright (C) 2026 Free Software Foundation
+
+  Copying and distribution of this file, with or without modification,
+  are permitted in any medium without royalty provided the copyright
+  notice and this notice are preserved.
+
+  Simulates streaming ingest by appending M megabytes (default 256) in
+  reads of R bytes (default 16384), first accumulating all of it as a
+  file handle reading to the end of a file does, then treating the data
+  as a queue from which a consumer removes most of each read from the
+  front, as a protocol parser does.  Each workload is run with a data
+  object from +dataWithCapacity:, which holds one contiguous buffer,
+  and one from +dataWithChunkSize:.
+  Run as 'chunked_data_benchmark M R' to choose the parameters. */
+
+#include <Foundation/Foundation.h>
+#include <stdio.h>
+#include <unistd.h>
+
+static unsigned long
+residentKB()
+{
+  unsigned long	size = 0;
+  unsigned long	resident = 0;
+  FILE		*f = fopen("/proc/self/statm", "r");
+
+  if (f != 0)
+    {
+      if (fscanf(f, "%lu %lu", &size, &resident) != 2)
+	{
+	  resident = 0;
+	}
+      fclose(f);
+    }
+  return resident * (getpagesize() / 1024);
+}
+
+static NSMutableData *
+makeData(BOOL chunked)
+{
+  if (YES == chunked)
+    {
+      return [NSMutableData dataWithChunkSize: 0];
+    }
+  return [NSMutableData dataWithCapacity: 0];
+}
+
+static void
+accumulate(const uint8_t *buf, NSUInteger read, NSUInteger total,
+  BOOL chunked)
+{
+  CREATE_AUTORELEASE_POOL(pool);
+  NSMutableData	*d = makeData(chunked);
+  unsigned long	before = residentKB();
+  NSDate	*start = [NSDate date];
+  NSUInteger	done;
+  uint8_t	last;
+  double	t;
+
+  for (done = 0; done < total; done += read)
+    {
+      [d appendBytes: buf length: read];
+    }
+  [d getBytes: &last range: NSMakeRange([d length] - 1, 1)];
+  t = -[start timeIntervalSinceNow];
+  printf("accumulate %-10s %8.3f s  %8.1f MB/s  RSS +%lu KB  (check %u)\n",
+    chunked ? "chunked" : "contiguous", t, total / t / (1024.0 * 1024.0),
+    residentKB() - before, (unsigned)last);
+  DESTROY(pool);
+}
+
+static void
+queue(const uint8_t *buf, NSUInteger read, NSUInteger total, BOOL chunked)
+{
+  CREATE_AUTORELEASE_POOL(pool);
+  NSMutableData	*d = makeData(chunked);
+  NSUInteger	consume = read - read / 4;
+  NSDate	*start = [NSDate date];
+  NSUInteger	done;
+  unsigned long	sum = 0;
+  uint8_t	tmp[consume];
+  double	t;
+
+  for (done = 0; done < total; done += read)
+    {
+      [d appendBytes: buf length: read];
+      [d getBytes: tmp range: NSMakeRange(0, consume)];
+      sum += tmp[consume - 1];
+      [d replaceBytesInRange: NSMakeRange(0, consume) withBytes: 0 length: 0];
+    }
+  t = -[start timeIntervalSinceNow];
+  printf("queue      %-10s %8.3f s  %8.1f MB/s  backlog %lu KB  (check %lu)\n",
+    chunked ? "chunked" : "contiguous", t, total / t / (1024.0 * 1024.0),
+    (unsigned long)[d length] / 1024, sum);
+  DESTROY(pool);
+}
+
+int
+main(int argc, char **argv)
+{
+  CREATE_AUTORELEASE_POOL(pool);
+  NSUInteger	megabytes = (argc > 1) ? atoi(argv[1]) : 256;
+  NSUInteger	read = (argc > 2) ? atoi(argv[2]) : 16384;
+  NSUInteger	total = megabytes * 1024 * 1024;
+  uint8_t	*buf;
+  NSUInteger	i;
+
+  if (read < 4)
+    {
+      read = 4;
+    }
+  buf = malloc(read);
+  for (i = 0; i < read; i++)
+    {
+      buf[i] = (uint8_t)i;
+    }
+
+  accumulate(buf, read, total, NO);
+  accumulate(buf, read, total, YES);
+  queue(buf, read, total / 8, NO);
+  queue(buf, read, total / 8, YES);
+  free(buf);
+  DESTROY(pool);
+  return 0;
+}
@@ -0,0 +1,211 @@
+/* Benchmark for concurrent remote invocations over one NSConnection.
+
+  Copyright (C) 2026 Free Software Foundation
+
+  Copying and distribution of this file, with or without modification,
+  are permitted in any medium without royalty provided the copyright
+  notice and this notice are preserved.
+
+  Vends a server object on a socket port and calls it from T client
+  threads (default 8) sharing a single connection, each making C calls
+  (default 1000) to a method which takes W microseconds (default 200).
+  Reports the number of calls per second handled by a connection which
+  services requests in its run loop, and by one using a pool of T
+  request workers, along with the average size of a request message.
+  Run as 'connection_benchmark T C W' to choose the parameters, and add
+  '-GSCoderSystemVersion 999999' to compare with the encoding used
+  before compact coding was available. */
+
+#include <Foundation/Foundation.h>
+#include <stdio.h>
+#include <unistd.h>
+
+@protocol	Service
+- (int) work: (int)n;
+@end
+
+@interface	Server : NSObject <Service>
+{
+@public
+  useconds_t	delay;
+}
+@end
+
+@implementation	Server
+- (int) work: (int)n
+{
+  if (delay > 0)
+    {
+      usleep(delay);
+    }
+  return n + 1;
+}
+@end
+
+@interface	Client : NSObject
+{
+@public
+  id<Service>	proxy;
+  NSCondition	*done;
+  int		calls;
+  int		running;
+  int		errors;
+}
+- (void) run: (id)ignored;
+@end
+
+@implementation	Client
+- (void) run: (id)ignored
+{
+  CREATE_AUTORELEASE_POOL(pool);
+  int	bad = 0;
+  int	i;
+
+  for (i = 0; i < calls; i++)
+    {
+      if ([proxy work: i] != i + 1)
+	{
+	  bad++;
+	}
+    }
+  [done lock];
+  errors += bad;
+  running--;
+  [done signal];
+  [done unlock];
+  DESTROY(pool);
+}
+@end
+
+/* The client delegate supplies empty authentication data for each
+ * request, so that the server delegate gets to count the size of the
+ * messages it receives.  Neither end authenticates replies.
+ */
+@interface	ClientMeter : NSObject
+@end
+
+@implementation	ClientMeter
+- (NSData*) authenticationDataForComponents: (NSMutableArray*)components
+{
+  return [NSData data];
+}
+@end
+
+@interface	ServerMeter : NSObject
+{
+@public
+  unsigned long long	bytes;
+  unsigned long long	messages;
+}
+@end
+
+@implementation	ServerMeter
+- (BOOL) authenticateComponents: (NSMutableArray*)components
+		       withData: (NSData*)authenticationData
+{
+  NSUInteger	i = [components count];
+
+  while (i-- > 0)
+    {
+      id	o = [components objectAtIndex: i];
+
+      if ([o isKindOfClass: [NSData class]])
+	{
+	  bytes += [o length];
+	}
+    }
+  messages++;
+  return YES;
+}
+
+- (BOOL) connection: (NSConnection*)parent
+  shouldMakeNewConnection: (NSConnection*)child
+{
+  [child setDelegate: self];
+  return YES;
+}
+@end
+
+static void
+measure(int threads, int calls, useconds_t delay, BOOL workers)
+{
+  CREATE_AUTORELEASE_POOL(pool);
+  Server	*server = [[Server new] autorelease];
+  NSSocketPort	*serverPort = [[NSSocketPort new] autorelease];
+  NSSocketPort	*clientPort = [[NSSocketPort new] autorelease];
+  NSConnection	*s;
+  NSConnection	*c;
+  Client	*client = [[Client new] autorelease];
+  ClientMeter	*clientMeter = [[ClientMeter new] autorelease];
+  ServerMeter	*serverMeter = [[ServerMeter new] autorelease];
+  NSDate	*start;
+  double	t;
+  int		i;
+
+  server->delay = delay;
+  s = [[NSConnection alloc] initWithReceivePort: serverPort sendPort: nil];
+  [s setRootObject: server];
+  [s setDelegate: serverMeter];
+  c = [[NSConnection alloc] initWithReceivePort: clientPort
+				       sendPort: serverPort];
+  [c setDelegate: clientMeter];
+  if (YES == workers)
+    {
+      [s setRequestWorkers: threads];
+      [c setRequestWorkers: 1];
+    }
+  else
+    {
+      [s enableMultipleThreads];
+      [s runInNewThread];
+      [c enableMultipleThreads];
+    }
+
+  client->proxy = (id<Service>)[c rootProxy];
+  [(NSDistantObject*)client->proxy setProtocolForProxy: @protocol(Service)];
+  client->done = [[NSCondition new] autorelease];
+  client->calls = calls;
+  client->running = threads;
+
+  start = [NSDate date];
+  for (i = 0; i < threads; i++)
+    {
+      [NSThread detachNewThreadSelector: @selector(run:)
+			       toTarget: client
+			     withObject: nil];
+    }
+  [client->done lock];
+  while (client->running > 0)
+    {
+      [client->done wait];
+    }
+  [client->done unlock];
+  t = -[start timeIntervalSinceNow];
+
+  printf("%-12s %d threads  %d calls  %8.3f s  %10.0f calls/s"
+    "  %5.1f bytes/request  %d errors\n",
+    workers ? "workers" : "run loop", threads, threads * calls, t,
+    threads * calls / t,
+    serverMeter->messages ? (double)serverMeter->bytes / serverMeter->messages
+    : 0.0, client->errors);
+
+  [c invalidate];
+  [s invalidate];
+  [c release];
+  [s release];
+  DESTROY(pool);
+}
+
+int
+main(int argc, char **argv)
+{
+  CREATE_AUTORELEASE_POOL(pool);
+  int		threads = (argc > 1) ? atoi(argv[1]) : 8;
+  int		calls = (argc > 2) ? atoi(argv[2]) : 1000;
+  useconds_t	delay = (argc > 3) ? atoi(argv[3]) : 200;
+
+  measure(threads, calls, delay, NO);
+  measure(threads, calls, delay, YES);
+  DESTROY(pool);
+  return 0;
+}
@@ -0,0 +1,198 @@
+/* Benchmark for copying files and sending them through file handles.
+
+  Copyright (C) 2026 Free Software Foundation
+
+  Copying and distribution of this file, with or without modification,
+  are permitted in any medium without royalty provided the copyright
+  notice and this notice are preserved.
+
+  Creates a file of M megabytes (default 512) in directory D (default
+  the temporary directory), then reports the throughput of copying it
+  with a read()/write() loop through an 8KB buffer (as NSFileManager
+  used to) and with -copyItemAtPath:toPath:error:, which lets the
+  kernel copy or share the data.  It then sends the file through a pipe
+  to a thread which discards it, first by reading the file into NSData
+  and writing that, then with a background transfer from one file
+  handle to the other.
+  Run as 'file_copy_benchmark M D' to choose the parameters. */
+
+#include <Foundation/Foundation.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+@interface	Drain : NSObject
+{
+@public
+  int			fd;
+  unsigned long long	total;
+  NSCondition		*done;
+  BOOL			finished;
+}
+- (void) run: (id)ignored;
+@end
+
+@implementation	Drain
+- (void) run: (id)ignored
+{
+  char		buf[65536];
+  ssize_t	got;
+
+  while ((got = read(fd, buf, sizeof(buf))) > 0)
+    {
+      total += got;
+    }
+  [done lock];
+  finished = YES;
+  [done signal];
+  [done unlock];
+}
+@end
+
+@interface	Waiter : NSObject
+{
+@public
+  BOOL	written;
+}
+- (void) written: (NSNotification*)n;
+@end
+
+@implementation	Waiter
+- (void) written: (NSNotification*)n
+{
+  written = YES;
+}
+@end
+
+static void
+report(const char *label, NSDate *start, unsigned long long bytes)
+{
+  double	t = -[start timeIntervalSinceNow];
+
+  printf("%-24s %8.3f s  %8.1f MB/s\n", label, t,
+    bytes / t / (1024.0 * 1024.0));
+}
+
+static void
+bufferCopy(NSString *from, NSString *to)
+{
+  char	buf[8096];
+  int	in = open([from fileSystemRepresentation], O_RDONLY);
+  int	out = open([to fileSystemRepresentation],
+    O_WRONLY|O_CREAT|O_TRUNC, 0644);
+  int	got;
+
+  while ((got = read(in, buf, sizeof(buf))) > 0)
+    {
+      if (write(out, buf, got) != got)
+	{
+	  break;
+	}
+    }
+  close(in);
+  close(out);
+}
+
+static void
+sendFile(NSString *path, unsigned long long size, BOOL transfer)
+{
+  CREATE_AUTORELEASE_POOL(pool);
+  NSPipe	*pipe = [NSPipe pipe];
+  NSFileHandle	*out = [pipe fileHandleForWriting];
+  Drain		*drain = [[Drain new] autorelease];
+  NSDate	*start;
+
+  drain->fd = [[pipe fileHandleForReading] fileDescriptor];
+  drain->done = [[NSCondition new] autorelease];
+  [NSThread detachNewThreadSelector: @selector(run:)
+			   toTarget: drain
+			 withObject: nil];
+
+  start = [NSDate date];
+  if (YES == transfer)
+    {
+      NSFileHandle	*in = [NSFileHandle fileHandleForReadingAtPath: path];
+      Waiter		*w = [[Waiter new] autorelease];
+
+      [[NSNotificationCenter defaultCenter]
+	addObserver: w
+	   selector: @selector(written:)
+	       name: GSFileHandleWriteCompletionNotification
+	     object: out];
+      [out writeInBackgroundAndNotifyFromFileHandle: in
+					     offset: 0
+					     length: size];
+      while (NO == w->written)
+	{
+	  [[NSRunLoop currentRunLoop] runMode: NSDefaultRunLoopMode
+				   beforeDate: [NSDate distantFuture]];
+	}
+      [[NSNotificationCenter defaultCenter] removeObserver: w];
+    }
+  else
+    {
+      [out writeData: [NSData dataWithContentsOfFile: path]];
+    }
+  [out closeFile];
+  [drain->done lock];
+  while (NO == drain->finished)
+    {
+      [drain->done wait];
+    }
+  [drain->done unlock];
+  report(transfer ? "send by transfer" : "send through NSData", start,
+    drain->total);
+  DESTROY(pool);
+}
+
+int
+main(int argc, char **argv)
+{
+  CREATE_AUTORELEASE_POOL(pool);
+  NSFileManager		*mgr = [NSFileManager defaultManager];
+  unsigned long long	megabytes = (argc > 1) ? atoi(argv[1]) : 512;
+  NSString		*dir;
+  NSString		*src;
+  NSString		*dst;
+  NSMutableData		*block;
+  NSFileHandle		*fh;
+  unsigned long long	size = megabytes * 1024 * 1024;
+  unsigned long long	i;
+  NSDate		*start;
+
+  dir = (argc > 2) ? [NSString stringWithUTF8String: argv[2]]
+    : NSTemporaryDirectory();
+  src = [dir stringByAppendingPathComponent: @"file_copy_benchmark.src"];
+  dst = [dir stringByAppendingPathComponent: @"file_copy_benchmark.dst"];
+
+  block = [NSMutableData dataWithLength: 1024 * 1024];
+  for (i = 0; i < [block length]; i++)
+    {
+      ((uint8_t*)[block mutableBytes])[i] = (uint8_t)(i * 7);
+    }
+  [mgr createFileAtPath: src contents: nil attributes: nil];
+  fh = [NSFileHandle fileHandleForWritingAtPath: src];
+  for (i = 0; i < megabytes; i++)
+    {
+      [fh writeData: block];
+    }
+  [fh synchronizeFile];
+  [fh closeFile];
+
+  start = [NSDate date];
+  bufferCopy(src, dst);
+  report("copy with 8KB buffer", start, size);
+  [mgr removeItemAtPath: dst error: NULL];
+
+  start = [NSDate date];
+  [mgr copyItemAtPath: src toPath: dst error: NULL];
+  report("copyItemAtPath:", start, size);
+  [mgr removeItemAtPath: dst error: NULL];
+
+  sendFile(src, size, NO);
+  sendFile(src, size, YES);
+
+  [mgr removeItemAtPath: src error: NULL];
+  DESTROY(pool);
+  return 0;
+}
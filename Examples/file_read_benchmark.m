@@ -0,0 +1,176 @@
+/* Benchmark for reading files and pipes through NSFileHandle.
+
+  Copyright (C) 2026 Free Software Foundation
+
+  Copying and distribution of this file, with or without modification,
+  are permitted in any medium without royalty provided the copyright
+  notice and this notice are preserved.
+
+  Creates a file of M megabytes (default 256) in directory D (default
+  the temporary directory), then reports the throughput of reading it
+  with -readDataToEndOfFile, with -readDataOfLength: in 1MB pieces and
+  with a read() loop into a plain buffer for comparison.  It then
+  reports the throughput of -readDataToEndOfFile and -availableData on
+  a pipe fed by a thread writing the same amount of data.
+  Run as 'file_read_benchmark M D' to choose the parameters. */
+
+#include <Foundation/Foundation.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+@interface	Feeder : NSObject
+{
+@public
+  int			fd;
+  unsigned long long	size;
+}
+- (void) run: (id)ignored;
+@end
+
+@implementation	Feeder
+- (void) run: (id)ignored
+{
+  char			buf[65536];
+  unsigned long long	left = size;
+
+  memset(buf, 'x', sizeof(buf));
+  while (left > 0)
+    {
+      size_t	n = (left < sizeof(buf)) ? left : sizeof(buf);
+      ssize_t	done = write(fd, buf, n);
+
+      if (done <= 0)
+	{
+	  break;
+	}
+      left -= done;
+    }
+  close(fd);
+}
+@end
+
+static void
+report(const char *label, NSDate *start, unsigned long long bytes)
+{
+  double	t = -[start timeIntervalSinceNow];
+
+  printf("%-24s %8.3f s  %8.1f MB/s\n", label, t,
+    bytes / t / (1024.0 * 1024.0));
+}
+
+static NSFileHandle *
+feed(unsigned long long size)
+{
+  NSPipe	*pipe = [NSPipe pipe];
+  Feeder	*feeder = [[Feeder new] autorelease];
+
+  /* The feeder closes its own descriptor, so the handle must not.
+   */
+  feeder->fd = dup([[pipe fileHandleForWriting] fileDescriptor]);
+  feeder->size = size;
+  [[pipe fileHandleForWriting] closeFile];
+  [NSThread detachNewThreadSelector: @selector(run:)
+			   toTarget: feeder
+			 withObject: nil];
+  return [pipe fileHandleForReading];
+}
+
+int
+main(int argc, char **argv)
+{
+  CREATE_AUTORELEASE_POOL(pool);
+  NSFileManager		*mgr = [NSFileManager defaultManager];
+  unsigned long long	megabytes = (argc > 1) ? atoi(argv[1]) : 256;
+  unsigned long long	size = megabytes * 1024 * 1024;
+  unsigned long long	total;
+  unsigned long long	i;
+  NSString		*dir;
+  NSString		*src;
+  NSMutableData		*block;
+  NSFileHandle		*fh;
+  NSDate		*start;
+  char			*buf;
+  int			fd;
+  ssize_t		got;
+
+  dir = (argc > 2) ? [NSString stringWithUTF8String: argv[2]]
+    : NSTemporaryDirectory();
+  src = [dir stringByAppendingPathComponent: @"file_read_benchmark.src"];
+
+  block = [NSMutableData dataWithLength: 1024 * 1024];
+  for (i = 0; i < [block length]; i++)
+    {
+      ((uint8_t*)[block mutableBytes])[i] = (uint8_t)(i * 7);
+    }
+  [mgr createFileAtPath: src contents: nil attributes: nil];
+  fh = [NSFileHandle fileHandleForWritingAtPath: src];
+  for (i = 0; i < megabytes; i++)
+    {
+      [fh writeData: block];
+    }
+  [fh synchronizeFile];
+  [fh closeFile];
+
+  buf = malloc(1024 * 1024);
+  start = [NSDate date];
+  fd = open([src fileSystemRepresentation], O_RDONLY);
+  total = 0;
+  while ((got = read(fd, buf, 1024 * 1024)) > 0)
+    {
+      total += got;
+    }
+  close(fd);
+  report("read() into a buffer", start, total);
+  free(buf);
+
+  start = [NSDate date];
+  fh = [NSFileHandle fileHandleForReadingAtPath: src];
+  total = [[fh readDataToEndOfFile] length];
+  [fh closeFile];
+  report("file to end", start, total);
+
+  start = [NSDate date];
+  fh = [NSFileHandle fileHandleForReadingAtPath: src];
+  total = 0;
+  for (;;)
+    {
+      CREATE_AUTORELEASE_POOL(inner);
+      NSUInteger	len = [[fh readDataOfLength: 1024 * 1024] length];
+
+      DESTROY(inner);
+      if (0 == len)
+	{
+	  break;
+	}
+      total += len;
+    }
+  [fh closeFile];
+  report("file in 1MB pieces", start, total);
+
+  start = [NSDate date];
+  fh = feed(size);
+  total = [[fh readDataToEndOfFile] length];
+  report("pipe to end", start, total);
+
+  start = [NSDate date];
+  fh = feed(size);
+  total = 0;
+  for (;;)
+    {
+      CREATE_AUTORELEASE_POOL(inner);
+      NSUInteger	len = [[fh availableData] length];
+
+      DESTROY(inner);
+      if (0 == len)
+	{
+	  break;
+	}
+      total += len;
+    }
+  report("pipe availableData", start, total);
+
+  [mgr removeItemAtPath: src error: NULL];
+  DESTROY(pool);
+  return 0;
+}
@@ -0,0 +1,112 @@
+/* Benchmark for parsing HTTP headers with GSMimeParser.
+
+  Copyright (C) 2026 Free Software Foundation
+
+  Copying and distribution of this file, with or without modification,
+  are permitted in any medium without royalty provided the copyright
+  notice and this notice are preserved.
+
+  Parses a typical browser request header block and a typical server
+  response header block N times each (default 100000), using a new
+  parser for every block as a web server or client would, and reports
+  the headers parsed per second.  The blocks are given to the parser in
+  pieces of C bytes (default 0, meaning all at once) to show the cost
+  of headers split across reads.
+  Run as 'http_header_benchmark N C' to choose the parameters. */
+
+#include <Foundation/Foundation.h>
+#include <GNUstepBase/GSMime.h>
+#include <stdio.h>
+
+static const char *request =
+  "Host: www.example.com\r\n"
+  "User-Agent: Mozilla/5.0 (X11; Linux x86_64; rv:120.0) Gecko/20100101\r\n"
+  "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8\r\n"
+  "Accept-Language: en-GB,en;q=0.5\r\n"
+  "Accept-Encoding: gzip, deflate, br\r\n"
+  "Referer: https://www.example.com/index.html\r\n"
+  "Connection: keep-alive\r\n"
+  "Cookie: session=0123456789abcdef; theme=dark; lang=en\r\n"
+  "Upgrade-Insecure-Requests: 1\r\n"
+  "If-Modified-Since: Mon, 19 Oct 2026 10:00:00 GMT\r\n"
+  "If-None-Match: \"5f3c-1a2b3c4d\"\r\n"
+  "Cache-Control: max-age=0\r\n"
+  "\r\n";
+
+static const char *response =
+  "HTTP/1.1 200 OK\r\n"
+  "Date: Mon, 19 Oct 2026 10:00:00 GMT\r\n"
+  "Server: Apache/2.4.58 (Unix)\r\n"
+  "Last-Modified: Sun, 18 Oct 2026 09:00:00 GMT\r\n"
+  "ETag: \"5f3c-1a2b3c4d\"\r\n"
+  "Accept-Ranges: bytes\r\n"
+  "Content-Length: 0\r\n"
+  "Cache-Control: public, max-age=3600\r\n"
+  "Expires: Mon, 19 Oct 2026 11:00:00 GMT\r\n"
+  "Vary: Accept-Encoding\r\n"
+  "Set-Cookie: session=0123456789abcdef; Path=/; HttpOnly\r\n"
+  "X-Frame-Options: SAMEORIGIN\r\n"
+  "Connection: keep-alive\r\n"
+  "\r\n";
+
+static void
+run(const char *label, const char *text, unsigned count, unsigned chunk)
+{
+  NSData	*data;
+  NSDate	*start;
+  NSUInteger	length = strlen(text);
+  NSUInteger	headers = 0;
+  double	t;
+  unsigned	i;
+
+  data = [NSData dataWithBytes: text length: length];
+  if (0 == chunk || chunk > length)
+    {
+      chunk = length;
+    }
+  start = [NSDate date];
+  for (i = 0; i < count; i++)
+    {
+      CREATE_AUTORELEASE_POOL(arp);
+      GSMimeParser	*parser = [GSMimeParser new];
+      NSUInteger	pos = 0;
+
+      [parser setIsHttp];
+      [parser setHeadersOnly];
+      while (pos < length)
+	{
+	  NSUInteger	len = length - pos;
+	  NSData	*d;
+
+	  if (len > chunk)
+	    {
+	      len = chunk;
+	    }
+	  d = [data subdataWithRange: NSMakeRange(pos, len)];
+	  pos += len;
+	  if (NO == [parser parse: d])
+	    {
+	      break;
+	    }
+	}
+      headers += [[[parser mimeDocument] allHeaders] count];
+      RELEASE(parser);
+      DESTROY(arp);
+    }
+  t = -[start timeIntervalSinceNow];
+  printf("%-10s %8.3f s  %10.0f headers/s  %8.0f blocks/s\n", label, t,
+    headers / t, count / t);
+}
+
+int
+main(int argc, char **argv)
+{
+  CREATE_AUTORELEASE_POOL(pool);
+  unsigned	count = (argc > 1) ? atoi(argv[1]) : 100000;
+  unsigned	chunk = (argc > 2) ? atoi(argv[2]) : 0;
+
+  run("request", request, count, chunk);
+  run("response", response, count, chunk);
+  DESTROY(pool);
+  return 0;
+}
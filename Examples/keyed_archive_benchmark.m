@@ -0,0 +1,201 @@
+/* Benchmark for keyed archiving and unarchiving of large object graphs.
+
+  Copyright (C) 2026 Free Software Foundation
+
+  Copying and distribution of this file, with or without modification,
+  are permitted in any medium without royalty provided the copyright
+  notice and this notice are preserved.
+
+  Builds a graph of N model objects (default 100000) and reports the
+  time, archive size and memory used to archive it with NSKeyedArchiver,
+  then the time to open the archive and to unarchive the whole graph.
+  Run as 'keyed_archive_benchmark archive N' to archive into a temporary
+  file and then as 'keyed_archive_benchmark unarchive' to read that file,
+  so that the peak memory figures for each direction are not mixed. */
+
+#include <Foundation/Foundation.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+#define	ENTRIES	100000
+
+@interface	Item : NSObject <NSCoding>
+{
+  NSString	*name;
+  NSArray	*tags;
+  Item		*parent;
+  double	price;
+  int		number;
+}
+- (id) initWithNumber: (int)n parent: (Item*)p;
+@end
+
+@implementation	Item
+- (void) dealloc
+{
+  [name release];
+  [tags release];
+  [parent release];
+  [super dealloc];
+}
+
+- (void) encodeWithCoder: (NSCoder*)aCoder
+{
+  [aCoder encodeObject: name forKey: @"name"];
+  [aCoder encodeObject: tags forKey: @"tags"];
+  [aCoder encodeConditionalObject: parent forKey: @"parent"];
+  [aCoder encodeDouble: price forKey: @"price"];
+  [aCoder encodeInt: number forKey: @"number"];
+}
+
+- (id) initWithCoder: (NSCoder*)aCoder
+{
+  name = [[aCoder decodeObjectForKey: @"name"] retain];
+  tags = [[aCoder decodeObjectForKey: @"tags"] retain];
+  parent = [[aCoder decodeObjectForKey: @"parent"] retain];
+  price = [aCoder decodeDoubleForKey: @"price"];
+  number = [aCoder decodeIntForKey: @"number"];
+  return self;
+}
+
+- (id) initWithNumber: (int)n parent: (Item*)p
+{
+  name = [[NSString alloc] initWithFormat: @"Item number %d", n];
+  tags = [[NSArray alloc] initWithObjects: @"red", @"green",
+    [NSString stringWithFormat: @"tag%d", n % 97], nil];
+  parent = [p retain];
+  price = n * 0.25;
+  number = n;
+  return self;
+}
+@end
+
+static unsigned long
+residentKB()
+{
+  unsigned long	size = 0;
+  unsigned long	resident = 0;
+  FILE		*f = fopen("/proc/self/statm", "r");
+
+  if (f != 0)
+    {
+      if (fscanf(f, "%lu %lu", &size, &resident) != 2)
+	{
+	  resident = 0;
+	}
+      fclose(f);
+    }
+  return resident * (getpagesize() / 1024);
+}
+
+static unsigned long
+peakKB()
+{
+  struct rusage	usage;
+
+  getrusage(RUSAGE_SELF, &usage);
+  return (unsigned long)usage.ru_maxrss;
+}
+
+static NSArray *
+makeGraph(int entries)
+{
+  NSMutableArray	*graph;
+  Item			*root;
+  int			i;
+
+  graph = [NSMutableArray arrayWithCapacity: entries];
+  root = [[[Item alloc] initWithNumber: 0 parent: nil] autorelease];
+  [graph addObject: root];
+  for (i = 1; i < entries; i++)
+    {
+      Item	*item;
+
+      item = [[Item alloc] initWithNumber: i
+				   parent: [graph objectAtIndex: i / 10]];
+      [graph addObject: item];
+      [item release];
+    }
+  return graph;
+}
+
+static NSData *
+archive(NSArray *graph)
+{
+  CREATE_AUTORELEASE_POOL(pool);
+  unsigned long	before = residentKB();
+  NSDate	*start = [NSDate date];
+  NSData	*data;
+
+  data = [NSKeyedArchiver archivedDataWithRootObject: graph];
+  printf("archive   %8.3f s  %lu bytes  RSS +%lu KB  peak %lu KB\n",
+    -[start timeIntervalSinceNow], (unsigned long)[data length],
+    residentKB() - before, peakKB());
+  [data retain];
+  DESTROY(pool);
+  return [data autorelease];
+}
+
+static void
+unarchive(NSData *data)
+{
+  CREATE_AUTORELEASE_POOL(pool);
+  unsigned long		before = residentKB();
+  NSDate		*start = [NSDate date];
+  NSKeyedUnarchiver	*u;
+  NSArray		*graph;
+
+  u = [[NSKeyedUnarchiver alloc] initForReadingWithData: data];
+  [u release];
+  printf("open      %8.3f s\n", -[start timeIntervalSinceNow]);
+
+  start = [NSDate date];
+  graph = [NSKeyedUnarchiver unarchiveObjectWithData: data];
+  printf("unarchive %8.3f s  %lu objects  RSS +%lu KB  peak %lu KB\n",
+    -[start timeIntervalSinceNow], (unsigned long)[graph count],
+    residentKB() - before, peakKB());
+  DESTROY(pool);
+}
+
+int
+main(int argc, char **argv)
+{
+  CREATE_AUTORELEASE_POOL(pool);
+  NSString	*path;
+  NSData	*data;
+
+  path = [NSTemporaryDirectory()
+    stringByAppendingPathComponent: @"keyed_archive_benchmark.archive"];
+  if (argc > 1 && strcmp(argv[1], "unarchive") == 0)
+    {
+      data = [NSData dataWithContentsOfFile: path];
+      if (nil == data)
+	{
+	  printf("run 'keyed_archive_benchmark archive' first\n");
+	}
+      else
+	{
+	  unarchive(data);
+	  [[NSFileManager defaultManager] removeItemAtPath: path error: NULL];
+	}
+    }
+  else
+    {
+      int	entries = (argc > 2) ? atoi(argv[2]) : ENTRIES;
+      NSArray	*graph = makeGraph(entries);
+
+      printf("graph of %d objects, RSS %lu KB\n", entries, residentKB());
+      data = archive(graph);
+      if (argc > 1 && strcmp(argv[1], "archive") == 0)
+	{
+	  [data writeToFile: path atomically: YES];
+	}
+      else
+	{
+	  unarchive(data);
+	}
+    }
+  DESTROY(pool);
+  return 0;
+}
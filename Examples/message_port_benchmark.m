@@ -0,0 +1,180 @@
+/* Benchmark for large data passed between processes with NSMessagePort.
+
+  Copyright (C) 2026 Free Software Foundation
+
+  Copying and distribution of this file, with or without modification,
+  are permitted in any medium without royalty provided the copyright
+  notice and this notice are preserved.
+
+  Starts a copy of itself as a server process, registered with the
+  message port name server, and sends it NSData arguments of sizes from
+  1KB to 16MB, first one way and then echoed back.  Reports the time per
+  call and the throughput for each size.
+  Run as 'message_port_benchmark -GSMessagePortSharedMemory 0' to have
+  both processes copy all data through the socket, for comparison with
+  the default, which passes large data in shared memory. */
+
+#include <Foundation/Foundation.h>
+#include <stdio.h>
+
+#define	SERVICE	@"MessagePortBenchmark"
+
+@protocol	Sink
+- (unsigned) consume: (NSData*)d;
+- (NSData*) echo: (NSData*)d;
+@end
+
+@interface	Sink : NSObject <Sink>
+@end
+
+@implementation	Sink
+- (unsigned) consume: (NSData*)d
+{
+  const unsigned char	*b = [d bytes];
+  NSUInteger		l = [d length];
+  unsigned		s = 0;
+  NSUInteger		i;
+
+  /* Touch one byte in each page, as a real consumer would read it.
+   */
+  for (i = 0; i < l; i += 4096)
+    {
+      s += b[i];
+    }
+  return s;
+}
+
+- (NSData*) echo: (NSData*)d
+{
+  return d;
+}
+@end
+
+static int
+serve(NSString *name)
+{
+  NSMessagePort	*port = [[NSMessagePort new] autorelease];
+  NSConnection	*c;
+
+  c = [[NSConnection alloc] initWithReceivePort: port sendPort: nil];
+  [c setRootObject: [[Sink new] autorelease]];
+  if ([[NSMessagePortNameServer sharedInstance] registerPort: port
+						     forName: name] == NO)
+    {
+      fprintf(stderr, "unable to register %s\n", [name UTF8String]);
+      return 1;
+    }
+  [[NSRunLoop currentRunLoop] run];
+  return 0;
+}
+
+static void
+measure(id<Sink> proxy, NSUInteger size, BOOL echo)
+{
+  CREATE_AUTORELEASE_POOL(pool);
+  NSMutableData	*d = [NSMutableData dataWithLength: size];
+  NSUInteger	calls = (256 * 1024 * 1024) / size;
+  NSDate	*start;
+  NSUInteger	i;
+  double	t;
+
+  memset([d mutableBytes], 'x', size);
+  if (calls < 20)
+    {
+      calls = 20;
+    }
+  if (calls > 20000)
+    {
+      calls = 20000;
+    }
+  start = [NSDate date];
+  for (i = 0; i < calls; i++)
+    {
+      CREATE_AUTORELEASE_POOL(arp);
+
+      if (YES == echo)
+	{
+	  [proxy echo: d];
+	}
+      else
+	{
+	  [proxy consume: d];
+	}
+      DESTROY(arp);
+    }
+  t = -[start timeIntervalSinceNow];
+  printf("%-8s %9lu bytes  %6lu calls  %10.1f us/call  %9.1f MB/s\n",
+    echo ? "echo" : "consume", (unsigned long)size, (unsigned long)calls,
+    t * 1000000.0 / calls,
+    (echo ? 2.0 : 1.0) * size * calls / t / (1024.0 * 1024.0));
+  DESTROY(pool);
+}
+
+int
+main(int argc, char **argv)
+{
+  CREATE_AUTORELEASE_POOL(pool);
+  NSProcessInfo		*info = [NSProcessInfo processInfo];
+  NSArray		*args = [info arguments];
+  NSString		*name;
+  NSMutableArray	*serverArgs;
+  NSTask		*task;
+  NSConnection		*c;
+  NSPort		*port = nil;
+  id<Sink>		proxy;
+  NSUInteger		size;
+  int			i;
+
+  if ([args count] > 2 && [[args objectAtIndex: 1] isEqual: @"server"])
+    {
+      int	status = serve([args objectAtIndex: 2]);
+
+      DESTROY(pool);
+      return status;
+    }
+
+  /* Pass any other arguments (such as user defaults) on to the server.
+   */
+  name = [NSString stringWithFormat: @"%@%d",
+    SERVICE, [info processIdentifier]];
+  serverArgs = [NSMutableArray arrayWithObjects: @"server", name, nil];
+  [serverArgs addObjectsFromArray:
+    [args subarrayWithRange: NSMakeRange(1, [args count] - 1)]];
+  task = [NSTask launchedTaskWithLaunchPath:
+    [[NSBundle mainBundle] executablePath] arguments: serverArgs];
+  for (i = 0; i < 100 && port == nil; i++)
+    {
+      [NSThread sleepForTimeInterval: 0.1];
+      port = [[NSMessagePortNameServer sharedInstance] portForName: name];
+    }
+  if (port == nil)
+    {
+      fprintf(stderr, "server did not start\n");
+      [task terminate];
+      return 1;
+    }
+
+  c = [[NSConnection alloc]
+    initWithReceivePort: [[NSMessagePort new] autorelease]
+	       sendPort: port];
+  [c setRequestTimeout: 60.0];
+  [c setReplyTimeout: 60.0];
+  proxy = (id<Sink>)[c rootProxy];
+  [(NSDistantObject*)proxy setProtocolForProxy: @protocol(Sink)];
+
+  for (size = 1024; size <= 16 * 1024 * 1024; size *= 4)
+    {
+      measure(proxy, size, NO);
+    }
+  for (size = 1024; size <= 16 * 1024 * 1024; size *= 4)
+    {
+      measure(proxy, size, YES);
+    }
+
+  [c invalidate];
+  [c release];
+  [task terminate];
+  [task waitUntilExit];
+  DESTROY(pool);
+  return 0;
+}
@@ -0,0 +1,155 @@
+/* Benchmark for parsing large multipart MIME bodies with GSMimeParser.
+
+  Copyright (C) 2026 Free Software Foundation
+
+  Copying and distribution of this file, with or without modification,
+  are permitted in any medium without royalty provided the copyright
+  notice and this notice are preserved.
+
+  Feeds a multipart/form-data body of P parts (default 4) holding M
+  megabytes (default 2048) of base64 encoded data in total to a parser
+  in 64KB pieces, as it would arrive from the network, with a delegate
+  taking the decoded data as it is streamed.  It reports the rate at
+  which data was parsed and the peak memory use of the process, which
+  should stay small however large the body is.  The same is then done
+  without streaming for at most 256 megabytes (to stay within memory),
+  followed by the rates of +encodeBase64: and +decodeBase64:.
+  Run as 'mime_stream_benchmark M P' to choose the parameters. */
+
+#include <Foundation/Foundation.h>
+#include <GNUstepBase/GSMime.h>
+#include <stdio.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+@interface	Sink : NSObject
+{
+@public
+  BOOL			stream;
+  unsigned long long	decoded;
+}
+@end
+
+@implementation	Sink
+- (BOOL) mimeParser: (GSMimeParser*)parser
+  shouldStreamDocument: (GSMimeDocument*)doc
+{
+  return stream;
+}
+
+- (void) mimeParser: (GSMimeParser*)parser
+	   document: (GSMimeDocument*)doc
+	decodedData: (NSData*)data
+{
+  decoded += [data length];
+}
+@end
+
+static void
+report(const char *label, NSDate *start, unsigned long long bytes)
+{
+  double	t = -[start timeIntervalSinceNow];
+  struct rusage	u;
+
+  getrusage(RUSAGE_SELF, &u);
+  printf("%-10s %8.3f s  %8.1f MB/s  peak %ld MB\n", label, t,
+    bytes / t / (1024.0 * 1024.0), (long)(u.ru_maxrss / 1024));
+}
+
+static void
+run(const char *label, unsigned megabytes, unsigned parts, BOOL stream)
+{
+  CREATE_AUTORELEASE_POOL(pool);
+  Sink			*sink = [[Sink new] autorelease];
+  GSMimeParser		*parser = [GSMimeParser mimeParser];
+  NSMutableData		*block;
+  NSMutableData		*line;
+  NSData		*raw;
+  NSData		*piece;
+  NSDate		*start;
+  unsigned long long	total = 0;
+  unsigned long long	perPart;
+  unsigned		i;
+
+  /* One 64KB block of base64 lines (840 lines of 76 characters).
+   */
+  block = [NSMutableData dataWithCapacity: 65520];
+  line = [NSMutableData dataWithLength: 57];
+  for (i = 0; i < 57; i++)
+    {
+      ((unsigned char*)[line mutableBytes])[i] = i * 37;
+    }
+  raw = [GSMimeDocument encodeBase64: line];
+  for (i = 0; i < 840; i++)
+    {
+      [block appendData: raw];
+      [block appendBytes: "\r\n" length: 2];
+    }
+  perPart = ((unsigned long long)megabytes * 1024 * 1024 / parts)
+    / [block length] + 1;
+
+  sink->stream = stream;
+  [parser setDelegate: sink];
+  piece = [@"Content-Type: multipart/form-data; boundary=XyZzYbOuNdArY\r\n"
+    @"\r\n" dataUsingEncoding: NSASCIIStringEncoding];
+  start = [NSDate date];
+  [parser parse: piece];
+  for (i = 0; i < parts; i++)
+    {
+      unsigned long long	n;
+
+      piece = [[NSString stringWithFormat: @"--XyZzYbOuNdArY\r\n"
+	@"Content-Disposition: form-data; name=\"f%u\"; filename=\"f%u\"\r\n"
+	@"Content-Type: application/octet-stream\r\n"
+	@"Content-Transfer-Encoding: base64\r\n"
+	@"\r\n", i, i] dataUsingEncoding: NSASCIIStringEncoding];
+      [parser parse: piece];
+      for (n = 0; n < perPart; n++)
+	{
+	  [parser parse: block];
+	  total += [block length];
+	}
+      [parser parse: [NSData dataWithBytes: "\r\n" length: 2]];
+    }
+  piece = [@"--XyZzYbOuNdArY--\r\n" dataUsingEncoding: NSASCIIStringEncoding];
+  [parser parse: piece];
+  report(label, start, total);
+  if (NO == [parser isComplete])
+    {
+      printf("parse failed\n");
+    }
+  DESTROY(pool);
+}
+
+int
+main(int argc, char **argv)
+{
+  CREATE_AUTORELEASE_POOL(pool);
+  unsigned	megabytes = (argc > 1) ? atoi(argv[1]) : 2048;
+  unsigned	parts = (argc > 2) ? atoi(argv[2]) : 4;
+  NSMutableData	*data;
+  NSData	*encoded;
+  NSDate	*start;
+  unsigned	i;
+
+  if (parts == 0)
+    {
+      parts = 1;
+    }
+  run("streamed", megabytes, parts, YES);
+  run("buffered", megabytes > 256 ? 256 : megabytes, parts, NO);
+
+  data = [NSMutableData dataWithLength: 64 * 1024 * 1024];
+  for (i = 0; i < [data length]; i += 4096)
+    {
+      ((unsigned char*)[data mutableBytes])[i] = i / 4096;
+    }
+  start = [NSDate date];
+  encoded = [GSMimeDocument encodeBase64: data];
+  report("encode", start, [data length]);
+  start = [NSDate date];
+  [GSMimeDocument decodeBase64: encoded];
+  report("decode", start, [encoded length]);
+  DESTROY(pool);
+  return 0;
+}
@@ -347,7 +347,8 @@ int
 con_benchmark (id prx)
 {
   int i;
-  NSDate	  *d = [NSDate date];
+  NSDate	  *d;
+  NSTimeInterval t;
   NSMutableData *sen = [NSMutableData data];
   id localObj;
   id rep;
@@ -359,6 +360,7 @@ con_benchmark (id prx)
 
   localObj = [[NSObject alloc] init];
   [prx addObject: localObj];  // FIXME: Why is this needed?
+  d = [NSDate date];
   for (i = 0; i < 10000; i++)
     {
 #if 0
@@ -370,8 +372,19 @@ con_benchmark (id prx)
 #endif
       [prx echoObject: localObj];
     }
+  t = -[d timeIntervalSinceNow];
+  printf("  %d small round trips in %f seconds (%.0f per second)\n",
+    i, t, i / t);
 
-  printf("  Delay is %f\n", [d timeIntervalSinceNow]);
+  [sen setLength: 1024 * 1024];
+  d = [NSDate date];
+  for (i = 0; i < 100; i++)
+    {
+      [prx sendObject: sen];
+    }
+  t = -[d timeIntervalSinceNow];
+  printf("  %d round trips of 1MB in %f seconds (%.1f MB per second)\n",
+    i, t, 2 * i / t);
   printf("Done\n");
   return 0;
 }
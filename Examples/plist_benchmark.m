@@ -0,0 +1,207 @@
+/* Benchmark for lazy reading of large binary property lists.
+
+  Copyright (C) 2026 Free Software Foundation
+
+  Copying and distribution of this file, with or without modification,
+  are permitted in any medium without royalty provided the copyright
+  notice and this notice are preserved.
+
+  Writes a large binary property list catalog, then compares the time
+  and resident memory needed to open it and look up a few entries
+  using the eager parser and the lazy mapped file reader.
+  Run as 'plist_benchmark eager' or 'plist_benchmark lazy' to measure
+  one reader on its own, so that the memory figures are not mixed.
+  Run as 'plist_benchmark write N' to compare writing a catalog of N
+  entries to a stream with building the whole property list in memory
+  (use a large N to produce a multi-gigabyte file). */
+
+#include <Foundation/Foundation.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#define	ENTRIES	200000
+#define	LOOKUPS	1000
+
+static unsigned long
+residentKB()
+{
+  unsigned long	size = 0;
+  unsigned long	resident = 0;
+  FILE		*f = fopen("/proc/self/statm", "r");
+
+  if (f != 0)
+    {
+      if (fscanf(f, "%lu %lu", &size, &resident) != 2)
+	{
+	  resident = 0;
+	}
+      fclose(f);
+    }
+  return resident * (getpagesize() / 1024);
+}
+
+static NSDictionary *
+makeCatalog(int entries)
+{
+  NSMutableDictionary	*catalog;
+  int			i;
+
+  catalog = [NSMutableDictionary dictionaryWithCapacity: entries];
+  for (i = 0; i < entries; i++)
+    {
+      CREATE_AUTORELEASE_POOL(pool);
+      NSDictionary	*entry;
+
+      entry = [NSDictionary dictionaryWithObjectsAndKeys:
+	[NSString stringWithFormat: @"Product number %d", i], @"name",
+	[NSNumber numberWithInt: i * 3], @"price",
+	[NSArray arrayWithObjects: @"red", @"green",
+	  [NSString stringWithFormat: @"tag%d", i % 97], nil], @"tags",
+	nil];
+      [catalog setObject: entry
+		  forKey: [NSString stringWithFormat: @"item%d", i]];
+      DESTROY(pool);
+    }
+  return catalog;
+}
+
+static NSString *
+writeCatalog()
+{
+  CREATE_AUTORELEASE_POOL(pool);
+  NSDictionary	*catalog = makeCatalog(ENTRIES);
+  NSString	*path;
+  NSData	*data;
+
+  path = [NSTemporaryDirectory()
+    stringByAppendingPathComponent: @"plist_benchmark.plist"];
+  data = [NSPropertyListSerialization
+    dataWithPropertyList: catalog
+		  format: NSPropertyListBinaryFormat_v1_0
+		 options: 0
+		   error: 0];
+  [data writeToFile: path atomically: YES];
+  printf("catalog of %d entries, %lu bytes\n",
+    ENTRIES, (unsigned long)[data length]);
+  RETAIN(path);
+  DESTROY(pool);
+  return AUTORELEASE(path);
+}
+
+static void
+lookup(NSDictionary *catalog)
+{
+  int	i;
+
+  for (i = 0; i < LOOKUPS; i++)
+    {
+      NSString	*key;
+
+      key = [NSString stringWithFormat: @"item%d", (i * 7919) % ENTRIES];
+      [[catalog objectForKey: key] objectForKey: @"price"];
+    }
+}
+
+static void
+run(NSString *path, BOOL lazy)
+{
+  CREATE_AUTORELEASE_POOL(pool);
+  unsigned long	before = residentKB();
+  NSDate	*start = [NSDate date];
+  NSDictionary	*catalog;
+  double	opened;
+
+  if (YES == lazy)
+    {
+      catalog = [NSPropertyListSerialization
+	propertyListWithContentsOfMappedFile: path
+				     options: NSPropertyListImmutable
+				      format: 0
+				       error: 0];
+    }
+  else
+    {
+      catalog = [NSPropertyListSerialization
+	propertyListWithData: [NSData dataWithContentsOfFile: path]
+		     options: NSPropertyListImmutable
+		      format: 0
+		       error: 0];
+    }
+  opened = -[start timeIntervalSinceNow];
+  lookup(catalog);
+  printf("%-6s open %8.3f s  open+%d lookups %8.3f s  RSS +%lu KB\n",
+    lazy ? "lazy" : "eager", opened, LOOKUPS, -[start timeIntervalSinceNow],
+    residentKB() - before);
+  DESTROY(pool);
+}
+
+static void
+writeBenchmark(int entries)
+{
+  CREATE_AUTORELEASE_POOL(pool);
+  NSDictionary		*catalog = makeCatalog(entries);
+  NSString		*path;
+  NSOutputStream	*stream;
+  NSData		*data;
+  NSInteger		length;
+  unsigned long		before;
+  NSDate		*start;
+
+  path = [NSTemporaryDirectory()
+    stringByAppendingPathComponent: @"plist_benchmark.plist"];
+
+  before = residentKB();
+  start = [NSDate date];
+  stream = [NSOutputStream outputStreamToFileAtPath: path append: NO];
+  [stream open];
+  length = [NSPropertyListSerialization writePropertyList: catalog
+						toStream: stream
+						  format: NSPropertyListBinaryFormat_v1_0
+						 options: 0
+						   error: 0];
+  [stream close];
+  printf("stream %ld bytes  %8.3f s  RSS +%lu KB\n", (long)length,
+    -[start timeIntervalSinceNow], residentKB() - before);
+
+  before = residentKB();
+  start = [NSDate date];
+  data = [NSPropertyListSerialization
+    dataWithPropertyList: catalog
+		  format: NSPropertyListBinaryFormat_v1_0
+		 options: 0
+		   error: 0];
+  [data writeToFile: path atomically: NO];
+  printf("memory %lu bytes  %8.3f s  RSS +%lu KB\n",
+    (unsigned long)[data length], -[start timeIntervalSinceNow],
+    residentKB() - before);
+
+  [[NSFileManager defaultManager] removeItemAtPath: path error: NULL];
+  DESTROY(pool);
+}
+
+int
+main(int argc, char **argv)
+{
+  CREATE_AUTORELEASE_POOL(pool);
+  NSString	*path;
+
+  if (argc > 1 && strcmp(argv[1], "write") == 0)
+    {
+      writeBenchmark(argc > 2 ? atoi(argv[2]) : ENTRIES);
+      DESTROY(pool);
+      return 0;
+    }
+  path = writeCatalog();
+
+  if (argc < 2 || strcmp(argv[1], "lazy") == 0)
+    {
+      run(path, YES);
+    }
+  if (argc < 2 || strcmp(argv[1], "eager") == 0)
+    {
+      run(path, NO);
+    }
+  [[NSFileManager defaultManager] removeItemAtPath: path error: NULL];
+  DESTROY(pool);
+  return 0;
+}
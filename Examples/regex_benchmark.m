@@ -0,0 +1,96 @@
+/* Benchmark for NSRegularExpression pattern and matcher caching.
+
+  Copyright (C) 2026 Free Software Foundation
+
+  Copying and distribution of this file, with or without modification,
+  are permitted in any medium without royalty provided the copyright
+  notice and this notice are preserved.
+
+  Compares compiling a pattern for every match (the old behaviour of
+  NSString's NSRegularExpressionSearch) with matching repeatedly using
+  one shared expression, for both 8-bit and 16-bit subject strings. */
+
+#include <Foundation/Foundation.h>
+#include <stdio.h>
+
+#define	LOOPS	200000
+
+static void
+report(const char *label, NSDate *start)
+{
+  double	t = -[start timeIntervalSinceNow];
+
+  printf("%-36s %8.3f s  %10.0f matches/s\n", label, t, LOOPS / t);
+}
+
+static void
+run(NSString *subject, const char *kind)
+{
+  CREATE_AUTORELEASE_POOL(pool);
+  NSString		*pattern = @"([0-9]+)-([a-z]+)";
+  NSRange		range = NSMakeRange(0, [subject length]);
+  NSRegularExpression	*shared;
+  NSDate		*start;
+  int			i;
+
+  printf("%s subject:\n", kind);
+
+  start = [NSDate date];
+  for (i = 0; i < LOOPS; i++)
+    {
+      NSRegularExpression	*r;
+
+      r = [[NSRegularExpression alloc] initWithPattern: pattern
+					       options: 0
+						 error: NULL];
+      [r rangeOfFirstMatchInString: subject options: 0 range: range];
+      [r release];
+      if (i % 1000 == 0)
+	{
+	  [pool emptyPool];
+	}
+    }
+  report("  compile per call", start);
+
+  shared = [[NSRegularExpression alloc] initWithPattern: pattern
+						options: 0
+						  error: NULL];
+  start = [NSDate date];
+  for (i = 0; i < LOOPS; i++)
+    {
+      [shared rangeOfFirstMatchInString: subject options: 0 range: range];
+      if (i % 1000 == 0)
+	{
+	  [pool emptyPool];
+	}
+    }
+  report("  shared expression", start);
+  [shared release];
+
+  start = [NSDate date];
+  for (i = 0; i < LOOPS; i++)
+    {
+      [subject rangeOfString: pattern
+		     options: NSRegularExpressionSearch
+		       range: range];
+      if (i % 1000 == 0)
+	{
+	  [pool emptyPool];
+	}
+    }
+  report("  NSRegularExpressionSearch", start);
+
+  DESTROY(pool);
+}
+
+int
+main()
+{
+  CREATE_AUTORELEASE_POOL(pool);
+  unichar	u[] = { 0x4e2d, ' ', 'i', 'd', '=', '4', '2', '-', 'x', 'y' };
+
+  run(@"2026-10-19 12:00:00 request id=4711-abc done", "8-bit");
+  run([NSString stringWithCharacters: u length: 10], "16-bit");
+  DESTROY(pool);
+  return 0;
+}
@@ -0,0 +1,85 @@
+/* Benchmark for editing large mutable strings.
+
+  Copyright (C) 2026 Free Software Foundation
+
+  Copying and distribution of this file, with or without modification,
+  are permitted in any medium without royalty provided the copyright
+  notice and this notice are preserved.
+
+  Measures edits per second for insertions, deletions and replacements
+  at random positions and at sequential positions in strings of a few
+  megabytes, then the time taken for the first contiguous access after
+  the edits (which joins the edited string into a single buffer). */
+
+#include <Foundation/Foundation.h>
+#include <stdio.h>
+
+#define	EDITS	20000
+
+static NSMutableString *
+makeString(NSUInteger size)
+{
+  NSMutableString	*m = [NSMutableString stringWithCapacity: size];
+
+  while ([m length] < size)
+    {
+      [m appendString: @"The quick brown fox jumps over the lazy dog. "];
+    }
+  return m;
+}
+
+static void
+run(NSUInteger size, BOOL sequential, const char *name)
+{
+  CREATE_AUTORELEASE_POOL(pool);
+  NSMutableString	*m = makeString(size);
+  NSDate		*start;
+  NSUInteger		pos = size / 2;
+  int			i;
+
+  srandom(1);
+  start = [NSDate date];
+  for (i = 0; i < EDITS; i++)
+    {
+      NSUInteger	len = [m length];
+
+      if (NO == sequential)
+	{
+	  pos = random() % (len - 8);
+	}
+      switch (i % 3)
+	{
+	  case 0:
+	    [m insertString: @"inserted " atIndex: pos];
+	    break;
+	  case 1:
+	    [m deleteCharactersInRange: NSMakeRange(pos, 5)];
+	    break;
+	  default:
+	    [m replaceCharactersInRange: NSMakeRange(pos, 3)
+			     withString: (i % 30 == 2) ? @"\u20AC" : @"abcd"];
+	    break;
+	}
+      pos += 4;
+    }
+  printf("%-10s %6.1f MB %10.0f edits/s", name,
+    size / (1024.0 * 1024.0), EDITS / -[start timeIntervalSinceNow]);
+
+  start = [NSDate date];
+  [m rangeOfString: @"not present"];
+  printf("  first search %.3fs\n", -[start timeIntervalSinceNow]);
+  DESTROY(pool);
+}
+
+int
+main()
+{
+  CREATE_AUTORELEASE_POOL(pool);
+
+  run(1024 * 1024, NO, "random");
+  run(1024 * 1024, YES, "sequential");
+  run(8 * 1024 * 1024, NO, "random");
+  run(8 * 1024 * 1024, YES, "sequential");
+  DESTROY(pool);
+  return 0;
+}
@@ -0,0 +1,116 @@
+/* Benchmark for slicing large NSData objects.
+
+  Copyright (C) 2026 Free Software Foundation
+
+  Copying and distribution of this file, with or without modification,
+  are permitted in any medium without royalty provided the copyright
+  notice and this notice are preserved.
+
+  Splits a buffer of M megabytes (default 64) into records of R bytes
+  (default 100), as a parser extracting fields from a message would,
+  and keeps every record until the end of the pass.  Reports the time
+  and memory used when the records are taken with -subdataWithRange:,
+  which refers to the buffer, and when each record is copied with
+  +dataWithBytes:length:, which is what -subdataWithRange: used to do.
+  Run as 'subdata_benchmark M R' to choose the parameters. */
+
+#include <Foundation/Foundation.h>
+#include <stdio.h>
+#include <unistd.h>
+
+static unsigned long
+residentKB()
+{
+  unsigned long	size = 0;
+  unsigned long	resident = 0;
+  FILE		*f = fopen("/proc/self/statm", "r");
+
+  if (f != 0)
+    {
+      if (fscanf(f, "%lu %lu", &size, &resident) != 2)
+	{
+	  resident = 0;
+	}
+      fclose(f);
+    }
+  return resident * (getpagesize() / 1024);
+}
+
+static void
+measure(NSData *buffer, NSUInteger record, BOOL slice)
+{
+  CREATE_AUTORELEASE_POOL(pool);
+  NSUInteger		length = [buffer length];
+  const uint8_t		*bytes = [buffer bytes];
+  NSMutableArray	*records;
+  unsigned long		before;
+  unsigned long		sum = 0;
+  NSUInteger		pos;
+  NSUInteger		count;
+  NSUInteger		i;
+  NSDate		*start;
+  double		t;
+
+  records = [NSMutableArray arrayWithCapacity: length / record + 1];
+  before = residentKB();
+  start = [NSDate date];
+  for (pos = 0; pos < length; pos += record)
+    {
+      NSRange	r = NSMakeRange(pos, record);
+      NSData	*d;
+
+      if (NSMaxRange(r) > length)
+	{
+	  r.length = length - pos;
+	}
+      if (YES == slice)
+	{
+	  d = [buffer subdataWithRange: r];
+	}
+      else
+	{
+	  d = [NSData dataWithBytes: bytes + r.location length: r.length];
+	}
+      [records addObject: d];
+    }
+  count = [records count];
+  for (i = 0; i < count; i++)
+    {
+      sum += *(const uint8_t*)[[records objectAtIndex: i] bytes];
+    }
+  t = -[start timeIntervalSinceNow];
+
+  printf("%-8s %10lu records  %8.3f s  %12.0f records/s  RSS +%lu KB"
+    "  (check %lu)\n",
+    slice ? "slice" : "copy", (unsigned long)count, t, count / t,
+    residentKB() - before, sum);
+  DESTROY(pool);
+}
+
+int
+main(int argc, char **argv)
+{
+  CREATE_AUTORELEASE_POOL(pool);
+  NSUInteger	megabytes = (argc > 1) ? atoi(argv[1]) : 64;
+  NSUInteger	record = (argc > 2) ? atoi(argv[2]) : 100;
+  NSUInteger	length = megabytes * 1024 * 1024;
+  uint8_t	*bytes;
+  NSData	*buffer;
+  NSUInteger	i;
+
+  if (record == 0)
+    {
+      record = 1;
+    }
+  bytes = malloc(length);
+  for (i = 0; i < length; i++)
+    {
+      bytes[i] = (uint8_t)i;
+    }
+  buffer = [NSData dataWithBytesNoCopy: bytes length: length];
+
+  measure(buffer, record, NO);
+  measure(buffer, record, YES);
+  DESTROY(pool);
+  return 0;
+}
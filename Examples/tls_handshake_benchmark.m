@@ -0,0 +1,245 @@
+/* Benchmark for TLS handshakes on socket streams.
+
+  Copyright (C) 2026 Free Software Foundation
+
+  Copying and distribution of this file, with or without modification,
+  are permitted in any medium without royalty provided the copyright
+  notice and this notice are preserved.
+
+  Starts a local TLS server on port P (default 14433) using the PEM
+  certificate C and key K (default testCert.pem and testKey.pem, as found
+  in Tests/base/GSTLS), then makes N connections to it (default 500) one
+  after another, each waiting for a byte from the server before closing.
+  This is done first with session resumption turned off and then with
+  it on, and the handshakes per second are reported for each.
+  Run as 'tls_handshake_benchmark N P C K' to choose the parameters. */
+
+#include <Foundation/Foundation.h>
+#include <GNUstepBase/NSStream+GNUstepBase.h>
+#include <stdio.h>
+
+/* One accepted connection at the server end.
+ */
+@interface	Connection : NSObject
+{
+@public
+  NSInputStream		*input;
+  NSOutputStream	*output;
+  NSMutableSet		*owner;
+  BOOL			sent;
+}
+@end
+
+@implementation	Connection
+- (void) close
+{
+  [input setDelegate: nil];
+  [output setDelegate: nil];
+  [input close];
+  [output close];
+  [input removeFromRunLoop: [NSRunLoop currentRunLoop]
+		   forMode: NSDefaultRunLoopMode];
+  [output removeFromRunLoop: [NSRunLoop currentRunLoop]
+		    forMode: NSDefaultRunLoopMode];
+  DESTROY(input);
+  DESTROY(output);
+  [[self retain] autorelease];
+  [owner removeObject: self];
+}
+
+- (void) stream: (NSStream*)stream handleEvent: (NSStreamEvent)event
+{
+  if (NSStreamEventHasSpaceAvailable == event && NO == sent)
+    {
+      sent = YES;
+      [output write: (const uint8_t*)"x" maxLength: 1];
+    }
+  else if (NSStreamEventHasBytesAvailable == event)
+    {
+      uint8_t	buf[64];
+
+      if ([input read: buf maxLength: sizeof(buf)] <= 0)
+	{
+	  [self close];
+	}
+    }
+  else if (NSStreamEventEndEncountered == event
+    || NSStreamEventErrorOccurred == event)
+    {
+      [self close];
+    }
+}
+@end
+
+@interface	Bench : NSObject
+{
+@public
+  GSServerStream	*server;
+  NSMutableSet		*connections;
+  NSInputStream		*input;
+  NSOutputStream	*output;
+  NSHost		*host;
+  unsigned		port;
+  unsigned		count;
+  unsigned		done;
+  BOOL			resume;
+  BOOL			failed;
+}
+- (void) connect;
+@end
+
+@implementation	Bench
+- (void) connect
+{
+  NSRunLoop	*rl = [NSRunLoop currentRunLoop];
+
+  [NSStream getStreamsToHost: host
+			port: port
+		 inputStream: &input
+		outputStream: &output];
+  [input retain];
+  [output retain];
+  [input setProperty: NSStreamSocketSecurityLevelNegotiatedSSL
+	      forKey: NSStreamSocketSecurityLevelKey];
+  [output setProperty: NSStreamSocketSecurityLevelNegotiatedSSL
+	       forKey: NSStreamSocketSecurityLevelKey];
+  if (NO == resume)
+    {
+      [input setProperty: @"" forKey: GSTLSResumeKey];
+      [output setProperty: @"" forKey: GSTLSResumeKey];
+    }
+  [input setDelegate: self];
+  [output setDelegate: self];
+  [input scheduleInRunLoop: rl forMode: NSDefaultRunLoopMode];
+  [output scheduleInRunLoop: rl forMode: NSDefaultRunLoopMode];
+  [input open];
+  [output open];
+}
+
+- (void) disconnect
+{
+  [input setDelegate: nil];
+  [output setDelegate: nil];
+  [input close];
+  [output close];
+  [input removeFromRunLoop: [NSRunLoop currentRunLoop]
+		   forMode: NSDefaultRunLoopMode];
+  [output removeFromRunLoop: [NSRunLoop currentRunLoop]
+		    forMode: NSDefaultRunLoopMode];
+  DESTROY(input);
+  DESTROY(output);
+}
+
+- (void) stream: (NSStream*)stream handleEvent: (NSStreamEvent)event
+{
+  if (stream == server)
+    {
+      if (NSStreamEventHasBytesAvailable == event)
+	{
+	  Connection	*c = [[Connection new] autorelease];
+	  NSRunLoop	*rl = [NSRunLoop currentRunLoop];
+
+	  [server acceptWithInputStream: &c->input
+			   outputStream: &c->output];
+	  if (nil != c->input)
+	    {
+	      [c->input retain];
+	      [c->output retain];
+	      c->owner = connections;
+	      [connections addObject: c];
+	      [c->input setDelegate: c];
+	      [c->output setDelegate: c];
+	      [c->input scheduleInRunLoop: rl forMode: NSDefaultRunLoopMode];
+	      [c->output scheduleInRunLoop: rl forMode: NSDefaultRunLoopMode];
+	      [c->input open];
+	      [c->output open];
+	    }
+	}
+      return;
+    }
+  if (NSStreamEventHasBytesAvailable == event && stream == input)
+    {
+      uint8_t	buf[64];
+
+      if ([input read: buf maxLength: sizeof(buf)] > 0)
+	{
+	  [self disconnect];
+	  if (++done < count)
+	    {
+	      [self connect];
+	    }
+	}
+    }
+  else if (NSStreamEventErrorOccurred == event
+    || NSStreamEventEndEncountered == event)
+    {
+      printf("connection failed: %s\n", [[NSString stringWithFormat: @"%@",
+	[stream streamError]] UTF8String]);
+      [self disconnect];
+      failed = YES;
+    }
+}
+@end
+
+static void
+run(const char *label, Bench *b, BOOL resume)
+{
+  NSRunLoop	*rl = [NSRunLoop currentRunLoop];
+  NSDate	*start;
+  double	t;
+
+  b->resume = resume;
+  b->done = 0;
+  b->failed = NO;
+  start = [NSDate date];
+  [b connect];
+  while (b->done < b->count && NO == b->failed)
+    {
+      CREATE_AUTORELEASE_POOL(arp);
+      [rl runMode: NSDefaultRunLoopMode
+       beforeDate: [NSDate dateWithTimeIntervalSinceNow: 5.0]];
+      DESTROY(arp);
+    }
+  t = -[start timeIntervalSinceNow];
+  printf("%-10s %8.3f s  %8.1f handshakes/s\n", label, t, b->done / t);
+}
+
+int
+main(int argc, char **argv)
+{
+  CREATE_AUTORELEASE_POOL(pool);
+  Bench		*b = [[Bench new] autorelease];
+  NSString	*cert = @"testCert.pem";
+  NSString	*key = @"testKey.pem";
+
+  b->count = (argc > 1) ? atoi(argv[1]) : 500;
+  b->port = (argc > 2) ? atoi(argv[2]) : 14433;
+  if (argc > 3)
+    {
+      cert = [NSString stringWithUTF8String: argv[3]];
+    }
+  if (argc > 4)
+    {
+      key = [NSString stringWithUTF8String: argv[4]];
+    }
+  b->host = [NSHost hostWithAddress: @"127.0.0.1"];
+  b->connections = [NSMutableSet set];
+
+  b->server = [GSServerStream serverStreamToAddr: @"127.0.0.1"
+					    port: b->port];
+  [b->server setProperty: NSStreamSocketSecurityLevelNegotiatedSSL
+		  forKey: NSStreamSocketSecurityLevelKey];
+  [b->server setProperty: cert forKey: GSTLSCertificateFile];
+  [b->server setProperty: key forKey: GSTLSCertificateKeyFile];
+  [b->server setDelegate: b];
+  [b->server scheduleInRunLoop: [NSRunLoop currentRunLoop]
+		       forMode: NSDefaultRunLoopMode];
+  [b->server open];
+
+  run("full", b, NO);
+  run("resumed", b, YES);
+
+  [b->server close];
+  DESTROY(pool);
+  return 0;
+}
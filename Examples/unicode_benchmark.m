@@ -0,0 +1,96 @@
+/* Benchmark for string encoding conversion throughput.
+
+  Copyright (C) 2026 Free Software Foundation
+
+  Copying and distribution of this file, with or without modification,
+  are permitted in any medium without royalty provided the copyright
+  notice and this notice are preserved.
+
+  Measures MB/s for creating strings from ASCII, Latin-1 and UTF-8 data
+  and for converting them back.  Run with GNUSTEP_UNICODE_SCALAR=YES in
+  the environment to compare against the scalar conversion code. */
+
+#include <Foundation/Foundation.h>
+#include <stdio.h>
+
+#define	SIZE	(4 * 1024 * 1024)
+#define	LOOPS	20
+
+static void
+report(const char *label, NSDate *start)
+{
+  double	t = -[start timeIntervalSinceNow];
+
+  printf("%-32s %8.1f MB/s\n", label,
+    (double)SIZE * LOOPS / (1024.0 * 1024.0) / t);
+}
+
+static void
+run(NSData *data, NSStringEncoding enc, const char *name)
+{
+  CREATE_AUTORELEASE_POOL(pool);
+  NSString	*str = nil;
+  NSDate	*start;
+  char		label[64];
+  int		i;
+
+  start = [NSDate date];
+  for (i = 0; i < LOOPS; i++)
+    {
+      [str release];
+      str = [[NSString alloc] initWithBytes: [data bytes]
+				     length: [data length]
+				   encoding: enc];
+    }
+  snprintf(label, sizeof(label), "%s to string", name);
+  report(label, start);
+
+  start = [NSDate date];
+  for (i = 0; i < LOOPS; i++)
+    {
+      CREATE_AUTORELEASE_POOL(inner);
+      [str dataUsingEncoding: enc];
+      DESTROY(inner);
+    }
+  snprintf(label, sizeof(label), "%s from string", name);
+  report(label, start);
+  [str release];
+  DESTROY(pool);
+}
+
+int
+main()
+{
+  CREATE_AUTORELEASE_POOL(pool);
+  NSMutableData	*ascii = [NSMutableData dataWithLength: SIZE];
+  NSMutableData	*latin1 = [NSMutableData dataWithLength: SIZE];
+  NSMutableData	*utf8 = [NSMutableData dataWithLength: SIZE];
+  unsigned char	*a = [ascii mutableBytes];
+  unsigned char	*l = [latin1 mutableBytes];
+  unsigned char	*u = [utf8 mutableBytes];
+  unsigned	i;
+
+  for (i = 0; i < SIZE; i++)
+    {
+      a[i] = ' ' + i % 90;
+      l[i] = (i % 64 == 0) ? 0xe9 : a[i];
+      /* Mostly ascii with a two byte sequence every 64 bytes.
+       */
+      if (i % 64 == 62 && i + 1 < SIZE)
+	{
+	  u[i++] = 0xc3;
+	  u[i] = 0xa9;
+	}
+      else
+	{
+	  u[i] = a[i];
+	}
+    }
+
+  run(ascii, NSASCIIStringEncoding, "ASCII");
+  run(ascii, NSUTF8StringEncoding, "UTF-8 (pure ASCII)");
+  run(utf8, NSUTF8StringEncoding, "UTF-8 (mixed)");
+  run(latin1, NSISOLatin1StringEncoding, "Latin-1");
+  DESTROY(pool);
+  return 0;
+}
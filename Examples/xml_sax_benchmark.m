@@ -0,0 +1,99 @@
+/* Benchmark for the rate at which NSXMLParser reports elements.
+
+  Copyright (C) 2026 Free Software Foundation
+
+  Copying and distribution of this file, with or without modification,
+  are permitted in any medium without royalty provided the copyright
+  notice and this notice are preserved.
+
+  Builds a document of N elements (default 1000000), each with a few
+  attributes and some text containing an entity, in a plain form and in
+  a form using namespace prefixes.  It then parses each one, with and
+  without namespace processing, and reports the elements parsed per
+  second along with the number of text reports made, which shows how
+  well adjacent pieces of text are gathered together.
+  Run as 'xml_sax_benchmark N' to choose the parameters. */
+
+#include <Foundation/Foundation.h>
+#include <stdio.h>
+
+@interface	Counter : NSObject
+{
+@public
+  NSUInteger	elements;
+  NSUInteger	attributes;
+  NSUInteger	texts;
+}
+@end
+
+@implementation	Counter
+- (void) parser: (NSXMLParser *)parser
+  didStartElement: (NSString *)elementName
+  namespaceURI: (NSString *)namespaceURI
+  qualifiedName: (NSString *)qName
+  attributes: (NSDictionary *)attributeDict
+{
+  elements++;
+  attributes += [attributeDict count];
+}
+
+- (void) parser: (NSXMLParser *)parser foundCharacters: (NSString *)string
+{
+  texts++;
+}
+@end
+
+static NSData *
+build(unsigned count, BOOL prefixed)
+{
+  NSMutableString	*s = [NSMutableString stringWithCapacity: count * 80];
+  NSString		*p = prefixed ? @"r:" : @"";
+  unsigned		i;
+
+  [s appendFormat: @"<?xml version=\"1.0\"?>\n<%@records%@>\n", p,
+    prefixed ? @" xmlns:r=\"urn:records\"" : @""];
+  for (i = 0; i < count; i++)
+    {
+      [s appendFormat: @"<%@record %@id=\"%u\" %@kind=\"k%u\">"
+	@"Record %u &amp; notes</%@record>\n",
+	p, p, i, p, i % 5, i, p];
+    }
+  [s appendFormat: @"</%@records>\n", p];
+  return [s dataUsingEncoding: NSUTF8StringEncoding];
+}
+
+static void
+parse(NSData *data, BOOL namespaces, const char *label)
+{
+  CREATE_AUTORELEASE_POOL(pool);
+  NSXMLParser	*parser;
+  Counter	*c = [[Counter new] autorelease];
+  NSDate	*start;
+  double	t;
+
+  parser = [[[NSXMLParser alloc] initWithData: data] autorelease];
+  [parser setShouldProcessNamespaces: namespaces];
+  [parser setDelegate: c];
+  start = [NSDate date];
+  [parser parse];
+  t = -[start timeIntervalSinceNow];
+  printf("%-24s %8.3f s  %10.0f elements/s  %lu texts\n", label, t,
+    c->elements / t, (unsigned long)c->texts);
+  DESTROY(pool);
+}
+
+int
+main(int argc, char **argv)
+{
+  CREATE_AUTORELEASE_POOL(pool);
+  unsigned	count = (argc > 1) ? atoi(argv[1]) : 1000000;
+  NSData	*plain = build(count, NO);
+  NSData	*prefixed = build(count, YES);
+
+  parse(plain, NO, "plain");
+  parse(plain, YES, "plain, namespaces");
+  parse(prefixed, NO, "prefixed");
+  parse(prefixed, YES, "prefixed, namespaces");
+  DESTROY(pool);
+  return 0;
+}
@@ -0,0 +1,120 @@
+/* Benchmark for parsing a large xml document with NSXMLParser.
+
+  Copyright (C) 2026 Free Software Foundation
+
+  Copying and distribution of this file, with or without modification,
+  are permitted in any medium without royalty provided the copyright
+  notice and this notice are preserved.
+
+  Creates an xml document of about M megabytes (default 256) in
+  directory D (default the temporary directory), then parses it with
+  -initWithStream: from a file stream and with -initWithContentsOfURL:,
+  reporting the throughput and the peak memory use of the process after
+  each.  The stream is parsed first because the peak only ever grows.
+  Run as 'xml_stream_benchmark M D' to choose the parameters. */
+
+#include <Foundation/Foundation.h>
+#include <stdio.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+@interface	Counter : NSObject
+{
+@public
+  NSUInteger		elements;
+  unsigned long long	characters;
+}
+@end
+
+@implementation	Counter
+- (void) parser: (NSXMLParser *)parser
+  didStartElement: (NSString *)elementName
+  namespaceURI: (NSString *)namespaceURI
+  qualifiedName: (NSString *)qName
+  attributes: (NSDictionary *)attributeDict
+{
+  elements++;
+}
+
+- (void) parser: (NSXMLParser *)parser foundCharacters: (NSString *)string
+{
+  characters += [string length];
+}
+@end
+
+static void
+parse(NSXMLParser *parser, const char *label, unsigned long long size)
+{
+  CREATE_AUTORELEASE_POOL(pool);
+  Counter	*c = [[Counter new] autorelease];
+  NSDate	*start = [NSDate date];
+  struct rusage	u;
+  BOOL		ok;
+  double	t;
+
+  [parser setDelegate: c];
+  ok = [parser parse];
+  t = -[start timeIntervalSinceNow];
+  getrusage(RUSAGE_SELF, &u);
+  printf("%-8s %s %8.3f s  %8.1f MB/s  %lu elements  peak %ld MB\n",
+    label, ok ? "ok  " : "fail", t, size / t / (1024.0 * 1024.0),
+    (unsigned long)c->elements, (long)(u.ru_maxrss / 1024));
+  DESTROY(pool);
+}
+
+int
+main(int argc, char **argv)
+{
+  CREATE_AUTORELEASE_POOL(pool);
+  unsigned long long	megabytes = (argc > 1) ? atoi(argv[1]) : 256;
+  unsigned long long	size;
+  NSMutableString	*piece;
+  NSFileHandle		*fh;
+  NSString		*dir;
+  NSString		*path;
+  NSData		*block;
+  NSXMLParser		*parser;
+  unsigned		i;
+
+  dir = (argc > 2) ? [NSString stringWithUTF8String: argv[2]]
+    : NSTemporaryDirectory();
+  path = [dir stringByAppendingPathComponent: @"xml_stream_benchmark.xml"];
+
+  /* The document is made of identical pieces of about 1MB.
+   */
+  piece = [NSMutableString string];
+  for (i = 0; [piece length] < 1024 * 1024; i++)
+    {
+      [piece appendFormat: @"<record id=\"%u\"><name>Record %u</name>"
+	@"<value type=\"int\">%u</value><note>Some text &amp; more</note>"
+	@"</record>\n", i, i, i * 37];
+    }
+  block = [piece dataUsingEncoding: NSUTF8StringEncoding];
+  [[NSFileManager defaultManager] createFileAtPath: path
+					  contents: nil
+					attributes: nil];
+  fh = [NSFileHandle fileHandleForWritingAtPath: path];
+  [fh writeData: [@"<?xml version=\"1.0\"?>\n<records>\n"
+    dataUsingEncoding: NSUTF8StringEncoding]];
+  for (i = 0; i < megabytes; i++)
+    {
+      [fh writeData: block];
+    }
+  [fh writeData: [@"</records>\n" dataUsingEncoding: NSUTF8StringEncoding]];
+  size = [fh offsetInFile];
+  [fh closeFile];
+
+  parser = [[NSXMLParser alloc] initWithStream:
+    [NSInputStream inputStreamWithFileAtPath: path]];
+  parse(parser, "stream", size);
+  RELEASE(parser);
+
+  parser = [[NSXMLParser alloc] initWithContentsOfURL:
+    [NSURL fileURLWithPath: path]];
+  parse(parser, "data", size);
+  RELEASE(parser);
+
+  [[NSFileManager defaultManager] removeItemAtPath: path error: NULL];
+  DESTROY(pool);
+  return 0;
+}
@@ -0,0 +1,119 @@
+/* Benchmark for querying a large xml document with NSXMLDocument.
+
+  Copyright (C) 2026 Free Software Foundation
+
+  Copying and distribution of this file, with or without modification,
+  are permitted in any medium without royalty provided the copyright
+  notice and this notice are preserved.
+
+  Builds a document of N records (default 200000) and parses it into an
+  NSXMLDocument.  It then runs Q (default 1000) queries which each find
+  a single record, reporting the average latency, and walks every record
+  with -nodeEnumeratorForXPath:error:, -nodesForXPath:error: and -children,
+  reporting the time taken and the peak memory use of the process after
+  each.  The enumerator is used first because the peak only ever grows.
+  Run as 'xml_xpath_benchmark N Q' to choose the parameters. */
+
+#include <Foundation/Foundation.h>
+#include <stdio.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+static void
+report(const char *label, NSDate *start, unsigned long long characters)
+{
+  double	t = -[start timeIntervalSinceNow];
+  struct rusage	u;
+
+  getrusage(RUSAGE_SELF, &u);
+  printf("%-12s %8.3f s  %12llu characters  peak %ld MB\n", label, t,
+    characters, (long)(u.ru_maxrss / 1024));
+}
+
+int
+main(int argc, char **argv)
+{
+  CREATE_AUTORELEASE_POOL(pool);
+  unsigned		count = (argc > 1) ? atoi(argv[1]) : 200000;
+  unsigned		queries = (argc > 2) ? atoi(argv[2]) : 1000;
+  unsigned long long	characters;
+  NSMutableString	*xml;
+  NSXMLDocument		*doc;
+  NSEnumerator		*e;
+  NSXMLNode		*node;
+  NSDate		*start;
+  double		t;
+  unsigned		i;
+
+  xml = [NSMutableString stringWithCapacity: count * 80];
+  [xml appendString: @"<?xml version=\"1.0\"?>\n<records>\n"];
+  for (i = 0; i < count; i++)
+    {
+      [xml appendFormat: @"<record id=\"r%u\"><name>Record %u</name>"
+	@"<value>%u</value></record>\n", i, i, i * 37];
+    }
+  [xml appendString: @"</records>\n"];
+
+  start = [NSDate date];
+  doc = [[NSXMLDocument alloc] initWithXMLString: xml options: 0 error: NULL];
+  report("parse", start, [xml length]);
+
+  start = [NSDate date];
+  for (i = 0; i < queries; i++)
+    {
+      CREATE_AUTORELEASE_POOL(arp);
+      NSString	*q;
+
+      q = [NSString stringWithFormat: @"/records/record[%u]/name",
+	(i * 7919) % count + 1];
+      [[doc nodesForXPath: q error: NULL] lastObject];
+      DESTROY(arp);
+    }
+  t = -[start timeIntervalSinceNow];
+  printf("%-12s %8.3f s  %12.1f us per query\n", "query", t,
+    t * 1000000.0 / (queries > 0 ? queries : 1));
+
+  start = [NSDate date];
+  characters = 0;
+  e = [doc nodeEnumeratorForXPath: @"//record/name" error: NULL];
+  while ((node = [e nextObject]) != nil)
+    {
+      CREATE_AUTORELEASE_POOL(arp);
+      characters += [[node stringValue] length];
+      DESTROY(arp);
+    }
+  report("enumerator", start, characters);
+
+  start = [NSDate date];
+  characters = 0;
+  {
+    CREATE_AUTORELEASE_POOL(arp);
+    NSArray	*nodes = [doc nodesForXPath: @"//record/name" error: NULL];
+
+    e = [nodes objectEnumerator];
+    while ((node = [e nextObject]) != nil)
+      {
+	characters += [[node stringValue] length];
+      }
+    DESTROY(arp);
+  }
+  report("array", start, characters);
+
+  start = [NSDate date];
+  characters = 0;
+  {
+    CREATE_AUTORELEASE_POOL(arp);
+
+    e = [[[doc rootElement] children] objectEnumerator];
+    while ((node = [e nextObject]) != nil)
+      {
+	characters += [[[node childAtIndex: 0] stringValue] length];
+      }
+    DESTROY(arp);
+  }
+  report("children", start, characters);
+
+  RELEASE(doc);
+  DESTROY(pool);
+  return 0;
+}
@@ -71,6 +71,9 @@ extern "C" {
   BOOL		_initialPass;
 #endif
 #if     GS_NONFRAGILE
+#  if	defined(GS_NSArchiver_IVARS)
+@public GS_NSArchiver_IVARS
+#  endif
 #else
   /* Pointer to private additional data used to avoid breaking ABI
    * when we don't have the non-fragile ABI available.
@@ -113,6 +116,8 @@ extern "C" {
  *	NB. you would normally want to issue a 'setLength:0' message to the
  *	mutable data object used by the archiver as well, othewrwise the next
  *	root object encoded will be appended to data.
+ *	The cross-reference tables keep their capacity, so an archiver which
+ *	is reused for graphs of a similar size does not need to grow them.
  */
 - (void) resetArchiver;
 
@@ -158,6 +158,11 @@ GS_NSConnection_IVARS;
 - (void) setRequestTimeout: (NSTimeInterval)to;
 - (void) setRootObject: anObj;
 - (NSDictionary*) statistics;
+
+#if OS_API_VERSION(GS_API_NONE, GS_API_NONE)
+- (NSUInteger) requestWorkers;
+- (void) setRequestWorkers: (NSUInteger)count;
+#endif
 @end
 
 
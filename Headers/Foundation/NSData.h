@@ -71,6 +71,7 @@ enum {
 
 #if OS_API_VERSION(MAC_OS_X_VERSION_10_9,GS_API_LATEST)
 DEFINE_BLOCK_TYPE(GSDataDeallocatorBlock, void, void*, NSUInteger);
+DEFINE_BLOCK_TYPE(GSDataByteRangeBlock, void, const void*, NSRange, BOOL*);
 #endif
 
 @interface NSData : NSObject <NSCoding, NSCopying, NSMutableCopying>
@@ -135,6 +136,9 @@ DEFINE_BLOCK_TYPE(GSDataDeallocatorBlock, void, void*, NSUInteger);
 - (void) getBytes: (void*)buffer
 	    range: (NSRange)aRange;
 - (NSData*) subdataWithRange: (NSRange)aRange;
+#if OS_API_VERSION(MAC_OS_X_VERSION_10_9,GS_API_LATEST)
+- (void) enumerateByteRangesUsingBlock: (GSDataByteRangeBlock)aBlock;
+#endif
 
 // base64
 #if OS_API_VERSION(MAC_OS_X_VERSION_10_9,GS_API_LATEST)
@@ -349,6 +353,12 @@ DEFINE_BLOCK_TYPE(GSDataDeallocatorBlock, void, void*, NSUInteger);
 #if OS_API_VERSION(GS_API_NONE, GS_API_NONE)
 
 @interface NSMutableData (GNUstepExtensions)
+/*
+ *	Chunked data for efficiently accumulating or queueing large amounts
+ *	of incoming data.
+ */
++ (id) dataWithChunkSize: (NSUInteger)chunkSize;
+
 /*
  *	Capacity management - GNUstep gives you control over the size of
  *	the data buffer as well as the 'length' of valid data in it.
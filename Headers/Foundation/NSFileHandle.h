@@ -209,6 +209,13 @@ GS_EXPORT NSString * const NSFileHandleOperationException;
 - (BOOL) useCompression;
 - (void) writeInBackgroundAndNotify: (NSData*)item forModes: (NSArray*)modes;
 - (void) writeInBackgroundAndNotify: (NSData*)item;
+- (void) writeInBackgroundAndNotifyFromFileHandle: (NSFileHandle*)source
+					   offset: (unsigned long long)offset
+					   length: (unsigned long long)length
+					 forModes: (NSArray*)modes;
+- (void) writeInBackgroundAndNotifyFromFileHandle: (NSFileHandle*)source
+					   offset: (unsigned long long)offset
+					   length: (unsigned long long)length;
 - (BOOL) writeInProgress;
 @end
 
@@ -325,6 +332,14 @@ GS_EXPORT NSString * const NSFileHandleOperationException;
  *   the certificate of the host we are connecting to.<br />
  *   If this is not specified, all the names provided by NSHost are used.
  *   </desc>
+ *   <term>GSTLSResumeKey</term>
+ *   <desc>A string identifying the remote end of an outgoing connection,
+ *   used to look up data saved from an earlier session with the same
+ *   settings so that the handshake can resume that session rather than
+ *   negotiating a new one.<br />
+ *   If this is not specified, the address and port of the remote end are
+ *   used.  An empty string turns off session resumption.
+ *   </desc>
  *   <term>GSTLSRevokeFile</term>
  *   <desc>The full path of a file containing certificate revocation
  *   information for certificates issued by our trusted authorites but
@@ -393,6 +408,11 @@ GS_EXPORT NSString * const GSTLSPriority;
  */
 GS_EXPORT NSString * const GSTLSRemoteHosts;
 
+/** Dictionary key for the string identifying the remote end when caching
+ * data to resume a session.
+ */
+GS_EXPORT NSString * const GSTLSResumeKey;
+
 /** Dictionary key for the path to a PEM encoded certificate revocation
  * file.
  */
@@ -391,6 +391,18 @@ typedef NSUInteger NSDirectoryEnumerationOptions;
  * </p>
  */
 - (NSDirectoryEnumerator*) enumeratorAtPath: (NSString*)path;
+#if OS_API_VERSION(GS_API_NONE, GS_API_NONE)
+/**
+ * Returns an enumerator like that from -enumeratorAtPath:, but which
+ * reads the directories in a background thread, keeping up to count
+ * entries ready ahead of the consumer.  The entries are returned in
+ * the same order as by a normal enumerator.<br />
+ * A count of zero returns a normal enumerator.  Where background
+ * reading is not supported this also returns a normal enumerator.
+ */
+- (NSDirectoryEnumerator*) enumeratorAtPath: (NSString*)path
+				   prefetch: (NSUInteger)count;
+#endif
 - (NSDictionary*) fileAttributesAtPath: (NSString*)path
 			  traverseLink: (BOOL)flag;
 
@@ -438,7 +450,9 @@ typedef NSUInteger NSDirectoryEnumerationOptions;
  * handler object which should respond to
  * [NSObject(NSFileManagerHandler)-fileManager:willProcessPath:] and
  * [NSObject(NSFileManagerHandler)-fileManager:shouldProceedAfterError:]
- * messages.
+ * messages.<br />
+ * When there is no handler a directory tree is removed by a small pool
+ * of threads working on several subdirectories at once.
  */
 - (BOOL) removeFileAtPath: (NSString*)path
 		  handler: (id)handler;
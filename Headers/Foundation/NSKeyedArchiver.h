@@ -72,6 +72,9 @@ extern "C" {
   NSPropertyListFormat	_format;
 #endif
 #if     GS_NONFRAGILE
+#  if	defined(GS_NSKeyedArchiver_IVARS)
+@public GS_NSKeyedArchiver_IVARS
+#  endif
 #else
   /* Pointer to private additional data used to avoid breaking ABI
    * when we don't have the non-fragile ABI available.
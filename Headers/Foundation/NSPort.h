@@ -277,7 +277,11 @@ typedef SOCKET NSSocketNativeHandle;
 /**
  *  An [NSPort] implementation for network object communications
  *  which can be used for interthread/interprocess communications
- *  on the same host, but not between different hosts.
+ *  on the same host, but not between different hosts.<br />
+ *  On Linux, data items of 64KB or more are passed to the receiving
+ *  process in shared memory rather than being copied through the
+ *  socket.  The GSMessagePortSharedMemory user default sets the size
+ *  from which this is done, and a value of zero turns it off.
  */
 @interface NSMessagePort : NSPort
 {
@@ -71,6 +71,22 @@ typedef NSUInteger NSPropertyListReadOptions;
 @class NSError;
 #endif
 
+#if OS_API_VERSION(GS_API_NONE, GS_API_NONE)
+/**
+ * GNUstep specific option for
+ * [NSPropertyListSerialization+writePropertyList:toStream:format:options:error:]
+ * <list>
+ * <item><strong>GSPropertyListWriteBounded</strong>
+ * when writing a binary property list, use a fixed amount of memory
+ * however large the list is.  Only strings and numbers equal to ones
+ * written recently are shared, so the output may be larger.</item>
+ * </list>
+ */
+enum {
+  GSPropertyListWriteBounded = 1
+};
+#endif
+
 /**
  * Specifies the serialisation format for a serialised property list.
  * <list>
@@ -281,6 +297,26 @@ typedef NSUInteger NSPropertyListFormat;
                           error: (out NSError**)error;
 #endif
 
+#if OS_API_VERSION(GS_API_NONE, GS_API_NONE)
+/**
+ * Reads a property list from the file at path, mapping the file into
+ * memory rather than reading it.<br />
+ * If the file contains a binary property list and anOption is
+ * NSPropertyListImmutable, the arrays and dictionaries in the returned
+ * property list decode their contents only when those contents are
+ * first accessed, so opening a large file is cheap and memory is only
+ * used for the parts which are actually looked at.  Errors in parts of
+ * the file which have not yet been decoded are reported by raising an
+ * exception when they are accessed.<br />
+ * Any other property list is parsed from the mapped data in the normal
+ * way, as by +propertyListWithData:options:format:error:
+ */
++ (id) propertyListWithContentsOfMappedFile: (NSString*)path
+				    options: (NSPropertyListReadOptions)anOption
+				     format: (NSPropertyListFormat*)aFormat
+				      error: (out NSError**)error;
+#endif
+
 @end
 
 #endif	/* GS_API_MACOSX */
@@ -36,6 +36,7 @@ extern "C" {
 
 @class NSArray;
 @class NSDictionary;
+@class NSEnumerator;
 @class NSError;
 @class NSString;
 @class NSURL;
@@ -385,6 +386,26 @@ typedef NSUInteger NSXMLNodeKind;
 
 @end
 
+#if OS_API_VERSION(GS_API_NONE, GS_API_NONE)
+
+@interface NSXMLNode (GNUstepExtensions)
+/** Returns an enumerator over the nodes resulting from applying xpath to
+ * the receiver.<br />
+ * Unlike -nodesForXPath:error: this does not make an object for every
+ * node found before returning, but makes the object for each node only
+ * as -nextObject returns it, so a large result can be worked through
+ * without holding objects for all of it at once.  The enumerator keeps
+ * the tree alive while it exists, but the tree must not be modified
+ * until it has been finished with.<br />
+ * Returns nil if the expression cannot be evaluated or does not result
+ * in a set of nodes.
+ */
+- (NSEnumerator*) nodeEnumeratorForXPath: (NSString*)anxpath
+                                   error: (NSError**)error;
+@end
+
+#endif
+
 #if	defined(__cplusplus)
 }
 #endif
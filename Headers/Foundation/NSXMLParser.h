@@ -36,7 +36,7 @@
 extern "C" {
 #endif
 
-@class NSData, NSDictionary, NSError, NSString, NSURL;
+@class NSData, NSDictionary, NSError, NSInputStream, NSString, NSURL;
 
 /**
  * Domain for errors
@@ -107,6 +107,17 @@ GS_EXPORT NSString* const NSXMLParserErrorDomain;
  */
 - (id) initWithData: (NSData*)data;
 
+#if OS_API_VERSION(MAC_OS_X_VERSION_10_7, GS_API_LATEST)
+/**
+ * Initialises the parser to read an xml document from stream, which is
+ * opened when parsing starts (if it is not already open) and closed
+ * when parsing ends.<br />
+ * The document is passed to the parser a piece at a time as it is
+ * read, so the memory used does not depend on the size of the document.
+ */
+- (id) initWithStream: (NSInputStream*)stream;
+#endif
+
 /**
  * Parses the supplied data and returns YES on success, NO otherwise.
  */
@@ -247,6 +258,9 @@ GS_EXPORT NSString* const NSXMLParserErrorDomain;
   foundCDATA: (NSData*)aBlock;
 
 /** <override-dummy />
+ * Called with the text found in the document.  The parser reports each
+ * run of text between other items in one call where it can, but may
+ * split a very large run over several calls.
  */
 - (void) parser: (NSXMLParser*)aParser
   foundCharacters: (NSString*)aString;
@@ -64,6 +64,35 @@ enum {
 };
 
 
+@class	NSData;
+@class	NSLock;
+@class	NSMapTable;
+
+/*
+ * Classes, selectors and method types interned by the port coders of a
+ * connection which uses the compact encoding (see NSPortCoder.m).
+ * Each item is sent in full, along with the identifier we gave it, until
+ * a reply arrives to a message containing it, after which only the
+ * identifier is sent.
+ */
+@interface	GSPortCoderInterns : NSObject
+{
+@public
+  NSLock	*lock;
+  NSMapTable	*outItems;	/* Class or SEL -> identifier.	*/
+  NSMapTable	*outTypes;	/* Method type -> identifier.	*/
+  NSMapTable	*inItems;	/* Identifier -> Class or SEL.	*/
+  NSMapTable	*inTypes;	/* Identifier -> method type.	*/
+  uint8_t	*known;		/* Items the other end has.	*/
+  unsigned	size;		/* Size of known array.		*/
+  unsigned	next;		/* Last identifier allocated.	*/
+}
+/* Marks the items with the identifiers in the array of unsigned integers
+ * as known to the other end.
+ */
+- (void) confirm: (NSData*)identifiers;
+@end
+
 /*
  * Category containing the methods by which the public interface to
  * NSConnection must be extended in order to allow it's use by
@@ -79,6 +108,16 @@ enum {
 - (void) forwardInvocation: (NSInvocation *)inv 
 		  forProxy: (NSDistantObject*)object;
 - (const char *) typeForSelector: (SEL)sel remoteTarget: (unsigned)target;
+- (NSMethodSignature*) methodSignatureForSelector: (SEL)sel
+				     remoteTarget: (unsigned)target;
+- (BOOL) compactCoding;
+- (GSPortCoderInterns*) interns;
+@end
+
+@interface NSPortCoder (Internal)
++ (BOOL) compactCodingAvailable;
+- (NSData*) definedInterns;
+- (BOOL) moreToDecode;
 @end
 
 @interface NSPort (Internal)
@@ -242,12 +242,14 @@ extern "C" {
     unsigned int	excessData:1;
     unsigned int	headersOnly:1;
     unsigned int        encodedWord:1;
+    unsigned int	streaming:1;
   } flags;
   NSData		*boundary;	// Also overloaded to hold excess
   GSMimeDocument	*document;
   GSMimeParser		*child;
   GSMimeCodingContext	*context;
   NSStringEncoding	_defaultEncoding;
+  id			delegate;
 #endif
 #if	!GS_NONFRAGILE
   void			*_unused;
@@ -263,6 +265,7 @@ extern "C" {
 	  fromRange: (NSRange)aRange
 	   intoData: (NSMutableData*)dData
 	withContext: (GSMimeCodingContext*)con;
+- (id) delegate;
 - (NSData*) excess;
 - (void) expectNoHeaders;
 - (BOOL) isComplete;
@@ -288,10 +291,40 @@ extern "C" {
 - (NSString*) scanToken: (NSScanner*)scanner;
 - (void) setBuggyQuotes: (BOOL)flag;
 - (void) setDefaultCharset: (NSString*)aName;
+- (void) setDelegate: (id)anObject;
 - (void) setHeadersOnly;
 - (void) setIsHttp;
 @end
 
+/** Informal protocol for delegates of the GSMimeParser class.
+ * The default implementations of these methods do nothing, and the
+ * default -mimeParser:shouldStreamDocument: returns NO.
+ */
+@interface	NSObject (GSMimeParser)
+/** Called when the headers of a document (or of a part of a multipart
+ * document) have been parsed and its body is about to be decoded.
+ * Returning YES means that the decoded body data is passed to
+ * -mimeParser:document:decodedData: as it arrives, and is not kept
+ * as the content of the document.
+ */
+- (BOOL) mimeParser: (GSMimeParser*)parser
+  shouldStreamDocument: (GSMimeDocument*)doc;
+
+/** Passes the next piece of decoded body data for a document which is
+ * being streamed.  The data object is reused by the parser, so you must
+ * copy its contents if you need to keep them after this method returns.
+ */
+- (void) mimeParser: (GSMimeParser*)parser
+	   document: (GSMimeDocument*)doc
+	decodedData: (NSData*)data;
+
+/** Called when all of the body data of a streamed document has been
+ * passed to the delegate.
+ */
+- (void) mimeParser: (GSMimeParser*)parser
+   finishedDocument: (GSMimeDocument*)doc;
+@end
+
 /** Instances of the GSMimeSerializer class are used to serialise
  * GSMimeDocument objects to NSMutableData objects, producing data
  * in a form suitable for sending as an Email over the SMTP protocol
@@ -134,6 +134,90 @@ static NSString         *CteXuuencode = @"x-uuencode";
 
 typedef BOOL (*boolIMP)(id, SEL, id);
 
+static IMP		parseHeaderIMP = 0;
+static IMP		scanHeaderBodyIMP = 0;
+
+/* Header names which are common in web traffic and email.  Any header
+ * with one of these names can be made using the constant strings here
+ * rather than new strings for each header parsed.  Entries with a nil
+ * name are the headers which always need to go through -parseHeader:
+ */
+typedef struct {
+  unsigned	length;
+  const char	*bytes;
+  NSString	*name;
+  NSString	*lower;
+} KnownHeader;
+
+#define	KNOWN(N, L)	{ sizeof(N) - 1, N, @N, @L }
+#define	SPECIAL(L)	{ sizeof(L) - 1, L, nil, @L }
+
+static KnownHeader	knownHeaders[] = {
+  KNOWN("Accept", "accept"),
+  KNOWN("Accept-Charset", "accept-charset"),
+  KNOWN("Accept-Encoding", "accept-encoding"),
+  KNOWN("Accept-Language", "accept-language"),
+  KNOWN("Accept-Ranges", "accept-ranges"),
+  KNOWN("Age", "age"),
+  KNOWN("Allow", "allow"),
+  KNOWN("Authorization", "authorization"),
+  KNOWN("Cache-Control", "cache-control"),
+  KNOWN("Cc", "cc"),
+  KNOWN("Connection", "connection"),
+  KNOWN("Content-Encoding", "content-encoding"),
+  KNOWN("Content-Language", "content-language"),
+  KNOWN("Content-Length", "content-length"),
+  KNOWN("Content-Location", "content-location"),
+  KNOWN("Content-Range", "content-range"),
+  KNOWN("Cookie", "cookie"),
+  KNOWN("Date", "date"),
+  KNOWN("ETag", "etag"),
+  KNOWN("Expect", "expect"),
+  KNOWN("Expires", "expires"),
+  KNOWN("From", "from"),
+  KNOWN("Host", "host"),
+  KNOWN("If-Match", "if-match"),
+  KNOWN("If-Modified-Since", "if-modified-since"),
+  KNOWN("If-None-Match", "if-none-match"),
+  KNOWN("If-Range", "if-range"),
+  KNOWN("If-Unmodified-Since", "if-unmodified-since"),
+  KNOWN("Keep-Alive", "keep-alive"),
+  KNOWN("Last-Modified", "last-modified"),
+  KNOWN("Location", "location"),
+  KNOWN("Message-ID", "message-id"),
+  KNOWN("Origin", "origin"),
+  KNOWN("Pragma", "pragma"),
+  KNOWN("Proxy-Authorization", "proxy-authorization"),
+  KNOWN("Range", "range"),
+  KNOWN("Received", "received"),
+  KNOWN("Referer", "referer"),
+  KNOWN("Reply-To", "reply-to"),
+  KNOWN("Retry-After", "retry-after"),
+  KNOWN("Return-Path", "return-path"),
+  KNOWN("Sender", "sender"),
+  KNOWN("Server", "server"),
+  KNOWN("Set-Cookie", "set-cookie"),
+  KNOWN("Subject", "subject"),
+  KNOWN("TE", "te"),
+  KNOWN("To", "to"),
+  KNOWN("Upgrade", "upgrade"),
+  KNOWN("User-Agent", "user-agent"),
+  KNOWN("Vary", "vary"),
+  KNOWN("Via", "via"),
+  KNOWN("WWW-Authenticate", "www-authenticate"),
+  KNOWN("X-Forwarded-For", "x-forwarded-for"),
+  SPECIAL("content-disposition"),
+  SPECIAL("content-transfer-encoding"),
+  SPECIAL("content-type"),
+  SPECIAL("mime-version"),
+  SPECIAL("transfer-encoding"),
+  SPECIAL("unknown"),
+  { 0, 0, nil, nil }
+};
+
+#undef	KNOWN
+#undef	SPECIAL
+
 static char	*hex = "0123456789ABCDEF";
 
 /* This is a test for SMTP standard white space characters.
@@ -145,6 +229,89 @@ isWSP(int c)
   return (c == ' ' || c == '\t') ? YES : NO;
 }
 
+/* Test for a character permitted in a header name (the same characters
+ * as are in the tokenSet used by GSMimeHeader).
+ */
+static inline BOOL
+isTokenChar(unsigned char c)
+{
+  if (c <= 32 || c >= 127)
+    {
+      return NO;
+    }
+  switch (c)
+    {
+      case '(': case ')': case '<': case '>': case '@': case ',':
+      case ';': case ':': case '\\': case '"': case '/': case '[':
+      case ']': case '?': case '=':
+	return NO;
+      default:
+	return YES;
+    }
+}
+
+/* Test for a header value which is plain ASCII and holds no encoded words,
+ * so it will decode to the same string whatever charset the parser uses.
+ * The high bits are checked a word at a time since that is the slow part.
+ */
+static inline BOOL
+isPlainText(const unsigned char *src, const unsigned char *end)
+{
+  const unsigned char	*ptr = src;
+
+  while (end - ptr >= (NSInteger)sizeof(uintptr_t))
+    {
+      uintptr_t	w;
+
+      memcpy(&w, ptr, sizeof(w));
+      if (w & (~(uintptr_t)0 / 255 * 0x80))
+	{
+	  return NO;
+	}
+      ptr += sizeof(w);
+    }
+  while (ptr < end)
+    {
+      if (*ptr++ & 0x80)
+	{
+	  return NO;
+	}
+    }
+  while ((src = memchr(src, '=', end - src)) != NULL)
+    {
+      if (++src < end && '?' == *src)
+	{
+	  return NO;
+	}
+    }
+  return YES;
+}
+
+/* Test for an encoding in which plain ASCII text means the same as it
+ * does in ASCII.
+ */
+static inline BOOL
+isASCIICompatible(NSStringEncoding enc)
+{
+  switch (enc)
+    {
+      case NSASCIIStringEncoding:
+      case NSUTF8StringEncoding:
+      case NSISOLatin1StringEncoding:
+      case NSISOLatin2StringEncoding:
+      case NSWindowsCP1250StringEncoding:
+      case NSWindowsCP1251StringEncoding:
+      case NSWindowsCP1252StringEncoding:
+	return YES;
+      default:
+	return NO;
+    }
+}
+
+@interface GSMimeHeader (Private)
+- (id) _initWithName: (NSString*)n lower: (NSString*)l value: (NSString*)v;
+@end
+
 @interface GSMimeDocument (Private)
 - (GSMimeHeader*) _lastHeaderNamed: (NSString*)name;
 - (NSUInteger) _indexOfHeaderNamed: (NSString*)name;
@@ -162,40 +329,104 @@ decodebase64(unsigned char *dst, const unsigned char *src)
   dst[2] = ((src[2] & 0x03) << 6) |  (src[3] & 0x3F);
 }
 
+/* The value of each character in the standard base64 alphabet, or 255
+ * for any other character.
+ */
+#define	X	255
+static const unsigned char	b64Value[256] = {
+  X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X,
+  X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X,
+  X, X, X, X, X, X, X, X, X, X, X, 62, X, X, X, 63,
+  52, 53, 54, 55, 56, 57, 58, 59, 60, 61, X, X, X, X, X, X,
+  X, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14,
+  15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, X, X, X, X, X,
+  X, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40,
+  41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, X, X, X, X, X,
+  X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X,
+  X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X,
+  X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X,
+  X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X,
+  X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X,
+  X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X,
+  X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X,
+  X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X,
+};
+#undef	X
+
+/*
+ *	Name -		decodebase64run()
+ *	Purpose -	Decode groups of four characters of the standard base64
+ *			alphabet, stopping at the first group containing any
+ *			other character (eg. a line break or padding).  Returns
+ *			the number of characters used, which the caller adds
+ *			to its source pointer (and three quarters of it to
+ *			the destination pointer).
+ */
+static NSUInteger
+decodebase64run(unsigned char *dst, const unsigned char *src, NSUInteger len)
+{
+  const unsigned char	*beg = src;
+  const unsigned char	*end = src + (len & ~(NSUInteger)3);
+
+  while (src < end)
+    {
+      unsigned	c0 = b64Value[src[0]];
+      unsigned	c1 = b64Value[src[1]];
+      unsigned	c2 = b64Value[src[2]];
+      unsigned	c3 = b64Value[src[3]];
+
+      if ((c0 | c1 | c2 | c3) & 0xC0)
+	{
+	  break;
+	}
+      dst[0] = (c0 << 2) | (c1 >> 4);
+      dst[1] = (c1 << 4) | (c2 >> 2);
+      dst[2] = (c2 << 6) | c3;
+      dst += 3;
+      src += 4;
+    }
+  return src - beg;
+}
+
 void
 GSPrivateEncodeBase64(const uint8_t *src, NSUInteger length, uint8_t *dst)
 {
-  int	dIndex = 0;
-  int	sIndex;
+  static char b64[]
+    = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  const uint8_t	*end = src + length - length % 3;
 
-  for (sIndex = 0; sIndex < length; sIndex += 3)
+  /* Encode each complete group of three bytes without checking for the
+   * end of the data.
+   */
+  while (src < end)
     {
-      static char b64[]
-        = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
-      int	c0 = src[sIndex];
-      int	c1 = (sIndex+1 < length) ? src[sIndex+1] : 0;
-      int	c2 = (sIndex+2 < length) ? src[sIndex+2] : 0;
+      uint32_t	v = (src[0] << 16) | (src[1] << 8) | src[2];
 
-      dst[dIndex++] = b64[(c0 >> 2) & 077];
-      dst[dIndex++] = b64[((c0 << 4) & 060) | ((c1 >> 4) & 017)];
-      dst[dIndex++] = b64[((c1 << 2) & 074) | ((c2 >> 6) & 03)];
-      dst[dIndex++] = b64[c2 & 077];
+      dst[0] = b64[v >> 18];
+      dst[1] = b64[(v >> 12) & 077];
+      dst[2] = b64[(v >> 6) & 077];
+      dst[3] = b64[v & 077];
+      src += 3;
+      dst += 4;
     }
 
-   /* If len was not a multiple of 3, then we have encoded too
-    * many characters.  Adjust appropriately.
-    */
-   if (sIndex == length + 1)
-     {
-       /* There were only 2 bytes in that last group */
-       dst[dIndex - 1] = '=';
-     }
-   else if (sIndex == length + 2)
-     {
-       /* There was only 1 byte in that last group */
-       dst[dIndex - 1] = '=';
-       dst[dIndex - 2] = '=';
-     }
+  /* If len was not a multiple of 3, encode the last one or two bytes
+   * and pad the group.
+   */
+  if (length % 3 == 2)
+    {
+      dst[0] = b64[src[0] >> 2];
+      dst[1] = b64[((src[0] << 4) & 060) | (src[1] >> 4)];
+      dst[2] = b64[(src[1] << 2) & 074];
+      dst[3] = '=';
+    }
+  else if (length % 3 == 1)
+    {
+      dst[0] = b64[src[0] >> 2];
+      dst[1] = b64[(src[0] << 4) & 060];
+      dst[2] = '=';
+      dst[3] = '=';
+    }
 }
 
 static void
@@ -599,8 +830,20 @@ wordData(NSString *word, BOOL *encoded)
    */
   while (src < end)
     {
-      int	cc = *src++;
+      int	cc;
 
+      if (0 == pos)
+	{
+	  NSUInteger	used = decodebase64run(dst, src, end - src);
+
+	  src += used;
+	  dst += used / 4 * 3;
+	  if (src >= end)
+	    {
+	      break;
+	    }
+	}
+      cc = *src++;
       if (isupper(cc))
 	{
 	  cc -= 'A';
@@ -834,6 +1077,7 @@ wordData(NSString *word, BOOL *encoded)
 - (BOOL) _decodeBody: (NSData*)d;
 - (NSString*) _decodeHeader;
 - (NSRange) _endOfHeaders: (NSData*)newData;
+- (BOOL) _parseSimpleHeader;
 - (BOOL) _scanHeaderParameters: (NSScanner*)scanner into: (GSMimeHeader*)info;
 @end
 
@@ -907,6 +1151,13 @@ wordData(NSString *word, BOOL *encoded)
     {
       headerClass = [GSMimeHeader class];
     }
+  if (parseHeaderIMP == 0)
+    {
+      parseHeaderIMP = [GSMimeParser instanceMethodForSelector:
+	@selector(parseHeader:)];
+      scanHeaderBodyIMP = [GSMimeParser instanceMethodForSelector:
+	@selector(scanHeaderBody:into:)];
+    }
 }
 
 /**
@@ -1080,11 +1331,11 @@ wordData(NSString *word, BOOL *encoded)
       beg = 0;
 
       /* Make sure buffer is big enough, and set up output pointers.
-       * ctxt->size is the amount of data laready decoded, so if we
-       * add the size of the chunked source data we are guaranteed
-       * to have enough space for the unchunked data.
+       * The unchunked data can be no larger than the chunked source data,
+       * so adding that size to what is already in the buffer guarantees
+       * enough space (even if the buffer is emptied between calls).
        */
-      [dData setLength: ctxt->size + [sData length]];
+      [dData setLength: size + aRange.length];
       buf = (unsigned char*)[dData mutableBytes];
       dst = buf + size;
       beg = dst;
@@ -1172,8 +1423,19 @@ wordData(NSString *word, BOOL *encoded)
 	       */
 	      if (ctxt->pos > 0)
 		{
-		  *dst++ = *src++;
-		  if (--ctxt->pos == 0)
+		  NSUInteger	n = end - src;
+
+		  /* Copy as much of the chunk as we have in one go.
+		   */
+		  if (n > ctxt->pos)
+		    {
+		      n = ctxt->pos;
+		    }
+		  memcpy(dst, src, n);
+		  dst += n;
+		  src += n;
+		  ctxt->pos -= n;
+		  if (ctxt->pos == 0)
 		    {
 		      ctxt->state = ChunkEol2;
 		    }
@@ -1287,6 +1549,38 @@ wordData(NSString *word, BOOL *encoded)
   return result;
 }
 
+/**
+ * Returns the delegate set using the -setDelegate: method.
+ */
+- (id) delegate
+{
+  return delegate;
+}
+
+/**
+ * <p>
+ *   Sets a delegate (which is not retained) to be told about the
+ *   documents parsed.  Once the headers of a document (or of each
+ *   part of a multipart document) have been parsed, the delegate is
+ *   asked whether it wants the body data streamed to it.  If it does,
+ *   the decoded data is passed to the delegate as it arrives and is
+ *   not stored as the content of the document, so a large document
+ *   may be parsed without having to hold it all in memory.
+ * </p>
+ * <p>
+ *   With a delegate set, the parts of a multipart document are also
+ *   passed to the parsers for the parts as they arrive, rather than
+ *   after the whole of each part has been read.
+ * </p>
+ * <p>
+ *   See the GSMimeParser informal protocol for the delegate methods.
+ * </p>
+ */
+- (void) setDelegate: (id)anObject
+{
+  delegate = anObject;
+}
+
 - (NSString*) description
 {
   NSString	*desc;
@@ -1501,6 +1795,7 @@ wordData(NSString *word, BOOL *encoded)
   GSMimeHeader	*hdr;
   NSRange	r;
   NSUInteger	l = [d length];
+  BOOL		simple;
 
   if (flags.complete == 1 || flags.inBody == 1)
     {
@@ -1563,10 +1858,27 @@ wordData(NSString *word, BOOL *encoded)
 	}
     }
 
+  /* Plain headers may be taken straight from the raw data unless a
+   * subclass has changed the way headers are parsed, or the charset
+   * used for web headers might give a different result from ASCII.
+   * The status line of a response makes the headers web headers, so
+   * the charset is checked again for each header.
+   */
+  simple = ([self methodForSelector: @selector(parseHeader:)]
+    == parseHeaderIMP
+    && [self methodForSelector: @selector(scanHeaderBody:into:)]
+    == scanHeaderBodyIMP);
+
   while (flags.inBody == 0)
     {
       NSString		*header;
 
+      if (YES == simple
+	&& (0 == flags.isHttp || isASCIICompatible(_defaultEncoding))
+	&& YES == [self _parseSimpleHeader])
+	{
+	  continue;
+	}
       header = [self _decodeHeader];
       if (header == nil)
 	{
@@ -2346,6 +2658,26 @@ NSDebugMLLog(@"GSMime", @"Header parsed - %@", info);
 
 @end
 
+@implementation	NSObject (GSMimeParser)
+- (BOOL) mimeParser: (GSMimeParser*)parser
+  shouldStreamDocument: (GSMimeDocument*)doc
+{
+  return NO;
+}
+- (void) mimeParser: (GSMimeParser*)parser
+	   document: (GSMimeDocument*)doc
+	decodedData: (NSData*)data
+{
+  return;
+}
+- (void) mimeParser: (GSMimeParser*)parser
+   finishedDocument: (GSMimeDocument*)doc
+{
+  return;
+}
+@end
+
+
 @implementation	GSMimeParser (Private)
 
 /*
@@ -2367,6 +2699,29 @@ NSDebugMLLog(@"GSMime", @"Header parsed - %@", info);
    * Tell child parser the default encoding to use.
    */
   child->_defaultEncoding = _defaultEncoding;
+  child->delegate = delegate;
+}
+
+/* Return the position in buf after the line terminator for a boundary
+ * which ends at pos (or after the marker for the end of a multipart
+ * document).
+ */
+static NSUInteger
+skipBoundaryEnd(const unsigned char *buf, NSUInteger pos, NSUInteger len)
+{
+  if (pos + 1 < len && buf[pos] == '-' && buf[pos+1] == '-')
+    {
+      pos += 2;
+    }
+  if (pos < len && buf[pos] == '\r')
+    {
+      pos++;
+    }
+  if (pos < len && buf[pos] == '\n')
+    {
+      pos++;
+    }
+  return pos;
 }
 
 /*
@@ -2412,6 +2767,17 @@ NSDebugMLLog(@"GSMime", @"Header parsed - %@", info);
       context = [self contextFor: hdr];
       IF_NO_GC([context retain];)
       NSDebugMLLog(@"GSMime", @"Parse body expects %u bytes", expect);
+
+      /* A delegate may take the decoded data of anything but a multipart
+       * document (whose parts are documents in their own right) as it
+       * arrives.  Uuencoded data can't be decoded until it is complete.
+       */
+      if (delegate != nil && boundary == nil
+	&& [context class] != [GSMimeUUCodingContext class])
+	{
+	  flags.streaming = [delegate mimeParser: self
+			    shouldStreamDocument: document] ? 1 : 0;
+	}
     }
 
   NSDebugMLLog(@"GSMime", @"Parse %u bytes - '%*.*s'",
@@ -2463,7 +2829,25 @@ NSDebugMLLog(@"GSMime", @"Header parsed - %@", info);
 		  intoData: data
 	       withContext: context];
 
-	  if ([context atEnd] == YES
+	  if (1 == flags.streaming && [data length] > 0)
+	    {
+	      [delegate mimeParser: self
+			  document: document
+		       decodedData: data];
+	      [data setLength: 0];
+	    }
+
+	  if (1 == flags.streaming && ([context atEnd] == YES
+	    || (expect > 0 && rawBodyLength >= expect)))
+	    {
+	      flags.inBody = 0;
+	      flags.complete = 1;
+
+	      NSDebugMLLog(@"GSMime", @"%@", @"Parse body complete");
+	      [delegate mimeParser: self finishedDocument: document];
+	      needsMore = NO;
+	    }
+	  else if ([context atEnd] == YES
 	    || (expect > 0 && rawBodyLength >= expect))
 	    {
 	      NSString	*subtype = [typeInfo objectForKey: @"Subtype"];
@@ -2654,6 +3038,24 @@ NSDebugMLLog(@"GSMime", @"Header parsed - %@", info);
 	    }
 	  if (found == NO)
 	    {
+	      /* With a delegate, the child may be streaming its body, so
+	       * we pass it everything up to the line end which might come
+	       * before the next boundary rather than buffering the section.
+	       */
+	      if (child != nil && delegate != nil
+		&& lineStart > sectionStart + 2)
+		{
+		  NSData	*childBody;
+
+		  childBody = [[NSData alloc]
+		    initWithBytesNoCopy: (void*)(buf + sectionStart)
+				 length: lineStart - 2 - sectionStart
+			   freeWhenDone: NO];
+		  [child parse: childBody];
+		  [childBody release];
+		  sectionStart = lineStart - 2;
+		}
+
 	      /* Need more data ... so, if we have none buffered we must
 	       * buffer any unused data, otherwise we can copy data within
 	       * the buffer.
@@ -2669,7 +3071,7 @@ NSDebugMLLog(@"GSMime", @"Header parsed - %@", info);
 	      else if (sectionStart > 0)
 		{
 		  len -= sectionStart;
-		  memcpy(bytes, buf + sectionStart, len);
+		  memmove(bytes, buf + sectionStart, len);
 		  sectionStart = lineStart = 0;
 		  [data setLength: len];
 		  dataEnd = len;
@@ -2682,10 +3084,11 @@ NSDebugMLLog(@"GSMime", @"Header parsed - %@", info);
 
 	      /*
 	       * Found boundary at the start of the first section.
-	       * Set sectionStart to point immediately after boundary.
+	       * Set sectionStart to point immediately after boundary
+	       * and its line terminator.
 	       */
 	      lineStart += bLength;
-	      sectionStart = lineStart;
+	      sectionStart = skipBoundaryEnd(buf, lineStart, len);
 
 	      /*
 	       * If we have an explicit character set for the multipart
@@ -2708,29 +3111,13 @@ NSDebugMLLog(@"GSMime", @"Header parsed - %@", info);
 
 	      /*
 	       * Found boundary at the end of a section.
-	       * Skip past line terminator for boundary at start of section
-	       * or past marker for end of multipart document.
-	       */
-	      if (buf[sectionStart] == '-' && sectionStart < len
-		&& buf[sectionStart+1] == '-')
-		{
-		  sectionStart += 2;
-		}
-	      if (buf[sectionStart] == '\r')
-		{
-		  sectionStart++;
-		}
-	      if (buf[sectionStart] == '\n')
-		{
-		  sectionStart++;
-		}
-
-	      /*
-	       * Create data object for this section and pass it to the
-	       * child parser to deal with.  NB. As lineStart points to
-	       * the start of the end boundary, we need to step back to
-	       * before the end of line introducing it in order to have
-	       * the correct length of body data for the child document.
+	       * Create data object for the rest of this section and pass
+	       * it to the child parser to deal with.  NB. As lineStart
+	       * points to the start of the end boundary, we need to step
+	       * back to before the end of line introducing it in order to
+	       * have the correct length of body data for the child document
+	       * (which is empty if the boundary follows straight on from
+	       * the one starting the section).
 	       */
 	      pos = lineStart;
 	      if (pos > 0 && buf[pos-1] == '\n')
@@ -2741,6 +3128,10 @@ NSDebugMLLog(@"GSMime", @"Header parsed - %@", info);
 		{
 		  pos--;
 		}
+	      if (pos < sectionStart)
+		{
+		  pos = sectionStart;
+		}
 	      /* Since we know the child can't modify it, and we know
 	       * that we aren't going to change the buffer while the
 	       * child is using it, we can safely pass a data object
@@ -2787,7 +3178,7 @@ NSDebugMLLog(@"GSMime", @"Header parsed - %@", info);
 	       * Update parser data.
 	       */
 	      lineStart += bLength;
-	      sectionStart = lineStart;
+	      sectionStart = skipBoundaryEnd(buf, lineStart, len);
 	      if (endedFinalPart == YES)
 		{
 		  if (eol < len)
@@ -2820,6 +3211,38 @@ NSDebugMLLog(@"GSMime", @"Header parsed - %@", info);
   return needsMore;
 }
 
+/* Return a pointer to the next place in header data where -_decodeHeader
+ * has work to do (a line end or the start of an encoded word), or to the
+ * end of the data if there is none.  Uses memchr() since that is much
+ * faster than looking at each byte in turn.
+ */
+static inline const unsigned char *
+nextSpecial(const unsigned char *src, const unsigned char *end)
+{
+  const unsigned char	*eol;
+  const unsigned char	*eq;
+
+  eol = memchr(src, '\n', end - src);
+  if (NULL == eol)
+    {
+      eol = end;
+    }
+  else if (eol > src && '\r' == eol[-1])
+    {
+      eol--;
+    }
+  eq = src;
+  while ((eq = memchr(eq, '=', eol - eq)) != NULL)
+    {
+      if (eq + 1 < end && '?' == eq[1])
+	{
+	  return eq;
+	}
+      eq++;
+    }
+  return eol;
+}
+
 static const unsigned char *
 unfold(const unsigned char *src, const unsigned char *end, BOOL *folded)
 {
@@ -2898,6 +3321,16 @@ unfold(const unsigned char *src, const unsigned char *end, BOOL *folded)
 
   while (src < end)
     {
+      if (0 == flags.encodedWord)
+	{
+	  /* Outside an encoded word, we can skip ordinary text.
+	   */
+	  src = nextSpecial(src, end);
+	  if (src >= end)
+	    {
+	      break;
+	    }
+	}
       if (src[0] == '\n'
         || (src[0] == '\r' && src+1 < end && src[1] == '\n')
         || (src[0] == '=' && src+1 < end && src[1] == '?'))
@@ -3260,43 +3693,31 @@ unfold(const unsigned char *src, const unsigned char *end, BOOL *folded)
 	}
     }
 
-  /* Now check for end of headers in new data.
+  /* Now check for end of headers in new data.  Use memchr() to find each
+   * LF (with room for another line end after it) and only then look at
+   * the bytes around it.  A preceding CR belongs with the LF.
    */
   pos = 0;
   while (pos + 2 <= nl)
     {
-      c = np[pos];
+      const unsigned char	*lf;
+      unsigned int		start;
+
+      lf = memchr(np + pos, '\n', nl - pos - 1);
+      if (NULL == lf)
+	{
+	  break;
+	}
+      pos = lf - np;
+      start = (pos > 0 && '\r' == np[pos - 1]) ? pos - 1 : pos;
+      c = np[pos + 1];
       if ('\n' == c)
 	{
-	  char	c1 = np[pos + 1];
-
-	  if ('\n' ==  c1)
-	    {
-	      return NSMakeRange(pos + ol, 2);	// LFLF
-	    }
-	  if ('\r' == c1 && pos + 3 <= nl && '\n' == np[pos + 2])
-	    {
-	      return NSMakeRange(pos + ol, 3);	// LFCRLF
-	    }
+	  return NSMakeRange(start + ol, pos + 2 - start);	// (CR)LFLF
 	}
-      else if ('\r' == c)
+      if ('\r' == c && pos + 3 <= nl && '\n' == np[pos + 2])
 	{
-	  char	c1 = np[pos + 1];
-
-	  if ('\n' == c1 && pos + 3 <= nl)
-	    {
-	      char	c2 = np[pos + 2];
-
-	      if ('\n' == c2)
-		{
-		  return NSMakeRange(pos + ol, 3);	// CRLFLF
-		}
-	      if ('\r' == c2 && pos + 4 <= nl && '\n' == np[pos + 3])
-		{
-		  return NSMakeRange(pos + ol, 4);	// CRLFCRLF
-		}
-	      pos++;
-	    }
+	  return NSMakeRange(start + ol, pos + 3 - start);	// (CR)LFCRLF
 	}
       pos++;
     }
@@ -3304,6 +3725,120 @@ unfold(const unsigned char *src, const unsigned char *end, BOOL *folded)
   return NSMakeRange(NSNotFound, 0);
 }
 
+/* Parse the next header straight from the raw data if it is a simple
+ * one (a single line of plain ASCII, with a name needing no special
+ * treatment), avoiding the cost of -_decodeHeader and -parseHeader:
+ * which most web headers have no need for.  The result is the same as
+ * the general code would produce.<br />
+ * Returns NO, having changed nothing, if the header is not simple or is
+ * not yet complete.
+ */
+- (BOOL) _parseSimpleHeader
+{
+  const unsigned char	*beg = &bytes[input];
+  const unsigned char	*end = &bytes[dataEnd];
+  const unsigned char	*eol;
+  const unsigned char	*lim;
+  const unsigned char	*colon;
+  const unsigned char	*val;
+  const unsigned char	*ptr;
+  const KnownHeader	*known;
+  unsigned char		buf[64];
+  NSUInteger		len;
+  NSString		*n;
+  NSString		*l;
+  NSString		*v;
+  GSMimeHeader		*info;
+
+  if (beg >= end || (eol = memchr(beg, '\n', end - beg)) == NULL
+    || eol + 1 >= end)
+    {
+      return NO;	// Can't yet tell whether the header is folded.
+    }
+  if (isspace(eol[1]) && eol[1] != '\r' && eol[1] != '\n')
+    {
+      return NO;	// Folded header.
+    }
+  lim = (eol > beg && '\r' == eol[-1]) ? eol - 1 : eol;
+  colon = memchr(beg, ':', lim - beg);
+  if (NULL == colon)
+    {
+      return NO;	// Empty line or not a header.
+    }
+  len = colon - beg;
+  if (0 == len || len > sizeof(buf))
+    {
+      return NO;
+    }
+  for (ptr = beg; ptr < colon; ptr++)
+    {
+      if (NO == isTokenChar(*ptr))
+	{
+	  return NO;
+	}
+      buf[ptr - beg] = tolower(*ptr);
+    }
+  val = colon + 1;
+  while (val < lim && isspace(*val))
+    {
+      val++;
+    }
+  if (NO == isPlainText(val, lim))
+    {
+      return NO;
+    }
+
+  for (known = knownHeaders; known->length > 0; known++)
+    {
+      if (known->length == len
+	&& 0 == strncasecmp(known->bytes, (const char*)beg, len))
+	{
+	  break;
+	}
+    }
+  if (known->length > 0)
+    {
+      if (nil == known->name)
+	{
+	  return NO;	// Needs the full checks in -parseHeader:
+	}
+      if (0 == memcmp(known->bytes, beg, len))
+	{
+	  n = RETAIN(known->name);
+	}
+      else
+	{
+	  n = [NSStringClass allocWithZone: NSDefaultMallocZone()];
+	  n = [n initWithBytes: beg length: len encoding: NSASCIIStringEncoding];
+	}
+      l = RETAIN(known->lower);
+    }
+  else
+    {
+      n = [NSStringClass allocWithZone: NSDefaultMallocZone()];
+      n = [n initWithBytes: beg length: len encoding: NSASCIIStringEncoding];
+      l = [NSStringClass allocWithZone: NSDefaultMallocZone()];
+      l = [l initWithBytes: buf length: len encoding: NSASCIIStringEncoding];
+    }
+  v = [NSStringClass allocWithZone: NSDefaultMallocZone()];
+  v = [v initWithBytes: val length: lim - val encoding: NSASCIIStringEncoding];
+
+  info = [headerClass allocWithZone: NSDefaultMallocZone()];
+  info = [info _initWithName: n lower: l value: v];
+  RELEASE(n);
+  RELEASE(l);
+  RELEASE(v);
+  NSDebugMLLog(@"GSMime", @"Parse header - '%@: %@'",
+    [info namePreservingCase: YES], [info value]);
+  [document addHeader: info];
+  RELEASE(info);
+
+  input = eol + 1 - bytes;
+  flags.encodedWord = 0;
+  expect = 0;
+  return YES;
+}
+
 - (BOOL) _scanHeaderParameters: (NSScanner*)scanner into: (GSMimeHeader*)info
 {
   [self scanPastSpace: scanner];
@@ -4533,6 +5068,22 @@ appendString(NSMutableData *m, NSUInteger offset, NSUInteger fold,
 
 @end
 
+@implementation	GSMimeHeader (Private)
+
+/* Initialise a header whose name the parser has already checked to be a
+ * valid token, and which needs none of the special treatment given by
+ * -initWithName:value:parameters: to names like content-type.
+ */
+- (id) _initWithName: (NSString*)n lower: (NSString*)l value: (NSString*)v
+{
+  name = RETAIN(n);
+  lower = RETAIN(l);
+  value = [v copy];
+  return self;
+}
+
+@end
+
 
 
 /**
@@ -4825,8 +5376,20 @@ appendString(NSMutableData *m, NSUInteger offset, NSUInteger fold,
 
   while ((src != end) && *src != '\0')
     {
-      int	c = *src++;
+      int	c;
+
+      if (0 == pos)
+	{
+	  NSUInteger	used = decodebase64run(dst, src, end - src);
 
+	  src += used;
+	  dst += used / 4 * 3;
+	  if (src == end || *src == '\0')
+	    {
+	      break;
+	    }
+	}
+      c = *src++;
       if (isupper(c))
 	{
 	  c -= 'A';
@@ -8448,8 +9011,8 @@ GS_PRIVATE_INTERNAL(GSMimeSMTPClient)
           length = [internal->istream read: buf maxLength: sizeof(buf)];
           if (length > 0)
             {
-              uint8_t   *ptr;
-              int       i;
+              const uint8_t     *ptr;
+              NSUInteger        end;
 
               if (internal->rdata == nil)
                 {
@@ -8461,30 +9024,45 @@ GS_PRIVATE_INTERNAL(GSMimeSMTPClient)
                   [internal->rdata appendBytes: buf length: length];
                   length = [internal->rdata length];
                 }
-              ptr = [internal->rdata mutableBytes];
-              for (i = 0; i < length; i++)
+
+              /* Find the end of the last complete line we have, copy all
+               * the complete lines into a single data object, and pass
+               * each line on as a slice of that object.  Any partial line
+               * is left in rdata to be completed by the next read.
+               */
+              ptr = [internal->rdata bytes];
+              for (end = length; end > 0 && ptr[end - 1] != '\n'; end--)
+                ;
+              if (end > 0)
                 {
-                  if (ptr[i] == '\n')
+                  NSData        *chunk;
+                  NSUInteger    start = 0;
+                  NSUInteger    i;
+
+                  chunk = [[NSData alloc] initWithBytes: ptr length: end];
+                  if (end == (NSUInteger)length)
+                    {
+                      DESTROY(internal->rdata);
+                    }
+                  else
                     {
-                      NSData    *d;
+                      uint8_t   *mptr = [internal->rdata mutableBytes];
 
-                      i++;
-                      if (i == length)
-                        {
-                          d = [internal->rdata autorelease];
-                          internal->rdata = nil;
-                        }
-                      else
+                      memmove(mptr, mptr + end, length - end);
+                      [internal->rdata setLength: length - end];
+                    }
+                  ptr = [chunk bytes];
+                  for (i = 0; i < end; i++)
+                    {
+                      if (ptr[i] == '\n')
                         {
-                          d = [NSData dataWithBytes: ptr length: i];
-                          memcpy(ptr, ptr + i, length - i);
-                          length -= i;
-                          [internal->rdata setLength: length];
-                          ptr = [internal->rdata mutableBytes];
-                          i = -1;
+                          NSRange       r = NSMakeRange(start, i + 1 - start);
+
+                          [self _recvData: [chunk subdataWithRange: r]];
+                          start = i + 1;
                         }
-                      [self _recvData: d];
                     }
+                  RELEASE(chunk);
                 }
             }
           else
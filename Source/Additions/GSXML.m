@@ -2517,6 +2517,86 @@ static NSString	*endMarker = @"At end of incremental parse";
  */
 #define	HANDLER	((GSSAXHandler*)(((xmlParserCtxtPtr)ctx)->_private))
 
+/*
+ * The state a handler keeps while parsing.  Element and attribute names
+ * and namespaces are held in the dictionary of the parser context, so we
+ * can make each into a string just once and look it up by its address.
+ * Adjacent pieces of text are gathered up and reported together.
+ */
+typedef struct {
+  NSMapTable		*names;		// Strings keyed by dictionary entry
+  unsigned char		*text;		// Characters not yet reported
+  unsigned		used;
+  unsigned		size;
+  BOOL			coalesce;	// Gather up characters
+} GSSAXState;
+
+/* The state is kept in the same allocation as the libxml2 SAX handler
+ * structure, after it, so that it adds nothing to the instance layout.
+ */
+typedef struct {
+  xmlSAXHandler		sax;		// Must be first (lib points here)
+  GSSAXState		state;
+} GSSAXLib;
+
+#define	STATE(H)	(&((GSSAXLib*)((H)->lib))->state)
+
+// Most text we gather before reporting it.
+#define	MAX_TEXT	65536
+
+static inline NSString*
+internStr(void *ctx, const unsigned char *bytes)
+{
+  xmlDictPtr	dict = ((xmlParserCtxtPtr)ctx)->dict;
+  GSSAXState	*s = STATE(HANDLER);
+  NSString	*str;
+
+  if (NULL == bytes)
+    {
+      return nil;
+    }
+  if (s->names != 0 && (str = NSMapGet(s->names, bytes)) != nil)
+    {
+      return str;
+    }
+  if (NULL == dict || xmlDictOwns(dict, bytes) != 1)
+    {
+      return UTF8Str(bytes);
+    }
+  str = [[NSString_class alloc] initWithUTF8String: (const char*)bytes];
+  if (nil != str)
+    {
+      if (0 == s->names)
+	{
+	  s->names = NSCreateMapTable(NSNonOwnedPointerMapKeyCallBacks,
+	    NSObjectMapValueCallBacks, 64);
+	}
+      NSMapInsert(s->names, bytes, str);
+      RELEASE(str);
+    }
+  return str;
+}
+
+/* Reports the text gathered so far, returning NO if the handler stopped
+ * the parse in response.
+ */
+static BOOL
+flushText(void *ctx)
+{
+  GSSAXState	*s = STATE(HANDLER);
+  NSString	*str = UTF8StrLen(s->text, s->used);
+
+  s->used = 0;
+  [HANDLER characters: str];
+  return (0 == ((xmlParserCtxtPtr)ctx)->disableSAX) ? YES : NO;
+}
+
+/* Must be used by every event callback other than characters, so that
+ * text is reported in order.
+ */
+#define	FLUSH(ctx) \
+  if (STATE(HANDLER)->used > 0 && NO == flushText(ctx)) return
+
 static xmlEntityPtr
 getEntityDefault(void *ctx, const xmlChar *name, BOOL resolve)
 {
@@ -2866,6 +2946,7 @@ static void
 endDocumentFunction(void *ctx)
 {
   NSCAssert(ctx,@"No Context");
+  FLUSH(ctx);
   [HANDLER endDocument];
 }
 
@@ -3001,6 +3082,7 @@ startElementFunction(void *ctx, const unsigned char *name,
   NSMutableDictionary *dict;
 
   NSCAssert(ctx,@"No Context");
+  FLUSH(ctx);
   dict = [NSMutableDictionary dictionary];
   if (atts != NULL)
     {
@@ -3008,7 +3090,7 @@ startElementFunction(void *ctx, const unsigned char *name,
 
       while (atts[i] != NULL)
 	{
-	  NSString		*key = UTF8Str(atts[i++]);
+	  NSString		*key = internStr(ctx, atts[i++]);
 	  NSString		*obj;
 	  const unsigned char	*val = atts[i++];
 
@@ -3025,14 +3107,15 @@ startElementFunction(void *ctx, const unsigned char *name,
 	  [dict setObject: obj forKey: key];
 	}
     }
-  [HANDLER startElement: UTF8Str(name)
+  [HANDLER startElement: internStr(ctx, name)
 	     attributes: dict];
 }
 
 static void
 endElementFunction(void *ctx, const unsigned char *name)
 {
-  [HANDLER endElement: UTF8Str(name)];
+  FLUSH(ctx);
+  [HANDLER endElement: internStr(ctx, name)];
 }
 
 static void
@@ -3047,7 +3130,8 @@ startElementNsFunction(void *ctx, const unsigned char *name,
   NSString		*elem;
 
   NSCAssert(ctx,@"No Context");
-  elem = UTF8Str(name);
+  FLUSH(ctx);
+  elem = internStr(ctx, name);
   if (atts != NULL)
     {
       int 	i;
@@ -3056,14 +3140,13 @@ startElementNsFunction(void *ctx, const unsigned char *name,
       adict = [NSMutableDictionary dictionaryWithCapacity: nb_attributes];
       for (i = j = 0; i < nb_attributes; i++, j += 5)
 	{
-	  NSString	*key = UTF8Str(atts[j]);
+	  NSString	*key = internStr(ctx, atts[j]);
           NSString      *obj = nil;
           // We need to append the namespace prefix
           if (atts[j+1] != NULL)
             {
-              key =
-               [[UTF8Str(atts[j+1]) stringByAppendingString: @":"]
-                                      stringByAppendingString: key];
+              key = [NSString_class stringWithFormat: @"%@:%@",
+		internStr(ctx, atts[j+1]), key];
             }
 	  obj = UTF8StrLen(atts[j+3], atts[j+4]-atts[j+3]);
 
@@ -3087,7 +3170,7 @@ startElementNsFunction(void *ctx, const unsigned char *name,
             }
           else
             {
-              key = UTF8Str(namespaces[pos]);
+              key = internStr(ctx, namespaces[pos]);
             }
           pos++;
           if (namespaces[pos] == 0)
@@ -3096,15 +3179,15 @@ startElementNsFunction(void *ctx, const unsigned char *name,
             }
           else
             {
-              obj = UTF8Str(namespaces[pos]);
+              obj = internStr(ctx, namespaces[pos]);
             }
           pos++;
           [ndict setObject: obj forKey: key];
         }
     }
   [HANDLER startElement: elem
-		 prefix: UTF8Str(prefix)
-		   href: UTF8Str(href)
+		 prefix: internStr(ctx, prefix)
+		   href: internStr(ctx, href)
 	     attributes: adict
              namespaces: ndict];
 }
@@ -3114,22 +3197,64 @@ endElementNsFunction(void *ctx, const unsigned char *name,
   const unsigned char *prefix, const unsigned char *href)
 {
   NSCAssert(ctx,@"No Context");
-  [HANDLER endElement: UTF8Str(name)
-	       prefix: UTF8Str(prefix)
-		 href: UTF8Str(href)];
+  FLUSH(ctx);
+  [HANDLER endElement: internStr(ctx, name)
+	       prefix: internStr(ctx, prefix)
+		 href: internStr(ctx, href)];
 }
 
 static void
 charactersFunction(void *ctx, const unsigned char *ch, int len)
 {
+  GSSAXState	*s;
+
   NSCAssert(ctx,@"No Context");
-  [HANDLER characters: UTF8StrLen(ch, len)];
+  s = STATE(HANDLER);
+  if (YES == s->coalesce && s->used + len > s->size)
+    {
+      /* Report what we have rather than let the buffer grow too large.
+       */
+      if (s->used > 0 && s->used + len > MAX_TEXT && NO == flushText(ctx))
+	{
+	  return;
+	}
+      if (s->used + len > s->size)
+	{
+	  unsigned	size = (s->size < 1024) ? 1024 : s->size;
+	  unsigned char	*tmp;
+
+	  while (size < s->used + len)
+	    {
+	      size *= 2;
+	    }
+	  if ((tmp = realloc(s->text, size)) == NULL)
+	    {
+	      s->coalesce = NO;
+	    }
+	  else
+	    {
+	      s->text = tmp;
+	      s->size = size;
+	    }
+	}
+    }
+  if (YES == s->coalesce)
+    {
+      memcpy(s->text + s->used, ch, len);
+      s->used += len;
+    }
+  else
+    {
+      FLUSH(ctx);
+      [HANDLER characters: UTF8StrLen(ch, len)];
+    }
 }
 
 static void
 referenceFunction(void *ctx, const unsigned char *name)
 {
   NSCAssert(ctx,@"No Context");
+  FLUSH(ctx);
   [HANDLER reference: UTF8Str(name)];
 }
 
@@ -3137,6 +3262,7 @@ static void
 ignorableWhitespaceFunction(void *ctx, const unsigned char *ch, int len)
 {
   NSCAssert(ctx,@"No Context");
+  FLUSH(ctx);
   [HANDLER ignoreWhitespace: UTF8StrLen(ch, len)];
 }
 
@@ -3145,6 +3271,7 @@ processingInstructionFunction(void *ctx, const unsigned char *target,
   const char *data)
 {
   NSCAssert(ctx,@"No Context");
+  FLUSH(ctx);
   [HANDLER processInstruction: UTF8Str(target)
 			 data: UTF8Str((const unsigned char*)data)];
 }
@@ -3153,6 +3280,7 @@ static void
 cdataBlockFunction(void *ctx, const unsigned char *value, int len)
 {
   NSCAssert(ctx,@"No Context");
+  FLUSH(ctx);
   [HANDLER cdataBlock: [NSData dataWithBytes: value length: len]];
 }
 
@@ -3160,6 +3288,7 @@ static void
 commentFunction(void *ctx, const unsigned char *value)
 {
   NSCAssert(ctx,@"No Context");
+  FLUSH(ctx);
   [HANDLER comment: UTF8Str(value)];
 }
 
@@ -3179,6 +3308,10 @@ warningFunction(void *ctx, const unsigned char *msg, ...)
   NSCAssert(ctx,@"No Context");
   lineNumber = getLineNumber(ctx);
   colNumber = xmlSAX2GetColumnNumber(ctx);
+  if (STATE(HANDLER)->used > 0)
+    {
+      flushText(ctx);
+    }
   [HANDLER warning: estr
 	 colNumber: colNumber
 	lineNumber: lineNumber];
@@ -3199,6 +3332,10 @@ errorFunction(void *ctx, const unsigned char *msg, ...)
   NSCAssert(ctx,@"No Context");
   lineNumber = xmlSAX2GetLineNumber(ctx);
   colNumber = xmlSAX2GetColumnNumber(ctx);
+  if (STATE(HANDLER)->used > 0)
+    {
+      flushText(ctx);
+    }
   [HANDLER error: estr
        colNumber: colNumber
       lineNumber: lineNumber];
@@ -3219,6 +3356,10 @@ fatalErrorFunction(void *ctx, const unsigned char *msg, ...)
   NSCAssert(ctx, @"No Context");
   lineNumber = xmlSAX2GetLineNumber(ctx);
   colNumber = xmlSAX2GetColumnNumber(ctx);
+  if (STATE(HANDLER)->used > 0)
+    {
+      flushText(ctx);
+    }
   [HANDLER fatalError: estr
             colNumber: colNumber
            lineNumber: lineNumber];
@@ -3272,6 +3413,13 @@ fatalErrorFunction(void *ctx, const unsigned char *msg, ...)
 {
   if (lib != NULL)
     {
+      GSSAXState	*s = STATE(self);
+
+      if (s->names != 0)
+	{
+	  NSFreeMapTable(s->names);
+	}
+      free(s->text);
       free(lib);
     }
   [super dealloc];
@@ -3300,7 +3448,9 @@ fatalErrorFunction(void *ctx, const unsigned char *msg, ...)
 }
 
 /**
- * Called when an opening tag has been processed.
+ * Called when an opening tag has been processed.<br />
+ * The attributes dictionary is emptied and passed again for a later
+ * element unless something other than the handler has retained it.
  */
 - (void) startElement: (NSString*)elementName
 	   attributes: (NSMutableDictionary*)elementAttributes
@@ -3352,7 +3502,9 @@ fatalErrorFunction(void *ctx, const unsigned char *msg, ...)
 }
 
 /**
- * Receiving some chars from the parser.
+ * Receiving some chars from the parser.<br />
+ * Adjacent pieces of text are reported together, so this is called
+ * once for each run of text, unless the run is very large.
  */
 - (void) characters: (NSString*) name
 {
@@ -3589,7 +3741,7 @@ fatalErrorFunction(void *ctx, const unsigned char *msg, ...)
  */
 - (BOOL) _initLibXML
 {
-  lib = (xmlSAXHandler*)malloc(sizeof(xmlSAXHandler));
+  lib = (xmlSAXHandler*)calloc(1, sizeof(GSSAXLib));
   if (lib == NULL)
     {
       return NO;
@@ -3633,12 +3785,25 @@ fatalErrorFunction(void *ctx, const unsigned char *msg, ...)
       LIB->cdataBlock             = (void*) cdataBlockFunction;
       LIB->resolveEntity          = (void*) resolveEntityFunction;
 #undef	LIB
+      /* All events come to us, so we can gather up characters and
+       * report them before whatever comes next.
+       */
+      STATE(self)->coalesce = YES;
       return YES;
     }
 }
 
 - (void) _setParser: (GSXMLParser*)value
 {
+  GSSAXState	*s = STATE(self);
+
+  /* Names are only valid for the parser they came from.
+   */
+  if (s->names != 0)
+    {
+      NSResetMapTable(s->names);
+    }
+  s->used = 0;
   parser = value;
 }
 @end
@@ -3708,7 +3873,7 @@ fatalErrorFunction(void *ctx, const unsigned char *msg, ...)
 
 - (BOOL) _initLibXML
 {
-  lib = (xmlSAXHandler*)malloc(sizeof(xmlSAXHandler));
+  lib = (xmlSAXHandler*)calloc(1, sizeof(GSSAXLib));
   if (lib == NULL)
     {
       return NO;
@@ -3775,7 +3940,7 @@ fatalErrorFunction(void *ctx, const unsigned char *msg, ...)
 - (BOOL) _initLibXML
 {
   isHtmlHandler = YES;
-  lib = (xmlSAXHandler*)malloc(sizeof(htmlSAXHandler));
+  lib = (xmlSAXHandler*)calloc(1, sizeof(GSSAXLib));
   if (lib == NULL)
     {
       return NO;
@@ -3811,6 +3976,7 @@ fatalErrorFunction(void *ctx, const unsigned char *msg, ...)
       LIB->getParameterEntity     = (void*)getParameterEntityFunction;
       LIB->cdataBlock             = (void*)cdataBlockFunction;
 #undef	LIB
+      STATE(self)->coalesce = YES;
       return YES;
     }
 }
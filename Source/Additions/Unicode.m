@@ -870,6 +870,261 @@ decode(uint32_t* state, uint32_t* codep, uint32_t byte)
 #endif
 
 
+/* Bulk conversion helpers for the common ASCII and Latin-1 cases.
+ * Each has a portable scalar version and, on x86, SSE2 and AVX2 versions.
+ * The implementation is chosen at runtime the first time one is used;
+ * setting the GNUSTEP_UNICODE_SCALAR environment variable to YES forces
+ * the scalar versions (useful for benchmarking and testing).
+ */
+#if	defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#if	defined(__SSE2__)
+#define	GS_UNICODE_SSE2	1
+#endif
+#if	defined(__clang__) || __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)
+#define	GS_UNICODE_AVX2	1
+#endif
+#endif
+
+/* Return the number of leading bytes in src which are ASCII.
+ */
+static unsigned
+asciiPrefixScalar(const unsigned char *src, unsigned len)
+{
+  unsigned	i = 0;
+
+  while (i + 8 <= len)
+    {
+      uint64_t	w;
+
+      memcpy(&w, src + i, 8);
+      if (w & 0x8080808080808080ULL)
+	{
+	  break;
+	}
+      i += 8;
+    }
+  while (i < len && src[i] < 0x80)
+    {
+      i++;
+    }
+  return i;
+}
+
+/* Widen 8-bit (ASCII/Latin-1) characters to unichars.
+ */
+static void
+widenScalar(unichar *dst, const unsigned char *src, unsigned len)
+{
+  unsigned	i;
+
+  for (i = 0; i < len; i++)
+    {
+      dst[i] = src[i];
+    }
+}
+
+/* Copy leading unichars below limit (128 or 256) to 8-bit output,
+ * stopping at the first character which is not.  Returns the count copied.
+ */
+static unsigned
+narrowScalar(unsigned char *dst, const unichar *src, unsigned len,
+  unichar limit)
+{
+  unsigned	i;
+
+  for (i = 0; i < len && src[i] < limit; i++)
+    {
+      dst[i] = (unsigned char)src[i];
+    }
+  return i;
+}
+
+#if	defined(GS_UNICODE_SSE2)
+static unsigned
+asciiPrefixSSE2(const unsigned char *src, unsigned len)
+{
+  unsigned	i = 0;
+
+  while (i + 16 <= len)
+    {
+      __m128i	v = _mm_loadu_si128((const __m128i*)(src + i));
+      int	m = _mm_movemask_epi8(v);
+
+      if (m != 0)
+	{
+	  return i + __builtin_ctz(m);
+	}
+      i += 16;
+    }
+  return i + asciiPrefixScalar(src + i, len - i);
+}
+
+static void
+widenSSE2(unichar *dst, const unsigned char *src, unsigned len)
+{
+  __m128i	zero = _mm_setzero_si128();
+  unsigned	i = 0;
+
+  while (i + 16 <= len)
+    {
+      __m128i	v = _mm_loadu_si128((const __m128i*)(src + i));
+
+      _mm_storeu_si128((__m128i*)(dst + i), _mm_unpacklo_epi8(v, zero));
+      _mm_storeu_si128((__m128i*)(dst + i + 8), _mm_unpackhi_epi8(v, zero));
+      i += 16;
+    }
+  widenScalar(dst + i, src + i, len - i);
+}
+
+static unsigned
+narrowSSE2(unsigned char *dst, const unichar *src, unsigned len,
+  unichar limit)
+{
+  __m128i	mask = _mm_set1_epi16((short)(unichar)~(limit - 1));
+  __m128i	zero = _mm_setzero_si128();
+  unsigned	i = 0;
+
+  while (i + 16 <= len)
+    {
+      __m128i	a = _mm_loadu_si128((const __m128i*)(src + i));
+      __m128i	b = _mm_loadu_si128((const __m128i*)(src + i + 8));
+      __m128i	t = _mm_and_si128(_mm_or_si128(a, b), mask);
+
+      if (_mm_movemask_epi8(_mm_cmpeq_epi16(t, zero)) != 0xffff)
+	{
+	  break;
+	}
+      _mm_storeu_si128((__m128i*)(dst + i), _mm_packus_epi16(a, b));
+      i += 16;
+    }
+  return i + narrowScalar(dst + i, src + i, len - i, limit);
+}
+#endif
+
+#if	defined(GS_UNICODE_AVX2)
+__attribute__((target("avx2"))) static unsigned
+asciiPrefixAVX2(const unsigned char *src, unsigned len)
+{
+  unsigned	i = 0;
+
+  while (i + 32 <= len)
+    {
+      __m256i	v = _mm256_loadu_si256((const __m256i*)(src + i));
+      unsigned	m = (unsigned)_mm256_movemask_epi8(v);
+
+      if (m != 0)
+	{
+	  return i + __builtin_ctz(m);
+	}
+      i += 32;
+    }
+  return i + asciiPrefixScalar(src + i, len - i);
+}
+
+__attribute__((target("avx2"))) static void
+widenAVX2(unichar *dst, const unsigned char *src, unsigned len)
+{
+  unsigned	i = 0;
+
+  while (i + 16 <= len)
+    {
+      __m128i	v = _mm_loadu_si128((const __m128i*)(src + i));
+
+      _mm256_storeu_si256((__m256i*)(dst + i), _mm256_cvtepu8_epi16(v));
+      i += 16;
+    }
+  widenScalar(dst + i, src + i, len - i);
+}
+
+__attribute__((target("avx2"))) static unsigned
+narrowAVX2(unsigned char *dst, const unichar *src, unsigned len,
+  unichar limit)
+{
+  __m256i	mask = _mm256_set1_epi16((short)(unichar)~(limit - 1));
+  unsigned	i = 0;
+
+  while (i + 32 <= len)
+    {
+      __m256i	a = _mm256_loadu_si256((const __m256i*)(src + i));
+      __m256i	b = _mm256_loadu_si256((const __m256i*)(src + i + 16));
+      __m256i	p;
+
+      if (!_mm256_testz_si256(_mm256_or_si256(a, b), mask))
+	{
+	  break;
+	}
+      /* packus works within 128bit lanes, so restore the order.
+       */
+      p = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xd8);
+      _mm256_storeu_si256((__m256i*)(dst + i), p);
+      i += 32;
+    }
+  return i + narrowScalar(dst + i, src + i, len - i, limit);
+}
+#endif
+
+static unsigned asciiPrefixSelect(const unsigned char *src, unsigned len);
+static void widenSelect(unichar *dst, const unsigned char *src, unsigned len);
+static unsigned narrowSelect(unsigned char *dst, const unichar *src,
+  unsigned len, unichar limit);
+
+static unsigned	(*asciiPrefix)(const unsigned char*, unsigned)
+  = asciiPrefixSelect;
+static void	(*widen)(unichar*, const unsigned char*, unsigned)
+  = widenSelect;
+static unsigned	(*narrow)(unsigned char*, const unichar*, unsigned, unichar)
+  = narrowSelect;
+
+static void
+selectConverters(void)
+{
+  if (GSPrivateEnvironmentFlag("GNUSTEP_UNICODE_SCALAR", NO) == NO)
+    {
+#if	defined(GS_UNICODE_AVX2)
+      if (__builtin_cpu_supports("avx2"))
+	{
+	  asciiPrefix = asciiPrefixAVX2;
+	  widen = widenAVX2;
+	  narrow = narrowAVX2;
+	  return;
+	}
+#endif
+#if	defined(GS_UNICODE_SSE2)
+      asciiPrefix = asciiPrefixSSE2;
+      widen = widenSSE2;
+      narrow = narrowSSE2;
+      return;
+#endif
+    }
+  asciiPrefix = asciiPrefixScalar;
+  widen = widenScalar;
+  narrow = narrowScalar;
+}
+
+static unsigned
+asciiPrefixSelect(const unsigned char *src, unsigned len)
+{
+  selectConverters();
+  return (*asciiPrefix)(src, len);
+}
+
+static void
+widenSelect(unichar *dst, const unsigned char *src, unsigned len)
+{
+  selectConverters();
+  (*widen)(dst, src, len);
+}
+
+static unsigned
+narrowSelect(unsigned char *dst, const unichar *src, unsigned len,
+  unichar limit)
+{
+  selectConverters();
+  return (*narrow)(dst, src, len, limit);
+}
+
+
 /**
  * Function to convert from 8-bit data to 16-bit unicode characters.
  * <p>The dst argument is a pointer to a pointer to a buffer in which the
@@ -980,6 +1235,25 @@ GSToUnicode(unichar **dst, unsigned int *size, const unsigned char *src,
 	    {
 
 #if     defined(UTF8DECODE)
+	      /* Fast track ... a run of ascii characters between complete
+	       * sequences widens straight to unicode.
+	       */
+	      if (UTF8_ACCEPT == state && src[spos] < 0x80)
+		{
+		  unsigned	n = (*asciiPrefix)(src + spos, slen - spos);
+
+		  if (dst != 0)
+		    {
+		      while (dpos + n > bsize)
+			{
+			  GROW();
+			}
+		      (*widen)(ptr + dpos, src + spos, n);
+		    }
+		  dpos += n;
+		  spos += n;
+		  continue;
+		}
               if (decode(&state, &u, src[spos++]))
                 {
                   continue;
@@ -1303,16 +1577,13 @@ GSToUnicode(unichar **dst, unsigned int *size, const unsigned char *src,
 		    bsize = grow / sizeof(unichar);
 		  }
 	      }
-	    while (spos < slen)
+	    spos = (*asciiPrefix)(src, slen);
+	    (*widen)(ptr + dpos, src, spos);
+	    dpos += spos;
+	    if (spos < slen)
 	      {
-		unichar	c = (unichar)((unc)src[spos++]);
-
-		if (c > 127)
-		  {
-		    result = NO;	// Non-ascii data found in input.
-		    goto done;
-		  }
-		ptr[dpos++] = c;
+		result = NO;	// Non-ascii data found in input.
+		goto done;
 	      }
 	  }
 	break;
@@ -1361,10 +1632,9 @@ GSToUnicode(unichar **dst, unsigned int *size, const unsigned char *src,
 		    bsize = grow / sizeof(unichar);
 		  }
 	      }
-	    while (spos < slen)
-	      {
-		ptr[dpos++] = (unichar)((unc)src[spos++]);
-	      }
+	    (*widen)(ptr + dpos, src, slen);
+	    dpos += slen;
+	    spos = slen;
 	  }
 	break;
 
@@ -2011,22 +2281,31 @@ GSFromUnicode(unsigned char **dst, unsigned int *size, const unichar *src,
 		  int		sl;
 		  int		i;
 
-		  /* get first unichar */
-		  u1 = src[spos++];
-
-		  /* Fast track ... if this is actually an ascii character
-		   * it just converts straight to utf-8
+		  /* Fast track ... a run of ascii characters
+		   * converts straight to utf-8
 		   */
-		  if (u1 <= 0x7f)
+		  if (src[spos] <= 0x7f)
 		    {
+		      unsigned	n;
+
 		      if (dpos >= bsize)
 			{
 			  GROW();
 			}
-		      ptr[dpos++] = (unsigned char)u1;
+		      n = slen - spos;
+		      if (n > bsize - dpos)
+			{
+			  n = bsize - dpos;
+			}
+		      n = (*narrow)(ptr + dpos, src + spos, n, 0x80);
+		      dpos += n;
+		      spos += n;
 		      continue;
 		    }
 
+		  /* get first unichar */
+		  u1 = src[spos++];
+
 		  // 0xfeff is a zero-width-no-break-space inside text
 		  if (u1 >= 0xdc00 && u1 <= 0xdfff)	// bad pairing
 		    {
@@ -2268,8 +2547,27 @@ bases:
 	  {
 	    /* Just counting bytes, and we know there is exactly one
 	     * unicode codepoint needed for each character.
+	     * In strict mode, every character must be representable.
 	     */
+	    if (strict == YES)
+	      {
+		while (spos < slen)
+		  {
+		    unichar	u = src[spos++];
+
+		    if (swapped == YES)
+		      {
+			u = (((u & 0xff00) >> 8) + ((u & 0x00ff) << 8));
+		      }
+		    if (u >= base)
+		      {
+			result = NO;
+			goto done;
+		      }
+		  }
+	      }
 	    dpos = slen;
+	    goto done;
 	  }
         else
 	  {
@@ -2326,16 +2624,18 @@ bases:
 	      {
 		while (spos < slen)
 		  {
-		    unichar	u = src[spos++];
+		    unichar	u;
+		    unsigned	n;
 
-		    if (u < base)
+		    n = (*narrow)(ptr + dpos, src + spos, slen - spos, base);
+		    dpos += n;
+		    spos += n;
+		    if (spos == slen)
 		      {
-			ptr[dpos++] = (unsigned char)u;
-		      }
-		    else
-		      {
-			ptr[dpos++] =  '?';
+			break;
 		      }
+		    u = src[spos++];
+		    ptr[dpos++] = (u < base) ? (unsigned char)u : '?';
 		  }
 	      }
 	  }
@@ -2361,19 +2661,12 @@ bases:
 	      }
 	    else
 	      {
-		while (spos < slen)
+		spos = (*narrow)(ptr, src, slen, base);
+		dpos = spos;
+		if (spos < slen)
 		  {
-		    unichar	u = src[spos++];
-
-		    if (u < base)
-		      {
-			ptr[dpos++] = (unsigned char)u;
-		      }
-		    else
-		      {
-			result = NO;
-			goto done;
-		      }
+		    result = NO;
+		    goto done;
 		  }
 	      }
 	  }
@@ -1163,7 +1163,7 @@ GSInvocationCallback (void *callback_data, va_alist args)
   BOOL		out_parameters = NO;
   const char	*type = [_sig methodType];
 
-  [coder encodeValueOfObjCType: @encode(char*) at: &type];
+  [coder encodeMethodType: type];
 
   for (i = 0; i < _numArgs; i++)
     {
@@ -628,7 +628,7 @@ GSFFIInvocationCallback(ffi_cif *cif, void *retp, void **args, void *user)
   BOOL		out_parameters = NO;
   const char	*type = [_sig methodType];
 
-  [coder encodeValueOfObjCType: @encode(char*) at: &type];
+  [coder encodeMethodType: type];
 
   for (i = 0; i < _numArgs; i++)
     {
@@ -69,6 +69,9 @@ struct sockaddr_in;
 #if	defined(_WIN32)
   WSAEVENT  		event;
 #endif
+  void			*ringRead;	/* Read queued on an io_uring	*/
+  void			*ringWrite;	/* Write queued on an io_uring	*/
+  BOOL			ringOff;	/* Do not use an io_uring	*/
 #endif
 }
 
@@ -107,6 +110,10 @@ struct sockaddr_in;
 	       forMode: (NSString*)mode;
 
 - (void) setAddr: (struct sockaddr *)sin;
+- (NSInteger) transfer: (int)fd
+		offset: (unsigned long long*)offset
+		length: (NSUInteger)len
+		method: (int*)how;
 
 - (BOOL) useCompression;
 - (void) watchReadDescriptorForModes: (NSArray*)modes;
@@ -62,6 +62,7 @@
 #endif
 
 #include <sys/ioctl.h>
+#include <sys/uio.h>
 #ifdef	__svr4__
 #  ifdef HAVE_SYS_FILIO_H
 #    include <sys/filio.h>
@@ -69,6 +70,25 @@
 #endif
 #include <netdb.h>
 
+#if	defined(__linux__)
+#  include <sys/sendfile.h>
+#  include <sys/syscall.h>
+#  if	defined(__has_include)
+#    if	__has_include(<linux/io_uring.h>)
+#      include <linux/io_uring.h>
+#      include <sys/eventfd.h>
+#      include <sys/mman.h>
+#      if	defined(SYS_io_uring_setup) && defined(IORING_FEAT_RW_CUR_POS) \
+  && defined(IO_URING_OP_SUPPORTED)
+#        define	GS_IO_URING	1
+#        ifndef	IORING_SQ_CQ_OVERFLOW
+#          define	IORING_SQ_CQ_OVERFLOW	(1U << 1)
+#        endif
+#      endif
+#    endif
+#  endif
+#endif
+
 /*
  *	Stuff for setting the sockets into non-blocking mode.
  */
@@ -96,6 +116,129 @@
 #define	NETBUF_SIZE	(1024 * 16)
 #define	READ_SIZE	NETBUF_SIZE*10
 
+// Maximum data copied by the kernel in one call.
+#define	COPY_SIZE	0x40000000
+// Maximum data moved in each event of a background transfer.
+#define	TRANSFER_SIZE	(8 * 1024 * 1024)
+// Size of buffer used when the kernel cannot copy data for us.
+#define	BUFFER_SIZE	(64 * 1024)
+
+/* Returns YES if a copy failed because the descriptors do not support
+ * the method used, so another method should be tried.
+ */
+static inline BOOL
+unsupportedCopy(int e)
+{
+  return (e == EINVAL || e == ENOSYS || e == EXDEV || e == EOPNOTSUPP
+    || e == EBADF || e == ESPIPE) ? YES : NO;
+}
+
+NSInteger
+GSPrivateCopyDescriptor(int in, unsigned long long *offset, int out,
+  NSUInteger length, int *how)
+{
+  off_t		pos = (off_t)*offset;
+  ssize_t	result = -1;
+
+  if (length > COPY_SIZE)
+    {
+      length = COPY_SIZE;
+    }
+
+#if	defined(__linux__)
+#  if	defined(SYS_copy_file_range)
+  if (GSCopyRange == *how)
+    {
+      do
+	{
+	  result = syscall(SYS_copy_file_range, in, &pos, out, NULL, length, 0);
+	}
+      while (result < 0 && EINTR == errno);
+      /* Some kernels report the end of file for pseudo files whose data
+       * they cannot copy, so let sendfile() confirm the end of the input.
+       */
+      if (result > 0 || (result < 0 && NO == unsupportedCopy(errno)))
+	{
+	  goto done;
+	}
+      pos = (off_t)*offset;
+      *how = GSCopySendfile;
+    }
+#  endif
+  if (GSCopyRange == *how)
+    {
+      *how = GSCopySendfile;
+    }
+  if (GSCopySendfile == *how)
+    {
+      do
+	{
+	  result = sendfile(out, in, &pos, length);
+	}
+      while (result < 0 && EINTR == errno);
+      if (result >= 0 || NO == unsupportedCopy(errno))
+	{
+	  goto done;
+	}
+      pos = (off_t)*offset;
+      *how = GSCopySplice;
+    }
+#  if	defined(SPLICE_F_MOVE)
+  if (GSCopySplice == *how)
+    {
+      do
+	{
+	  result = splice(in, &pos, out, NULL, length, SPLICE_F_MOVE);
+	}
+      while (result < 0 && EINTR == errno);
+      if (result >= 0 || NO == unsupportedCopy(errno))
+	{
+	  goto done;
+	}
+      pos = (off_t)*offset;
+    }
+#  endif
+#endif
+  *how = GSCopyBuffer;
+
+  {
+    char	buf[BUFFER_SIZE];
+    ssize_t	got;
+
+    if (length > sizeof(buf))
+      {
+	length = sizeof(buf);
+      }
+    do
+      {
+	got = pread(in, buf, length, pos);
+      }
+    while (got < 0 && EINTR == errno);
+    if (got <= 0)
+      {
+	return got;
+      }
+    do
+      {
+	result = write(out, buf, got);
+      }
+    while (result < 0 && EINTR == errno);
+    if (result > 0)
+      {
+	pos += result;
+      }
+  }
+
+#if	defined(__linux__)
+done:
+#endif
+  if (result > 0)
+    {
+      *offset = (unsigned long long)pos;
+    }
+  return result;
+}
+
 static GSFileHandle     *fh_stdin = nil;
 static GSFileHandle     *fh_stdout = nil;
 static GSFileHandle     *fh_stderr = nil;
@@ -257,21 +400,505 @@ static int	tuneSBuf = 0;
 
 // Key to info dictionary for operation mode.
 static NSString*	NotificationKey = @"NSFileHandleNotificationKey";
+// Keys to info dictionary for the state of a background transfer.
+static NSString*	TransferOffsetKey = @"GSFileHandleTransferOffset";
+static NSString*	TransferLengthKey = @"GSFileHandleTransferLength";
+static NSString*	TransferMethodKey = @"GSFileHandleTransferMethod";
+
+#if	defined(GS_IO_URING)
+
+// Number of entries in the submission queue of an io_uring.
+#define	RING_SIZE	256
+
+/* Minimal io_uring ring, driven through the raw system calls so that
+ * no library is needed.  Only the submitting thread uses a ring.
+ */
+typedef struct {
+  int			fd;		// The ring
+  int			efd;		// Signalled when completions arrive
+  unsigned		*sqHead;
+  unsigned		*sqTail;
+  unsigned		*sqFlags;
+  unsigned		*sqArray;
+  unsigned		sqMask;
+  unsigned		sqEntries;
+  struct io_uring_sqe	*sqes;
+  unsigned		*cqHead;
+  unsigned		*cqTail;
+  unsigned		cqMask;
+  struct io_uring_cqe	*cqes;
+  void			*sqMap;
+  size_t		sqLen;
+  void			*cqMap;
+  size_t		cqLen;
+  size_t		sqesLen;
+  unsigned		queued;		// Prepared but not yet submitted
+} GSRing;
+
+static void
+ringClose(GSRing *r)
+{
+  if (r->sqes != MAP_FAILED && r->sqes != 0)
+    {
+      munmap(r->sqes, r->sqesLen);
+    }
+  if (r->cqMap != MAP_FAILED && r->cqMap != 0 && r->cqMap != r->sqMap)
+    {
+      munmap(r->cqMap, r->cqLen);
+    }
+  if (r->sqMap != MAP_FAILED && r->sqMap != 0)
+    {
+      munmap(r->sqMap, r->sqLen);
+    }
+  if (r->efd >= 0)
+    {
+      close(r->efd);
+    }
+  if (r->fd >= 0)
+    {
+      close(r->fd);
+    }
+  memset(r, '\0', sizeof(GSRing));
+  r->fd = r->efd = -1;
+}
+
+/* Returns YES if the kernel supports every operation we use.
+ */
+static BOOL
+ringProbe(int fd)
+{
+  static const int	ops[] = { IORING_OP_READV, IORING_OP_WRITE,
+    IORING_OP_ACCEPT, IORING_OP_ASYNC_CANCEL };
+  struct io_uring_probe	*p;
+  size_t		size;
+  BOOL			ok = NO;
+  unsigned		i;
+
+  size = sizeof(*p) + 256 * sizeof(struct io_uring_probe_op);
+  if ((p = calloc(1, size)) == 0)
+    {
+      return NO;
+    }
+  if (syscall(SYS_io_uring_register, fd, IORING_REGISTER_PROBE, p, 256) == 0)
+    {
+      ok = YES;
+      for (i = 0; i < sizeof(ops) / sizeof(*ops); i++)
+	{
+	  if (ops[i] > p->last_op
+	    || (p->ops[ops[i]].flags & IO_URING_OP_SUPPORTED) == 0)
+	    {
+	      ok = NO;
+	    }
+	}
+    }
+  free(p);
+  return ok;
+}
+
+/* Sets up a ring with the specified number of submission entries and an
+ * eventfd which is signalled on completion.  Returns NO (leaving the ring
+ * closed) if the kernel lacks any feature we need.
+ */
+static BOOL
+ringOpen(GSRing *r, unsigned entries)
+{
+  struct io_uring_params	p;
+  char				*sq;
+  char				*cq;
+
+  memset(r, '\0', sizeof(GSRing));
+  r->fd = r->efd = -1;
+  memset(&p, '\0', sizeof(p));
+  r->fd = syscall(SYS_io_uring_setup, entries, &p);
+  if (r->fd < 0)
+    {
+      r->fd = -1;
+      return NO;
+    }
+  /* Operations at the current file position, completions kept when the
+   * queue is full, and one mapping for both rings.
+   */
+  if ((p.features & IORING_FEAT_RW_CUR_POS) == 0
+    || (p.features & IORING_FEAT_NODROP) == 0
+    || (p.features & IORING_FEAT_SINGLE_MMAP) == 0
+    || NO == ringProbe(r->fd))
+    {
+      ringClose(r);
+      return NO;
+    }
+
+  r->sqLen = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+  r->cqLen = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+  if (r->cqLen > r->sqLen)
+    {
+      r->sqLen = r->cqLen;
+    }
+  r->cqLen = r->sqLen;
+  r->sqMap = mmap(0, r->sqLen, PROT_READ|PROT_WRITE,
+    MAP_SHARED|MAP_POPULATE, r->fd, IORING_OFF_SQ_RING);
+  if (r->sqMap == MAP_FAILED)
+    {
+      ringClose(r);
+      return NO;
+    }
+  r->cqMap = r->sqMap;
+  r->sqesLen = p.sq_entries * sizeof(struct io_uring_sqe);
+  r->sqes = mmap(0, r->sqesLen, PROT_READ|PROT_WRITE,
+    MAP_SHARED|MAP_POPULATE, r->fd, IORING_OFF_SQES);
+  if (r->sqes == MAP_FAILED)
+    {
+      ringClose(r);
+      return NO;
+    }
+
+  sq = (char*)r->sqMap;
+  r->sqHead = (unsigned*)(sq + p.sq_off.head);
+  r->sqTail = (unsigned*)(sq + p.sq_off.tail);
+  r->sqFlags = (unsigned*)(sq + p.sq_off.flags);
+  r->sqArray = (unsigned*)(sq + p.sq_off.array);
+  r->sqMask = *(unsigned*)(sq + p.sq_off.ring_mask);
+  r->sqEntries = p.sq_entries;
+  cq = (char*)r->cqMap;
+  r->cqHead = (unsigned*)(cq + p.cq_off.head);
+  r->cqTail = (unsigned*)(cq + p.cq_off.tail);
+  r->cqMask = *(unsigned*)(cq + p.cq_off.ring_mask);
+  r->cqes = (struct io_uring_cqe*)(cq + p.cq_off.cqes);
+
+  r->efd = eventfd(0, EFD_NONBLOCK|EFD_CLOEXEC);
+  if (r->efd < 0
+    || syscall(SYS_io_uring_register, r->fd, IORING_REGISTER_EVENTFD,
+      &r->efd, 1) != 0)
+    {
+      ringClose(r);
+      return NO;
+    }
+  return YES;
+}
+
+/* Passes prepared entries to the kernel, waiting for at least wait
+ * completions.  Returns the result of io_uring_enter().
+ */
+static int
+ringEnter(GSRing *r, unsigned wait)
+{
+  unsigned	flags = 0;
+  int		result;
+
+  if (wait > 0 || (__atomic_load_n(r->sqFlags, __ATOMIC_ACQUIRE)
+    & IORING_SQ_CQ_OVERFLOW))
+    {
+      flags |= IORING_ENTER_GETEVENTS;
+    }
+  do
+    {
+      result = syscall(SYS_io_uring_enter, r->fd, r->queued, wait, flags,
+	NULL, 0);
+    }
+  while (result < 0 && EINTR == errno);
+  if (result > 0)
+    {
+      r->queued -= ((unsigned)result > r->queued) ? r->queued : result;
+    }
+  return result;
+}
+
+/* Returns a cleared entry to be prepared and then queued with
+ * ringQueue(), or NULL if the submission queue is full and cannot be
+ * emptied now.
+ */
+static struct io_uring_sqe *
+ringEntry(GSRing *r)
+{
+  unsigned	tail = *r->sqTail;
+  struct io_uring_sqe	*sqe;
+
+  if (tail - __atomic_load_n(r->sqHead, __ATOMIC_ACQUIRE) >= r->sqEntries)
+    {
+      ringEnter(r, 0);
+      if (tail - __atomic_load_n(r->sqHead, __ATOMIC_ACQUIRE) >= r->sqEntries)
+	{
+	  return 0;
+	}
+    }
+  sqe = &r->sqes[tail & r->sqMask];
+  memset(sqe, '\0', sizeof(*sqe));
+  return sqe;
+}
+
+/* Makes the entry returned by ringEntry() visible to the kernel, which
+ * sees it on the next ringEnter().
+ */
+static void
+ringQueue(GSRing *r, struct io_uring_sqe *sqe)
+{
+  unsigned	tail = *r->sqTail;
+
+  r->sqArray[tail & r->sqMask] = sqe - r->sqes;
+  __atomic_store_n(r->sqTail, tail + 1, __ATOMIC_RELEASE);
+  r->queued++;
+}
+
+/* Returns the next completion, or NULL if there is none.  The entry must
+ * be released by ringSeen() before calling this again.
+ */
+static struct io_uring_cqe *
+ringCompletion(GSRing *r)
+{
+  unsigned	head = *r->cqHead;
+
+  if (head == __atomic_load_n(r->cqTail, __ATOMIC_ACQUIRE))
+    {
+      return 0;
+    }
+  return &r->cqes[head & r->cqMask];
+}
+
+static void
+ringSeen(GSRing *r)
+{
+  __atomic_store_n(r->cqHead, *r->cqHead + 1, __ATOMIC_RELEASE);
+}
+
+enum {
+  GSRingRead,
+  GSRingAccept,
+  GSRingWrite
+};
+
+@class	GSFileHandleRing;
+
+/* An operation queued on an io_uring.  It holds on to the file handle
+ * and the data being read or written until the kernel has finished.
+ */
+typedef struct {
+  GSFileHandleRing	*ring;
+  GSFileHandle		*handle;
+  id			item;
+  NSArray		*modes;
+  GSDataSpace		space;
+  struct iovec		iov[2];
+  int			kind;
+  BOOL			cancelled;
+} GSRingOp;
+
+/* The io_uring used by the file handles of one thread.  The run loop
+ * watches its eventfd in the modes of the operations queued on it, and
+ * operations queued while handling events are passed to the kernel
+ * together, just before the run loop waits for more.
+ */
+@interface	GSFileHandleRing : NSObject <RunLoopEvents>
+{
+@public
+  GSRing	ring;
+}
+- (void) cancel: (GSRingOp*)op;
+- (void) completed: (GSRingOp*)op result: (int)result;
+- (void) queue: (GSRingOp*)op entry: (struct io_uring_sqe*)sqe;
+- (void) watch: (NSArray*)modes add: (BOOL)flag;
+@end
+
+#endif
 
 @interface GSFileHandle(private)
+- (NSInteger) readData: (NSMutableData*)d limit: (NSUInteger)max;
+- (NSInteger) readInto: (NSMutableData*)d length: (NSUInteger)len;
+- (NSUInteger) readSize;
+- (void) accepted: (int)desc;
+- (NSUInteger) readLength: (BOOL)large;
 - (void) receivedEventRead;
+- (void) receivedEventTransfer: (NSMutableDictionary*)info;
 - (void) receivedEventWrite;
+- (void) receivedRead: (NSInteger)received;
+- (void) receivedWrite: (NSInteger)written;
+#if	defined(GS_IO_URING)
+- (GSFileHandleRing*) ring;
+- (void) ringDone: (GSRingOp*)op result: (int)result;
+- (BOOL) ringRead: (NSArray*)modes;
+- (BOOL) ringWrite;
+#endif
 @end
 
+#if	defined(GS_IO_URING)
+
+/* How background operations may use an io_uring: not at all (0), for
+ * regular files (1, the default) or for all descriptors (2).
+ */
+static int	ringPolicy = 1;
+static NSString	*ringKey = @"GSFileHandleRing";
+static BOOL	ringFailed = NO;
+
+/* Returns the ring for the current thread, creating it if necessary
+ * and possible.
+ */
+static GSFileHandleRing *
+currentRing(BOOL create)
+{
+  NSMutableDictionary	*d = [[NSThread currentThread] threadDictionary];
+  GSFileHandleRing	*r = [d objectForKey: ringKey];
+
+  if (nil == r && YES == create && NO == ringFailed)
+    {
+      r = [GSFileHandleRing new];
+      if (NO == ringOpen(&r->ring, RING_SIZE))
+	{
+	  NSDebugFLog(@"GSFileHandle io_uring unavailable - %@",
+	    [NSError _last]);
+	  ringFailed = YES;
+	  DESTROY(r);
+	}
+      else
+	{
+	  [d setObject: r forKey: ringKey];
+	  RELEASE(r);
+	}
+    }
+  return r;
+}
+
+@implementation	GSFileHandleRing
+
+- (void) cancel: (GSRingOp*)op
+{
+  struct io_uring_sqe	*sqe;
+
+  op->cancelled = YES;
+  if (currentRing(NO) == self && (sqe = ringEntry(&ring)) != 0)
+    {
+      sqe->opcode = IORING_OP_ASYNC_CANCEL;
+      sqe->addr = (uintptr_t)op;
+      ringQueue(&ring, sqe);
+    }
+}
+
+- (void) completed: (GSRingOp*)op result: (int)result
+{
+  [self watch: op->modes add: NO];
+  if (GSRingRead == op->kind)
+    {
+      GSPrivateDataExtend(op->item, &op->space,
+	(YES == op->cancelled || result < 0) ? 0 : result);
+    }
+  else if (GSRingAccept == op->kind && YES == op->cancelled && result >= 0)
+    {
+      close(result);
+    }
+  if (NO == op->cancelled)
+    {
+      [op->handle ringDone: op result: result];
+    }
+  RELEASE(op->handle);
+  RELEASE(op->item);
+  RELEASE(op->modes);
+  NSZoneFree(NSDefaultMallocZone(), op);
+}
+
+- (void) dealloc
+{
+  /* Any operation still in the kernel is leaked rather than freed, as
+   * the kernel may use its buffers until the ring is shut down.
+   */
+  ringClose(&ring);
+  [super dealloc];
+}
+
+- (void) queue: (GSRingOp*)op entry: (struct io_uring_sqe*)sqe
+{
+  op->ring = self;
+  sqe->user_data = (uintptr_t)op;
+  ringQueue(&ring, sqe);
+  [self watch: op->modes add: YES];
+}
+
+- (void) receivedEvent: (void*)data
+                  type: (RunLoopEventType)type
+		 extra: (void*)extra
+	       forMode: (NSString*)mode
+{
+  struct io_uring_cqe	*cqe;
+  uint64_t		count;
+
+  (void)read(ring.efd, &count, sizeof(count));
+  while ((cqe = ringCompletion(&ring)) != 0)
+    {
+      GSRingOp	*op = (GSRingOp*)(uintptr_t)cqe->user_data;
+      int	result = cqe->res;
+
+      ringSeen(&ring);
+      if (op != 0)
+	{
+	  [self completed: op result: result];
+	}
+    }
+}
+
+/* Called before the run loop waits, to pass everything queued in this
+ * iteration to the kernel in one call.
+ */
+- (BOOL) runLoopShouldBlock: (BOOL*)trigger
+{
+  if (ring.queued > 0
+    || (__atomic_load_n(ring.sqFlags, __ATOMIC_ACQUIRE)
+    & IORING_SQ_CQ_OVERFLOW))
+    {
+      ringEnter(&ring, 0);
+    }
+  *trigger = YES;
+  return (ringCompletion(&ring) == 0) ? YES : NO;
+}
+
+- (void) watch: (NSArray*)modes add: (BOOL)flag
+{
+  NSRunLoop	*l = [NSRunLoop currentRunLoop];
+  void		*data = (void*)(uintptr_t)ring.efd;
+  NSUInteger	count = [modes count];
+  NSUInteger	i = 0;
+
+  do
+    {
+      NSString	*mode;
+
+      mode = (count > 0) ? [modes objectAtIndex: i] : NSDefaultRunLoopMode;
+      if (YES == flag)
+	{
+	  [l addEvent: data type: ET_RDESC watcher: self forMode: mode];
+	}
+      else
+	{
+	  [l removeEvent: data type: ET_RDESC forMode: mode all: NO];
+	}
+    }
+  while (++i < count);
+}
+
+@end
+
+#endif
+
 @implementation GSFileHandle
 
 static GSTcpTune        *tune = nil;
+static IMP		baseRead = 0;
+#if	defined(GS_IO_URING)
+static IMP		baseWrite = 0;
+#endif
 
 + (void) initialize
 {
   if (nil == tune)
     {
       tune = [GSTcpTune new];
+      baseRead = [GSFileHandle instanceMethodForSelector:
+	@selector(read:length:)];
+#if	defined(GS_IO_URING)
+      baseWrite = [GSFileHandle instanceMethodForSelector:
+	@selector(write:length:)];
+      if ([[NSUserDefaults standardUserDefaults]
+	objectForKey: @"GSFileHandleIOURing"] != nil)
+	{
+	  ringPolicy = [[NSUserDefaults standardUserDefaults]
+	    boolForKey: @"GSFileHandleIOURing"] ? 2 : 0;
+	}
+#endif
     }
 }
 
@@ -305,6 +932,147 @@ static GSTcpTune        *tune = nil;
   return result;
 }
 
+/**
+ * Reads into d until max bytes have been read or the end of the file is
+ * reached, returning the result of the last read.<br />
+ * The rest of a regular file is read into space sized to hold it and one
+ * more byte, so that the end of the file (or any data added since the
+ * size was checked) is found without making more space.
+ */
+- (NSInteger) readData: (NSMutableData*)d limit: (NSUInteger)max
+{
+  NSUInteger	rmax = [tune recvSize];
+  NSUInteger	left = NSNotFound;
+  NSUInteger	want;
+  NSInteger	len = 0;
+  BOOL		sized = NO;
+
+  if (YES == isStandardFile)
+    {
+      left = [self readSize];
+    }
+  if (left != NSNotFound && left < max)
+    {
+      want = left + 1;
+      sized = YES;
+    }
+  else if (left != NSNotFound)
+    {
+      want = max;
+    }
+  else
+    {
+      want = (max < rmax) ? max : rmax;
+    }
+  while (max > 0 && (len = [self readInto: d length: want]) > 0)
+    {
+      max -= len;
+      if (YES == sized && (NSUInteger)len < want)
+	{
+	  want -= len;	// The rest of the space, or the byte to find the end
+	}
+      else
+	{
+	  sized = NO;
+	  want = (max < rmax) ? max : rmax;
+	}
+    }
+  return len;
+}
+
+/**
+ * Reads up to len bytes straight into free space at the end of d,
+ * returning the result of the read.<br />
+ * Where that space is the end of one chunk followed by a new one, both
+ * are filled by a single readv() unless reading is done through zlib or
+ * by a subclass.
+ */
+- (NSInteger) readInto: (NSMutableData*)d length: (NSUInteger)len
+{
+  GSDataSpace	space;
+  NSUInteger	first;
+  NSInteger	result;
+  int		e;
+
+  GSPrivateDataSpace(d, len, &space);
+  first = (space.len[0] < len) ? space.len[0] : len;
+  if (2 == space.count && first < len
+#if	USE_ZLIB
+    && 0 == gzDescriptor
+#endif
+    && [self methodForSelector: @selector(read:length:)] == baseRead)
+    {
+      struct iovec	iov[2];
+
+      iov[0].iov_base = space.buf[0];
+      iov[0].iov_len = first;
+      iov[1].iov_base = space.buf[1];
+      iov[1].iov_len = len - first;
+      if (iov[1].iov_len > space.len[1])
+	{
+	  iov[1].iov_len = space.len[1];
+	}
+      do
+	{
+	  result = readv(descriptor, iov, 2);
+	}
+      while (result < 0 && EINTR == errno);
+    }
+  else
+    {
+      result = [self read: space.buf[0] length: first];
+    }
+  e = errno;
+  GSPrivateDataExtend(d, &space, (result > 0) ? (NSUInteger)result : 0);
+  errno = e;
+  return result;
+}
+
+/**
+ * Returns the number of bytes a read may expect to get: what is left of
+ * a regular file, or what is waiting in a pipe or socket.  Returns
+ * NSNotFound if that is not known.
+ */
+- (NSUInteger) readSize
+{
+#if	USE_ZLIB
+  if (gzDescriptor != 0)
+    {
+      return NSNotFound;
+    }
+#endif
+  if (YES == isStandardFile)
+    {
+      struct stat	sb;
+      off_t		pos;
+
+      if (fstat(descriptor, &sb) == 0
+	&& (pos = lseek(descriptor, 0, SEEK_CUR)) >= 0)
+	{
+	  if (sb.st_size <= pos)
+	    {
+	      return 0;
+	    }
+	  if ((unsigned long long)(sb.st_size - pos) < NSNotFound / 2)
+	    {
+	      return (NSUInteger)(sb.st_size - pos);
+	    }
+	}
+    }
+#if	defined(FIONREAD)
+  else
+    {
+      int	n = 0;
+
+      if (ioctl(descriptor, FIONREAD, &n) == 0 && n >= 0)
+	{
+	  return (NSUInteger)n;
+	}
+    }
+#endif
+  return NSNotFound;
+}
+
 /**
  * Encapsulates low level write operation to send data to the operating
  * system.
@@ -335,6 +1103,50 @@ static GSTcpTune        *tune = nil;
   return result;
 }
 
+/**
+ * Encapsulates low level copying of data from the file descriptor fd
+ * (starting at *offset, which is advanced by the amount copied) to the
+ * receiver.  The kernel moves the data where possible, but data for a
+ * compressed handle goes through a buffer and -write:length:.<br />
+ * The how argument records the copying method between calls, as
+ * for GSPrivateCopyDescriptor().
+ */
+- (NSInteger) transfer: (int)fd
+		offset: (unsigned long long*)offset
+		length: (NSUInteger)len
+		method: (int*)how
+{
+#if	USE_ZLIB
+  if (gzDescriptor != 0)
+    {
+      char	buf[BUFFER_SIZE];
+      ssize_t	got;
+      NSInteger	result;
+
+      if (len > sizeof(buf))
+	{
+	  len = sizeof(buf);
+	}
+      do
+	{
+	  got = pread(fd, buf, len, (off_t)*offset);
+	}
+      while (got < 0 && EINTR == errno);
+      if (got <= 0)
+	{
+	  return got;
+	}
+      result = [self write: buf length: got];
+      if (result > 0)
+	{
+	  *offset += result;
+	}
+      return result;
+    }
+#endif
+  return GSPrivateCopyDescriptor(fd, offset, descriptor, len, how);
+}
+
 + (id) allocWithZone: (NSZone*)z
 {
   return NSAllocateObject ([self class], 0, z);
@@ -1389,64 +2201,57 @@ NSString * const GSSOCKSRecvAddr = @"GSSOCKSRecvAddr";
 
 - (NSData*) availableData
 {
-  int			rmax = [tune recvSize];
-  char			buf[rmax];
   NSMutableData*	d;
-  int			len;
+  NSInteger		len = 0;
 
   [self checkRead];
-  d = [NSMutableData dataWithCapacity: 0];
   if (isStandardFile)
     {
+      /* We read to the end of the file, so collect the data in chunks
+       * rather than repeatedly copying it into a larger buffer.
+       */
+      d = [NSMutableData dataWithChunkSize: 0];
       if (isNonBlocking == YES)
 	{
 	  [self setNonBlocking: NO];
 	}
-      while ((len = [self read: buf length: sizeof(buf)]) > 0)
-        {
-	  [d appendBytes: buf length: len];
-        }
+      len = [self readData: d limit: NSUIntegerMax];
     }
   else
     {
+      NSUInteger	rmax = [tune recvSize];
+      NSUInteger	want;
+
+      d = [NSMutableData dataWithCapacity: 0];
       if (isNonBlocking == NO)
 	{
 	  [self setNonBlocking: YES];
 	}
-      len = [self read: buf length: sizeof(buf)];
+      if ((want = [self readSize]) > 0)
+	{
+	  len = [self readInto: d length: (want < rmax) ? want : rmax];
+	}
 
-      if (len <= 0)
+      if (0 == want || (len < 0 && (errno == EAGAIN || errno == EINTR)))
 	{
-	  if (errno == EAGAIN || errno == EINTR)
+	  /*
+	   * Nothing is waiting, or the read would have blocked ... so try
+	   * to get a single character in blocking mode (to ensure we wait
+	   * until data arrives) and then take whatever else has arrived.
+	   * This ensures that we block for *some* data as we should.
+	   */
+	  [self setNonBlocking: NO];
+	  len = [self readInto: d length: 1];
+	  [self setNonBlocking: YES];
+	  if (len == 1 && (want = [self readSize]) > 0)
 	    {
-	      /*
-	       * Read would have blocked ... so try to get a single character
-	       * in non-blocking mode (to ensure we wait until data arrives)
-	       * and then try again.
-	       * This ensures that we block for *some* data as we should.
-	       */
-	      [self setNonBlocking: NO];
-	      len = [self read: buf length: 1];
-	      [self setNonBlocking: YES];
-	      if (len == 1)
+	      if ([self readInto: d length: (want < rmax - 1) ? want : rmax - 1]
+		> 0)
 		{
-		  len = [self read: &buf[1] length: sizeof(buf) - 1];
-		  if (len <= 0)
-		    {
-		      len = 1;
-		    }
-		  else
-		    {
-		      len = len + 1;
-		    }
+		  len = [d length];
 		}
 	    }
 	}
-
-      if (len > 0)
-	{
-	  [d appendBytes: buf length: len];
-	}
     }
   if (len < 0)
     {
@@ -1459,21 +2264,16 @@ NSString * const GSSOCKSRecvAddr = @"GSSOCKSRecvAddr";
 
 - (NSData*) readDataToEndOfFile
 {
-  int			rmax = [tune recvSize];
-  char			buf[rmax];
   NSMutableData*	d;
-  int			len;
+  NSInteger		len;
 
   [self checkRead];
   if (isNonBlocking == YES)
     {
       [self setNonBlocking: NO];
     }
-  d = [NSMutableData dataWithCapacity: 0];
-  while ((len = [self read: buf length: sizeof(buf)]) > 0)
-    {
-      [d appendBytes: buf length: len];
-    }
+  d = [NSMutableData dataWithChunkSize: 0];
+  len = [self readData: d limit: NSUIntegerMax];
   if (len < 0)
     {
       [NSException raise: NSFileHandleOperationException
@@ -1486,9 +2286,6 @@ NSString * const GSSOCKSRecvAddr = @"GSSOCKSRecvAddr";
 - (NSData*) readDataOfLength: (unsigned)len
 {
   NSMutableData	*d;
-  int		got;
-  int		rmax = [tune recvSize];
-  char		buf[rmax];
 
   [self checkRead];
   if (isNonBlocking == YES)
@@ -1496,25 +2293,20 @@ NSString * const GSSOCKSRecvAddr = @"GSSOCKSRecvAddr";
       [self setNonBlocking: NO];
     }
 
-  d = [NSMutableData dataWithCapacity: len < sizeof(buf) ? len : sizeof(buf)];
-  do
+  if (len > (unsigned)[tune recvSize])
     {
-      int	chunk = len > sizeof(buf) ? sizeof(buf) : len;
-
-      got = [self read: buf length: chunk];
-      if (got > 0)
-	{
-	  [d appendBytes: buf length: got];
-	  len -= got;
-	}
-      else if (got < 0)
-	{
-	  [NSException raise: NSFileHandleOperationException
-		      format: @"unable to read from descriptor - %@",
-		      [NSError _last]];
-	}
+      d = [NSMutableData dataWithChunkSize: 0];
+    }
+  else
+    {
+      d = [NSMutableData dataWithCapacity: len];
+    }
+  if ([self readData: d limit: len] < 0)
+    {
+      [NSException raise: NSFileHandleOperationException
+		  format: @"unable to read from descriptor - %@",
+		  [NSError _last]];
     }
-  while (len > 0 && got > 0);
 
   return d;
 }
@@ -1604,9 +2396,8 @@ NSString * const GSSOCKSRecvAddr = @"GSSOCKSRecvAddr";
   readInfo = [[NSMutableDictionary alloc] initWithCapacity: 4];
   [readInfo setObject: NSFileHandleReadCompletionNotification
 	       forKey: NotificationKey];
-  d = [[NSMutableData alloc] initWithCapacity: 0];
+  d = [NSMutableData dataWithChunkSize: 0];
   [readInfo setObject: d forKey: NSFileHandleNotificationDataItem];
-  RELEASE(d);
   [self watchReadDescriptorForModes: modes];
 }
 
@@ -1620,9 +2411,8 @@ NSString * const GSSOCKSRecvAddr = @"GSSOCKSRecvAddr";
   readInfo = [[NSMutableDictionary alloc] initWithCapacity: 4];
   [readInfo setObject: NSFileHandleReadToEndOfFileCompletionNotification
 	       forKey: NotificationKey];
-  d = [[NSMutableData alloc] initWithCapacity: 0];
+  d = [NSMutableData dataWithChunkSize: 0];
   [readInfo setObject: d forKey: NSFileHandleNotificationDataItem];
-  RELEASE(d);
   [self watchReadDescriptorForModes: modes];
 }
 
@@ -1839,6 +2629,59 @@ NSString * const GSSOCKSRecvAddr = @"GSSOCKSRecvAddr";
   [self writeInBackgroundAndNotify: item forModes: nil];
 }
 
+- (void) writeInBackgroundAndNotifyFromFileHandle: (NSFileHandle*)source
+					   offset: (unsigned long long)offset
+					   length: (unsigned long long)length
+					 forModes: (NSArray*)modes
+{
+  NSMutableDictionary*	info;
+  int			fd;
+
+  [self checkWrite];
+  fd = [source isKindOfClass: [GSFileHandle class]]
+    ? [source fileDescriptor] : -1;
+  if (fd < 0 || lseek(fd, 0, SEEK_CUR) < 0)
+    {
+      [NSException raise: NSInvalidArgumentException
+		  format: @"transfer source is not a seekable file"];
+    }
+#if	USE_ZLIB
+  if (((GSFileHandle*)source)->gzDescriptor != 0)
+    {
+      [NSException raise: NSInvalidArgumentException
+		  format: @"transfer source uses compression"];
+    }
+#endif
+
+  info = [[NSMutableDictionary alloc] initWithCapacity: 6];
+  [info setObject: source forKey: NSFileHandleNotificationFileHandleItem];
+  [info setObject: [NSNumber numberWithUnsignedLongLong: offset]
+	   forKey: TransferOffsetKey];
+  [info setObject: [NSNumber numberWithUnsignedLongLong: length]
+	   forKey: TransferLengthKey];
+  [info setObject: [NSNumber numberWithInt: GSCopyRange]
+	   forKey: TransferMethodKey];
+  [info setObject: GSFileHandleWriteCompletionNotification
+	   forKey: NotificationKey];
+  if (modes != nil)
+    {
+      [info setObject: modes forKey: NSFileHandleNotificationMonitorModes];
+    }
+  [writeInfo addObject: info];
+  RELEASE(info);
+  [self watchWriteDescriptor];
+}
+
+- (void) writeInBackgroundAndNotifyFromFileHandle: (NSFileHandle*)source
+					   offset: (unsigned long long)offset
+					   length: (unsigned long long)length
+{
+  [self writeInBackgroundAndNotifyFromFileHandle: source
+					  offset: offset
+					  length: length
+					forModes: nil];
+}
+
 - (void) postReadNotification
 {
   NSMutableDictionary	*info = readInfo;
@@ -1919,6 +2762,28 @@ NSString * const GSSOCKSRecvAddr = @"GSSOCKSRecvAddr";
   NSRunLoop	*l;
   NSArray	*modes;
 
+#if	defined(GS_IO_URING)
+  if (ringRead != 0)
+    {
+      GSRingOp	*op = (GSRingOp*)ringRead;
+
+      /* The kernel may still write to the data item, so the read info
+       * gets a copy of what has been read and the item stays with the
+       * operation until it is finished.
+       */
+      ringRead = 0;
+      if (op->item != nil
+	&& [readInfo objectForKey: NSFileHandleNotificationDataItem]
+	== op->item)
+	{
+	  NSMutableData	*d = [op->item mutableCopy];
+
+	  [readInfo setObject: d forKey: NSFileHandleNotificationDataItem];
+	  RELEASE(d);
+	}
+      [op->ring cancel: op];
+    }
+#endif
   if (descriptor < 0)
     {
       return;
@@ -1958,6 +2823,15 @@ NSString * const GSSOCKSRecvAddr = @"GSSOCKSRecvAddr";
   NSRunLoop	*l;
   NSArray	*modes;
 
+#if	defined(GS_IO_URING)
+  if (ringWrite != 0)
+    {
+      GSRingOp	*op = (GSRingOp*)ringWrite;
+
+      ringWrite = 0;
+      [op->ring cancel: op];
+    }
+#endif
   if (descriptor < 0)
     {
       return;
@@ -2001,6 +2875,17 @@ NSString * const GSSOCKSRecvAddr = @"GSSOCKSRecvAddr";
     {
       return;
     }
+#if	defined(GS_IO_URING)
+  if (YES == [self ringRead: modes])
+    {
+      if (modes && [modes count])
+	{
+	  [readInfo setObject: modes
+		       forKey: NSFileHandleNotificationMonitorModes];
+	}
+      return;
+    }
+#endif
 
   l = [NSRunLoop currentRunLoop];
   [self setNonBlocking: YES];
@@ -2032,6 +2917,12 @@ NSString * const GSSOCKSRecvAddr = @"GSSOCKSRecvAddr";
     {
       return;
     }
+#if	defined(GS_IO_URING)
+  if (YES == [self ringWrite])
+    {
+      return;
+    }
+#endif
   if ([writeInfo count] > 0)
     {
       NSMutableDictionary	*info = [writeInfo objectAtIndex: 0];
@@ -2063,46 +2954,134 @@ NSString * const GSSOCKSRecvAddr = @"GSSOCKSRecvAddr";
     }
 }
 
-- (void) receivedEventRead
+/* Makes a new handle for a connection accepted on desc, or records the
+ * failure if desc is negative, then posts the read notification.
+ */
+- (void) accepted: (int)desc
 {
-  NSString	*operation;
+  if (desc < 0)
+    {
+      NSString	*s;
 
-  operation = [readInfo objectForKey: NotificationKey];
-  if (operation == NSFileHandleConnectionAcceptedNotification)
+      s = [NSString stringWithFormat: @"Accept attempt failed - %@",
+	[NSError _last]];
+      [readInfo setObject: s forKey: GSFileHandleNotificationError];
+    }
+  else
+    { // Accept attempt completed.
+      GSFileHandle		*h;
+      struct sockaddr	sin;
+      unsigned int		size = sizeof(sin);
+
+      [tune tune: (void*)(intptr_t)desc];
+
+      h = [[[self class] alloc] initWithFileDescriptor: desc
+					closeOnDealloc: YES];
+      h->isSocket = YES;
+      if (getpeername(desc, &sin, &size) >= 0)
+	{
+	  [h setAddr: &sin];
+	}
+      [readInfo setObject: h
+		   forKey: NSFileHandleNotificationFileHandleItem];
+      RELEASE(h);
+    }
+  [self postReadNotification];
+}
+
+/* Returns the number of bytes to read for the background read in
+ * progress.  When large is YES (the read does not hold up the run loop)
+ * the rest of a regular file is read in pieces of up to TRANSFER_SIZE.
+ */
+- (NSUInteger) readLength: (BOOL)large
+{
+  NSMutableData	*item;
+  NSUInteger	length;
+  NSUInteger	waiting;
+  NSUInteger	rmax = [tune recvSize];
+
+  item = [readInfo objectForKey: NSFileHandleNotificationDataItem];
+  if (YES == large && YES == isStandardFile && readMax >= 0
+    && rmax < TRANSFER_SIZE)
     {
-      struct sockaddr	buf;
-      int			desc;
-      unsigned int		blen = sizeof(buf);
+      rmax = TRANSFER_SIZE;
+    }
+  /*
+   * We may have a maximum data size set...
+   */
+  if (readMax > 0)
+    {
+      length = (unsigned int)readMax - [item length];
+      if (length > rmax)
+	{
+	  length = rmax;
+	}
+    }
+  else
+    {
+      length = rmax;
+    }
+  /*
+   * Only make space for what is waiting to be read, if we know.  For
+   * a file, one more byte finds the end without another read.
+   */
+  waiting = [self readSize];
+  if (YES == large && YES == isStandardFile && waiting < length)
+    {
+      length = waiting + 1;
+    }
+  else if (waiting > 0 && waiting < length)
+    {
+      length = waiting;
+    }
+  return length;
+}
+
+/* Handles the result of a background read into the data item, posting
+ * the notification once the read is complete or has failed.
+ */
+- (void) receivedRead: (NSInteger)received
+{
+  NSMutableData	*item;
 
-      desc = accept(descriptor, &buf, &blen);
-      if (desc == -1)
+  item = [readInfo objectForKey: NSFileHandleNotificationDataItem];
+  if (received == 0)
+    { // Read up to end of file.
+      [self postReadNotification];
+    }
+  else if (received < 0)
+    {
+      if (errno != EAGAIN && errno != EINTR)
 	{
 	  NSString	*s;
 
-	  s = [NSString stringWithFormat: @"Accept attempt failed - %@",
+	  s = [NSString stringWithFormat: @"Read attempt failed - %@",
 	    [NSError _last]];
 	  [readInfo setObject: s forKey: GSFileHandleNotificationError];
+	  [self postReadNotification];
 	}
-      else
-	{ // Accept attempt completed.
-	  GSFileHandle		*h;
-	  struct sockaddr	sin;
-	  unsigned int		size = sizeof(sin);
-
-          [tune tune: (void*)(intptr_t)desc];
-        
-	  h = [[[self class] alloc] initWithFileDescriptor: desc
-					    closeOnDealloc: YES];
-	  h->isSocket = YES;
-	  if (getpeername(desc, &sin, &size) >= 0)
-            {
-              [h setAddr: &sin];
-            }
-	  [readInfo setObject: h
-                       forKey: NSFileHandleNotificationFileHandleItem];
-	  RELEASE(h);
+    }
+  else
+    {
+      if (readMax < 0 || (readMax > 0 && (int)[item length] == readMax))
+	{
+	  // Read a single chunk of data
+	  [self postReadNotification];
 	}
-      [self postReadNotification];
+    }
+}
+
+- (void) receivedEventRead
+{
+  NSString	*operation;
+
+  operation = [readInfo objectForKey: NotificationKey];
+  if (operation == NSFileHandleConnectionAcceptedNotification)
+    {
+      struct sockaddr	buf;
+      unsigned int	blen = sizeof(buf);
+
+      [self accepted: accept(descriptor, &buf, &blen)];
     }
   else if (operation == NSFileHandleDataAvailableNotification)
     {
@@ -2111,54 +3090,9 @@ NSString * const GSSOCKSRecvAddr = @"GSSOCKSRecvAddr";
   else
     {
       NSMutableData	*item;
-      int		length;
-      int		received = 0;
-      int		rmax = [tune recvSize];
-      char		buf[rmax];
 
       item = [readInfo objectForKey: NSFileHandleNotificationDataItem];
-      /*
-       * We may have a maximum data size set...
-       */
-      if (readMax > 0)
-        {
-          length = (unsigned int)readMax - [item length];
-          if (length > (int)sizeof(buf))
-            {
-	      length = sizeof(buf);
-	    }
-	}
-      else
-	{
-	  length = sizeof(buf);
-	}
-
-      received = [self read: buf length: length];
-      if (received == 0)
-        { // Read up to end of file.
-          [self postReadNotification];
-        }
-      else if (received < 0)
-        {
-          if (errno != EAGAIN && errno != EINTR)
-            {
-	      NSString	*s;
-
-	      s = [NSString stringWithFormat: @"Read attempt failed - %@",
-		[NSError _last]];
-	      [readInfo setObject: s forKey: GSFileHandleNotificationError];
-	      [self postReadNotification];
-	    }
-	}
-      else
-	{
-	  [item appendBytes: buf length: received];
-	  if (readMax < 0 || (readMax > 0 && (int)[item length] == readMax))
-	    {
-	      // Read a single chunk of data
-	      [self postReadNotification];
-	    }
-	}
+      [self receivedRead: [self readInto: item length: [self readLength: NO]]];
     }
 }
 
@@ -2201,6 +3135,10 @@ NSString * const GSSOCKSRecvAddr = @"GSSOCKSRecvAddr";
       connectOK = NO;
       [self postWriteNotification];
     }
+  else if ([info objectForKey: TransferLengthKey] != nil)
+    {
+      [self receivedEventTransfer: info];
+    }
   else
     {
       NSData	*item;
@@ -2212,34 +3150,108 @@ NSString * const GSSOCKSRecvAddr = @"GSSOCKSRecvAddr";
       ptr = [item bytes];
       if (writePos < length)
         {
-          int	written;
-
-          written = [self write: (char*)ptr+writePos
-                         length: length-writePos];
-          if (written <= 0)
-            {
-	      if (written < 0 && errno != EAGAIN && errno != EINTR)
-	        {
-	          NSString	*s;
-
-	          s = [NSString stringWithFormat:
-		    @"Write attempt failed - %@", [NSError _last]];
-	          [info setObject: s forKey: GSFileHandleNotificationError];
-	          [self postWriteNotification];
-	        }
-	    }
-	  else
-            {
-	      writePos += written;
-	    }
+          [self receivedWrite: [self write: (char*)ptr+writePos
+				    length: length-writePos]];
 	}
-      if (writePos >= length)
+      else
         { // Write operation completed.
           [self postWriteNotification];
         }
     }
 }
 
+/* Handles the result of writing part of the data item of the first
+ * background write, posting the notification once it is all written
+ * or the write has failed.
+ */
+- (void) receivedWrite: (NSInteger)written
+{
+  NSMutableDictionary	*info = [writeInfo objectAtIndex: 0];
+
+  if (written <= 0)
+    {
+      if (written < 0 && errno != EAGAIN && errno != EINTR)
+	{
+	  NSString	*s;
+
+	  s = [NSString stringWithFormat:
+	    @"Write attempt failed - %@", [NSError _last]];
+	  [info setObject: s forKey: GSFileHandleNotificationError];
+	  [self postWriteNotification];
+	}
+    }
+  else
+    {
+      writePos += written;
+      if (writePos >= (int)[[info objectForKey:
+	NSFileHandleNotificationDataItem] length])
+	{ // Write operation completed.
+	  [self postWriteNotification];
+	}
+    }
+}
+
+/* Moves the next part of a background transfer from another file handle
+ * to the receiver, posting the write notification when it is complete.
+ * Each event moves a limited amount, so that a large transfer to a file
+ * does not stop the run loop handling other events.
+ */
+- (void) receivedEventTransfer: (NSMutableDictionary*)info
+{
+  NSFileHandle		*source;
+  unsigned long long	offset;
+  unsigned long long	length;
+  NSInteger		done;
+  int			how;
+
+  source = [info objectForKey: NSFileHandleNotificationFileHandleItem];
+  offset = [[info objectForKey: TransferOffsetKey] unsignedLongLongValue];
+  length = [[info objectForKey: TransferLengthKey] unsignedLongLongValue];
+  how = [[info objectForKey: TransferMethodKey] intValue];
+  if (length == 0)
+    {
+      [self postWriteNotification];
+      return;
+    }
+
+  done = [self transfer: [source fileDescriptor]
+		 offset: &offset
+		 length: (length > TRANSFER_SIZE) ? TRANSFER_SIZE : length
+		 method: &how];
+  if (done < 0)
+    {
+      if (errno != EAGAIN && errno != EINTR)
+	{
+	  NSString	*s;
+
+	  s = [NSString stringWithFormat:
+	    @"Transfer attempt failed - %@", [NSError _last]];
+	  [info setObject: s forKey: GSFileHandleNotificationError];
+	  [self postWriteNotification];
+	}
+    }
+  else if (done == 0)
+    {
+      [info setObject: @"Transfer source ended before the requested length"
+	       forKey: GSFileHandleNotificationError];
+      [self postWriteNotification];
+    }
+  else
+    {
+      length -= done;
+      [info setObject: [NSNumber numberWithUnsignedLongLong: offset]
+	       forKey: TransferOffsetKey];
+      [info setObject: [NSNumber numberWithUnsignedLongLong: length]
+	       forKey: TransferLengthKey];
+      [info setObject: [NSNumber numberWithInt: how]
+	       forKey: TransferMethodKey];
+      if (length == 0)
+	{
+	  [self postWriteNotification];
+	}
+    }
+}
+
 - (void) receivedEvent: (void*)data
                   type: (RunLoopEventType)type
 		 extra: (void*)extra
@@ -2261,6 +3273,239 @@ NSString * const GSSOCKSRecvAddr = @"GSSOCKSRecvAddr";
     }
 }
 
+#if	defined(GS_IO_URING)
+/* Returns the io_uring to queue background reads and writes on, or nil
+ * if they should wait for the run loop to find the descriptor ready.
+ * Handles which read or write through zlib or a subclass never use it.
+ */
+- (GSFileHandleRing*) ring
+{
+  if (YES == ringOff || descriptor < 0 || 0 == ringPolicy
+    || (NO == isStandardFile && ringPolicy < 2))
+    {
+      return nil;
+    }
+#if	USE_ZLIB
+  if (gzDescriptor != 0)
+    {
+      return nil;
+    }
+#endif
+  if ([self methodForSelector: @selector(read:length:)] != baseRead
+    || [self methodForSelector: @selector(write:length:)] != baseWrite)
+    {
+      return nil;
+    }
+  return currentRing(YES);
+}
+
+/* Handles the completion of an operation queued on the ring, much as
+ * the run loop events for the descriptor would be handled, and queues
+ * the next part of the operation if it is not finished.  A kernel which
+ * will not wait for a non-blocking descriptor reports EAGAIN, in which
+ * case the handle goes back to the run loop.
+ */
+- (void) ringDone: (GSRingOp*)op result: (int)result
+{
+  if (GSRingWrite == op->kind)
+    {
+      id	info = [writeInfo objectAtIndex: 0];
+
+      ringWrite = 0;
+      if (-EAGAIN == result)
+	{
+	  ringOff = YES;
+	  [self watchWriteDescriptor];
+	  return;
+	}
+      if (result < 0)
+	{
+	  errno = -result;
+	  result = -1;
+	}
+      [self receivedWrite: result];
+      if ([writeInfo count] > 0 && [writeInfo objectAtIndex: 0] == info)
+	{
+	  [self watchWriteDescriptor];
+	}
+      return;
+    }
+
+  ringRead = 0;
+  if (-EAGAIN == result)
+    {
+      ringOff = YES;
+      [self watchReadDescriptorForModes: op->modes];
+      return;
+    }
+  if (result < 0)
+    {
+      errno = -result;
+      result = -1;
+    }
+  if (GSRingAccept == op->kind)
+    {
+      [self accepted: result];
+    }
+  else
+    {
+      [self receivedRead: result];
+      if (readInfo != nil)
+	{
+	  [self watchReadDescriptorForModes: op->modes];
+	}
+    }
+}
+
+/* Queues the next part of the background read or accept on the ring,
+ * returning NO if the ring cannot be used for it.
+ */
+- (BOOL) ringRead: (NSArray*)modes
+{
+  GSFileHandleRing	*r;
+  struct io_uring_sqe	*sqe;
+  GSRingOp		*op;
+  NSString		*operation;
+
+  if (ringRead != 0)
+    {
+      return YES;
+    }
+  operation = [readInfo objectForKey: NotificationKey];
+  if (operation == NSFileHandleConnectionAcceptedNotification)
+    {
+      if (NO == isSocket)
+	{
+	  return NO;
+	}
+    }
+  else if (operation == NSFileHandleDataAvailableNotification
+    || nil == [readInfo objectForKey: NSFileHandleNotificationDataItem])
+    {
+      return NO;
+    }
+  if (nil == (r = [self ring]))
+    {
+      return NO;
+    }
+  if ((sqe = ringEntry(&r->ring)) == 0)
+    {
+      ringOff = YES;
+      return NO;
+    }
+
+  op = NSZoneCalloc(NSDefaultMallocZone(), 1, sizeof(GSRingOp));
+  sqe->fd = descriptor;
+  if (operation == NSFileHandleConnectionAcceptedNotification)
+    {
+      op->kind = GSRingAccept;
+      sqe->opcode = IORING_OP_ACCEPT;
+    }
+  else
+    {
+      NSMutableData	*item;
+      NSUInteger	length = [self readLength: YES];
+      unsigned		count = 1;
+
+      item = [readInfo objectForKey: NSFileHandleNotificationDataItem];
+      op->kind = GSRingRead;
+      op->item = RETAIN(item);
+      GSPrivateDataSpace(item, length, &op->space);
+      op->iov[0].iov_base = op->space.buf[0];
+      op->iov[0].iov_len = (op->space.len[0] < length)
+	? op->space.len[0] : length;
+      if (2 == op->space.count && op->iov[0].iov_len < length)
+	{
+	  length -= op->iov[0].iov_len;
+	  op->iov[1].iov_base = op->space.buf[1];
+	  op->iov[1].iov_len = (op->space.len[1] < length)
+	    ? op->space.len[1] : length;
+	  count = 2;
+	}
+      sqe->opcode = IORING_OP_READV;
+      sqe->addr = (uintptr_t)op->iov;
+      sqe->len = count;
+      sqe->off = (uint64_t)-1;		// At (and advancing) the file offset
+    }
+  op->handle = RETAIN(self);
+  op->modes = ([modes count] > 0) ? RETAIN(modes) : nil;
+  [r queue: op entry: sqe];
+  ringRead = op;
+  return YES;
+}
+
+/* Queues the rest of the first background write on the ring, returning
+ * NO if the ring cannot be used for it.
+ */
+- (BOOL) ringWrite
+{
+  NSMutableDictionary	*info;
+  GSFileHandleRing	*r;
+  struct io_uring_sqe	*sqe;
+  GSRingOp		*op;
+  NSData		*item;
+  NSUInteger		length;
+
+  if (ringWrite != 0)
+    {
+      return YES;
+    }
+  if (YES == connectOK || [writeInfo count] == 0)
+    {
+      return NO;
+    }
+  info = [writeInfo objectAtIndex: 0];
+  if ([info objectForKey: NotificationKey]
+    != GSFileHandleWriteCompletionNotification
+    || [info objectForKey: TransferLengthKey] != nil)
+    {
+      return NO;
+    }
+  item = [info objectForKey: NSFileHandleNotificationDataItem];
+  length = [item length];
+  if ((NSUInteger)writePos >= length)
+    {
+      return NO;
+    }
+  if (nil == (r = [self ring]))
+    {
+      return NO;
+    }
+  if ((sqe = ringEntry(&r->ring)) == 0)
+    {
+      ringOff = YES;
+      return NO;
+    }
+
+  /* The kernel reads the bytes after we return, so they must not be
+   * changed or moved by the owner of mutable data meanwhile.
+   */
+  if ([item isKindOfClass: [NSMutableData class]])
+    {
+      item = AUTORELEASE([item copy]);
+      [info setObject: item forKey: NSFileHandleNotificationDataItem];
+    }
+  length -= writePos;
+  if (length > COPY_SIZE)
+    {
+      length = COPY_SIZE;
+    }
+  op = NSZoneCalloc(NSDefaultMallocZone(), 1, sizeof(GSRingOp));
+  op->kind = GSRingWrite;
+  op->item = RETAIN(item);
+  op->handle = RETAIN(self);
+  op->modes = RETAIN([info objectForKey: NSFileHandleNotificationMonitorModes]);
+  sqe->opcode = IORING_OP_WRITE;
+  sqe->fd = descriptor;
+  sqe->addr = (uintptr_t)((const char*)[item bytes] + writePos);
+  sqe->len = length;
+  sqe->off = (uint64_t)-1;		// At (and advancing) the file offset
+  [r queue: op entry: sqe];
+  ringWrite = op;
+  return YES;
+}
+#endif
+
 - (void) setAddr: (struct sockaddr *)sin
 {
   NSString	*s;
@@ -225,6 +225,35 @@ static const char _itowa_upper_digits[36]
 /* Internal function for converting integers to ASCII.  */
 
 
+/* Pairs of decimal digits for the values 0 to 99, so that base 10
+   conversion needs only one division for every two digits.  */
+static const char _itowa_decimal_pairs[201]
+  = "0001020304050607080910111213141516171819"
+  "2021222324252627282930313233343536373839"
+  "4041424344454647484950515253545556575859"
+  "6061626364656667686970717273747576777879"
+  "8081828384858687888990919293949596979899";
+
+/* Base 10 conversion, producing two digits per division.  */
+#define DECIMAL								      \
+    case 10:								      \
+      while (value >= 100)						      \
+	{								      \
+	  unsigned int r = (unsigned int) (value % 100);		      \
+									      \
+	  value /= 100;							      \
+	  *--bp = _itowa_decimal_pairs[2 * r + 1];			      \
+	  *--bp = _itowa_decimal_pairs[2 * r];				      \
+	}								      \
+      if (value >= 10)							      \
+	{								      \
+	  *--bp = _itowa_decimal_pairs[2 * value + 1];			      \
+	  *--bp = _itowa_decimal_pairs[2 * value];			      \
+	}								      \
+      else								      \
+	*--bp = digits[value];						      \
+      break
+
 /* Convert VALUE into ASCII in base BASE (2..36).
    Write backwards starting the character just before BUFLIM.
    Return the address of the first (left-to-right) character in the number.
@@ -246,7 +275,7 @@ static unichar *_itowa (unsigned long long int value, unichar *buflim,
       while ((value /= Base) != 0);					      \
       break
 
-      SPECIAL (10);
+      DECIMAL;
       SPECIAL (16);
       SPECIAL (8);
     default:
@@ -275,7 +304,7 @@ _itowa_word (unsigned long value, unichar *buflim,
       while ((value /= Base) != 0);					      \
       break
 
-      SPECIAL (10);
+      DECIMAL;
       SPECIAL (16);
       SPECIAL (8);
     default:
@@ -747,9 +776,64 @@ parse_one_spec (const unichar *format, size_t posn, struct printf_spec *spec,
 
 static inline void GSStrAppendUnichar(GSStr s, unichar u)
 {
+  /* Store directly into the buffer when there is space and the
+   * character does not require the string to be widened.
+   */
+  if (s->_count + 2 < s->_capacity)
+    {
+      if (s->_flags.wide == 1)
+	{
+	  s->_contents.u[s->_count++] = u;
+	  return;
+	}
+      if (u < 128)
+	{
+	  s->_contents.c[s->_count++] = (unsigned char)u;
+	  return;
+	}
+    }
   GSPrivateStrAppendUnichars(s, &u, 1);
 }
 
+/* Append LEN bytes of C string output (as produced by snprintf) to S.
+ */
+static void GSStrAppendASCII(GSStr s, const char *b, size_t len)
+{
+  size_t	i;
+
+  if (s->_count + len + 1 < s->_capacity)
+    {
+      if (s->_flags.wide == 1)
+	{
+	  unichar	*u = s->_contents.u + s->_count;
+
+	  for (i = 0; i < len; i++)
+	    {
+	      u[i] = (unsigned char)b[i];
+	    }
+	  s->_count += len;
+	  return;
+	}
+      for (i = 0; i < len; i++)
+	{
+	  if (((unsigned char)b[i]) > 127)
+	    {
+	      break;
+	    }
+	}
+      if (i == len)
+	{
+	  memcpy(s->_contents.c + s->_count, b, len);
+	  s->_count += len;
+	  return;
+	}
+    }
+  for (i = 0; i < len; i++)
+    {
+      GSStrAppendUnichar(s, (unsigned char)b[i]);
+    }
+}
+
 #define	outchar(Ch)		GSStrAppendUnichar(s, Ch)
 #define outstring(String, Len)	GSPrivateStrAppendUnichars(s, String, Len)
 
@@ -808,10 +892,63 @@ static int printf_unknown (GSStr, const struct printf_info *,
 static unichar *group_number (unichar *, unichar *, const char *, NSString *);
 
 
-/* The function itself.  */
-void
-GSPrivateFormat (GSStr s, const unichar *format, va_list ap,
-NSDictionary *locale)
+/* A parsed format string.  These are cached for constant format
+   strings so that repeated use of the same format does not need to
+   parse it again.  The SPECS point into the FORMAT characters, which
+   are owned by the entry.  */
+typedef struct
+{
+  NSString		*key;		/* Constant string (not retained).  */
+  NSUInteger		length;		/* Length of the KEY string.  */
+  NSUInteger		hash;		/* Hash of the KEY string.  */
+  unichar		*format;	/* Nul terminated format characters.  */
+  size_t		lead;		/* Length of leading literal text.  */
+  size_t		nspecs;		/* Number of format specifiers.  */
+  size_t		nargs;		/* Number of arguments consumed.  */
+  int			*args_type;	/* Types of the arguments.  */
+  struct printf_spec	*specs;		/* The parsed specifiers.  */
+} format_cache_entry;
+
+/* Fill in the types of all the arguments consumed by SPECS.  */
+static void
+fill_args_type (int *args_type, const struct printf_spec *specs,
+  size_t nspecs)
+{
+  size_t	cnt;
+
+  /* XXX Could do sanity check here: If any element in ARGS_TYPE is
+     still zero after this loop, format is invalid.  For now we
+     simply use 0 as the value.  */
+
+  for (cnt = 0; cnt < nspecs; ++cnt)
+    {
+      /* If the width is determined by an argument this is an int.  */
+      if (specs[cnt].width_arg != -1)
+	args_type[specs[cnt].width_arg] = PA_INT;
+
+      /* If the precision is determined by an argument this is an int.  */
+      if (specs[cnt].prec_arg != -1)
+	args_type[specs[cnt].prec_arg] = PA_INT;
+
+      switch (specs[cnt].ndata_args)
+	{
+	case 0:		/* No arguments.  */
+	  break;
+	case 1:		/* One argument; we already have the type.  */
+	  args_type[specs[cnt].data_arg] = specs[cnt].data_arg_type;
+	  break;
+	default:
+	  /* ??? */
+	  break;
+	}
+    }
+}
+
+/* The function itself.  If PARSED is not NULL it is the result of an
+   earlier parse of FORMAT and is used instead of parsing again.  */
+static void
+format_parsed (GSStr s, const unichar *format, const format_cache_entry *parsed,
+  va_list ap, NSDictionary *locale)
 {
   /* The character used as thousands separator.  */
   NSString *thousands_sep = @"";
@@ -894,7 +1031,14 @@ NSDictionary *locale)
   nspecs_done = 0;
 
   /* Find the first format specifier.  */
-  f = lead_str_end = find_spec ((const unichar *) format);
+  if (parsed != NULL)
+    {
+      f = lead_str_end = format + parsed->lead;
+    }
+  else
+    {
+      f = lead_str_end = find_spec ((const unichar *) format);
+    }
 
 
   /* Write the literal text before the first format.  */
@@ -944,70 +1088,59 @@ NSDictionary *locale)
 	  grouping = NULL;
       }
 
-    for (f = lead_str_end; *f != '\0'; f = specs[nspecs++].next_fmt)
+    if (parsed != NULL)
+      {
+	/* Processing modifies the width and precision of the specifiers,
+	   so we work on a copy of the cached ones.  */
+	nspecs = parsed->nspecs;
+	specs = alloca (nspecs * sizeof (struct printf_spec));
+	memcpy (specs, parsed->specs, nspecs * sizeof (struct printf_spec));
+	nargs = parsed->nargs;
+	args_type = parsed->args_type;
+	args_value = alloca (nargs * sizeof (union printf_arg));
+      }
+    else
       {
-	if (nspecs >= nspecs_max)
+	for (f = lead_str_end; *f != '\0'; f = specs[nspecs++].next_fmt)
 	  {
-	    /* Extend the array of format specifiers.  */
-	    struct printf_spec *old = specs;
+	    if (nspecs >= nspecs_max)
+	      {
+		/* Extend the array of format specifiers.  */
+		struct printf_spec *old = specs;
 
-	    nspecs_max *= 2;
-	    specs = alloca (nspecs_max * sizeof (struct printf_spec));
+		nspecs_max *= 2;
+		specs = alloca (nspecs_max * sizeof (struct printf_spec));
 
-	    if (specs == &old[nspecs])
-	      /* Stack grows up, OLD was the last thing allocated;
-		 extend it.  */
-	      nspecs_max += nspecs_max / 2;
-	    else
-	      {
-		/* Copy the old array's elements to the new space.  */
-		memcpy (specs, old, nspecs * sizeof (struct printf_spec));
-		if (old == &specs[nspecs])
-		  /* Stack grows down, OLD was just below the new
-		     SPECS.  We can use that space when the new space
-		     runs out.  */
+		if (specs == &old[nspecs])
+		  /* Stack grows up, OLD was the last thing allocated;
+		     extend it.  */
 		  nspecs_max += nspecs_max / 2;
+		else
+		  {
+		    /* Copy the old array's elements to the new space.  */
+		    memcpy (specs, old, nspecs * sizeof (struct printf_spec));
+		    if (old == &specs[nspecs])
+		      /* Stack grows down, OLD was just below the new
+			 SPECS.  We can use that space when the new space
+			 runs out.  */
+		      nspecs_max += nspecs_max / 2;
+		  }
 	      }
-	  }
-
-	/* Parse the format specifier.  */
-	nargs += parse_one_spec (f, nargs, &specs[nspecs], &max_ref_arg);
-      }
-
-    /* Determine the number of arguments the format string consumes.  */
-    nargs = MAX (nargs, max_ref_arg);
 
-    /* Allocate memory for the argument descriptions.  */
-    args_type = alloca (nargs * sizeof (int));
-    memset (args_type, 0, nargs * sizeof (int));
-    args_value = alloca (nargs * sizeof (union printf_arg));
-
-    /* XXX Could do sanity check here: If any element in ARGS_TYPE is
-       still zero after this loop, format is invalid.  For now we
-       simply use 0 as the value.  */
+	    /* Parse the format specifier.  */
+	    nargs += parse_one_spec (f, nargs, &specs[nspecs], &max_ref_arg);
+	  }
 
-    /* Fill in the types of all the arguments.  */
-    for (cnt = 0; cnt < nspecs; ++cnt)
-      {
-	/* If the width is determined by an argument this is an int.  */
-	if (specs[cnt].width_arg != -1)
-	  args_type[specs[cnt].width_arg] = PA_INT;
+	/* Determine the number of arguments the format string consumes.  */
+	nargs = MAX (nargs, max_ref_arg);
 
-	/* If the precision is determined by an argument this is an int.  */
-	if (specs[cnt].prec_arg != -1)
-	  args_type[specs[cnt].prec_arg] = PA_INT;
+	/* Allocate memory for the argument descriptions.  */
+	args_type = alloca (nargs * sizeof (int));
+	memset (args_type, 0, nargs * sizeof (int));
+	args_value = alloca (nargs * sizeof (union printf_arg));
 
-	switch (specs[cnt].ndata_args)
-	  {
-	  case 0:		/* No arguments.  */
-	    break;
-	  case 1:		/* One argument; we already have the type.  */
-	    args_type[specs[cnt].data_arg] = specs[cnt].data_arg_type;
-	    break;
-	  default:
-	    /* ??? */
-	    break;
-	  }
+	/* Fill in the types of all the arguments.  */
+	fill_args_type (args_type, specs, nspecs);
       }
 
     /* Now we know all the types and the order.  Fill in the argument
@@ -1530,7 +1663,14 @@ NSDictionary *locale)
 	      }
 	    else
 	      {
-		outchar(*bp++);
+		char	*e = bp;
+
+		while (*e != '\0' && *e != '\033')
+		  {
+		    e++;
+		  }
+		GSStrAppendASCII(s, bp, e - bp);
+		bp = e;
 	      }
 	  }
       }
@@ -1648,7 +1788,14 @@ NSDictionary *locale)
 	      }
 	    else
 	      {
-		outchar(*bp++);
+		char	*e = bp;
+
+		while (*e != '\0' && *e != '\033')
+		  {
+		    e++;
+		  }
+		GSStrAppendASCII(s, bp, e - bp);
+		bp = e;
 	      }
 	  }
       }
@@ -1952,6 +2099,179 @@ all_done:
 #endif
   return;
 }
+
+void
+GSPrivateFormat (GSStr s, const unichar *format, va_list ap,
+NSDictionary *locale)
+{
+  format_parsed (s, format, NULL, ap, locale);
+}
+
+/* Number of slots in the cache of parsed constant format strings.
+   Must be a power of two.  */
+#define	FORMAT_CACHE_SIZE	256
+
+/* Cache of parsed constant format strings, indexed by the address of
+   the string object.  Since a constant string goes away when the bundle
+   holding it is unloaded, an entry is only used if the length and hash
+   of the string match too.  A thread using an entry takes it out of its
+   slot (by compare and swap) and puts it back afterwards, so an entry
+   is never in use by more than one thread, and whichever thread holds
+   it may replace and free it without locking.  */
+static format_cache_entry	*format_cache[FORMAT_CACHE_SIZE];
+
+static void
+format_entry_free (format_cache_entry *e)
+{
+  if (e != NULL)
+    {
+      free (e->format);
+      free (e->specs);
+      free (e->args_type);
+      free (e);
+    }
+}
+
+/* Parse the LEN characters of FMT into a new cache entry for KEY,
+   whose hash is HASH.  Returns NULL if memory could not be allocated.  */
+static format_cache_entry *
+format_entry_new (NSString *key, NSUInteger hash, const unichar *fmt,
+  size_t len)
+{
+  format_cache_entry	*e;
+  size_t		nspecs_max = 8;
+  size_t		max_ref_arg = 0;
+  const unichar		*f;
+
+  if ((e = calloc (1, sizeof (format_cache_entry))) == NULL
+    || (e->format = malloc ((len + 1) * sizeof (unichar))) == NULL
+    || (e->specs = malloc (nspecs_max * sizeof (struct printf_spec))) == NULL)
+    {
+      format_entry_free (e);
+      return NULL;
+    }
+  memcpy (e->format, fmt, len * sizeof (unichar));
+  e->format[len] = '\0';
+
+  f = find_spec (e->format);
+  e->lead = f - e->format;
+  for (; *f != '\0'; f = e->specs[e->nspecs++].next_fmt)
+    {
+      if (e->nspecs >= nspecs_max)
+	{
+	  struct printf_spec	*tmp;
+
+	  nspecs_max *= 2;
+	  tmp = realloc (e->specs, nspecs_max * sizeof (struct printf_spec));
+	  if (tmp == NULL)
+	    {
+	      format_entry_free (e);
+	      return NULL;
+	    }
+	  e->specs = tmp;
+	}
+      e->nargs += parse_one_spec (f, e->nargs, &e->specs[e->nspecs],
+	&max_ref_arg);
+    }
+  e->nargs = MAX (e->nargs, max_ref_arg);
+
+  if ((e->args_type = calloc (e->nargs + 1, sizeof (int))) == NULL)
+    {
+      format_entry_free (e);
+      return NULL;
+    }
+  fill_args_type (e->args_type, e->specs, e->nspecs);
+  e->key = key;
+  e->length = len;
+  e->hash = hash;
+  return e;
+}
+
+void
+GSPrivateFormatString (GSStr s, NSString *format, va_list ap,
+NSDictionary *locale)
+{
+  static Class		constantStringClass = Nil;
+  unichar		fbuf[1024];
+  unichar		*fmt = fbuf;
+  format_cache_entry	*e = NULL;
+  unsigned		slot = 0;
+  NSUInteger		hash = 0;
+  BOOL			cacheable = NO;
+  size_t		len;
+
+  if (Nil == constantStringClass)
+    {
+      constantStringClass = [NSString constantStringClass];
+    }
+  len = [format length];
+  if (object_getClass(format) == constantStringClass)
+    {
+      hash = [format hash];
+      slot = (unsigned)(((uintptr_t)format) >> 3) & (FORMAT_CACHE_SIZE - 1);
+      do
+	{
+	  e = format_cache[slot];
+	}
+      while (e != NULL
+	&& NO == __sync_bool_compare_and_swap (&format_cache[slot], e, NULL));
+      if (e != NULL)
+	{
+	  if (e->key == format && e->length == len && e->hash == hash)
+	    {
+	      format_parsed (s, e->format, e, ap, locale);
+	      /* Another thread may have filled the slot while we were
+	       * using the entry, in which case we discard ours.
+	       */
+	      if (NO == __sync_bool_compare_and_swap (&format_cache[slot],
+		NULL, e))
+		{
+		  format_entry_free (e);
+		}
+	      return;
+	    }
+	  /* The entry is for a different (or unloaded) string, so it is
+	   * replaced by one for this format.
+	   */
+	  format_entry_free (e);
+	  e = NULL;
+	}
+      cacheable = YES;
+    }
+
+  /*
+   * Provide an array of unichar characters containing the format
+   * string.  For performance reasons we try to use an on-stack buffer
+   * if the format string is small enough ... it almost always will be.
+   */
+  if (len >= 1024)
+    {
+      fmt = NSZoneMalloc(NSDefaultMallocZone(), (len+1)*sizeof(unichar));
+    }
+  [format getCharacters: fmt range: ((NSRange){0, len})];
+  fmt[len] = '\0';
+
+  if (YES == cacheable
+    && (e = format_entry_new (format, hash, fmt, len)) != NULL)
+    {
+      /* Another thread may have filled the slot since we emptied it,
+       * in which case we use our entry once and discard it.
+       */
+      format_parsed (s, e->format, e, ap, locale);
+      if (NO == __sync_bool_compare_and_swap (&format_cache[slot], NULL, e))
+	{
+	  format_entry_free (e);
+	}
+    }
+  else
+    {
+      format_parsed (s, fmt, NULL, ap, locale);
+    }
+  if (fmt != fbuf)
+    {
+      NSZoneFree(NSDefaultMallocZone(), fmt);
+    }
+}
 
 /* Handle an unknown format specifier.  This prints out a canonicalized
    representation of the format spec itself.  */
@@ -1120,6 +1120,7 @@ debugWrite(GSHTTPURLHandle *handle, NSData *data)
             GSTLSDebug,
             GSTLSPriority,
             GSTLSRemoteHosts,
+            GSTLSResumeKey,
             GSTLSRevokeFile,
             GSTLSServerName,
             GSTLSVerify,
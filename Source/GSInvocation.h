@@ -62,6 +62,10 @@ typedef struct	{
 - (BOOL) encodeWithDistantCoder: (NSCoder*)coder passPointers: (BOOL)passp;
 @end
 
+@interface NSCoder (DistantCoding)
+- (void) encodeMethodType: (const char*)types;
+@end
+
 @interface NSMethodSignature (GNUstep)
 - (const char*) methodType;
 - (NSArgumentInfo*) methodInfo;
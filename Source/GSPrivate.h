@@ -407,6 +407,14 @@ void
 GSPrivateFormat(GSStr fb, const unichar *fmt, va_list ap, NSDictionary *loc)
   GS_ATTRIB_PRIVATE;
 
+/* Format arguments into an internal string using a format string object.
+ * The parsed form of constant format strings is cached so that they do
+ * not need to be parsed again each time they are used.
+ */
+void
+GSPrivateFormatString(GSStr fb, NSString *fmt, va_list ap, NSDictionary *loc)
+  GS_ATTRIB_PRIVATE;
+
 /* determine whether data in a particular encoding can
  * generally be represented as 8-bit characters including ascii.
  */
@@ -459,6 +467,77 @@ typedef NSRange (*GSRSFunc)(id, id, unsigned, NSRange);
 GSRSFunc
 GSPrivateRangeOfString(NSString *receiver, NSString *target) GS_ATTRIB_PRIVATE;
 
+@class	NSRegularExpression;
+
+/* Return a shared, compiled regular expression for the pattern and
+ * options (NSRegularExpressionOptions), taken from a bounded cache.
+ * Returns nil if the pattern is invalid.
+ */
+NSRegularExpression *
+GSPrivateRegularExpression(NSString *pattern, NSUInteger opts)
+  GS_ATTRIB_PRIVATE;
+
+/* Return YES if the regular expression matches the whole of the string.
+ */
+BOOL
+GSPrivateRegularExpressionMatches(NSRegularExpression *expression,
+  NSString *string) GS_ATTRIB_PRIVATE;
+
+@class	NSCharacterSet;
+
+/* A compiled form of a character set, used to test membership and to
+ * scan string buffers without sending a message for each character.
+ * If bits is not null it is the bitmap of the set in the BMP (length
+ * bytes long), otherwise imp is the set's -characterIsMember: method.
+ * A non-zero count means that chars holds all the members of the set.
+ */
+typedef struct {
+  const unsigned char	*bits;
+  NSUInteger		length;
+  NSCharacterSet	*set;
+  SEL			sel;
+  BOOL			(*imp)(id, SEL, unichar);
+  unsigned		count;
+  unichar		chars[8];
+} GSCharMatcher;
+
+static inline BOOL
+GSCharMatcherIsMember(const GSCharMatcher *m, unichar u)
+{
+  if (m->bits != 0)
+    {
+      NSUInteger	byte = u >> 3;
+
+      return (byte < m->length && (m->bits[byte] & (1 << (u & 7))))
+	? YES : NO;
+    }
+  return (*m->imp)(m->set, m->sel, u);
+}
+
+/* Return a matcher for aSet.  This may be a matcher cached by the set
+ * or may be built in buf, so buf must remain valid while the matcher
+ * is used.  The set must not be modified while the matcher is in use.
+ */
+const GSCharMatcher *
+GSPrivateCharMatcher(NSCharacterSet *aSet, GSCharMatcher *buf)
+  GS_ATTRIB_PRIVATE;
+
+/* Return the index of the first of len 8-bit (Latin-1) characters in buf
+ * whose membership of the matcher's set is the same as member, or len if
+ * there is no such character.
+ */
+NSUInteger
+GSPrivateCharMatcherScan8(const GSCharMatcher *m, const unsigned char *buf,
+  NSUInteger len, BOOL member) GS_ATTRIB_PRIVATE;
+
+/* Return the index of the first of len characters in buf whose membership
+ * of the matcher's set is the same as member, or len if there is no such
+ * character.
+ */
+NSUInteger
+GSPrivateCharMatcherScan16(const GSCharMatcher *m, const unichar *buf,
+  NSUInteger len, BOOL member) GS_ATTRIB_PRIVATE;
+
 /* Function to return the hash value for a small integer (used by NSNumber).
  */
 unsigned
@@ -610,5 +689,124 @@ void
 GSPrivateEncodeBase64(const uint8_t *src, NSUInteger length, uint8_t *dst)
   GS_ATTRIB_PRIVATE;
 
+@class	NSData;
+@class	NSMutableData;
+
+/* Incremental writer for binary property lists, used by the keyed
+ * archiver to produce its output without first building a property list.
+ * Each write function appends an object and returns its index, which
+ * may be used in arrays and dictionaries written later.  Equal strings,
+ * numbers, dates and references are written only once.
+ * GSPrivateBinaryPLWriterFinish() returns the complete property list,
+ * with the object at the root index as its top level object; after that
+ * the writer may only be freed.
+ */
+typedef struct GSBinaryPLWriter GSBinaryPLWriter;
+
+GSBinaryPLWriter *
+GSPrivateBinaryPLWriterCreate(void) GS_ATTRIB_PRIVATE;
+
+void
+GSPrivateBinaryPLWriterFree(GSBinaryPLWriter *w) GS_ATTRIB_PRIVATE;
+
+NSMutableData *
+GSPrivateBinaryPLWriterFinish(GSBinaryPLWriter *w, NSUInteger root)
+  GS_ATTRIB_PRIVATE;
+
+NSUInteger
+GSPrivateBinaryPLWriteArray(GSBinaryPLWriter *w,
+  const NSUInteger *refs, NSUInteger count) GS_ATTRIB_PRIVATE;
+
+NSUInteger
+GSPrivateBinaryPLWriteBool(GSBinaryPLWriter *w, BOOL value)
+  GS_ATTRIB_PRIVATE;
+
+NSUInteger
+GSPrivateBinaryPLWriteBytes(GSBinaryPLWriter *w,
+  const void *bytes, NSUInteger length) GS_ATTRIB_PRIVATE;
+
+NSUInteger
+GSPrivateBinaryPLWriteDictionary(GSBinaryPLWriter *w,
+  const NSUInteger *keys, const NSUInteger *values, NSUInteger count)
+  GS_ATTRIB_PRIVATE;
+
+NSUInteger
+GSPrivateBinaryPLWriteInteger(GSBinaryPLWriter *w, long long value)
+  GS_ATTRIB_PRIVATE;
+
+/* Writes any property list object, raising an exception if it is not
+ * a valid property list.
+ */
+NSUInteger
+GSPrivateBinaryPLWriteObject(GSBinaryPLWriter *w, id object)
+  GS_ATTRIB_PRIVATE;
+
+NSUInteger
+GSPrivateBinaryPLWriteReal(GSBinaryPLWriter *w, double value)
+  GS_ATTRIB_PRIVATE;
+
+/* Writes a keyed archiver object reference.
+ */
+NSUInteger
+GSPrivateBinaryPLWriteUID(GSBinaryPLWriter *w, NSUInteger uid)
+  GS_ATTRIB_PRIVATE;
+
+/* Ways of copying data between descriptors, from the most efficient.
+ * A caller copying in several steps starts with GSCopyRange and passes
+ * the same variable to each call of GSPrivateCopyDescriptor(), which
+ * changes it to the first method the descriptors support.
+ */
+enum {
+  GSCopyRange = 0,	/* copy_file_range() between files	*/
+  GSCopySendfile,	/* sendfile() from a file		*/
+  GSCopySplice,		/* splice() from a file into a pipe	*/
+  GSCopyBuffer		/* pread() and write()			*/
+};
+
+/* Copies up to length bytes from the descriptor in, starting at *offset,
+ * to the current position of the descriptor out, leaving the position of
+ * the input unchanged.  The kernel moves the data where it can, otherwise
+ * it is copied through a buffer.  Returns the number of bytes copied
+ * (and advances *offset by that amount), zero at the end of the input,
+ * or -1 with errno set on failure.
+ */
+NSInteger
+GSPrivateCopyDescriptor(int in, unsigned long long *offset, int out,
+  NSUInteger length, int *how) GS_ATTRIB_PRIVATE;
+
+/* Free space at the end of an NSMutableData, into which a caller may read
+ * directly (eg with readv()) rather than reading into a buffer of its own
+ * and appending that.
+ */
+typedef struct {
+  void		*buf[2];	/* The free space, in order		*/
+  NSUInteger	len[2];
+  unsigned	count;		/* Number of buffers (one or two)	*/
+  NSUInteger	base;		/* Length of the data before reading	*/
+  BOOL		fresh;		/* The last buffer is a new chunk	*/
+} GSDataSpace;
+
+/* Makes at least want bytes of free space at the end of data and
+ * describes it in *space.  For data made by +dataWithChunkSize: this is
+ * whatever is left in the last chunk followed (if that is too small) by
+ * a new chunk, so nothing is moved; other mutable data grows its buffer.
+ * GSPrivateDataExtend() must be called before the data is used again,
+ * with the number of bytes stored in the space, to set its length.
+ */
+void
+GSPrivateDataSpace(NSMutableData *data, NSUInteger want, GSDataSpace *space)
+  GS_ATTRIB_PRIVATE;
+
+void
+GSPrivateDataExtend(NSMutableData *data, GSDataSpace *space, NSUInteger used)
+  GS_ATTRIB_PRIVATE;
+
+/* Returns an immutable property list read from binary data, whose arrays
+ * and dictionaries decode their contents when first used, or nil if the
+ * data is not a valid binary property list.
+ */
+id
+GSPrivateLazyPropertyList(NSData *data) GS_ATTRIB_PRIVATE;
+
 #endif /* _GSPrivate_h_ */
 
@@ -454,6 +454,7 @@ static NSArray  *keys = nil;
         GSTLSDebug,
         GSTLSPriority,
         GSTLSRemoteHosts,
+        GSTLSResumeKey,
         GSTLSRevokeFile,
         GSTLSServerName,
         GSTLSVerify,
@@ -646,7 +647,24 @@ static NSArray  *keys = nil;
 		   withTLSPriority: str
 		   fromInputStream: i
 		    orOutputStream: o];
-  
+
+  /* Unless told otherwise, let a connection resume a recent session
+   * with the same remote address and port.
+   */
+  if (NO == server && nil == [opts objectForKey: GSTLSResumeKey])
+    {
+      struct sockaddr   *sa = [i _address];
+
+      if (AF_INET == sa->sa_family
+#if     defined(AF_INET6)
+        || AF_INET6 == sa->sa_family
+#endif
+        )
+        {
+          [opts setObject: GSPrivateSockaddrName(sa) forKey: GSTLSResumeKey];
+        }
+    }
+
   session = [[GSTLSSession alloc] initWithOptions: opts
                                         direction: (server ? NO : YES)
                                         transport: (void*)self
@@ -769,6 +787,7 @@ static NSArray  *keys = nil;
         GSTLSDebug,
         GSTLSPriority,
         GSTLSRemoteHosts,
+        GSTLSResumeKey,
         GSTLSRevokeFile,
         GSTLSVerify,
         nil];
@@ -712,7 +712,10 @@ static RunLoopEventType typeForStream(NSStream *aStream)
 {
   if ((self = [super init]) != nil)
     {
-      ASSIGN(_data, data);
+      /* The stream reads a copy of the data, which for an immutable
+       * object is the object itself.
+       */
+      _data = [data copy];
       _pointer = 0;
     }
   return self;
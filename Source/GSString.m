@@ -582,6 +582,14 @@ instance.
 }
 @end
 
+/*
+ * A mutable string held as a piece table.  Instances are never created
+ * directly, GSMutableString instances switch to this class when edits
+ * of large strings would otherwise move a lot of data.
+ */
+@interface GSPieceString : NSMutableString
+@end
+
 /*
  *	Include sequence handling code with instructions to generate search
  *	and compare functions for NSString objects.
@@ -639,9 +647,9 @@ static Class GSUnicodeBufferStringClass = 0;
 static Class GSUnicodeSubStringClass = 0;
 static Class GSUInlineStringClass = 0;
 static Class GSMutableStringClass = 0;
+static Class GSPieceStringClass = 0;
 static Class NSConstantStringClass = 0;
 
-static SEL	cMemberSel;
 static SEL	convertSel;
 static BOOL	(*convertImp)(id, SEL, NSStringEncoding);
 static SEL	equalSel;
@@ -692,6 +700,7 @@ setup(BOOL rerun)
       GSCSubStringClass = [GSCSubString class];
       GSUnicodeSubStringClass = [GSUnicodeSubString class];
       GSMutableStringClass = [GSMutableString class];
+      GSPieceStringClass = [GSPieceString class];
       NSConstantStringClass = [NXConstantString class];
 
       /*
@@ -699,7 +708,6 @@ setup(BOOL rerun)
        * cases where we want to use the implementation
        * provided in the abstract rolot cllass of the cluster.
        */
-      cMemberSel = @selector(characterIsMember:);
       convertSel = @selector(canBeConvertedToEncoding:);
       convertImp = (BOOL (*)(id, SEL, NSStringEncoding))
 	[NSStringClass instanceMethodForSelector: convertSel];
@@ -1578,31 +1586,16 @@ fixBOM(unsigned char **bytes, NSUInteger*length, BOOL *owned,
 {
   GSStr		f;
   unsigned char	buf[2048];
-  unichar	fbuf[1024];
-  unichar	*fmt = fbuf;
-  size_t	len;
   GSStr		me;
 
   if (NULL == format)
     [NSException raise: NSInvalidArgumentException
       format: @"[GSPlaceholderString-initWithFormat:locale:arguments:]: NULL format"];
-  /*
-   * First we provide an array of unichar characters containing the
-   * format string.  For performance reasons we try to use an on-stack
-   * buffer if the format string is small enough ... it almost always
-   * will be.
-   */
-  len = [format length];
-  if (len >= 1024)
-    {
-      fmt = NSZoneMalloc(NSDefaultMallocZone(), (len+1)*sizeof(unichar));
-    }
-  [format getCharacters: fmt];
-  fmt[len] = '\0';
 
   /*
-   * Now set up 'f' as a GSMutableString object whose initial buffer is
-   * allocated on the stack.  The GSPrivateFormat function can write into it.
+   * Set up 'f' as a GSMutableString object whose initial buffer is
+   * allocated on the stack.  The GSPrivateFormatString function can
+   * write into it.
    */
   f = (GSStr)alloca(class_getInstanceSize(GSMutableStringClass));
   object_setClass(f, GSMutableStringClass);
@@ -1612,11 +1605,7 @@ fixBOM(unsigned char **bytes, NSUInteger*length, BOOL *owned,
   f->_count = 0;
   f->_flags.wide = 0;
   f->_flags.owned = 0;
-  GSPrivateFormat(f, fmt, argList, locale);
-  if (fmt != fbuf)
-    {
-      NSZoneFree(NSDefaultMallocZone(), fmt);
-    }
+  GSPrivateFormatString(f, format, argList, locale);
 
   /*
    * Don't use noCopy because f->_contents.u may be memory on the stack,
@@ -3398,7 +3387,8 @@ rangeOfCharacter_c(GSStr self, NSCharacterSet *aSet, unsigned mask,
   int		stop;
   int		step;
   NSRange	range;
-  BOOL		(*mImp)(id, SEL, unichar);
+  GSCharMatcher	matcher;
+  const GSCharMatcher	*m;
 
   if (aSet == nil)
     [NSException raise: NSInvalidArgumentException format: @"range of nil"];
@@ -3418,8 +3408,18 @@ rangeOfCharacter_c(GSStr self, NSCharacterSet *aSet, unsigned mask,
   range.location = NSNotFound;
   range.length = 0;
 
-  mImp = (BOOL(*)(id,SEL,unichar))
-    [aSet methodForSelector: cMemberSel];
+  m = GSPrivateCharMatcher(aSet, &matcher);
+
+  if (step > 0 && internalEncoding == NSISOLatin1StringEncoding)
+    {
+      i = start + GSPrivateCharMatcherScan8(m, self->_contents.c + start,
+	stop - start, YES);
+      if (i < stop)
+	{
+	  range = NSMakeRange(i, 1);
+	}
+      return range;
+    }
 
   for (i = start; i != stop; i += step)
     {
@@ -3440,7 +3440,7 @@ rangeOfCharacter_c(GSStr self, NSCharacterSet *aSet, unsigned mask,
       /* FIXME ... what about UTF-16 sequences of more than one 16bit value
        * corresponding to a single UCS-32 codepoint?
        */
-      if ((*mImp)(aSet, cMemberSel, u))
+      if (GSCharMatcherIsMember(m, u))
 	{
 	  range = NSMakeRange(i, 1);
 	  break;
@@ -3459,7 +3459,8 @@ rangeOfCharacter_u(GSStr self, NSCharacterSet *aSet, unsigned mask,
   int		stop;
   int		step;
   NSRange	range;
-  BOOL		(*mImp)(id, SEL, unichar);
+  GSCharMatcher	matcher;
+  const GSCharMatcher	*m;
 
   if (aSet == nil)
     [NSException raise: NSInvalidArgumentException format: @"range of nil"];
@@ -3479,17 +3480,26 @@ rangeOfCharacter_u(GSStr self, NSCharacterSet *aSet, unsigned mask,
   range.location = NSNotFound;
   range.length = 0;
 
-  mImp = (BOOL(*)(id,SEL,unichar))
-    [aSet methodForSelector: cMemberSel];
+  m = GSPrivateCharMatcher(aSet, &matcher);
 
   /* FIXME ... what about UTF-16 sequences of more than one 16bit value
    * corresponding to a single UCS-32 codepoint?
    */
+  if (step > 0)
+    {
+      i = start + GSPrivateCharMatcherScan16(m, self->_contents.u + start,
+	stop - start, YES);
+      if (i < stop)
+	{
+	  range = NSMakeRange(i, 1);
+	}
+      return range;
+    }
   for (i = start; i != stop; i += step)
     {
       unichar letter = self->_contents.u[i];
 
-      if ((*mImp)(aSet, cMemberSel, letter))
+      if (GSCharMatcherIsMember(m, letter))
 	{
 	  range = NSMakeRange(i, 1);
 	  break;
@@ -4559,6 +4569,660 @@ agree, create a new GSUInlineString otherwise.
 @end
 
 
+/*
+ * Large mutable strings which are edited away from their end switch to
+ * a piece table, so that an edit costs time in proportion to the number
+ * of pieces rather than to the number of characters which would have
+ * to be moved.  Inserted text is kept in append-only buffers (8-bit where
+ * possible), so inserting a wide character does not widen the whole
+ * string.  The GSPieceString class shares the ivar layout of
+ * GSMutableString: _count holds the length, _zone the zone and
+ * _contents.c points to the table.  Operations which need all the
+ * characters in one buffer join the pieces and turn the object back
+ * into a GSMutableString.
+ */
+#define	GS_PIECE_MIN_LENGTH	65536	/* Smallest string to switch.	*/
+#define	GS_PIECE_MIN_MOVE	16384	/* Smallest move worth avoiding. */
+#define	GS_PIECE_MAX_PIECES	1024	/* Pieces before joining again.	*/
+#define	GS_PIECE_CHUNK		8192	/* Size of buffers for additions. */
+
+typedef struct {
+  void		*data;		/* Characters (8-bit or unichar).	*/
+  NSUInteger	used;		/* Number of characters stored.		*/
+  NSUInteger	capacity;	/* Number of characters allocated.	*/
+  BOOL		wide;		/* Whether data holds unichars.		*/
+} GSPieceBuffer;
+
+typedef struct {
+  NSUInteger	offset;		/* Start of characters in the buffer.	*/
+  NSUInteger	length;		/* Number of characters.		*/
+  unsigned	buffer;		/* Index of the buffer.			*/
+} GSPiece;
+
+typedef struct {
+  NSZone	*zone;
+  GSPiece	*pieces;
+  unsigned	count;		/* Number of pieces in use.		*/
+  unsigned	size;		/* Number of pieces allocated.		*/
+  GSPieceBuffer	*buffers;
+  unsigned	nbuffers;	/* Number of buffers in use.		*/
+  unsigned	bsize;		/* Number of buffers allocated.		*/
+  unsigned	add8;		/* Buffer for 8-bit additions, or 0.	*/
+  unsigned	add16;		/* Buffer for 16-bit additions, or 0.	*/
+  unsigned	cursor;		/* Index of the last piece located.	*/
+  NSUInteger	cursorStart;	/* Character index where it starts.	*/
+} GSPieceTable;
+
+#define	PIECES(o)	((GSPieceTable*)(((GSStr)(o))->_contents.c))
+
+static void
+pieceTableFree(GSPieceTable *t)
+{
+  unsigned	i;
+
+  for (i = 0; i < t->nbuffers; i++)
+    {
+      NSZoneFree(t->zone, t->buffers[i].data);
+    }
+  NSZoneFree(t->zone, t->buffers);
+  NSZoneFree(t->zone, t->pieces);
+  NSZoneFree(t->zone, t);
+}
+
+static unsigned
+pieceBufferAdd(GSPieceTable *t, void *data, NSUInteger used,
+  NSUInteger capacity, BOOL wide)
+{
+  GSPieceBuffer	*b;
+
+  if (t->nbuffers == t->bsize)
+    {
+      t->bsize = (t->bsize == 0) ? 8 : t->bsize * 2;
+      t->buffers = NSZoneRealloc(t->zone, t->buffers,
+	t->bsize * sizeof(GSPieceBuffer));
+    }
+  b = &t->buffers[t->nbuffers];
+  b->data = data;
+  b->used = used;
+  b->capacity = capacity;
+  b->wide = wide;
+  return t->nbuffers++;
+}
+
+static void
+pieceInsert(GSPieceTable *t, unsigned index, GSPiece p)
+{
+  if (t->count == t->size)
+    {
+      t->size = (t->size == 0) ? 16 : t->size * 2;
+      t->pieces = NSZoneRealloc(t->zone, t->pieces,
+	t->size * sizeof(GSPiece));
+    }
+  memmove(&t->pieces[index + 1], &t->pieces[index],
+    (t->count - index) * sizeof(GSPiece));
+  t->pieces[index] = p;
+  t->count++;
+}
+
+/*
+ * Return the index of the piece containing the character at index
+ * (or the number of pieces if index is the length of the string),
+ * and store the character index at which that piece starts in *start.
+ * Searches from the last piece located, since edits tend to be close
+ * to each other.
+ */
+static unsigned
+pieceLocate(GSPieceTable *t, NSUInteger index, NSUInteger *start)
+{
+  unsigned	i = t->cursor;
+  NSUInteger	s = t->cursorStart;
+
+  if (index < s)
+    {
+      while (index < s)
+	{
+	  s -= t->pieces[--i].length;
+	}
+    }
+  else
+    {
+      while (i < t->count && index >= s + t->pieces[i].length)
+	{
+	  s += t->pieces[i++].length;
+	}
+    }
+  t->cursor = i;
+  t->cursorStart = s;
+  *start = s;
+  return i;
+}
+
+/*
+ * Make sure a piece starts at index, splitting a piece if necessary,
+ * and return the index of that piece.
+ */
+static unsigned
+pieceSplit(GSPieceTable *t, NSUInteger index)
+{
+  NSUInteger	start;
+  unsigned	i = pieceLocate(t, index, &start);
+  GSPiece	tail;
+
+  if (i == t->count || start == index)
+    {
+      return i;
+    }
+  tail = t->pieces[i];
+  tail.offset += index - start;
+  tail.length -= index - start;
+  t->pieces[i].length = index - start;
+  pieceInsert(t, i + 1, tail);
+  t->cursor = i + 1;
+  t->cursorStart = index;
+  return i + 1;
+}
+
+/*
+ * Copy len characters, starting from offset from within piece p,
+ * into the unichar buffer dst.
+ */
+static void
+pieceChars(GSPieceTable *t, GSPiece *p, NSUInteger from, NSUInteger len,
+  unichar *dst)
+{
+  GSPieceBuffer	*b = &t->buffers[p->buffer];
+
+  if (b->wide == YES)
+    {
+      memcpy(dst, ((unichar*)b->data) + p->offset + from,
+	len * sizeof(unichar));
+    }
+  else
+    {
+      unsigned char	*c = ((unsigned char*)b->data) + p->offset + from;
+
+      if (NSISOLatin1StringEncoding == internalEncoding)
+	{
+	  while (len-- > 0)
+	    {
+	      dst[len] = c[len];
+	    }
+	}
+      else
+	{
+	  unsigned	l = len;
+
+	  if (!GSToUnicode(&dst, &l, c, len, internalEncoding, 0, 0))
+	    {
+	      [NSException raise: NSInternalInconsistencyException
+			  format: @"Can't convert to Unicode."];
+	    }
+	}
+    }
+}
+
+/*
+ * Join all the pieces into a single newly allocated buffer of
+ * total characters (with space for one more).  The buffer is 8-bit
+ * unless some piece is held in a 16-bit buffer.
+ */
+static void *
+pieceJoin(GSPieceTable *t, NSUInteger total, BOOL *isWide)
+{
+  BOOL		wide = NO;
+  unsigned char	*data;
+  NSUInteger	pos = 0;
+  unsigned	i;
+
+  for (i = 0; i < t->count && wide == NO; i++)
+    {
+      wide = t->buffers[t->pieces[i].buffer].wide;
+    }
+  data = NSZoneMalloc(t->zone, (total + 1) * (wide ? sizeof(unichar) : 1));
+  for (i = 0; i < t->count; i++)
+    {
+      GSPiece		*p = &t->pieces[i];
+      GSPieceBuffer	*b = &t->buffers[p->buffer];
+
+      if (wide == YES)
+	{
+	  pieceChars(t, p, 0, p->length, ((unichar*)data) + pos);
+	}
+      else
+	{
+	  memcpy(data + pos, ((unsigned char*)b->data) + p->offset, p->length);
+	}
+      pos += p->length;
+    }
+  *isWide = wide;
+  return data;
+}
+
+/*
+ * Store the characters in an addition buffer and return a piece
+ * referring to them.
+ */
+static GSPiece
+pieceStore(GSPieceTable *t, const unichar *u, NSUInteger len)
+{
+  GSPieceBuffer	*b;
+  GSPiece	p;
+  BOOL		wide = NO;
+  unsigned	index;
+  NSUInteger	i;
+
+  for (i = 0; i < len; i++)
+    {
+      if (u[i] > 127
+	&& (u[i] > 255 || internalEncoding != NSISOLatin1StringEncoding))
+	{
+	  wide = YES;
+	  break;
+	}
+    }
+  index = (wide == YES) ? t->add16 : t->add8;
+  if (index == 0
+    || t->buffers[index].capacity - t->buffers[index].used < len)
+    {
+      NSUInteger	capacity = MAX(GS_PIECE_CHUNK, len);
+
+      index = pieceBufferAdd(t, NSZoneMalloc(t->zone,
+	capacity * (wide ? sizeof(unichar) : 1)), 0, capacity, wide);
+      if (wide == YES)
+	{
+	  t->add16 = index;
+	}
+      else
+	{
+	  t->add8 = index;
+	}
+    }
+  b = &t->buffers[index];
+  if (wide == YES)
+    {
+      memcpy(((unichar*)b->data) + b->used, u, len * sizeof(unichar));
+    }
+  else
+    {
+      unsigned char	*c = ((unsigned char*)b->data) + b->used;
+
+      for (i = 0; i < len; i++)
+	{
+	  c[i] = (unsigned char)u[i];
+	}
+    }
+  p.buffer = index;
+  p.offset = b->used;
+  p.length = len;
+  b->used += len;
+  return p;
+}
+
+/*
+ * Replace all the pieces with a single one holding the whole string.
+ */
+static void
+pieceCompact(GSStr self)
+{
+  GSPieceTable	*t = PIECES(self);
+  BOOL		wide;
+  void		*data = pieceJoin(t, self->_count, &wide);
+  unsigned	i;
+
+  for (i = 0; i < t->nbuffers; i++)
+    {
+      NSZoneFree(t->zone, t->buffers[i].data);
+    }
+  t->nbuffers = 0;
+  t->add8 = t->add16 = 0;
+  pieceBufferAdd(t, data, self->_count, self->_count + 1, wide);
+  t->pieces[0].buffer = 0;
+  t->pieces[0].offset = 0;
+  t->pieces[0].length = self->_count;
+  t->count = (self->_count > 0) ? 1 : 0;
+  t->cursor = 0;
+  t->cursorStart = 0;
+}
+
+static void
+pieceReplace(GSStr self, NSRange aRange, const unichar *u, NSUInteger len)
+{
+  GSPieceTable	*t = PIECES(self);
+  unsigned	first = pieceSplit(t, aRange.location);
+  unsigned	last = pieceSplit(t, NSMaxRange(aRange));
+  unsigned	n = (len > 0) ? 1 : 0;
+  BOOL		merged = NO;
+  GSPiece	p = {0, 0, 0};
+
+  if (n > 0)
+    {
+      p = pieceStore(t, u, len);
+      if (first > 0 && t->pieces[first - 1].buffer == p.buffer
+	&& t->pieces[first - 1].offset + t->pieces[first - 1].length
+	== p.offset)
+	{
+	  /* Extends the previous piece (eg. successive insertions).
+	   */
+	  t->pieces[first - 1].length += len;
+	  merged = YES;
+	  n = 0;
+	}
+    }
+  if (n > last - first)
+    {
+      pieceInsert(t, last, p);
+    }
+  else
+    {
+      if (n > 0)
+	{
+	  t->pieces[first] = p;
+	}
+      memmove(&t->pieces[first + n], &t->pieces[last],
+	(t->count - last) * sizeof(GSPiece));
+      t->count -= (last - first) - n;
+    }
+  self->_count = self->_count - aRange.length + len;
+  self->_flags.hash = 0;
+
+  /* The pieces before first are unchanged, so the piece at first
+   * still starts at the location of the replaced range (unless the
+   * new characters were added to the end of the piece before it).
+   */
+  if (merged == YES)
+    {
+      t->cursor = first - 1;
+      t->cursorStart = aRange.location + len - t->pieces[first - 1].length;
+    }
+  else
+    {
+      t->cursor = first;
+      t->cursorStart = aRange.location;
+    }
+
+  if (t->count > GS_PIECE_MAX_PIECES)
+    {
+      pieceCompact(self);
+    }
+}
+
+/*
+ * Switch a GSMutableString to use a piece table, taking over its buffer
+ * as the initial piece.
+ */
+static void
+pieceBecome(GSStr self)
+{
+  NSZone	*z = (self->_zone == 0) ? NSDefaultMallocZone() : self->_zone;
+  GSPieceTable	*t;
+  void		*data = self->_contents.c;
+  NSUInteger	size = self->_flags.wide ? sizeof(unichar) : 1;
+  GSPiece	p;
+
+  if (self->_flags.owned == 0)
+    {
+      data = NSZoneMalloc(z, (self->_count + 1) * size);
+      memcpy(data, self->_contents.c, self->_count * size);
+      self->_capacity = self->_count + 1;
+    }
+  t = NSZoneCalloc(z, 1, sizeof(GSPieceTable));
+  t->zone = z;
+  pieceBufferAdd(t, data, self->_count, self->_capacity, self->_flags.wide);
+  p.buffer = 0;
+  p.offset = 0;
+  p.length = self->_count;
+  pieceInsert(t, 0, p);
+  self->_zone = z;
+  self->_contents.c = (unsigned char*)t;
+  self->_flags.hash = 0;
+  GSClassSwizzle(self, GSPieceStringClass);
+}
+
+/*
+ * Join the pieces into a single buffer and turn back into a
+ * GSMutableString.
+ */
+static GSStr
+pieceRevert(GSStr self)
+{
+  GSPieceTable	*t = PIECES(self);
+  BOOL		wide;
+
+  self->_contents.c = pieceJoin(t, self->_count, &wide);
+  self->_capacity = self->_count + 1;
+  self->_flags.wide = wide;
+  self->_flags.owned = 1;
+  self->_flags.hash = 0;
+  self->_zone = t->zone;
+  pieceTableFree(t);
+  GSClassSwizzle(self, GSMutableStringClass);
+  return self;
+}
+
+@implementation GSPieceString
+
+- (unichar) characterAtIndex: (NSUInteger)index
+{
+  GSPieceTable	*t = PIECES(self);
+  NSUInteger	start;
+  unsigned	i;
+  unichar	u;
+
+  if (index >= ((GSStr)self)->_count)
+    [NSException raise: NSRangeException format: @"Invalid index."];
+  i = pieceLocate(t, index, &start);
+  pieceChars(t, &t->pieces[i], index - start, 1, &u);
+  return u;
+}
+
+- (NSComparisonResult) compare: (NSString*)aString
+		       options: (NSUInteger)mask
+			 range: (NSRange)aRange
+{
+  return [pieceRevert((GSStr)self) compare: aString
+				   options: mask
+				     range: aRange];
+}
+
+- (id) copyWithZone: (NSZone*)z
+{
+  return [pieceRevert((GSStr)self) copyWithZone: z];
+}
+
+- (const char *) cString
+{
+  return [pieceRevert((GSStr)self) cString];
+}
+
+- (const char *) cStringUsingEncoding: (NSStringEncoding)encoding
+{
+  return [pieceRevert((GSStr)self) cStringUsingEncoding: encoding];
+}
+
+- (NSData*) dataUsingEncoding: (NSStringEncoding)encoding
+	 allowLossyConversion: (BOOL)flag
+{
+  return [pieceRevert((GSStr)self) dataUsingEncoding: encoding
+				allowLossyConversion: flag];
+}
+
+- (void) dealloc
+{
+  pieceTableFree(PIECES(self));
+  ((GSStr)self)->_contents.c = 0;
+  [super dealloc];
+}
+
+- (void) deleteCharactersInRange: (NSRange)range
+{
+  GS_RANGE_CHECK(range, ((GSStr)self)->_count);
+  if (range.length > 0)
+    {
+      pieceReplace((GSStr)self, range, 0, 0);
+    }
+}
+
+- (void) getCharacters: (unichar*)buffer range: (NSRange)aRange
+{
+  GSPieceTable	*t = PIECES(self);
+  NSUInteger	start;
+  NSUInteger	from;
+  unsigned	i;
+
+  GS_RANGE_CHECK(aRange, ((GSStr)self)->_count);
+  if (aRange.length == 0)
+    {
+      return;
+    }
+  i = pieceLocate(t, aRange.location, &start);
+  from = aRange.location - start;
+  while (aRange.length > 0)
+    {
+      GSPiece		*p = &t->pieces[i++];
+      NSUInteger	n = MIN(p->length - from, aRange.length);
+
+      pieceChars(t, p, from, n, buffer);
+      buffer += n;
+      aRange.length -= n;
+      from = 0;
+    }
+}
+
+- (BOOL) getCString: (char*)buffer
+	  maxLength: (NSUInteger)maxLength
+	   encoding: (NSStringEncoding)encoding
+{
+  return [pieceRevert((GSStr)self) getCString: buffer
+				    maxLength: maxLength
+				     encoding: encoding];
+}
+
+- (NSUInteger) hash
+{
+  return [pieceRevert((GSStr)self) hash];
+}
+
+- (BOOL) isEqual: (id)anObject
+{
+  return [pieceRevert((GSStr)self) isEqual: anObject];
+}
+
+- (BOOL) isEqualToString: (NSString*)aString
+{
+  return [pieceRevert((GSStr)self) isEqualToString: aString];
+}
+
+- (NSUInteger) length
+{
+  return ((GSStr)self)->_count;
+}
+
+- (BOOL) makeImmutable
+{
+  return [pieceRevert((GSStr)self) makeImmutable];
+}
+
+- (id) makeImmutableCopyOnFail: (BOOL)force
+{
+  return [pieceRevert((GSStr)self) makeImmutableCopyOnFail: force];
+}
+
+- (id) mutableCopyWithZone: (NSZone*)z
+{
+  return [pieceRevert((GSStr)self) mutableCopyWithZone: z];
+}
+
+- (NSRange) rangeOfCharacterFromSet: (NSCharacterSet*)aSet
+			    options: (NSUInteger)mask
+			      range: (NSRange)aRange
+{
+  return [pieceRevert((GSStr)self) rangeOfCharacterFromSet: aSet
+						   options: mask
+						     range: aRange];
+}
+
+- (NSRange) rangeOfString: (NSString*)aString
+		  options: (NSUInteger)mask
+		    range: (NSRange)aRange
+{
+  return [pieceRevert((GSStr)self) rangeOfString: aString
+					 options: mask
+					   range: aRange];
+}
+
+- (void) replaceCharactersInRange: (NSRange)aRange
+		       withString: (NSString*)aString
+{
+  unichar	buf[512];
+  unichar	*u = buf;
+  NSUInteger	length = 0;
+
+  GS_RANGE_CHECK(aRange, ((GSStr)self)->_count);
+  if (aString != nil)
+    {
+      if (GSObjCIsInstance(aString) == NO)
+	{
+	  [NSException raise: NSInvalidArgumentException
+		      format: @"replace characters with non-string"];
+	}
+      length = [aString length];
+    }
+  if ((NSUInteger)((GSStr)self)->_count - aRange.length + length > UINT_MAX)
+    {
+      [NSException raise: NSInvalidArgumentException
+		  format: @"string too long"];
+    }
+  if (length > sizeof(buf) / sizeof(unichar))
+    {
+      u = NSZoneMalloc(NSDefaultMallocZone(), length * sizeof(unichar));
+    }
+  [aString getCharacters: u range: NSMakeRange(0, length)];
+  pieceReplace((GSStr)self, aRange, u, length);
+  if (u != buf)
+    {
+      NSZoneFree(NSDefaultMallocZone(), u);
+    }
+}
+
+- (void) setString: (NSString*)aString
+{
+  GSStr		s = (GSStr)self;
+
+  /* Discard the pieces rather than joining them.
+   */
+  pieceTableFree(PIECES(self));
+  s->_contents.c = NSZoneMalloc(s->_zone, 1);
+  s->_capacity = 1;
+  s->_count = 0;
+  s->_flags.wide = 0;
+  s->_flags.owned = 1;
+  s->_flags.hash = 0;
+  GSClassSwizzle(self, GSMutableStringClass);
+  [self setString: aString];
+}
+
+- (NSString*) substringWithRange: (NSRange)aRange
+{
+  unichar	*u;
+
+  GS_RANGE_CHECK(aRange, ((GSStr)self)->_count);
+  if (aRange.length == 0)
+    {
+      return @"";
+    }
+  u = NSZoneMalloc(NSDefaultMallocZone(), aRange.length * sizeof(unichar));
+  [self getCharacters: u range: aRange];
+  return AUTORELEASE([[NSString allocWithZone: NSDefaultMallocZone()]
+    initWithCharactersNoCopy: u length: aRange.length freeWhenDone: YES]);
+}
+
+- (const char *) UTF8String
+{
+  return [pieceRevert((GSStr)self) UTF8String];
+}
+
+@end
+
 
 /*
  * The GSMutableString class shares a common initial ivar layout with
@@ -4579,26 +5243,9 @@ agree, create a new GSUInlineString otherwise.
 - (void) appendFormat: (NSString*)format, ...
 {
   va_list	ap;
-  unichar	buf[1024];
-  unichar	*fmt = buf;
-  size_t	len;
 
   va_start(ap, format);
 
-  /*
-   * Make sure we have the format string in a nul terminated array of
-   * unichars for passing to GSPrivateFormat.  Use on-stack memory for
-   * performance unless the size of the format string is really big
-   * (a rare occurrence).
-   */
-  len = [format length];
-  if (len >= 1024)
-    {
-      fmt = NSZoneMalloc(NSDefaultMallocZone(), (len+1)*sizeof(unichar));
-    }
-  [format getCharacters: fmt];
-  fmt[len] = '\0';
-
   /*
    * If no zone is set, make sure we have one so any memory mangement
    * (buffer growth) is done with the correct zone.
@@ -4607,12 +5254,8 @@ agree, create a new GSUInlineString otherwise.
     {
       _zone = [self zone];
     }
-  GSPrivateFormat((GSStr)self, fmt, ap, nil);
+  GSPrivateFormatString((GSStr)self, format, ap, nil);
   _flags.hash = 0;	// Invalidate the hash for this string.
-  if (fmt != buf)
-    {
-      NSZoneFree(NSDefaultMallocZone(), fmt);
-    }
   va_end(ap);
 }
 
@@ -4733,6 +5376,13 @@ NSAssert(_flags.owned == 1 && _zone != 0, NSInternalInconsistencyException);
   GS_RANGE_CHECK(range, _count);
   if (range.length > 0)
     {
+      if (_count >= GS_PIECE_MIN_LENGTH
+	&& _count - NSMaxRange(range) >= GS_PIECE_MIN_MOVE)
+	{
+	  pieceBecome((GSStr)self);
+	  [self deleteCharactersInRange: range];
+	  return;
+	}
       fillHole((GSStr)self, range.location, range.length);
     }
 }
@@ -5081,32 +5731,10 @@ NSAssert(_flags.owned == 1 && _zone != 0, NSInternalInconsistencyException);
                locale: (NSDictionary*)locale
 	    arguments: (va_list)argList
 {
-  unichar	fbuf[1024];
-  unichar	*fmt = fbuf;
-  size_t	len;
-
   if (NULL == format)
     [NSException raise: NSInvalidArgumentException
       format: @"[GSMutableString-initWithFormat:locale:arguments:]: NULL format"];
-  /*
-   * First we provide an array of unichar characters containing the
-   * format string.  For performance reasons we try to use an on-stack
-   * buffer if the format string is small enough ... it almost always
-   * will be.
-   */
-  len = [format length];
-  if (len >= 1024)
-    {
-      fmt = NSZoneMalloc(NSDefaultMallocZone(), (len+1)*sizeof(unichar));
-    }
-  [format getCharacters: fmt];
-  fmt[len] = '\0';
-
-  GSPrivateFormat((GSStr)self, fmt, argList, locale);
-  if (fmt != fbuf)
-    {
-      NSZoneFree(NSDefaultMallocZone(), fmt);
-    }
+  GSPrivateFormatString((GSStr)self, format, argList, locale);
   return self;
 }
 
@@ -5304,6 +5932,20 @@ NSAssert(_flags.owned == 1 && _zone != 0, NSInternalInconsistencyException);
 	  length = [aString length];
 	}
     }
+
+  /*
+   * Editing a large string other than near its end would mean moving
+   * a lot of data (and perhaps widening the whole string), so we
+   * switch to a piece table instead.
+   */
+  if (_count >= GS_PIECE_MIN_LENGTH
+    && _count - NSMaxRange(aRange) >= GS_PIECE_MIN_MOVE
+    && length != aRange.length)
+    {
+      pieceBecome((GSStr)self);
+      [self replaceCharactersInRange: aRange withString: aString];
+      return;
+    }
   offset = length - aRange.length;
 
   /*
@@ -6159,13 +6801,26 @@ literalIsEqual(NXConstantString *self, id anObject)
 
   if (stop  > start)
     {
-      BOOL	(*mImp)(id, SEL, unichar);
-      unichar	n = 0;
-      unsigned	i = 0;
+      GSCharMatcher		matcher;
+      const GSCharMatcher	*m;
+      unichar			n = 0;
+      unsigned			i = 0;
 
-      mImp = (BOOL(*)(id,SEL,unichar))
-	[aSet methodForSelector: @selector(characterIsMember:)];
+      m = GSPrivateCharMatcher(aSet, &matcher);
 
+      if (YES == ascii && (mask & NSBackwardsSearch) == 0)
+	{
+	  /* ASCII is a subset of Latin-1, so the bytes can be scanned
+	   * directly.
+	   */
+	  index = start + GSPrivateCharMatcherScan8(m,
+	    (const unsigned char*)nxcsptr + start, stop - start, YES);
+	  if (index < stop)
+	    {
+	      range = NSMakeRange(index, 1);
+	    }
+	  return range;
+	}
       for (index = 0; index < start; index++)
 	{
 	  nextUTF8((const uint8_t *)nxcsptr, nxcslen, &i, &n);
@@ -6182,7 +6837,7 @@ literalIsEqual(NXConstantString *self, id anObject)
 	  index = stop;
 	  while (index-- > start)
 	    {
-	      if ((*mImp)(aSet, @selector(characterIsMember:), buf[--pos]))
+	      if (GSCharMatcherIsMember(m, buf[--pos]))
 		{
 		  range = NSMakeRange(index, 1);
 		  break;
@@ -6196,7 +6851,7 @@ literalIsEqual(NXConstantString *self, id anObject)
 	      unichar letter;
 
 	      letter = nextUTF8((const uint8_t *)nxcsptr, nxcslen, &i, &n);
-	      if ((*mImp)(aSet, @selector(characterIsMember:), letter))
+	      if (GSCharMatcherIsMember(m, letter))
 		{
 		  range = NSMakeRange(index, 1);
 		  break;
@@ -35,6 +35,7 @@ extern NSString * const GSTLSCertificateKeyPassword;
 extern NSString * const GSTLSDebug;
 extern NSString * const GSTLSPriority;
 extern NSString * const GSTLSRemoteHosts;
+extern NSString * const GSTLSResumeKey;
 extern NSString * const GSTLSRevokeFile;
 extern NSString * const GSTLSServerName;
 extern NSString * const GSTLSVerify;
@@ -166,6 +167,7 @@ extern NSString * const GSTLSVerify;
 - (gnutls_certificate_credentials_t) credentials;
 - (GSTLSPrivateKey*) key;
 - (GSTLSCertificateList*) list;
+- (NSString*) name;
 - (BOOL) trust;
 @end
 
@@ -192,6 +194,9 @@ typedef ssize_t (*GSTLSIOW)(gnutls_transport_ptr_t, const void *, size_t);
   BOOL                                  handshake;
   BOOL                                  setup;
   BOOL                                  debug;
+  BOOL                                  resumed;
+  BOOL                                  resumeSaved;
+  NSString                              *resumeKey;
   NSTimeInterval                        created;
 @public
   gnutls_session_t                      session;
@@ -259,6 +264,16 @@ typedef ssize_t (*GSTLSIOW)(gnutls_transport_ptr_t, const void *, size_t);
  */
 - (NSInteger) read: (void*)buf length: (NSUInteger)len;
 
+/** Returns YES if the handshake resumed an earlier session rather than
+ * negotiating a new one.
+ */
+- (BOOL) resumed;
+
+/* For internal use to cache the data needed to resume a client session
+ * (as identified by the GSTLSResumeKey option) in a later connection.
+ */
+- (void) saveResumeData;
+
 /** Get a report of the SSL/TLS status of the current session.
  */
 - (NSString*) sessionInfo;
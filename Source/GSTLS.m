@@ -80,6 +80,7 @@ NSString * const GSTLSCertificateKeyPassword = @"GSTLSCertificateKeyPassword";
 NSString * const GSTLSDebug = @"GSTLSDebug";
 NSString * const GSTLSPriority = @"GSTLSPriority";
 NSString * const GSTLSRemoteHosts = @"GSTLSRemoteHosts";
+NSString * const GSTLSResumeKey = @"GSTLSResumeKey";
 NSString * const GSTLSRevokeFile = @"GSTLSRevokeFile";
 NSString * const GSTLSServerName = @"GSTLSServerName";
 NSString * const GSTLSVerify = @"GSTLSVerify";
@@ -193,6 +194,19 @@ static int      globalDebug = 0;
  */
 static NSString *priority = nil;
 
+/* The resumeLimit variable gives the maximum number of sessions kept in
+ * each of the client and server session resumption caches, so that a
+ * reconnection to the same host (or from a recently seen client) can use
+ * an abbreviated handshake.  The hard-coded value can be overridden by the
+ * GS_TLS_RESUME environment variable, which in turn will be overridden by
+ * the GSTLSResumeLimit user default.  A value of zero turns resumption off.
+ */
+static NSUInteger       resumeLimit = 1000;
+
+/* How long resumption data may be used for once a session is established.
+ */
+static NSTimeInterval   resumeExpiry = 3600.0;
+
 static gnutls_anon_client_credentials_t anoncred;
 
 /* This class is used to ensure that the GNUTLS system is initialised
@@ -293,6 +307,20 @@ static NSMutableDictionary      *fileMap = nil;
       globalDebug = 0;
     }
 
+  str = [defs stringForKey: @"GSTLSResumeLimit"];
+  if (nil == str)
+    {
+      str = [env objectForKey: @"GS_TLS_RESUME"];
+    }
+  if (nil == str)
+    {
+      resumeLimit = 1000;
+    }
+  else
+    {
+      resumeLimit = ([str intValue] > 0) ? [str intValue] : 0;
+    }
+
   gnutls_global_set_log_level(globalDebug);
 }
 
@@ -1311,6 +1339,11 @@ static NSMutableDictionary      *credentialsCache = nil;
   return list;
 }
 
+- (NSString*) name
+{
+  return name;
+}
+
 - (BOOL) trust
 {
   return trust;
@@ -1398,8 +1431,211 @@ retrieve_callback(gnutls_session_t session,
 }
 #endif
 
+/* An entry in one of the session resumption caches.
+ */
+@interface      GSTLSResumeEntry : NSObject
+{
+@public
+  NSTimeInterval        when;
+  NSData                *data;
+}
+@end
+
+@implementation GSTLSResumeEntry
+- (void) dealloc
+{
+  DESTROY(data);
+  [super dealloc];
+}
+@end
+
+static NSLock                   *resumeLock = nil;
+static NSMutableDictionary      *clientCache = nil;     // By remote end
+static NSMutableDictionary      *serverCache = nil;     // By session ID
+static gnutls_datum_t           ticketKey = { NULL, 0 };
+
+/* Removes expired entries from a resumption cache and, if the cache is
+ * full, the oldest remaining entry too.  Must be called with the lock held.
+ */
+static void
+resumePurge(NSMutableDictionary *cache, BOOL full)
+{
+  NSTimeInterval        now = [NSDate timeIntervalSinceReferenceDate];
+  NSTimeInterval        when = now;
+  NSEnumerator          *enumerator;
+  id                    oldest = nil;
+  id                    key;
+
+  enumerator = [[cache allKeys] objectEnumerator];
+  while (nil != (key = [enumerator nextObject]))
+    {
+      GSTLSResumeEntry  *e = [cache objectForKey: key];
+
+      if (now - e->when > resumeExpiry)
+        {
+          [cache removeObjectForKey: key];
+        }
+      else if (e->when < when)
+        {
+          when = e->when;
+          oldest = key;
+        }
+    }
+  if (YES == full && nil != oldest && [cache count] >= resumeLimit)
+    {
+      [cache removeObjectForKey: oldest];
+    }
+}
+
+/* Returns the retained resumption data stored under key, or nil if there
+ * is none (or it has expired).
+ */
+static NSData *
+resumeGet(NSMutableDictionary *cache, id key)
+{
+  GSTLSResumeEntry      *e;
+  NSData                *d = nil;
+
+  if (resumeLimit > 0)
+    {
+      [resumeLock lock];
+      e = [cache objectForKey: key];
+      if (nil != e)
+        {
+          if ([NSDate timeIntervalSinceReferenceDate] - e->when > resumeExpiry)
+            {
+              [cache removeObjectForKey: key];
+            }
+          else
+            {
+              d = [e->data retain];
+            }
+        }
+      [resumeLock unlock];
+    }
+  return d;
+}
+
+static void
+resumePut(NSMutableDictionary *cache, id key, NSData *data)
+{
+  GSTLSResumeEntry      *e;
+
+  if (resumeLimit > 0)
+    {
+      e = [GSTLSResumeEntry new];
+      e->when = [NSDate timeIntervalSinceReferenceDate];
+      e->data = [data copy];
+      [resumeLock lock];
+      if ([cache count] >= resumeLimit)
+        {
+          resumePurge(cache, YES);
+        }
+      [cache setObject: e forKey: key];
+      [resumeLock unlock];
+      [e release];
+    }
+}
+
+static void
+resumeRemove(NSMutableDictionary *cache, id key)
+{
+  [resumeLock lock];
+  [cache removeObjectForKey: key];
+  [resumeLock unlock];
+}
+
+/* Callbacks to let gnutls keep the data for server sessions in memory
+ * so that clients may resume them by session ID.
+ */
+static int
+resumeStoreFunc(void *ptr, gnutls_datum_t key, gnutls_datum_t data)
+{
+  NSData        *k;
+  NSData        *d;
+
+  k = [[NSData alloc] initWithBytes: key.data length: key.size];
+  d = [[NSData alloc] initWithBytes: data.data length: data.size];
+  resumePut(serverCache, k, d);
+  [d release];
+  [k release];
+  return 0;
+}
+
+static gnutls_datum_t
+resumeRetrieveFunc(void *ptr, gnutls_datum_t key)
+{
+  gnutls_datum_t        result = { NULL, 0 };
+  NSData                *k;
+  NSData                *d;
+
+  k = [[NSData alloc] initWithBytesNoCopy: key.data
+                                   length: key.size
+                             freeWhenDone: NO];
+  d = resumeGet(serverCache, k);
+  [k release];
+  if (nil != d)
+    {
+      result.data = gnutls_malloc([d length]);
+      if (NULL != result.data)
+        {
+          memcpy(result.data, [d bytes], [d length]);
+          result.size = [d length];
+        }
+      [d release];
+    }
+  return result;
+}
+
+static int
+resumeRemoveFunc(void *ptr, gnutls_datum_t key)
+{
+  NSData        *k;
+
+  k = [[NSData alloc] initWithBytesNoCopy: key.data
+                                   length: key.size
+                             freeWhenDone: NO];
+  resumeRemove(serverCache, k);
+  [k release];
+  return 0;
+}
+
 @implementation GSTLSSession
 
+/* Method to purge expired resumption data from the caches.
+ */
++ (void) housekeeping: (NSNotification*)n
+{
+  [resumeLock lock];
+  resumePurge(clientCache, NO);
+  resumePurge(serverCache, NO);
+  [resumeLock unlock];
+}
+
++ (void) initialize
+{
+  if (nil == resumeLock)
+    {
+      resumeLock = [NSLock new];
+      [[NSObject leakAt: &resumeLock] release];
+      clientCache = [NSMutableDictionary new];
+      [[NSObject leakAt: &clientCache] release];
+      serverCache = [NSMutableDictionary new];
+      [[NSObject leakAt: &serverCache] release];
+
+#if GNUTLS_VERSION_NUMBER >= 0x020A00
+      /* The key used to encrypt the session tickets we give to clients
+       * is shared by all server sessions in the process.
+       */
+      gnutls_session_ticket_key_generate(&ticketKey);
+#endif
+
+      [[NSNotificationCenter defaultCenter] addObserver: self
+	selector: @selector(housekeeping:)
+	name: @"GSHousekeeping" object: nil];
+    }
+}
+
 + (GSTLSSession*) sessionWithOptions: (NSDictionary*)options
                            direction: (BOOL)isOutgoing
                            transport: (void*)handle
@@ -1439,6 +1675,7 @@ retrieve_callback(gnutls_session_t session,
   DESTROY(problem);
   DESTROY(issuer);
   DESTROY(owner);
+  DESTROY(resumeKey);
   [super dealloc];
 }
 
@@ -1449,10 +1686,12 @@ retrieve_callback(gnutls_session_t session,
 
 - (BOOL) disconnect: (BOOL)reusable
 {
+  BOOL  abnormal = handshake;
   BOOL  ok = YES;
 
   if (YES == active || YES == handshake)
     {
+      [self saveResumeData];
       active = NO;
       handshake = NO;
       if (NO == reusable)
@@ -1477,7 +1716,13 @@ retrieve_callback(gnutls_session_t session,
   if (YES == setup)
     {
       setup = NO;
-      gnutls_db_remove_session(session);
+      if (YES == abnormal || NO == ok)
+        {
+          /* A session which was not terminated properly must not be
+           * resumed.
+           */
+          gnutls_db_remove_session(session);
+        }
       gnutls_deinit(session);
     }
   return ok;
@@ -1740,6 +1985,50 @@ retrieve_callback(gnutls_session_t session,
       gnutls_transport_set_push_function(session, pushFunc);
       gnutls_transport_set_ptr(session, (gnutls_transport_ptr_t)handle);
       gnutls_session_set_ptr(session, (void*)self);
+
+      /* Set up session resumption so that reconnections can use an
+       * abbreviated handshake.
+       */
+      if (resumeLimit > 0 && YES == outgoing)
+        {
+          str = [opts objectForKey: GSTLSResumeKey];
+          if ([str length] > 0)
+            {
+              NSData    *d;
+
+              /* Data cached from an earlier session is only reused for
+               * a connection to the same place with the same settings.
+               */
+              resumeKey = [[NSString alloc] initWithFormat:
+                @"%@ %@ %@ %@ %@", str,
+                [opts objectForKey: GSTLSServerName],
+                [opts objectForKey: NSStreamSocketSecurityLevelKey],
+                [opts objectForKey: GSTLSPriority],
+                [credentials name]];
+              d = resumeGet(clientCache, resumeKey);
+              if (nil != d)
+                {
+                  gnutls_session_set_data(session, [d bytes], [d length]);
+                  [d release];
+                  if (YES == debug)
+                    {
+                      NSLog(@"%@ trying to resume session for '%@'",
+                        self, str);
+                    }
+                }
+            }
+        }
+      else if (resumeLimit > 0)
+        {
+          gnutls_db_set_cache_expiration(session, (int)resumeExpiry);
+          gnutls_db_set_retrieve_function(session, resumeRetrieveFunc);
+          gnutls_db_set_store_function(session, resumeStoreFunc);
+          gnutls_db_set_remove_function(session, resumeRemoveFunc);
+          gnutls_db_set_ptr(session, NULL);
+#if GNUTLS_VERSION_NUMBER >= 0x020A00
+          gnutls_session_ticket_enable_server(session, &ticketKey);
+#endif
+        }
     }
 
   return self;
@@ -1790,6 +2079,12 @@ retrieve_callback(gnutls_session_t session,
               ASSIGN(problem, p);
               NSLog(@"%@ in handshake: %@", self, p);
             }
+          if (nil != resumeKey)
+            {
+              /* Don't offer the same data again if it might be at fault.
+               */
+              resumeRemove(clientCache, resumeKey);
+            }
           [self disconnect: NO];
           return YES;   // Failed ... not active.
         }
@@ -1805,6 +2100,7 @@ retrieve_callback(gnutls_session_t session,
 
       active = YES;     // The TLS session is now active.
       handshake = NO;   // Handshake is over.
+      resumed = gnutls_session_is_resumed(session) ? YES : NO;
 
       if (YES == outgoing)
         {
@@ -1836,6 +2132,13 @@ retrieve_callback(gnutls_session_t session,
             }
           if (YES == shouldVerify)
             {
+              if (nil != resumeKey)
+                {
+                  /* Never keep data for a server we could not verify.
+                   */
+                  resumeRemove(clientCache, resumeKey);
+                  DESTROY(resumeKey);
+                }
               [self disconnect: NO];
             }
         }
@@ -1846,6 +2149,7 @@ retrieve_callback(gnutls_session_t session,
               NSLog(@"%@ succeeded verify:\n%@", self, [self sessionInfo]);
             }
         }
+      [self saveResumeData];
       return YES;       // Handshake complete
     }
 }
@@ -1869,6 +2173,13 @@ retrieve_callback(gnutls_session_t session,
 {
   int   result = gnutls_record_recv(session, buf, len);
 
+  if (nil != resumeKey && NO == resumeSaved)
+    {
+      int       e = errno;
+
+      [self saveResumeData];    // We may have been sent a session ticket
+      errno = e;
+    }
   if (result < 0)
     {
       NSString  *p;
@@ -1950,6 +2261,41 @@ retrieve_callback(gnutls_session_t session,
   return result;
 }
 
+- (BOOL) resumed
+{
+  return resumed;
+}
+
+- (void) saveResumeData
+{
+  gnutls_datum_t        d;
+
+  if (nil == resumeKey || YES == resumeSaved || NO == active)
+    {
+      return;
+    }
+#if GNUTLS_VERSION_NUMBER >= 0x030603
+  /* A TLS1.3 server sends its session ticket after the handshake, so
+   * there is nothing worth keeping until we have read that.
+   */
+  if (GNUTLS_TLS1_3 == gnutls_protocol_get_version(session)
+    && 0 == (gnutls_session_get_flags(session) & GNUTLS_SFLAGS_SESSION_TICKET))
+    {
+      return;
+    }
+#endif
+  resumeSaved = YES;
+  if (0 == gnutls_session_get_data2(session, &d))
+    {
+      NSData    *data;
+
+      data = [[NSData alloc] initWithBytes: d.data length: d.size];
+      resumePut(clientCache, resumeKey, data);
+      [data release];
+      gnutls_free(d.data);
+    }
+}
+
 /* Copied/based on the public domain code provided by gnutls
  * to print the session ... I've left in details for features
  * we don't yet support.
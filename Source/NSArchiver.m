@@ -49,10 +49,18 @@
 
 #include "GNUstepBase/GSIMap.h"
 
+#define	GS_NSArchiver_IVARS \
+  BOOL		singlePass;	/* Encoding root in one pass.	*/ \
+  BOOL		encodedLater;	/* Conditional object encoded.	*/
+
 #define	_IN_NSARCHIVER_M
 #import "Foundation/NSArchiver.h"
 #undef	_IN_NSARCHIVER_M
 
+#define	GSInternal	NSArchiverInternal
+#include	"GSInternal.h"
+GS_PRIVATE_INTERNAL(NSArchiver)
+
 #import "Foundation/NSCoder.h"
 #import "Foundation/NSData.h"
 #import "Foundation/NSException.h"
@@ -140,6 +148,7 @@ static Class	NSMutableDataMallocClass;
       _eObjImp = [self methodForSelector: eObjSel];
       _eValImp = [self methodForSelector: eValSel];
 
+      GS_CREATE_INTERNAL(NSArchiver)
       [self resetArchiver];
 
       /*
@@ -163,6 +172,7 @@ static Class	NSMutableDataMallocClass;
 
 - (void) dealloc
 {
+  GS_DESTROY_INTERNAL(NSArchiver)
   RELEASE(_data);
   if (_clsMap)
     {
@@ -702,6 +712,44 @@ static Class	NSMutableDataMallocClass;
 
   _encodingRoot = YES;
 
+  /*
+   *	If nothing has been encoded yet, try to write the archive in a
+   *	single pass, encoding each conditional object which has not been
+   *	encoded yet as nil.  That is only correct if none of those objects
+   *	is encoded later, so if one is we stop encoding, discard the
+   *	output and make a first pass to find the conditional objects.
+   */
+  if (_clsMap->nodeCount == 0 && _cIdMap->nodeCount == 0
+    && _uIdMap->nodeCount == 0 && _ptrMap->nodeCount == 0)
+    {
+      NSUInteger	start = [_data length];
+
+      internal->singlePass = YES;
+      internal->encodedLater = NO;
+      _initialPass = NO;
+      (*_eObjImp)(self, eObjSel, rootObject);
+      internal->singlePass = NO;
+      if (internal->encodedLater == NO)
+	{
+	  [self serializeHeaderAt: _startPos
+			  version: [self systemVersion]
+			  classes: _clsMap->nodeCount
+			  objects: _uIdMap->nodeCount
+			 pointers: _ptrMap->nodeCount];
+	  _encodingRoot = NO;
+	  return;
+	}
+      internal->encodedLater = NO;
+      [_data setLength: start];
+      GSIMapCleanMap(_clsMap);
+      GSIMapCleanMap(_cIdMap);
+      GSIMapCleanMap(_uIdMap);
+      GSIMapCleanMap(_ptrMap);
+      _xRefC = 0;
+      _xRefO = 0;
+      _xRefP = 0;
+    }
+
   /*
    *	First pass - find conditional objects.
    */
@@ -773,6 +821,38 @@ static Class	NSMutableDataMallocClass;
     {
       (*_eObjImp)(self, eObjSel, nil);
     }
+  else if (internal->singlePass)
+    {
+      GSIMapNode	node;
+
+      if (_repMap->nodeCount)
+	{
+	  node = GSIMapNodeForKey(_repMap, (GSIMapKey)anObject);
+	  if (node)
+	    {
+	      anObject = (id)node->value.ptr;
+	    }
+	}
+
+      /*
+       *	An object which has already been encoded is written as a
+       *	cross-reference, anything else is nil for now.
+       */
+      node = GSIMapNodeForKey(_uIdMap, (GSIMapKey)anObject);
+      if (node != 0)
+	{
+	  (*_eObjImp)(self, eObjSel, anObject);
+	}
+      else
+	{
+	  if (GSIMapNodeForKey(_cIdMap, (GSIMapKey)anObject) == 0)
+	    {
+	      GSIMapAddPair(_cIdMap,
+		(GSIMapKey)anObject, (GSIMapVal)(NSUInteger)0);
+	    }
+	  (*_eObjImp)(self, eObjSel, nil);
+	}
+    }
   else
     {
       GSIMapNode	node;
@@ -822,6 +902,14 @@ static Class	NSMutableDataMallocClass;
 
 - (void) encodeObject: (id)anObject
 {
+  if (internal->encodedLater == YES)
+    {
+      /*
+       *	The single pass output is being discarded, so stop walking
+       *	the object graph as soon as possible.
+       */
+      return;
+    }
   if (anObject == nil)
     {
       if (_initialPass == NO)
@@ -871,6 +959,15 @@ static Class	NSMutableDataMallocClass;
 	  Class	cls;
 	  id	obj;
 
+	  if (node == 0 && _cIdMap->nodeCount > 0 && internal->singlePass
+	    && GSIMapNodeForKey(_cIdMap, (GSIMapKey)anObject) != 0)
+	    {
+	      /*
+	       *	This object was written as nil when it was encoded
+	       *	conditionally, so the archive must be written again.
+	       */
+	      internal->encodedLater = YES;
+	    }
 	  if (node == 0)
 	    {
 	      node = GSIMapAddPair(_uIdMap,
@@ -1055,6 +1152,8 @@ static Class	NSMutableDataMallocClass;
     }
   _encodingRoot = NO;
   _initialPass = NO;
+  internal->singlePass = NO;
+  internal->encodedLater = NO;
   _xRefC = 0;
   _xRefO = 0;
   _xRefP = 0;
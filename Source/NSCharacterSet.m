@@ -38,6 +38,11 @@
 #import "Foundation/NSNotification.h"
 #import "Foundation/NSCharacterSet.h"
 #import "Foundation/NSData.h"
+#import "GSPrivate.h"
+
+#if	defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 /* Using an index set to hold a characterset is more space efficient but
  * on the intel core-2 system I benchmarked on, it made my applications
@@ -85,17 +90,20 @@
 
 @interface NSBitmapCharSet : NSCharacterSet
 {
+@public
   const unsigned char	*_data;
   unsigned		_length;
   NSData		*_obj;
   unsigned		_known;
   unsigned		_present;
+  GSCharMatcher		*_matcher;
 }
 - (id) initWithBitmap: (NSData*)bitmap;
 @end
 
 @interface NSMutableBitmapCharSet : NSMutableCharacterSet
 {
+@public
   unsigned char		*_data;
   unsigned		_length;
   NSMutableData		*_obj;
@@ -142,6 +150,11 @@
 - (void) dealloc
 {
   DESTROY(_obj);
+  if (_matcher != 0)
+    {
+      NSZoneFree(NSDefaultMallocZone(), _matcher);
+      _matcher = 0;
+    }
   [super dealloc];
 }
 
@@ -588,6 +601,7 @@ static Class concreteMutableClass = nil;
   NSData		*_obj;
   unsigned		_known;
   unsigned		_present;
+  GSCharMatcher		*_matcher;
   int			_index;
 }
 @end
@@ -630,6 +644,221 @@ static Class concreteMutableClass = nil;
 
 
 
+/*
+ * Character set matchers let string code test membership and scan
+ * buffers without sending -characterIsMember: for every character.
+ * For bitmap sets the matcher refers to the bitmap of the BMP directly,
+ * and immutable bitmap sets keep their matcher so it is built only once.
+ */
+static Class	bitmapClass = Nil;
+static Class	mutableBitmapClass = Nil;
+static Class	staticClass = Nil;
+static SEL	memberSel = 0;
+
+static void
+matcherWithImp(GSCharMatcher *m, NSCharacterSet *aSet)
+{
+  m->bits = 0;
+  m->length = 0;
+  m->set = aSet;
+  m->sel = memberSel;
+  m->imp = (BOOL (*)(id, SEL, unichar))[aSet methodForSelector: memberSel];
+  m->count = 0;
+}
+
+static void
+matcherWithBitmap(GSCharMatcher *m, NSCharacterSet *aSet,
+  const unsigned char *bits, unsigned length, BOOL findMembers)
+{
+  m->bits = bits;
+  m->length = (length > GSBITMAP_SIZE) ? GSBITMAP_SIZE : length;
+  m->set = aSet;
+  m->sel = memberSel;
+  m->imp = 0;
+  m->count = 0;
+  if (YES == findMembers)
+    {
+      unsigned	n = 0;
+      unsigned	i;
+
+      /* Record the members of a small set, so that buffers can be
+       * scanned by comparing against each member in turn.
+       */
+      for (i = 0; i < m->length && n <= 8; i++)
+	{
+	  unsigned	b = bits[i];
+
+	  while (b != 0)
+	    {
+	      if (n < 8)
+		{
+		  m->chars[n] = i * 8 + __builtin_ctz(b);
+		}
+	      n++;
+	      b &= b - 1;
+	    }
+	}
+      if (n <= 8)
+	{
+	  m->count = n;
+	}
+    }
+}
+
+const GSCharMatcher *
+GSPrivateCharMatcher(NSCharacterSet *aSet, GSCharMatcher *buf)
+{
+  Class	c = object_getClass(aSet);
+
+  if (c == bitmapClass || c == staticClass)
+    {
+      NSBitmapCharSet	*s = (NSBitmapCharSet*)aSet;
+      GSCharMatcher	*m = s->_matcher;
+
+      if (m == 0)
+	{
+	  m = NSZoneMalloc(NSDefaultMallocZone(), sizeof(GSCharMatcher));
+	  matcherWithBitmap(m, aSet, s->_data, s->_length, YES);
+	  if (__sync_bool_compare_and_swap(&s->_matcher, 0, m) == NO)
+	    {
+	      NSZoneFree(NSDefaultMallocZone(), m);
+	      m = s->_matcher;
+	    }
+	}
+      return m;
+    }
+  else if (c == mutableBitmapClass)
+    {
+      NSMutableBitmapCharSet	*s = (NSMutableBitmapCharSet*)aSet;
+
+      matcherWithBitmap(buf, aSet, s->_data, s->_length, NO);
+      return buf;
+    }
+  matcherWithImp(buf, aSet);
+  return buf;
+}
+
+NSUInteger
+GSPrivateCharMatcherScan8(const GSCharMatcher *m, const unsigned char *buf,
+  NSUInteger len, BOOL member)
+{
+  unsigned char	table[32];
+  NSUInteger	i = 0;
+  unsigned	k;
+
+  if (m->bits == 0)
+    {
+      while (i < len && (*m->imp)(m->set, m->sel, buf[i]) != member)
+	{
+	  i++;
+	}
+      return i;
+    }
+#if	defined(__SSE2__)
+  if (m->count > 0)
+    {
+      unsigned char	c[8];
+      unsigned		n = 0;
+
+      for (k = 0; k < m->count; k++)
+	{
+	  if (m->chars[k] < 256)
+	    {
+	      c[n++] = (unsigned char)m->chars[k];
+	    }
+	}
+      for (; i + 16 <= len; i += 16)
+	{
+	  __m128i	v = _mm_loadu_si128((const __m128i*)(buf + i));
+	  __m128i	hit = _mm_setzero_si128();
+	  unsigned	mask;
+
+	  for (k = 0; k < n; k++)
+	    {
+	      hit = _mm_or_si128(hit,
+		_mm_cmpeq_epi8(v, _mm_set1_epi8((char)c[k])));
+	    }
+	  mask = (unsigned)_mm_movemask_epi8(hit);
+	  if (NO == member)
+	    {
+	      mask ^= 0xffff;
+	    }
+	  if (mask != 0)
+	    {
+	      return i + __builtin_ctz(mask);
+	    }
+	}
+    }
+#endif
+  /* A local copy of the Latin-1 part of the bitmap means no bounds
+   * check is needed for each character.
+   */
+  k = (m->length < sizeof(table)) ? m->length : sizeof(table);
+  memcpy(table, m->bits, k);
+  memset(table + k, 0, sizeof(table) - k);
+  while (i < len)
+    {
+      unsigned char	b = buf[i];
+
+      if (((table[b >> 3] >> (b & 7)) & 1) == (member ? 1 : 0))
+	{
+	  break;
+	}
+      i++;
+    }
+  return i;
+}
+
+NSUInteger
+GSPrivateCharMatcherScan16(const GSCharMatcher *m, const unichar *buf,
+  NSUInteger len, BOOL member)
+{
+  NSUInteger	i = 0;
+
+  if (m->bits == 0)
+    {
+      while (i < len && (*m->imp)(m->set, m->sel, buf[i]) != member)
+	{
+	  i++;
+	}
+      return i;
+    }
+#if	defined(__SSE2__)
+  if (m->count > 0)
+    {
+      unsigned	k;
+
+      for (; i + 8 <= len; i += 8)
+	{
+	  __m128i	v = _mm_loadu_si128((const __m128i*)(buf + i));
+	  __m128i	hit = _mm_setzero_si128();
+	  unsigned	mask;
+
+	  for (k = 0; k < m->count; k++)
+	    {
+	      hit = _mm_or_si128(hit,
+		_mm_cmpeq_epi16(v, _mm_set1_epi16((short)m->chars[k])));
+	    }
+	  mask = (unsigned)_mm_movemask_epi8(hit);
+	  if (NO == member)
+	    {
+	      mask ^= 0xffff;
+	    }
+	  if (mask != 0)
+	    {
+	      return i + __builtin_ctz(mask) / 2;
+	    }
+	}
+    }
+#endif
+  while (i < len && GSCharMatcherIsMember(m, buf[i]) != member)
+    {
+      i++;
+    }
+  return i;
+}
+
+
 @implementation NSCharacterSet
 
 + (void) initialize
@@ -646,7 +875,11 @@ static Class concreteMutableClass = nil;
 #else
       concreteClass = [NSBitmapCharSet class];
       concreteMutableClass = [NSMutableBitmapCharSet class];
+      bitmapClass = concreteClass;
+      mutableBitmapClass = concreteMutableClass;
+      staticClass = [_GSStaticCharSet class];
 #endif
+      memberSel = @selector(characterIsMember:);
       beenHere = YES;
     }
 }
@@ -44,6 +44,7 @@
   BOOL			_shuttingDown; \
   BOOL			_useKeepalive; \
   BOOL			_keepaliveWait; \
+  BOOL			_compactCoding; \
   NSPort		*_receivePort; \
   NSPort		*_sendPort; \
   unsigned		_requestDepth; \
@@ -68,7 +69,16 @@
   NSString		*_remoteName; \
   NSString		*_registeredName; \
   NSPortNameServer	*_nameServer; \
-  int			_lastKeepalive
+  int			_lastKeepalive; \
+  NSUInteger		_requestWorkers; \
+  NSOperationQueue	*_workers; \
+  NSThread		*_receiver; \
+  BOOL			_ownsReceiver; \
+  BOOL			_threadsBeforeWorkers; \
+  NSCondition		*_replyCondition; \
+  NSUInteger		_repliesArrived; \
+  GSPortCoderInterns	*_interns; \
+  NSMutableDictionary	*_signatures
 
 #define	EXPOSE_NSDistantObject_IVARS	1
 
@@ -82,8 +92,12 @@
 #endif
 
 #import "Foundation/NSEnumerator.h"
+#import "Foundation/NSOperation.h"
+#import "Foundation/NSThread.h"
 #import "GNUstepBase/GSLock.h"
 
+@class	GSPortCoderInterns;
+
 /* Skip past an argument and also any offset information before the next.
  */
 static inline const char *
@@ -131,6 +145,7 @@ skip_argspec(const char *ptr)
 #import "Foundation/NSDate.h"
 #import "Foundation/NSException.h"
 #import "Foundation/NSLock.h"
+#import "Foundation/NSMethodSignature.h"
 #import "Foundation/NSThread.h"
 #import "Foundation/NSPort.h"
 #import "Foundation/NSPortMessage.h"
@@ -201,6 +216,11 @@ static Class	sendCoderClass;
 static Class	recvCoderClass;
 static Class	runLoopClass;
 
+/* Sent after the sequence number of a root proxy request, and after the
+ * root object in the reply, to agree on the compact encoding of messages.
+ */
+#define	COMPACT_CODING	1
+
 static NSString*
 stringFromMsgType(int type)
 {
@@ -321,6 +341,23 @@ GS_PRIVATE_INTERNAL(NSConnection)
 #define	IregisteredName		(internal->_registeredName)
 #define	InameServer		(internal->_nameServer)
 #define	IlastKeepalive		(internal->_lastKeepalive)
+#define	IrequestWorkers		(internal->_requestWorkers)
+#define	Iworkers		(internal->_workers)
+#define	Ireceiver		(internal->_receiver)
+#define	IownsReceiver		(internal->_ownsReceiver)
+#define	IthreadsBeforeWorkers	(internal->_threadsBeforeWorkers)
+#define	IreplyCondition		(internal->_replyCondition)
+#define	IrepliesArrived		(internal->_repliesArrived)
+#define	IcompactCoding		(internal->_compactCoding)
+#define	Iinterns		(internal->_interns)
+#define	Isignatures		(internal->_signatures)
+
+/* YES if the current thread should wait for replies on the reply condition
+ * rather than by running its own run loop: a dedicated thread receives
+ * the messages for the connection, and this is not that thread.
+ */
+#define	IwaitOnCondition	(Ireceiver != nil \
+  && Ireceiver != GSCurrentThread())
 
 /** </ignore> */
 
@@ -328,6 +365,8 @@ GS_PRIVATE_INTERNAL(NSConnection)
 
 - (void) handlePortMessage: (NSPortMessage*)msg;
 - (void) _runInNewThread;
+- (void) _runReceiver;
+- (void) _stopReceiver;
 + (int) setDebug: (int)val;
 - (void) _enableKeepalive;
 
@@ -1119,6 +1158,18 @@ static NSLock	*cached_proxies_gate = nil;
 	{
 	  [self _enableKeepalive];
 	}
+      /*
+       * A child connection shares the worker pool and the receiving
+       * thread of its parent, since its messages arrive on the same port.
+       */
+      if (GSIVar(parent, _requestWorkers) > 0)
+	{
+	  IrequestWorkers = GSIVar(parent, _requestWorkers);
+	  Iworkers = RETAIN(GSIVar(parent, _workers));
+	  Ireceiver = RETAIN(GSIVar(parent, _receiver));
+	  IthreadsBeforeWorkers = GSIVar(parent, _threadsBeforeWorkers);
+	  IreplyCondition = [NSCondition new];
+	}
     }
   else
     {
@@ -1237,6 +1288,16 @@ static NSLock	*cached_proxies_gate = nil;
 
   GSM_UNLOCK(IrefGate);
 
+  /*
+   * Stop any receiving thread and wake any threads waiting for replies,
+   * so they see we are invalid.
+   */
+  [self _stopReceiver];
+  [IreplyCondition lock];
+  IrepliesArrived++;
+  [IreplyCondition broadcast];
+  [IreplyCondition unlock];
+
   /*
    * Don't need notifications any more - so remove self as observer.
    */
@@ -1612,6 +1673,18 @@ static NSLock	*cached_proxies_gate = nil;
   return IrequestTimeout;
 }
 
+/**
+ * Returns the number of worker threads used to handle incoming requests,
+ * as set by the -setRequestWorkers: method.<br />
+ * This value is inherited from the parent connection.<br />
+ * The default value is zero (requests are handled by the thread which
+ * receives them).
+ */
+- (NSUInteger) requestWorkers
+{
+  return IrequestWorkers;
+}
+
 /**
  * Returns the object that is made available by this connection
  * or by its parent (the object is associated with the receive port).<br />
@@ -1648,10 +1721,31 @@ static NSLock	*cached_proxies_gate = nil;
           return [self rootObject];
         }
       op = [self _newOutRmc: 0 generate: &seq_num reply: YES];
+      /*
+       * Tell the other end we understand the compact encoding.  Older
+       * versions ignore anything after the sequence number, and do not
+       * send anything after the root object in their reply.
+       */
+      if ([sendCoderClass compactCodingAvailable] == YES)
+	{
+	  unsigned	coding = COMPACT_CODING;
+
+	  [op encodeValueOfObjCType: @encode(unsigned) at: &coding];
+	}
       [self _sendOutRmc: op type: ROOTPROXY_REQUEST sequence: seq_num];
 
       ip = [self _getReplyRmc: seq_num for: "rootproxy"];
       [ip decodeValueOfObjCType: @encode(id) at: &newProxy];
+      if ([ip moreToDecode] == YES)
+	{
+	  unsigned	coding;
+
+	  [ip decodeValueOfObjCType: @encode(unsigned) at: &coding];
+	  if (coding >= COMPACT_CODING)
+	    {
+	      IcompactCoding = YES;
+	    }
+	}
       [self _doneInRmc: ip];
     }
   NS_HANDLER
@@ -1761,6 +1855,81 @@ static NSLock	*cached_proxies_gate = nil;
   IrequestTimeout = to;
 }
 
+/**
+ * Sets the connection up so that many threads can use it at once.<br />
+ * If count is greater than zero, this enables multiple threads (see
+ * -enableMultipleThreads) and starts a thread which receives all the
+ * messages arriving for the connection.  Incoming requests are handed
+ * to a pool of up to count worker threads rather than being handled
+ * in the receiving run loop, so a slow request does not hold up the
+ * others.  Replies are matched to the requests they answer by their
+ * sequence numbers, and a thread waiting for a reply sleeps until the
+ * receiving thread passes the reply to it, so any number of threads
+ * may have requests outstanding at the same time.<br />
+ * Setting a count of zero makes the connection handle requests in the
+ * receiving thread again.<br />
+ * This option is inherited by child connections, which share the
+ * worker pool.<br />
+ * Setting a count of zero (or invalidating the connection) stops the
+ * receiving thread and puts back the threading setting which was in
+ * use before.<br />
+ * NB. requests from one remote connection may be handled in a different
+ * order from the one in which they arrived, and the receiving thread
+ * keeps the connection retained until it is stopped.
+ */
+- (void) setRequestWorkers: (NSUInteger)count
+{
+  NSThread		*t = nil;
+  NSOperationQueue	*q;
+
+  GS_M_LOCK(IrefGate);
+  if (count > 0 && IisValid == YES)
+    {
+      if (0 == IrequestWorkers)
+	{
+	  IthreadsBeforeWorkers = ImultipleThreads;
+	}
+      ImultipleThreads = YES;
+      if (Iworkers == nil)
+	{
+	  Iworkers = [NSOperationQueue new];
+	}
+      [Iworkers setMaxConcurrentOperationCount: count];
+      if (IreplyCondition == nil)
+	{
+	  IreplyCondition = [NSCondition new];
+	}
+      if (Ireceiver == nil)
+	{
+	  t = [[NSThread alloc] initWithTarget: self
+				      selector: @selector(_runReceiver)
+					object: nil];
+	  Ireceiver = t;
+	  IownsReceiver = YES;
+	}
+      IrequestWorkers = count;
+      GSM_UNLOCK(IrefGate);
+      [t start];
+    }
+  else
+    {
+      if (IrequestWorkers > 0)
+	{
+	  ImultipleThreads = IthreadsBeforeWorkers;
+	}
+      IrequestWorkers = 0;
+      q = Iworkers;
+      Iworkers = nil;
+      GSM_UNLOCK(IrefGate);
+      /* Let requests already queued be handled (and replied to) while
+       * the receiving thread is still there to get their replies.
+       */
+      [q waitUntilAllOperationsAreFinished];
+      RELEASE(q);
+      [self _stopReceiver];
+    }
+}
+
 /**
  * Sets the root object that is vended by the connection.
  */
@@ -1940,6 +2109,13 @@ static NSLock	*cached_proxies_gate = nil;
 
   DESTROY(IremoteName);
 
+  DESTROY(Iworkers);
+  DESTROY(Ireceiver);
+  DESTROY(IreplyCondition);
+
+  DESTROY(Iinterns);
+  DESTROY(Isignatures);
+
   DESTROY(IrefGate);
 
   [arp drain];
@@ -1958,9 +2134,11 @@ static NSLock	*cached_proxies_gate = nil;
   const char	*name;
   const char	*type;
   unsigned	seq;
+  NSData	*defined;
   NSRunLoop	*runLoop = GSRunLoopForThread(nil);
 
-  if ([IrunLoops indexOfObjectIdenticalTo: runLoop] == NSNotFound)
+  if (IwaitOnCondition == NO
+    && [IrunLoops indexOfObjectIdenticalTo: runLoop] == NSNotFound)
     {
       if (ImultipleThreads == NO)
 	{
@@ -2024,6 +2202,7 @@ static NSLock	*cached_proxies_gate = nil;
 	}
     }
 
+  defined = [op definedInterns];
   [self _sendOutRmc: op type: METHOD_REQUEST sequence: seq];
   name = sel_getName([inv selector]);
   NSDebugMLLog(@"NSConnection", @"Sent message %s RMC %d to 0x%"PRIxPTR,
@@ -2085,6 +2264,14 @@ static NSLock	*cached_proxies_gate = nil;
 	  [exc raise];
 	}
 
+      /* The other end has decoded the whole request, so it now knows
+       * any interned items which were sent in full.
+       */
+      if (defined != nil)
+	{
+	  [Iinterns confirm: defined];
+	}
+
       /* Get the return type qualifier flags, and the return type. */
       flags = objc_get_type_qualifiers(type);
       tmptype = objc_skip_type_qualifiers(type);
@@ -2319,8 +2506,22 @@ static NSLock	*cached_proxies_gate = nil;
 	 * for a reply, we are waiting for requests---so service it now.
 	 * If REPLY_DEPTH is non-zero, we may still want to service it now
 	 * if independent_queuing is NO.
+	 * If the connection has a pool of workers, we just hand it on.
 	 */
 	GS_M_LOCK(GSIVar(conn, _refGate));
+	if (GSIVar(conn, _workers) != nil)
+	  {
+	    NSInvocationOperation	*op;
+
+	    op = [[NSInvocationOperation alloc]
+	      initWithTarget: conn
+		    selector: @selector(_service_forwardForProxy:)
+		      object: rmc];
+	    [GSIVar(conn, _workers) addOperation: op];
+	    GSM_UNLOCK(GSIVar(conn, _refGate));
+	    RELEASE(op);	// The worker consumes rmc.
+	    break;
+	  }
 	if (GSIVar(conn, _requestDepth) == 0
 	  || GSIVar(conn, _independentQueueing) == NO)
 	  {
@@ -2396,6 +2597,13 @@ static NSLock	*cached_proxies_gate = nil;
 	      node->value.obj = rmc;
 	    }
 	  GSM_UNLOCK(GSIVar(conn, _refGate));
+	  if (node != 0 && GSIVar(conn, _replyCondition) != nil)
+	    {
+	      [GSIVar(conn, _replyCondition) lock];
+	      GSIVar(conn, _repliesArrived)++;
+	      [GSIVar(conn, _replyCondition) broadcast];
+	      [GSIVar(conn, _replyCondition) unlock];
+	    }
 	}
 	break;
 
@@ -2428,6 +2636,75 @@ static NSLock	*cached_proxies_gate = nil;
   [loop run];
 }
 
+/* The body of the thread which receives messages for a connection with
+ * request workers.  It runs until -_stopReceiver makes another thread
+ * the receiver (or none), and then takes its run loop out of the
+ * connection.
+ */
+- (void) _runReceiver
+{
+  NSThread	*thread = GSCurrentThread();
+  NSRunLoop	*loop = GSRunLoopForThread(nil);
+  BOOL		running = YES;
+
+  [self addRunLoop: loop];
+  while (running == YES)
+    {
+      CREATE_AUTORELEASE_POOL(arp);
+
+      GS_M_LOCK(IrefGate);
+      if (Ireceiver != thread || IisValid == NO)
+	{
+	  running = NO;
+	}
+      GSM_UNLOCK(IrefGate);
+      if (running == YES)
+	{
+	  running = [loop runMode: NSDefaultRunLoopMode
+		       beforeDate: [NSDate distantFuture]];
+	}
+      DESTROY(arp);
+    }
+  [self removeRunLoop: loop];
+}
+
+/* Stops the receiving thread (if this connection started it) and wakes
+ * any threads waiting on the reply condition, so that they go back to
+ * running their own run loops.  Child connections just stop using the
+ * thread of their parent.
+ */
+- (void) _stopReceiver
+{
+  NSThread	*t;
+  BOOL		owned;
+
+  GS_M_LOCK(IrefGate);
+  t = Ireceiver;
+  owned = IownsReceiver;
+  Ireceiver = nil;
+  IownsReceiver = NO;
+  GSM_UNLOCK(IrefGate);
+  if (t != nil)
+    {
+      if (owned == YES && [t isFinished] == NO)
+	{
+	  /* Take the connection out of the thread's run loop from within
+	   * that thread, which also wakes the loop so that the thread sees
+	   * it is no longer the receiver.
+	   */
+	  [self performSelector: @selector(removeRunLoop:)
+		       onThread: t
+		     withObject: GSRunLoopForThread(t)
+		  waitUntilDone: NO];
+	}
+      RELEASE(t);
+      [IreplyCondition lock];
+      IrepliesArrived++;
+      [IreplyCondition broadcast];
+      [IreplyCondition unlock];
+    }
+}
+
 + (int) setDebug: (int)val
 {
   int   old = debug_connection;
@@ -2519,7 +2796,8 @@ static NSLock	*cached_proxies_gate = nil;
       const char	*encoded_types = forward_type;
 
       NSParameterAssert (IisValid);
-      if ([IrunLoops indexOfObjectIdenticalTo: runLoop] == NSNotFound)
+      if (Iworkers == nil
+	&& [IrunLoops indexOfObjectIdenticalTo: runLoop] == NSNotFound)
 	{
 	  if (ImultipleThreads == YES)
 	    {
@@ -2908,9 +3186,26 @@ static NSLock	*cached_proxies_gate = nil;
   NSParameterAssert([rmc connection] == self);
 
   [rmc decodeValueOfObjCType: @encode(int) at: &sequence];
+  if ([rmc moreToDecode] == YES)
+    {
+      unsigned	coding;
+
+      [rmc decodeValueOfObjCType: @encode(unsigned) at: &coding];
+      if (coding >= COMPACT_CODING
+	&& [sendCoderClass compactCodingAvailable] == YES)
+	{
+	  IcompactCoding = YES;
+	}
+    }
   [self _doneInRmc: rmc];
   op = [self _newOutRmc: sequence generate: 0 reply: NO];
   [op encodeObject: rootObject];
+  if (IcompactCoding == YES)
+    {
+      unsigned	coding = COMPACT_CODING;
+
+      [op encodeValueOfObjCType: @encode(unsigned) at: &coding];
+    }
   [self _sendOutRmc: op type: ROOTPROXY_REPLY sequence: sequence];
 }
 
@@ -3103,7 +3398,8 @@ static NSLock	*cached_proxies_gate = nil;
    * get the reply in this thread.
    */
   runLoop = GSRunLoopForThread(nil);
-  if ([IrunLoops indexOfObjectIdenticalTo: runLoop] == NSNotFound)
+  if (IwaitOnCondition == NO
+    && [IrunLoops indexOfObjectIdenticalTo: runLoop] == NSNotFound)
     {
       if (ImultipleThreads == YES)
 	{
@@ -3161,6 +3457,48 @@ static NSLock	*cached_proxies_gate = nil;
 	      timeout_date
 		= [timeout_date initWithTimeIntervalSinceNow: IreplyTimeout];
 	    }
+	  if (IwaitOnCondition)
+	    {
+	      NSUInteger	arrived;
+	      BOOL		ready;
+	      BOOL		timedOut = NO;
+
+	      /*
+	       * Another thread receives the messages for this connection,
+	       * so we sleep until it tells us that a reply has arrived (or
+	       * that we have been invalidated), then check whether the reply
+	       * is ours.  The count of replies lets us do that without
+	       * holding both locks at once.
+	       */
+	      [IreplyCondition lock];
+	      arrived = IrepliesArrived;
+	      [IreplyCondition unlock];
+	      GS_M_LOCK(IrefGate);
+	      node = GSIMapNodeForKey(IreplyMap, (GSIMapKey)(NSUInteger)sn);
+	      ready = (IisValid == NO || node == 0
+		|| node->value.obj != dummyObject);
+	      GSM_UNLOCK(IrefGate);
+	      if (ready == NO)
+		{
+		  [IreplyCondition lock];
+		  while (timedOut == NO && arrived == IrepliesArrived)
+		    {
+		      if ([IreplyCondition waitUntilDate: timeout_date] == NO)
+			{
+			  timedOut = YES;
+			}
+		    }
+		  [IreplyCondition unlock];
+		}
+	      GS_M_LOCK(IrefGate); isLocked = YES;
+	      if (timedOut == YES)
+		{
+		  node = GSIMapNodeForKey(IreplyMap,
+		    (GSIMapKey)(NSUInteger)sn);
+		  break;
+		}
+	      continue;
+	    }
 	  RELEASE(delay_date);
 	  delay_date = [dateClass allocWithZone: NSDefaultMallocZone()];
 	  if (delay_interval < maximum_interval)
@@ -3957,6 +4295,61 @@ static NSLock	*cached_proxies_gate = nil;
   return ret;
 }
 
+- (BOOL) compactCoding
+{
+  return IcompactCoding;
+}
+
+- (GSPortCoderInterns*) interns
+{
+  GSPortCoderInterns	*t;
+
+  GS_M_LOCK(IrefGate);
+  if (Iinterns == nil)
+    {
+      Iinterns = [GSPortCoderInterns new];
+    }
+  t = Iinterns;
+  GSM_UNLOCK(IrefGate);
+  return t;
+}
+
+/*
+ * Asks the other end for the type of a method of one of its objects, and
+ * returns a signature for it shared by all the proxies on this connection
+ * which use the same type, or nil if the object's class does not have the
+ * method (the object may forward it).
+ */
+- (NSMethodSignature*) methodSignatureForSelector: (SEL)sel
+				     remoteTarget: (unsigned)target
+{
+  const char		*types;
+  NSString		*key;
+  NSMethodSignature	*sig;
+
+  types = [self typeForSelector: sel remoteTarget: target];
+  if (types == 0 || *types == '\0')
+    {
+      return nil;
+    }
+  key = [NSString stringWithUTF8String: types];
+  GS_M_LOCK(IrefGate);
+  sig = RETAIN([Isignatures objectForKey: key]);
+  GSM_UNLOCK(IrefGate);
+  if (sig == nil)
+    {
+      sig = RETAIN([NSMethodSignature signatureWithObjCTypes: types]);
+      GS_M_LOCK(IrefGate);
+      if (Isignatures == nil)
+	{
+	  Isignatures = [NSMutableDictionary new];
+	}
+      [Isignatures setObject: sig forKey: key];
+      GSM_UNLOCK(IrefGate);
+    }
+  return AUTORELEASE(sig);
+}
+
 - (NSDistantObject*) includesLocalTarget: (unsigned)target
 {
   NSDistantObject	*ret;
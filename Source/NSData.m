@@ -48,6 +48,7 @@
  *	NSData					Abstract base class.
  *	    NSDataStatic			Concrete class static buffers.
  *	        NSDataEmpty			Concrete class static buffers.
+ *	        NSDataSlice			Range of another data object.
  *		NSDataMalloc			Concrete class.
  *		    NSDataMappedFile		Memory mapped files.
  *		    NSDataShared		Extension for shared memory.
@@ -58,6 +59,7 @@
  *		    NSMutableDataShared		Extension for shared memory.
  *		    NSDataMutableFinalized	For GC of non-GC data.
  *          NSMutableDataWithDeallocatorBlock Adds custom deallocation behaviour
+ *	    NSMutableDataChunked		List of separate buffers.
  *
  *	NSMutableDataMalloc MUST share it's initial instance variable layout
  *	with NSDataMalloc so that it can use the 'behavior' code to inherit
@@ -118,7 +120,9 @@
 #endif
 
 @class	NSDataMalloc;
+@class	NSDataSlice;
 @class	NSDataStatic;
+@class	NSMutableDataChunked;
 @class	NSMutableDataMalloc;
 
 /*
@@ -127,7 +131,15 @@
  */
 static Class	dataStatic;
 static Class	dataMalloc;
+static Class	dataSlice;
+#ifdef	HAVE_MMAP
+static Class	dataMappedFile;
+#endif
+#ifdef	HAVE_SHMCTL
+static Class	dataShared;
+#endif
 static Class	mutableDataMalloc;
+static Class	mutableDataChunked;
 static Class	dataBlock;
 static Class	mutableDataBlock;
 static Class	NSDataAbstract;
@@ -414,6 +426,17 @@ failure:
 @interface	NSDataEmpty: NSDataStatic
 @end
 
+/*
+ *	Refers to a range of the bytes of a data object which owns them, and
+ *	retains that object so the bytes stay valid.
+ */
+@interface	NSDataSlice : NSDataStatic
+{
+  NSData	*parent;
+}
+- (id) initWithParent: (NSData*)p range: (NSRange)r;
+@end
+
 @interface	NSDataMalloc : NSDataStatic
 @end
 
@@ -461,6 +484,68 @@ failure:
 @end
 #endif
 
+/*
+ *	A contiguous piece of the contents of an NSMutableDataChunked.
+ *	The bytes in use are those from start to end.  If owner is nil the
+ *	buffer was allocated by the data object and may be filled up to size,
+ *	otherwise the buffer is the content of the (immutable) owner.
+ */
+typedef struct {
+  uint8_t	*buf;
+  NSUInteger	start;
+  NSUInteger	end;
+  NSUInteger	size;
+  NSData	*owner;
+} GSDataChunk;
+
+/*
+ *	Mutable data held as a list of chunks, so that appending never moves
+ *	the existing contents and removing bytes from the start only has to
+ *	release the chunks holding them.  The chunks are joined into a single
+ *	buffer only when -bytes or -mutableBytes needs one.
+ */
+@interface	NSMutableDataChunked : NSMutableData
+{
+  NSUInteger	length;
+  NSUInteger	chunkSize;	/* Preferred size of a new chunk.	*/
+  GSDataChunk	*chunks;
+  NSUInteger	first;		/* Index of the first chunk in use.	*/
+  NSUInteger	count;		/* Index after the last chunk in use.	*/
+  NSUInteger	slots;		/* Size of the chunks array.		*/
+}
+- (id) initWithChunkSize: (NSUInteger)size;
+@end
+
+/*
+ *	Returns YES if the data object is immutable and owns its bytes, so
+ *	that other objects may refer to them for as long as they retain it.
+ *	Static data may refer to memory which its creator reuses, and mutable
+ *	data may change, so their bytes must be copied.
+ */
+static inline BOOL
+isShareable(NSData *d)
+{
+  Class	c = object_getClass(d);
+
+  if (c == dataMalloc || c == dataSlice || c == dataBlock)
+    {
+      return YES;
+    }
+#ifdef	HAVE_MMAP
+  if (c == dataMappedFile)
+    {
+      return YES;
+    }
+#endif
+#ifdef	HAVE_SHMCTL
+  if (c == dataShared)
+    {
+      return YES;
+    }
+#endif
+  return NO;
+}
+
 
 
 /**
@@ -483,8 +568,16 @@ failure:
       NSMutableDataAbstract = [NSMutableData class];
       dataStatic = [NSDataStatic class];
       dataMalloc = [NSDataMalloc class];
+      dataSlice = [NSDataSlice class];
+#ifdef	HAVE_MMAP
+      dataMappedFile = [NSDataMappedFile class];
+#endif
+#ifdef	HAVE_SHMCTL
+      dataShared = [NSDataShared class];
+#endif
       dataBlock = [NSDataWithDeallocatorBlock class];
       mutableDataMalloc = [NSMutableDataMalloc class];
+      mutableDataChunked = [NSMutableDataChunked class];
       mutableDataBlock = [NSMutableDataWithDeallocatorBlock class];
       appendSel = @selector(appendBytes:length:);
       appendImp = [mutableDataMalloc instanceMethodForSelector: appendSel];
@@ -623,6 +716,10 @@ failure:
 {
   NSData	*d;
 
+  if (isShareable(data))
+    {
+      return AUTORELEASE(RETAIN(data));
+    }
   d = [dataMalloc allocWithZone: NSDefaultMallocZone()];
   d = [d initWithBytes: [data bytes] length: [data length]];
   return AUTORELEASE(d);
@@ -936,6 +1033,13 @@ failure:
       DESTROY(self);
       return nil;
     }
+  if (object_getClass(self) == dataMalloc && isShareable(data))
+    {
+      /* A new immutable object would be the same as the original.
+       */
+      DESTROY(self);
+      return RETAIN(data);
+    }
   return [self initWithBytes: [data bytes] length: [data length]];
 }
 
@@ -1019,11 +1123,35 @@ failure:
   return self;
 }
 
+/**
+ * Calls aBlock with each contiguous region of the receiver's bytes in
+ * turn, along with the range of the region within the receiver, until
+ * the block sets its stop argument to YES.<br />
+ * Most data objects have a single region, but one made by
+ * [NSMutableData+dataWithChunkSize:] may have many, and enumerating
+ * them avoids joining them into a single buffer.
+ */
+- (void) enumerateByteRangesUsingBlock: (GSDataByteRangeBlock)aBlock
+{
+  NSUInteger	l = [self length];
+
+  if (l > 0)
+    {
+      BOOL	stop = NO;
+
+      CALL_BLOCK(aBlock, [self bytes], NSMakeRange(0, l), &stop);
+    }
+}
+
 /**
  * Returns an NSData instance encapsulating the memory from the receiver
  * specified by the range aRange.<br />
  * If aRange specifies a range which does not entirely lie within the
- * receiver, an exception is raised.
+ * receiver, an exception is raised.<br />
+ * If the receiver is immutable and owns its memory, the new object refers
+ * to that memory rather than copying it, and keeps the receiver alive.
+ * Use +dataWithBytes:length: to get an independent copy of a small range
+ * of a large object which is no longer needed.
  */
 - (NSData*) subdataWithRange: (NSRange)aRange
 {
@@ -1032,6 +1160,16 @@ failure:
 
   GS_RANGE_CHECK(aRange, l);
 
+  if (aRange.length > 0 && isShareable(self))
+    {
+      if (aRange.length == l)
+	{
+	  return AUTORELEASE(RETAIN(self));
+	}
+      return AUTORELEASE([[dataSlice allocWithZone: NSDefaultMallocZone()]
+	initWithParent: self range: aRange]);
+    }
+
   buffer = NSZoneMalloc(NSDefaultMallocZone(), aRange.length);
   if (buffer == 0)
     {
@@ -2804,6 +2942,29 @@ failure:
   return AUTORELEASE(d);
 }
 
+/**
+ * Returns a new empty mutable data object which holds its contents as a
+ * list of separately allocated chunks of up to chunkSize bytes (or a
+ * default of 64KB if chunkSize is zero).<br />
+ * Appending to the object never moves its existing contents, removing
+ * bytes from its start with -replaceBytesInRange:withBytes:length:
+ * does not move the rest, and large immutable data objects appended to
+ * it are retained rather than copied.  This makes the object suitable
+ * for accumulating or queueing large amounts of incoming data.<br />
+ * The -bytes and -mutableBytes methods join the chunks into a single
+ * buffer (and subsequent appends add new chunks after it), so code which
+ * processes the contents should use -getBytes:range: or
+ * -enumerateByteRangesUsingBlock: where possible.
+ */
++ (id) dataWithChunkSize: (NSUInteger)chunkSize
+{
+  NSMutableData	*d;
+
+  d = [mutableDataChunked allocWithZone: NSDefaultMallocZone()];
+  d = [d initWithChunkSize: chunkSize];
+  return AUTORELEASE(d);
+}
+
 /**
  *  Returns current capacity of data buffer.
  */
@@ -3308,6 +3469,29 @@ getBytes(void* dst, void* src, unsigned len, unsigned limit, unsigned *pos)
 }
 @end
 
+
+@implementation NSDataSlice
+- (void) dealloc
+{
+  DESTROY(parent);
+  [super dealloc];
+}
+
+- (id) initWithParent: (NSData*)p range: (NSRange)r
+{
+  bytes = (uint8_t*)[p bytes] + r.location;
+  length = r.length;
+  /* A slice of a slice refers to the original owner of the bytes.
+   */
+  if (object_getClass(p) == dataSlice)
+    {
+      p = ((NSDataSlice*)p)->parent;
+    }
+  parent = RETAIN(p);
+  return self;
+}
+@end
+
 
 @implementation	NSDataMalloc
 
@@ -4234,6 +4418,34 @@ getBytes(void* dst, void* src, unsigned len, unsigned limit, unsigned *pos)
   length = size;
 }
 
+/* Describes at least want bytes of free space after the end of the data,
+ * growing the buffer as -setLength: would, but without clearing it.
+ */
+- (void) _space: (GSDataSpace*)s want: (NSUInteger)want
+{
+  if (capacity - length < want)
+    {
+      NSUInteger	growTo = capacity + capacity / 2;
+
+      if (length + want > growTo)
+	{
+	  growTo = length + want;
+	}
+      [self setCapacity: growTo];
+    }
+  s->buf[0] = (uint8_t*)bytes + length;
+  s->len[0] = capacity - length;
+  s->count = 1;
+  s->base = length;
+  s->fresh = NO;
+}
+
+- (void) _extend: (GSDataSpace*)s used: (NSUInteger)used
+{
+  length += used;
+  s->count = 0;
+}
+
 - (NSUInteger) sizeInBytesExcluding: (NSHashTable*)exclude
 {
   NSUInteger    size = GSPrivateMemorySize(self, exclude);
@@ -4516,3 +4728,645 @@ getBytes(void* dst, void* src, unsigned len, unsigned limit, unsigned *pos)
 
 @end
 #endif	/* HAVE_SHMCTL	*/
+
+
+#define	GS_DATA_CHUNK	65536		/* Default maximum chunk size	*/
+#define	GS_DATA_CHUNK_MIN	4096	/* Minimum size of a new chunk	*/
+
+static inline void
+releaseChunk(GSDataChunk *c)
+{
+  if (c->owner == nil)
+    {
+      NSZoneFree(NSDefaultMallocZone(), c->buf);
+    }
+  else
+    {
+      DESTROY(c->owner);
+    }
+}
+
+@implementation	NSMutableDataChunked
+
+- (Class) classForCoder
+{
+  return NSMutableDataAbstract;
+}
+
+/* Adds an empty chunk to the end of the list and returns it.
+ */
+- (GSDataChunk*) _addChunk
+{
+  GSDataChunk	*c;
+
+  if (count == slots)
+    {
+      if (first > 0)
+	{
+	  memmove(chunks, chunks + first, (count - first) * sizeof(GSDataChunk));
+	  count -= first;
+	  first = 0;
+	}
+      else
+	{
+	  NSUInteger	want = (slots > 0) ? slots * 2 : 8;
+	  GSDataChunk	*tmp;
+
+	  tmp = NSZoneRealloc(NSDefaultMallocZone(), chunks,
+	    want * sizeof(GSDataChunk));
+	  if (tmp == 0)
+	    {
+	      [NSException raise: NSMallocException
+		format: @"Unable to grow chunk list to %"PRIuPTR, want];
+	    }
+	  chunks = tmp;
+	  slots = want;
+	}
+    }
+  c = &chunks[count++];
+  memset(c, '\0', sizeof(GSDataChunk));
+  return c;
+}
+
+/* Adds bufferSize bytes copied from aBuffer (or zeros if aBuffer is null)
+ * to the end of the receiver, filling any space left in the last chunk
+ * before allocating a new one.  New chunks grow with the total length
+ * up to the chunk size, so small objects do not waste memory.
+ */
+- (void) _append: (const uint8_t*)aBuffer length: (NSUInteger)bufferSize
+{
+  NSUInteger	total = bufferSize;
+
+  if (count > first)
+    {
+      GSDataChunk	*c = &chunks[count - 1];
+
+      if (c->owner == nil && c->end < c->size)
+	{
+	  NSUInteger	n = c->size - c->end;
+
+	  if (n > bufferSize)
+	    {
+	      n = bufferSize;
+	    }
+	  if (aBuffer == 0)
+	    {
+	      memset(c->buf + c->end, '\0', n);
+	    }
+	  else
+	    {
+	      memcpy(c->buf + c->end, aBuffer, n);
+	      aBuffer += n;
+	    }
+	  c->end += n;
+	  bufferSize -= n;
+	}
+    }
+  if (bufferSize > 0)
+    {
+      NSUInteger	size = length;
+      uint8_t		*buf;
+      GSDataChunk	*c;
+
+      if (size < GS_DATA_CHUNK_MIN)
+	{
+	  size = GS_DATA_CHUNK_MIN;
+	}
+      if (size > chunkSize)
+	{
+	  size = chunkSize;
+	}
+      if (size < bufferSize)
+	{
+	  size = bufferSize;
+	}
+      buf = NSZoneMalloc(NSDefaultMallocZone(), size);
+      if (buf == 0)
+	{
+	  [NSException raise: NSMallocException
+	    format: @"Unable to allocate data chunk of %"PRIuPTR, size];
+	}
+      if (aBuffer == 0)
+	{
+	  memset(buf, '\0', bufferSize);
+	}
+      else
+	{
+	  memcpy(buf, aBuffer, bufferSize);
+	}
+      c = [self _addChunk];
+      c->buf = buf;
+      c->end = bufferSize;
+      c->size = size;
+    }
+  length += total;
+}
+
+/* Removes the specified number of bytes from the start of the receiver.
+ */
+- (void) _consume: (NSUInteger)amount
+{
+  length -= amount;
+  while (amount > 0)
+    {
+      GSDataChunk	*c = &chunks[first];
+      NSUInteger	n = c->end - c->start;
+
+      if (n <= amount)
+	{
+	  releaseChunk(c);
+	  first++;
+	  amount -= n;
+	}
+      else
+	{
+	  c->start += amount;
+	  amount = 0;
+	}
+    }
+  if (first == count)
+    {
+      first = count = 0;
+    }
+}
+
+/* Replaces the chunks by a single chunk holding all the bytes.
+ */
+- (void) _join
+{
+  NSUInteger	size = (length > GS_DATA_CHUNK_MIN) ? length : GS_DATA_CHUNK_MIN;
+  uint8_t	*buf;
+  GSDataChunk	*c;
+
+  buf = NSZoneMalloc(NSDefaultMallocZone(), size);
+  if (buf == 0)
+    {
+      [NSException raise: NSMallocException
+	format: @"Unable to allocate data buffer of %"PRIuPTR, size];
+    }
+  [self getBytes: buf range: NSMakeRange(0, length)];
+  while (first < count)
+    {
+      releaseChunk(&chunks[first++]);
+    }
+  first = count = 0;
+  c = [self _addChunk];
+  c->buf = buf;
+  c->end = length;
+  c->size = size;
+}
+
+/* Describes at least want bytes of free space after the end of the data
+ * without moving anything: the space left in the last chunk and (if that
+ * is not enough) an empty new chunk, sized as for -_append:length:.
+ */
+- (void) _space: (GSDataSpace*)s want: (NSUInteger)want
+{
+  NSUInteger	have = 0;
+
+  s->count = 0;
+  s->base = length;
+  s->fresh = NO;
+  if (count > first)
+    {
+      GSDataChunk	*c = &chunks[count - 1];
+
+      if (c->owner == nil && c->end < c->size)
+	{
+	  have = c->size - c->end;
+	  s->buf[0] = c->buf + c->end;
+	  s->len[0] = have;
+	  s->count = 1;
+	}
+    }
+  if (have < want)
+    {
+      NSUInteger	size = length;
+      uint8_t		*buf;
+      GSDataChunk	*c;
+
+      if (size < GS_DATA_CHUNK_MIN)
+	{
+	  size = GS_DATA_CHUNK_MIN;
+	}
+      if (size > chunkSize)
+	{
+	  size = chunkSize;
+	}
+      if (size < want - have)
+	{
+	  size = want - have;
+	}
+      buf = NSZoneMalloc(NSDefaultMallocZone(), size);
+      if (buf == 0)
+	{
+	  [NSException raise: NSMallocException
+	    format: @"Unable to allocate data chunk of %"PRIuPTR, size];
+	}
+      c = [self _addChunk];
+      c->buf = buf;
+      c->size = size;
+      s->buf[s->count] = buf;
+      s->len[s->count] = size;
+      s->count++;
+      s->fresh = YES;
+    }
+}
+
+/* Adds the bytes stored in the space described by -_space:want: to the
+ * data, releasing the new chunk if nothing was stored in it.
+ */
+- (void) _extend: (GSDataSpace*)s used: (NSUInteger)used
+{
+  NSUInteger	n = used;
+
+  if (s->count == 2 || (s->count == 1 && NO == s->fresh))
+    {
+      GSDataChunk	*c = &chunks[count - (YES == s->fresh ? 2 : 1)];
+      NSUInteger	k = (n < s->len[0]) ? n : s->len[0];
+
+      c->end += k;
+      n -= k;
+    }
+  if (YES == s->fresh)
+    {
+      GSDataChunk	*c = &chunks[count - 1];
+
+      if (n == 0)
+	{
+	  releaseChunk(c);
+	  count--;
+	  if (first == count)
+	    {
+	      first = count = 0;
+	    }
+	}
+      else
+	{
+	  c->end = n;
+	}
+    }
+  length += used;
+  s->count = 0;
+}
+
+- (void) appendBytes: (const void*)aBuffer
+	      length: (NSUInteger)bufferSize
+{
+  if (bufferSize > 0)
+    {
+      if (aBuffer == 0)
+	{
+	  [NSException raise: NSInvalidArgumentException
+	    format: @"[%@-appendBytes:length:] called with "
+	    @"length but null bytes", NSStringFromClass([self class])];
+	}
+      [self _append: aBuffer length: bufferSize];
+    }
+}
+
+- (void) appendData: (NSData*)other
+{
+  NSUInteger	l = [other length];
+
+  if (l == 0)
+    {
+      return;
+    }
+  if (l >= chunkSize / 4 && isShareable(other))
+    {
+      GSDataChunk	*c = [self _addChunk];
+
+      /* Refer to the bytes of a large immutable object rather than
+       * copying them.
+       */
+      c->owner = RETAIN(other);
+      c->buf = (uint8_t*)[other bytes];
+      c->end = l;
+      c->size = l;
+      length += l;
+    }
+  else if (object_getClass(other) == mutableDataChunked && other != self)
+    {
+      NSMutableDataChunked	*o = (NSMutableDataChunked*)other;
+      NSUInteger		i;
+
+      for (i = o->first; i < o->count; i++)
+	{
+	  GSDataChunk	*c = &o->chunks[i];
+
+	  [self _append: c->buf + c->start length: c->end - c->start];
+	}
+    }
+  else
+    {
+      [self _append: [other bytes] length: l];
+    }
+}
+
+- (const void*) bytes
+{
+  if (count - first == 1)
+    {
+      return chunks[first].buf + chunks[first].start;
+    }
+  return [self mutableBytes];
+}
+
+- (NSUInteger) capacity
+{
+  NSUInteger	c = length;
+
+  if (count > first && chunks[count - 1].owner == nil)
+    {
+      c += chunks[count - 1].size - chunks[count - 1].end;
+    }
+  return c;
+}
+
+- (id) copyWithZone: (NSZone*)z
+{
+  void	*buf = 0;
+
+  if (length > 0)
+    {
+      buf = NSZoneMalloc(z, length);
+      if (buf == 0)
+	{
+	  [NSException raise: NSMallocException
+	    format: @"Unable to allocate data buffer of %"PRIuPTR, length];
+	}
+      [self getBytes: buf range: NSMakeRange(0, length)];
+    }
+  return [[dataMalloc allocWithZone: z] initWithBytesNoCopy: buf
+						     length: length
+					       freeWhenDone: YES];
+}
+
+- (void) dealloc
+{
+  while (first < count)
+    {
+      releaseChunk(&chunks[first++]);
+    }
+  if (chunks != 0)
+    {
+      NSZoneFree(NSDefaultMallocZone(), chunks);
+      chunks = 0;
+    }
+  [super dealloc];
+}
+
+- (void) enumerateByteRangesUsingBlock: (GSDataByteRangeBlock)aBlock
+{
+  NSUInteger	pos = 0;
+  NSUInteger	i;
+  BOOL		stop = NO;
+
+  for (i = first; i < count && NO == stop; i++)
+    {
+      GSDataChunk	*c = &chunks[i];
+      NSUInteger	n = c->end - c->start;
+
+      if (n > 0)
+	{
+	  CALL_BLOCK(aBlock, c->buf + c->start, NSMakeRange(pos, n), &stop);
+	  pos += n;
+	}
+    }
+}
+
+- (void) getBytes: (void*)buffer range: (NSRange)aRange
+{
+  uint8_t	*dst = (uint8_t*)buffer;
+  NSUInteger	pos = 0;
+  NSUInteger	i;
+
+  GS_RANGE_CHECK(aRange, length);
+  for (i = first; i < count && aRange.length > 0; i++)
+    {
+      GSDataChunk	*c = &chunks[i];
+      NSUInteger	n = c->end - c->start;
+
+      if (aRange.location < pos + n)
+	{
+	  NSUInteger	offset = aRange.location - pos;
+	  NSUInteger	l = n - offset;
+
+	  if (l > aRange.length)
+	    {
+	      l = aRange.length;
+	    }
+	  memcpy(dst, c->buf + c->start + offset, l);
+	  dst += l;
+	  aRange.location += l;
+	  aRange.length -= l;
+	}
+      pos += n;
+    }
+}
+
+- (id) initWithBytesNoCopy: (void*)aBuffer
+		    length: (NSUInteger)bufferSize
+	      freeWhenDone: (BOOL)shouldFree
+{
+  if (aBuffer == 0 && bufferSize > 0)
+    {
+      [NSException raise: NSInvalidArgumentException
+	format: @"[%@-initWithBytesNoCopy:length:freeWhenDone:] called with "
+	@"length but null bytes", NSStringFromClass([self class])];
+    }
+  self = [self initWithChunkSize: 0];
+  if (self != nil && bufferSize > 0)
+    {
+      [self _append: aBuffer length: bufferSize];
+    }
+  if (shouldFree == YES && aBuffer != 0)
+    {
+      NSZoneFree(NSZoneFromPointer(aBuffer), aBuffer);
+    }
+  return self;
+}
+
+- (id) initWithCapacity: (NSUInteger)capacity
+{
+  return [self initWithChunkSize: 0];
+}
+
+- (id) initWithChunkSize: (NSUInteger)size
+{
+  if (nil != (self = [super init]))
+    {
+      chunkSize = (size > 0) ? size : GS_DATA_CHUNK;
+    }
+  return self;
+}
+
+- (id) initWithLength: (NSUInteger)size
+{
+  self = [self initWithChunkSize: 0];
+  if (self != nil)
+    {
+      [self _append: 0 length: size];
+    }
+  return self;
+}
+
+- (NSUInteger) length
+{
+  return length;
+}
+
+- (void*) mutableBytes
+{
+  if (count - first != 1 || chunks[first].owner != nil)
+    {
+      [self _join];
+    }
+  return chunks[first].buf + chunks[first].start;
+}
+
+- (id) mutableCopyWithZone: (NSZone*)z
+{
+  void	*buf = 0;
+
+  if (length > 0)
+    {
+      buf = NSZoneMalloc(z, length);
+      if (buf == 0)
+	{
+	  [NSException raise: NSMallocException
+	    format: @"Unable to allocate data buffer of %"PRIuPTR, length];
+	}
+      [self getBytes: buf range: NSMakeRange(0, length)];
+    }
+  return [[mutableDataMalloc allocWithZone: z] initWithBytesNoCopy: buf
+							    length: length
+						      freeWhenDone: YES];
+}
+
+- (void) replaceBytesInRange: (NSRange)aRange
+		   withBytes: (const void*)moreBytes
+		      length: (NSUInteger)bufferSize
+{
+  if (aRange.location == 0 && bufferSize == 0 && aRange.length <= length)
+    {
+      [self _consume: aRange.length];
+    }
+  else if (aRange.location == length && aRange.length == 0)
+    {
+      [self appendBytes: moreBytes length: bufferSize];
+    }
+  else
+    {
+      [super replaceBytesInRange: aRange
+		       withBytes: moreBytes
+			  length: bufferSize];
+    }
+}
+
+- (id) setCapacity: (NSUInteger)size
+{
+  if (size < length)
+    {
+      [self setLength: size];
+    }
+  return self;
+}
+
+- (void) setLength: (NSUInteger)size
+{
+  if (size > length)
+    {
+      [self _append: 0 length: size - length];
+    }
+  else
+    {
+      NSUInteger	excess = length - size;
+
+      while (excess > 0)
+	{
+	  GSDataChunk	*c = &chunks[count - 1];
+	  NSUInteger	n = c->end - c->start;
+
+	  if (n <= excess)
+	    {
+	      releaseChunk(c);
+	      count--;
+	      excess -= n;
+	    }
+	  else
+	    {
+	      c->end -= excess;
+	      excess = 0;
+	    }
+	}
+      if (first == count)
+	{
+	  first = count = 0;
+	}
+      length = size;
+    }
+}
+
+- (NSUInteger) sizeInBytesExcluding: (NSHashTable*)exclude
+{
+  NSUInteger    size = GSPrivateMemorySize(self, exclude);
+
+  if (size > 0)
+    {
+      NSUInteger	i;
+
+      size += slots * sizeof(GSDataChunk);
+      for (i = first; i < count; i++)
+	{
+	  if (chunks[i].owner == nil)
+	    {
+	      size += chunks[i].size;
+	    }
+	}
+    }
+  return size;
+}
+
+@end
+
+void
+GSPrivateDataSpace(NSMutableData *data, NSUInteger want, GSDataSpace *space)
+{
+  if (object_getClass(data) == mutableDataChunked)
+    {
+      [(NSMutableDataChunked*)data _space: space want: want];
+    }
+  else if ([data isKindOfClass: mutableDataMalloc])
+    {
+      [(NSMutableDataMalloc*)data _space: space want: want];
+    }
+  else
+    {
+      space->base = [data length];
+      space->fresh = NO;
+      [data setLength: space->base + want];
+      space->buf[0] = (uint8_t*)[data mutableBytes] + space->base;
+      space->len[0] = want;
+      space->count = 1;
+    }
+}
+
+void
+GSPrivateDataExtend(NSMutableData *data, GSDataSpace *space, NSUInteger used)
+{
+  if (object_getClass(data) == mutableDataChunked)
+    {
+      [(NSMutableDataChunked*)data _extend: space used: used];
+    }
+  else if ([data isKindOfClass: mutableDataMalloc])
+    {
+      [(NSMutableDataMalloc*)data _extend: space used: used];
+    }
+  else
+    {
+      [data setLength: space->base + used];
+      space->count = 0;
+    }
+}
@@ -750,16 +750,26 @@ GS_ROOT_CLASS @interface	GSDistantObjectPlaceHolder
 	  id		inv;
 	  id		sig;
 
-	  DO_FORWARD_INVOCATION(methodSignatureForSelector:, aSelector);
-
-	  if ([m isProxy] == YES)
+	  /* Ask the connection for the type of the remote method, which
+	   * takes one round trip, and only if the remote class does not
+	   * implement the method (it may forward it) ask the remote object
+	   * for its signature, which takes two.
+	   */
+	  m = [_connection methodSignatureForSelector: aSelector
+					 remoteTarget: _handle];
+	  if (m == nil)
 	    {
-	      const char	*types;
+	      DO_FORWARD_INVOCATION(methodSignatureForSelector:, aSelector);
 
-	      types = [m methodType];
-	      /* Create a local method signature.
-	       */
-	      m = [NSMethodSignature signatureWithObjCTypes: types];
+	      if ([m isProxy] == YES)
+		{
+		  const char	*types;
+
+		  types = [m methodType];
+		  /* Create a local method signature.
+		   */
+		  m = [NSMethodSignature signatureWithObjCTypes: types];
+		}
 	    }
 	  if (m != nil)
 	    {
@@ -713,6 +713,41 @@ NSString * const NSFileHandleOperationException
   [self subclassResponsibility: _cmd];
 }
 
+/**
+ * Call -writeInBackgroundAndNotifyFromFileHandle:offset:length:forModes:
+ * with nil modes.
+ */
+- (void) writeInBackgroundAndNotifyFromFileHandle: (NSFileHandle*)source
+					   offset: (unsigned long long)offset
+					   length: (unsigned long long)length
+{
+  [self writeInBackgroundAndNotifyFromFileHandle: source
+					  offset: offset
+					  length: length
+					forModes: nil];
+}
+
+/**
+ * Writes length bytes from the file of the source handle, starting at
+ * offset, to the receiver asynchronously, and notifies on completion
+ * in the same way as -writeInBackgroundAndNotify:forModes: (the source
+ * handle is the NSFileHandleNotificationFileHandleItem of the
+ * notification).<br />
+ * The data is moved by the operating system where possible, without
+ * being read into the process, so this is the most efficient way to
+ * send (part of) a file over a socket or to copy it to another file.
+ * The position of the source handle is not changed.<br />
+ * Raises an NSInvalidArgumentException if the source is not a file
+ * which can be read from any offset.
+ */
+- (void) writeInBackgroundAndNotifyFromFileHandle: (NSFileHandle*)source
+					   offset: (unsigned long long)offset
+					   length: (unsigned long long)length
+					 forModes: (NSArray*)modes
+{
+  [self subclassResponsibility: _cmd];
+}
+
 /**
  * Returns a boolean to indicate whether a write operation of any kind is
  * in progress on the handle.  An outgoing network connection attempt
@@ -1045,6 +1080,20 @@ GSTLSHandlePush(gnutls_transport_ptr_t handle, const void *buffer, size_t len)
               [d release];
             }
         }
+      /* If no value is specified for GSTLSResumeKey, use the address and
+       * port of the remote host so that sessions can be resumed.
+       */
+      if (YES == isOutgoing && nil == [opts objectForKey: GSTLSResumeKey])
+        {
+          NSMutableDictionary   *d = [opts mutableCopy];
+          NSString              *s;
+
+          s = [NSString stringWithFormat: @"%@:%@",
+            [self socketAddress], [self socketService]];
+          [d setObject: s forKey: GSTLSResumeKey];
+          ASSIGNCOPY(opts, d);
+          [d release];
+        }
       [self setNonBlocking: YES];
       session = [[GSTLSSession alloc] initWithOptions: opts
                                             direction: isOutgoing
@@ -1089,6 +1138,42 @@ GSTLSHandlePush(gnutls_transport_ptr_t handle, const void *buffer, size_t len)
   return nil;
 }
 
+- (NSInteger) transfer: (int)fd
+		offset: (unsigned long long*)offset
+		length: (NSUInteger)len
+		method: (int*)how
+{
+  if (YES == [session active])
+    {
+      char	buf[16384];
+      ssize_t	got;
+      NSInteger	result;
+
+      /* The data must be encrypted, so read it for the session to write.
+       */
+      if (len > sizeof(buf))
+	{
+	  len = sizeof(buf);
+	}
+      do
+	{
+	  got = pread(fd, buf, len, (off_t)*offset);
+	}
+      while (got < 0 && EINTR == errno);
+      if (got <= 0)
+	{
+	  return got;
+	}
+      result = [session write: buf length: got];
+      if (result > 0)
+	{
+	  *offset += result;
+	}
+      return result;
+    }
+  return [super transfer: fd offset: offset length: len method: how];
+}
+
 - (NSInteger) write: (const void*)buf length: (NSUInteger)len
 {
   if (YES == [session active])
@@ -173,6 +173,18 @@
 #define	GSBINIO	0
 #endif
 
+/*
+ * On Linux a copy may share the data of the original file (a reflink)
+ * on filesystems which support it.  This is the kernel's value for
+ * C libraries which do not declare it.
+ */
+#if	defined(__linux__)
+#  include <sys/ioctl.h>
+#  ifndef	FICLONE
+#    define	FICLONE	_IOW(0x94, 9, int)
+#  endif
+#endif
+
 @interface NSDirectoryEnumerator (Local)
 - (id) initWithDirectoryPath: (NSString*)path 
    recurseIntoSubdirectories: (BOOL)recurse
@@ -227,6 +239,805 @@
 
 #define	_CCP		const _CHAR*
 
+/*
+ * Parallel tree walking.
+ * A recursive remove or copy without a handler is done by a small pool
+ * of threads.  Each directory is a GSTreeNode which one thread scans,
+ * working on the entries relative to the open directory and using the
+ * type recorded in each entry to avoid a stat where it can.  Files are
+ * removed or copied as they are found, while subdirectories are queued
+ * for any thread to pick up.  A node counts its own scan and each of
+ * its unfinished subdirectories, and when the count drops to zero the
+ * whole subtree is done, so the directory itself is removed (or has the
+ * attributes of its source set) before its parent is told.
+ */
+#if	!defined(_WIN32) && defined(AT_FDCWD) && defined(AT_SYMLINK_NOFOLLOW) \
+  && defined(O_DIRECTORY) && defined(O_NOFOLLOW) && defined(UTIME_OMIT) \
+  && defined(DT_DIR)
+#define	GS_TREE_WALK	1
+#include <pthread.h>
+
+#ifdef	O_CLOEXEC
+#define	TREE_CLOEXEC	O_CLOEXEC
+#else
+#define	TREE_CLOEXEC	0
+#endif
+
+#ifndef	IFTODT
+#define	IFTODT(M)	(((M) & 0170000) >> 12)
+#endif
+
+/* The most threads (including the caller) working on one tree.
+ */
+#define	GS_TREE_THREADS	16
+
+typedef struct _GSTreeNode GSTreeNode;
+struct _GSTreeNode {
+  GSTreeNode	*parent;
+  GSTreeNode	*next;		// Link in the queue of directories to scan
+  char		*src;		// Directory to scan (and remove)
+  char		*dst;		// Directory to copy into (nul if removing)
+  struct stat	st;		// Attributes of the source directory
+  unsigned	pending;	// The scan plus unfinished subdirectories
+};
+
+typedef struct {
+  pthread_mutex_t	lock;
+  pthread_cond_t	cond;
+  GSTreeNode		*queue;
+  pthread_t		threads[GS_TREE_THREADS];
+  unsigned		started;	// Threads started for the walk
+  unsigned		limit;		// Most threads (including caller)
+  unsigned		idle;		// Threads waiting for work
+  BOOL			finished;	// The whole tree has been done
+  BOOL			copying;
+  BOOL			owner;		// Copy the owners of files
+  int			error;		// The first errno (zero if none)
+  const char		*reason;	// What failed first
+  char			*path;		// Where it failed
+} GSTreeWalk;
+
+static void	*treeWorker(void *arg);
+
+static char *
+treePath(const char *dir, const char *name)
+{
+  size_t	dl = strlen(dir);
+  size_t	nl = strlen(name);
+  char		*p = malloc(dl + nl + 2);
+
+  if (p != 0)
+    {
+      memcpy(p, dir, dl);
+      p[dl] = '/';
+      memcpy(p + dl + 1, name, nl + 1);
+    }
+  return p;
+}
+
+/* Records the first failure, which stops the walk.
+ */
+static void
+treeFail(GSTreeWalk *w, int err, const char *reason,
+  const char *dir, const char *name)
+{
+  pthread_mutex_lock(&w->lock);
+  if (0 == w->error)
+    {
+      w->error = (0 == err) ? EIO : err;
+      w->reason = reason;
+      w->path = (0 == name) ? strdup(dir) : treePath(dir, name);
+    }
+  pthread_mutex_unlock(&w->lock);
+}
+
+static BOOL
+treeFailed(GSTreeWalk *w)
+{
+  BOOL	failed;
+
+  pthread_mutex_lock(&w->lock);
+  failed = (w->error != 0) ? YES : NO;
+  pthread_mutex_unlock(&w->lock);
+  return failed;
+}
+
+/* Returns a node for the subdirectory name of the directory (and copy)
+ * of parent, or for the top directory if there is no parent.
+ */
+static GSTreeNode *
+treeNode(GSTreeNode *parent, const char *src, const char *dst,
+  const char *name)
+{
+  GSTreeNode	*n = calloc(1, sizeof(GSTreeNode));
+
+  if (n != 0)
+    {
+      n->parent = parent;
+      n->pending = 1;
+      n->src = (0 == name) ? strdup(src) : treePath(src, name);
+      if (dst != 0)
+	{
+	  n->dst = (0 == name) ? strdup(dst) : treePath(dst, name);
+	}
+      if (0 == n->src || (dst != 0 && 0 == n->dst))
+	{
+	  free(n->src);
+	  free(n->dst);
+	  free(n);
+	  n = 0;
+	}
+    }
+  return n;
+}
+
+/* Queues a subdirectory to be scanned, starting another thread if none
+ * is waiting for work and the pool is not yet full.
+ */
+static void
+treeQueue(GSTreeWalk *w, GSTreeNode *n)
+{
+  pthread_mutex_lock(&w->lock);
+  n->parent->pending++;
+  n->next = w->queue;
+  w->queue = n;
+  if (w->idle > 0)
+    {
+      pthread_cond_signal(&w->cond);
+    }
+  else if (w->started + 1 < w->limit)
+    {
+      if (pthread_create(&w->threads[w->started], 0, treeWorker, w) == 0)
+	{
+	  w->started++;
+	}
+    }
+  pthread_mutex_unlock(&w->lock);
+}
+
+/* Drops a count from the node, and once nothing is pending removes the
+ * directory (or sets the attributes of the copy) and does the same for
+ * its parent.  The top directory of a copy has its attributes set by
+ * the caller.  As in a serial copy, failing to set attributes is not
+ * treated as an error.
+ */
+static void
+treeRelease(GSTreeWalk *w, GSTreeNode *n)
+{
+  while (n != 0)
+    {
+      GSTreeNode	*parent = n->parent;
+      unsigned		left;
+      BOOL		failed;
+
+      pthread_mutex_lock(&w->lock);
+      left = --n->pending;
+      failed = (w->error != 0) ? YES : NO;
+      pthread_mutex_unlock(&w->lock);
+      if (left > 0)
+	{
+	  return;
+	}
+      if (NO == failed)
+	{
+	  if (NO == w->copying)
+	    {
+	      if (rmdir(n->src) != 0)
+		{
+		  treeFail(w, errno, "cannot remove directory", n->src, 0);
+		}
+	    }
+	  else if (parent != 0)
+	    {
+	      struct timespec	ts[2];
+
+	      ts[0].tv_sec = 0;
+	      ts[0].tv_nsec = UTIME_OMIT;
+	      ts[1].tv_sec = n->st.st_mtime;
+	      ts[1].tv_nsec = 0;
+	      if (chmod(n->dst, n->st.st_mode & 07777) == 0)
+		{
+		  utimensat(AT_FDCWD, n->dst, ts, 0);
+		}
+	    }
+	}
+      free(n->src);
+      free(n->dst);
+      free(n);
+      if (0 == parent)
+	{
+	  pthread_mutex_lock(&w->lock);
+	  w->finished = YES;
+	  pthread_cond_broadcast(&w->cond);
+	  pthread_mutex_unlock(&w->lock);
+	}
+      n = parent;
+    }
+}
+
+static BOOL
+treeCopyFile(GSTreeWalk *w, GSTreeNode *n, int sfd, int dfd,
+  const char *name)
+{
+  unsigned long long	pos = 0;
+  unsigned long long	size;
+  struct stat		st;
+  struct stat		now;
+  struct timespec	ts[2];
+  int			how = GSCopyRange;
+  int			in;
+  int			out;
+
+  in = openat(sfd, name, GSBINIO|O_RDONLY|O_NOFOLLOW|TREE_CLOEXEC);
+  if (in < 0 || fstat(in, &st) != 0)
+    {
+      treeFail(w, errno, "cannot open file for reading", n->src, name);
+      if (in >= 0)
+	{
+	  close(in);
+	}
+      return NO;
+    }
+  out = openat(dfd, name, GSBINIO|O_WRONLY|O_CREAT|O_TRUNC|TREE_CLOEXEC,
+    st.st_mode & 07777);
+  if (out < 0)
+    {
+      treeFail(w, errno, "cannot open file for writing", n->dst, name);
+      close(in);
+      return NO;
+    }
+  size = st.st_size;
+#if	defined(__linux__)
+  if (size > 0 && ioctl(out, FICLONE, in) == 0)
+    {
+      pos = size;
+    }
+#endif
+  while (pos < size)
+    {
+      unsigned long long	want = size - pos;
+      NSInteger			done;
+
+      done = GSPrivateCopyDescriptor(in, &pos, out,
+	(want > 0x40000000) ? 0x40000000 : (NSUInteger)want, &how);
+      if (done <= 0)
+	{
+	  if (0 == done)
+	    {
+	      break;	// End of input file
+	    }
+	  treeFail(w, errno, "cannot copy file data", n->dst, name);
+	  close(in);
+	  close(out);
+	  return NO;
+	}
+    }
+
+  /* Check for modification during copy.
+   */
+  if (fstat(in, &now) != 0 || now.st_mtime != st.st_mtime
+    || now.st_size != st.st_size)
+    {
+      treeFail(w, 0, "source modified during copy", n->dst, name);
+      close(in);
+      close(out);
+      return NO;
+    }
+
+  /* Set the attributes a serial copy would.
+   */
+  if (fchmod(out, st.st_mode & 07777) != 0
+    || (YES == w->owner && st.st_uid != geteuid()
+    && fchown(out, st.st_uid, -1) != 0))
+    {
+      ;	// Failures are ignored, as they are in a serial copy.
+    }
+  ts[0].tv_sec = 0;
+  ts[0].tv_nsec = UTIME_OMIT;
+  ts[1].tv_sec = st.st_mtime;
+  ts[1].tv_nsec = 0;
+  futimens(out, ts);
+  close(in);
+  close(out);
+  return YES;
+}
+
+/* Reads one directory, removing or copying everything in it other than
+ * subdirectories, which are queued.
+ */
+static void
+treeScan(GSTreeWalk *w, GSTreeNode *n)
+{
+  struct dirent	*e;
+  DIR		*d = 0;
+  int		sfd;
+  int		dfd = -1;
+
+  if (YES == treeFailed(w))
+    {
+      return;
+    }
+  sfd = open(n->src, O_RDONLY|O_DIRECTORY|O_NOFOLLOW|TREE_CLOEXEC);
+  if (sfd < 0 || (d = fdopendir(sfd)) == 0)
+    {
+      treeFail(w, errno, "cannot open directory", n->src, 0);
+      if (sfd >= 0)
+	{
+	  close(sfd);
+	}
+      return;
+    }
+  if (YES == w->copying
+    && (dfd = open(n->dst, O_RDONLY|O_DIRECTORY|TREE_CLOEXEC)) < 0)
+    {
+      treeFail(w, errno, "cannot open directory", n->dst, 0);
+      closedir(d);
+      return;
+    }
+
+  while ((e = readdir(d)) != 0)
+    {
+      const char	*name = e->d_name;
+      unsigned		type = e->d_type;
+      struct stat	st;
+
+      if ('.' == name[0]
+	&& (0 == name[1] || ('.' == name[1] && 0 == name[2])))
+	{
+	  continue;
+	}
+
+      /* Only stat an entry if the directory did not record its type,
+       * or if we need the attributes of a directory being copied.
+       */
+      if (DT_UNKNOWN == type || (DT_DIR == type && YES == w->copying))
+	{
+	  if (fstatat(sfd, name, &st, AT_SYMLINK_NOFOLLOW) != 0)
+	    {
+	      treeFail(w, errno, "cannot get file attributes", n->src, name);
+	      break;
+	    }
+	  type = IFTODT(st.st_mode);
+	}
+
+      if (DT_DIR == type)
+	{
+	  GSTreeNode	*c;
+
+	  if (YES == w->copying && mkdirat(dfd, name, 0700) != 0)
+	    {
+	      treeFail(w, errno, "cannot create directory", n->dst, name);
+	      break;
+	    }
+	  c = treeNode(n, n->src, n->dst, name);
+	  if (0 == c)
+	    {
+	      treeFail(w, ENOMEM, "cannot allocate memory", n->src, name);
+	      break;
+	    }
+	  if (YES == w->copying)
+	    {
+	      c->st = st;
+	    }
+	  treeQueue(w, c);
+	}
+      else if (NO == w->copying)
+	{
+	  if (unlinkat(sfd, name, 0) != 0)
+	    {
+	      treeFail(w, errno, "cannot remove file", n->src, name);
+	      break;
+	    }
+	}
+      else if (DT_REG == type)
+	{
+	  if (NO == treeCopyFile(w, n, sfd, dfd, name))
+	    {
+	      break;
+	    }
+	}
+      else if (DT_LNK == type)
+	{
+	  char		buf[PATH_MAX + 1];
+	  ssize_t	len;
+
+	  len = readlinkat(sfd, name, buf, PATH_MAX);
+	  if (len < 0)
+	    {
+	      treeFail(w, errno, "cannot read symbolic link", n->src, name);
+	      break;
+	    }
+	  buf[len] = '\0';
+	  if (symlinkat(buf, dfd, name) != 0)
+	    {
+	      treeFail(w, errno, "cannot create symbolic link", n->dst, name);
+	      break;
+	    }
+	}
+      /* Other types of file are skipped, as they are in a serial copy.
+       */
+    }
+  closedir(d);
+  if (dfd >= 0)
+    {
+      close(dfd);
+    }
+}
+
+static void *
+treeWorker(void *arg)
+{
+  GSTreeWalk	*w = (GSTreeWalk*)arg;
+
+  pthread_mutex_lock(&w->lock);
+  while (NO == w->finished)
+    {
+      GSTreeNode	*n = w->queue;
+
+      if (0 == n)
+	{
+	  w->idle++;
+	  pthread_cond_wait(&w->cond, &w->lock);
+	  w->idle--;
+	  continue;
+	}
+      w->queue = n->next;
+      pthread_mutex_unlock(&w->lock);
+      treeScan(w, n);
+      treeRelease(w, n);
+      pthread_mutex_lock(&w->lock);
+    }
+  pthread_mutex_unlock(&w->lock);
+  return 0;
+}
+
+/* The number of threads to use for a tree.  Most of the time is spent
+ * waiting for the filesystem, so use at least a few even on a machine
+ * with a single processor.
+ */
+static unsigned
+treeThreads()
+{
+  static unsigned	threads = 0;
+
+  if (0 == threads)
+    {
+      NSUInteger	n;
+
+      n = [[NSProcessInfo processInfo] activeProcessorCount];
+      threads = (n < 4) ? 4 : ((n > GS_TREE_THREADS) ? GS_TREE_THREADS : n);
+    }
+  return threads;
+}
+
+/* Removes the directory tree at src, or copies its contents into the
+ * existing directory dst.  Returns zero on success, otherwise the errno
+ * of the first failure, with a description of what failed in *reason
+ * and the path at which it failed in *path (which must be freed if it
+ * is not NULL).
+ */
+static int
+treeWalk(const char *src, const char *dst, const char **reason, char **path)
+{
+  GSTreeWalk	w;
+  GSTreeNode	*root;
+  unsigned	i;
+
+  *reason = 0;
+  *path = 0;
+  if ((root = treeNode(0, src, dst, 0)) == 0)
+    {
+      *reason = "cannot allocate memory";
+      return ENOMEM;
+    }
+  memset(&w, '\0', sizeof(w));
+  pthread_mutex_init(&w.lock, 0);
+  pthread_cond_init(&w.cond, 0);
+  w.limit = treeThreads();
+  w.copying = (dst != 0) ? YES : NO;
+  w.owner = (0 == geteuid()) ? YES : NO;
+  w.queue = root;
+
+  /* The calling thread works too, and only returns once the tree is done.
+   */
+  treeWorker(&w);
+  for (i = 0; i < w.started; i++)
+    {
+      pthread_join(w.threads[i], 0);
+    }
+  pthread_cond_destroy(&w.cond);
+  pthread_mutex_destroy(&w.lock);
+  *reason = w.reason;
+  *path = w.path;
+  return w.error;
+}
+
+/*
+ * Directory prefetching.
+ * A GSTreePrefetch reads a tree in a background thread, in the order
+ * an NSDirectoryEnumerator would, and keeps a ring of the relative paths
+ * of the entries it has found for the enumerator to take.  When the
+ * enumerator skips the descendents of a directory it tells the reader,
+ * which stops reading that directory, and discards any of its entries
+ * already in the ring.
+ */
+typedef struct {
+  char		*rel;		// Path relative to the top directory
+  BOOL		isDir;		// Read as a directory
+} GSTreeEntry;
+
+typedef struct {
+  DIR		*dir;
+  char		*rel;
+} GSTreeFrame;
+
+typedef struct {
+  pthread_mutex_t	lock;
+  pthread_cond_t	cond;
+  pthread_t		thread;
+  char			*top;
+  GSTreeEntry		*ring;
+  unsigned		size;
+  unsigned		head;
+  unsigned		count;
+  char			*skip;		// Directory being skipped
+  BOOL			follow;
+  BOOL			done;		// Reader has finished
+  BOOL			cancelled;	// Enumerator has gone
+} GSTreePrefetch;
+
+/* Returns YES if rel is the directory dir or within it.  Everything is
+ * within the top directory (an empty path).
+ */
+static BOOL
+treeWithin(const char *rel, const char *dir)
+{
+  size_t	l = strlen(dir);
+
+  if (0 == l)
+    {
+      return YES;
+    }
+  if (strncmp(rel, dir, l) == 0 && ('/' == rel[l] || '\0' == rel[l]))
+    {
+      return YES;
+    }
+  return NO;
+}
+
+static void *
+treePrefetch(void *arg)
+{
+  GSTreePrefetch	*p = (GSTreePrefetch*)arg;
+  GSTreeFrame		*stack = 0;
+  unsigned		depth = 0;
+  unsigned		capacity = 0;
+  DIR			*d = 0;
+  int			fd;
+
+  fd = open(p->top, O_RDONLY|O_DIRECTORY|TREE_CLOEXEC);
+  if (fd >= 0 && (d = fdopendir(fd)) == 0)
+    {
+      close(fd);
+    }
+  if (d != 0)
+    {
+      capacity = 16;
+      stack = malloc(capacity * sizeof(GSTreeFrame));
+      if (0 == stack || 0 == (stack[0].rel = strdup("")))
+	{
+	  closedir(d);
+	}
+      else
+	{
+	  stack[0].dir = d;
+	  depth = 1;
+	}
+    }
+
+  while (depth > 0)
+    {
+      GSTreeFrame	*f = &stack[depth - 1];
+      struct dirent	*e = readdir(f->dir);
+      const char	*name;
+      unsigned		type;
+      GSTreeEntry	entry;
+      BOOL		stop = NO;
+
+      if (0 == e)
+	{
+	  closedir(f->dir);
+	  free(f->rel);
+	  depth--;
+	  continue;
+	}
+      name = e->d_name;
+      if ('.' == name[0]
+	&& (0 == name[1] || ('.' == name[1] && 0 == name[2])))
+	{
+	  continue;
+	}
+      entry.rel = ('\0' == *f->rel) ? strdup(name) : treePath(f->rel, name);
+      if (0 == entry.rel)
+	{
+	  break;
+	}
+
+      /* Only stat an entry if the directory did not record its type, or
+       * if it is a link which we follow.
+       */
+      type = e->d_type;
+      if (DT_UNKNOWN == type || (DT_LNK == type && YES == p->follow))
+	{
+	  struct stat	st;
+
+	  if (fstatat(dirfd(f->dir), name, &st,
+	    (YES == p->follow) ? 0 : AT_SYMLINK_NOFOLLOW) == 0)
+	    {
+	      type = IFTODT(st.st_mode);
+	    }
+	}
+      entry.isDir = (DT_DIR == type) ? YES : NO;
+
+      /* Open a subdirectory before handing its entry over, as the
+       * enumerator owns the entry from then on.
+       */
+      if (YES == entry.isDir)
+	{
+	  int	flags = O_RDONLY|O_DIRECTORY|TREE_CLOEXEC;
+	  char	*rel = strdup(entry.rel);
+
+	  if (NO == p->follow)
+	    {
+	      flags |= O_NOFOLLOW;
+	    }
+	  d = 0;
+	  if (rel != 0 && (fd = openat(dirfd(f->dir), name, flags)) >= 0
+	    && (d = fdopendir(fd)) == 0)
+	    {
+	      close(fd);
+	    }
+	  if (d != 0 && depth == capacity)
+	    {
+	      GSTreeFrame	*s;
+
+	      s = realloc(stack, 2 * capacity * sizeof(GSTreeFrame));
+	      if (0 == s)
+		{
+		  closedir(d);
+		  d = 0;
+		}
+	      else
+		{
+		  stack = s;
+		  capacity *= 2;
+		}
+	    }
+	  if (0 == d)
+	    {
+	      free(rel);
+	    }
+	  else
+	    {
+	      stack[depth].dir = d;
+	      stack[depth].rel = rel;
+	      depth++;
+	    }
+	}
+
+      pthread_mutex_lock(&p->lock);
+      while (p->count == p->size && NO == p->cancelled)
+	{
+	  pthread_cond_wait(&p->cond, &p->lock);
+	}
+      if (YES == p->cancelled)
+	{
+	  free(entry.rel);
+	  stop = YES;
+	}
+      else
+	{
+	  p->ring[(p->head + p->count) % p->size] = entry;
+	  p->count++;
+	  pthread_cond_broadcast(&p->cond);
+
+	  /* Stop reading any directory the enumerator has skipped.
+	   */
+	  if (p->skip != 0)
+	    {
+	      while (depth > 0 && YES == treeWithin(stack[depth - 1].rel,
+		p->skip))
+		{
+		  depth--;
+		  closedir(stack[depth].dir);
+		  free(stack[depth].rel);
+		}
+	    }
+	}
+      pthread_mutex_unlock(&p->lock);
+      if (YES == stop)
+	{
+	  break;
+	}
+    }
+
+  while (depth > 0)
+    {
+      depth--;
+      closedir(stack[depth].dir);
+      free(stack[depth].rel);
+    }
+  free(stack);
+  pthread_mutex_lock(&p->lock);
+  p->done = YES;
+  pthread_cond_broadcast(&p->cond);
+  pthread_mutex_unlock(&p->lock);
+  return 0;
+}
+
+static GSTreePrefetch *
+treePrefetchStart(const char *top, NSUInteger count, BOOL follow)
+{
+  GSTreePrefetch	*p = calloc(1, sizeof(GSTreePrefetch));
+
+  if (0 == p)
+    {
+      return 0;
+    }
+  p->size = (count > 1048576) ? 1048576 : (unsigned)count;
+  p->ring = malloc(p->size * sizeof(GSTreeEntry));
+  p->top = strdup(top);
+  p->follow = follow;
+  pthread_mutex_init(&p->lock, 0);
+  pthread_cond_init(&p->cond, 0);
+  if (0 == p->ring || 0 == p->top
+    || pthread_create(&p->thread, 0, treePrefetch, p) != 0)
+    {
+      pthread_cond_destroy(&p->cond);
+      pthread_mutex_destroy(&p->lock);
+      free(p->ring);
+      free(p->top);
+      free(p);
+      return 0;
+    }
+  return p;
+}
+
+static void
+treePrefetchStop(GSTreePrefetch *p)
+{
+  pthread_mutex_lock(&p->lock);
+  p->cancelled = YES;
+  pthread_cond_broadcast(&p->cond);
+  pthread_mutex_unlock(&p->lock);
+  pthread_join(p->thread, 0);
+  while (p->count > 0)
+    {
+      free(p->ring[p->head].rel);
+      p->head = (p->head + 1) % p->size;
+      p->count--;
+    }
+  pthread_cond_destroy(&p->cond);
+  pthread_mutex_destroy(&p->lock);
+  free(p->skip);
+  free(p->ring);
+  free(p->top);
+  free(p);
+}
+
+@interface	GSPrefetchingDirectoryEnumerator : NSDirectoryEnumerator
+{
+  GSTreePrefetch	*_prefetch;
+  char			*_last;		// Last path returned or skipped
+  BOOL			_lastIsDir;
+}
+- (id) initWithDirectoryPath: (NSString*)path
+		    prefetch: (NSUInteger)count
+			 for: (NSFileManager*)mgr;
+@end
+#endif	/* GS_TREE_WALK */
+
+
 
 
 
@@ -1109,7 +1920,9 @@ static NSStringEncoding	defaultEncoding;
  * [NSObject(NSFileManagerHandler)-fileManager:willProcessPath:] and
  * [NSObject(NSFileManagerHandler)-fileManager:shouldProceedAfterError:]
  * messages.<br />
- * Will not copy to a destination which already exists.
+ * Will not copy to a destination which already exists.<br />
+ * When there is no handler the contents of a directory are copied by a
+ * small pool of threads working on several subdirectories at once.
  */
 - (BOOL) copyPath: (NSString*)source
 	   toPath: (NSString*)destination
@@ -1526,10 +2339,40 @@ static NSStringEncoding	defaultEncoding;
     }
   else
     {
-      NSArray   *contents = [self directoryContentsAtPath: path];
-      unsigned	count = [contents count];
+      NSArray   *contents;
+      unsigned	count;
       unsigned	i;
 
+#if	defined(GS_TREE_WALK)
+      if (nil == handler)
+	{
+	  const char	*reason;
+	  char		*bad;
+	  int		err;
+	  NSString	*s;
+
+	  if ((err = treeWalk(lpath, 0, &reason, &bad)) == 0)
+	    {
+	      return YES;
+	    }
+	  errno = err;
+	  s = [NSString stringWithFormat: @"%s '%@' - %@", reason,
+	    bad ? [self stringWithFileSystemRepresentation: bad
+						    length: strlen(bad)]
+	      : @"(unknown)",
+	    [NSError _last]];
+	  ASSIGN(_lastError, s);
+	  if (bad != 0)
+	    {
+	      free(bad);
+	    }
+	  errno = err;
+	  return NO;
+	}
+#endif
+      contents = [self directoryContentsAtPath: path];
+      count = [contents count];
+
       for (i = 0; i < count; i++)
 	{
 	  NSString		*item;
@@ -2252,6 +3095,25 @@ static NSStringEncoding	defaultEncoding;
 		       for: self]);
 }
 
+- (NSDirectoryEnumerator*) enumeratorAtPath: (NSString*)path
+				   prefetch: (NSUInteger)count
+{
+#if	defined(GS_TREE_WALK)
+  if (count > 0)
+    {
+      NSDirectoryEnumerator	*e;
+
+      e = [[GSPrefetchingDirectoryEnumerator alloc]
+	initWithDirectoryPath: path prefetch: count for: self];
+      if (nil != e)
+	{
+	  return AUTORELEASE(e);
+	}
+    }
+#endif
+  return [self enumeratorAtPath: path];
+}
+
 /**
  * Returns an array containing the (relative) paths of all the items
  * in the directory at path.<br />
@@ -2646,6 +3508,143 @@ static inline void gsedRelease(GSEnumeratedDirectory X)
 
 @end /* NSDirectoryEnumerator */
 
+#if	defined(GS_TREE_WALK)
+@implementation	GSPrefetchingDirectoryEnumerator
+
+- (id) initWithDirectoryPath: (NSString*)path
+		    prefetch: (NSUInteger)count
+			 for: (NSFileManager*)mgr
+{
+  if (nil != (self = [super init]))
+    {
+      _mgr = RETAIN(mgr);
+      _stack = NSZoneMalloc([self zone], sizeof(GSIArray_t));
+      GSIArrayInitWithZoneAndCapacity(_stack, [self zone], 1);
+      _flags.isRecursive = YES;
+      _flags.isFollowing = NO;
+      _flags.justContents = NO;
+      _topPath = [[NSString alloc] initWithString: path];
+      _prefetch = treePrefetchStart(
+	[_mgr fileSystemRepresentationWithPath: path], count, NO);
+      if (0 == _prefetch)
+	{
+	  DESTROY(self);
+	}
+    }
+  return self;
+}
+
+- (void) dealloc
+{
+  if (_prefetch != 0)
+    {
+      treePrefetchStop(_prefetch);
+    }
+  free(_last);
+  [super dealloc];
+}
+
+- (id) nextObject
+{
+  GSTreePrefetch	*p = _prefetch;
+  NSString		*name = nil;
+
+  DESTROY(_currentFilePath);
+  while (nil == name)
+    {
+      GSTreeEntry	entry;
+
+      entry.rel = 0;
+      pthread_mutex_lock(&p->lock);
+      while (0 == p->count && NO == p->done)
+	{
+	  pthread_cond_wait(&p->cond, &p->lock);
+	}
+      while (p->count > 0)
+	{
+	  entry = p->ring[p->head];
+	  p->head = (p->head + 1) % p->size;
+	  p->count--;
+	  pthread_cond_broadcast(&p->cond);
+	  if (p->skip != 0)
+	    {
+	      if (YES == treeWithin(entry.rel, p->skip))
+		{
+		  free(entry.rel);
+		  entry.rel = 0;
+		  continue;
+		}
+	      free(p->skip);
+	      p->skip = 0;
+	    }
+	  break;
+	}
+      if (0 == entry.rel && 0 == p->count && NO == p->done)
+	{
+	  pthread_mutex_unlock(&p->lock);
+	  continue;	// Discarded all we had ... wait for more.
+	}
+      pthread_mutex_unlock(&p->lock);
+      if (0 == entry.rel)
+	{
+	  return nil;	// Finished
+	}
+      free(_last);
+      _last = entry.rel;
+      _lastIsDir = entry.isDir;
+      /* if we have a null FileName something went wrong (charset?)
+       * and we skip it */
+      name = [_mgr stringWithFileSystemRepresentation: entry.rel
+					       length: strlen(entry.rel)];
+    }
+  _currentFilePath = RETAIN([_topPath stringByAppendingPathComponent: name]);
+  return name;
+}
+
+/* As in a normal enumerator, this skips the contents of the directory
+ * last returned, or if that was not a directory, the rest of the
+ * directory it was in.
+ */
+- (void) skipDescendents
+{
+  GSTreePrefetch	*p = _prefetch;
+  char			*dir;
+
+  if (0 == _last)
+    {
+      dir = strdup("");
+    }
+  else
+    {
+      if (NO == _lastIsDir)
+	{
+	  char	*s = strrchr(_last, '/');
+
+	  if (0 == s)
+	    {
+	      s = _last;
+	    }
+	  *s = '\0';
+	}
+      dir = _last;
+      _last = 0;
+    }
+  if (0 == dir)
+    {
+      return;
+    }
+  pthread_mutex_lock(&p->lock);
+  free(p->skip);
+  p->skip = dir;
+  pthread_mutex_unlock(&p->lock);
+  _last = strdup(dir);
+  _lastIsDir = NO;
+  DESTROY(_currentFilePath);
+}
+
+@end /* GSPrefetchingDirectoryEnumerator */
+#endif	/* GS_TREE_WALK */
+
 /**
  * Convenience methods for accessing named file attributes in a dictionary.
  */
@@ -2833,14 +3832,11 @@ static inline void gsedRelease(GSEnumeratedDirectory X)
   NSDictionary	*attributes;
   NSDate        *modification;
   unsigned long long	fileSize;
-  unsigned long long	i;
-  int		bufsize = 8096;
+  unsigned long long	pos = 0;
   int		sourceFd;
   int		destFd;
   int		fileMode;
-  int		rbytes;
-  int		wbytes;
-  char		buffer[bufsize];
+  int		how = GSCopyRange;
 
   attributes = [self fileAttributesAtPath: source traverseLink: NO];
   if (nil == attributes)
@@ -2882,14 +3878,27 @@ static inline void gsedRelease(GSEnumeratedDirectory X)
 				       toPath: destination];
     }
 
-  /* Read bufsize bytes from source file and write them into the destination
-     file. In case of errors call the handler and abort the operation. */
-  for (i = 0; i < fileSize; i += rbytes)
+  /* Make the destination share the data of the source if the filesystem
+   * supports that, otherwise have the kernel copy the data (falling back
+   * to reading and writing through a buffer where it cannot).
+   * In case of errors call the handler and abort the operation.
+   */
+#if	defined(__linux__)
+  if (fileSize > 0 && ioctl(destFd, FICLONE, sourceFd) == 0)
+    {
+      pos = fileSize;
+    }
+#endif
+  while (pos < fileSize)
     {
-      rbytes = read (sourceFd, buffer, bufsize);
-      if (rbytes <= 0)
+      unsigned long long	want = fileSize - pos;
+      NSInteger			done;
+
+      done = GSPrivateCopyDescriptor(sourceFd, &pos, destFd,
+	(want > 0x40000000) ? 0x40000000 : (NSUInteger)want, &how);
+      if (done <= 0)
 	{
-          if (0 == rbytes)
+          if (0 == done)
             {
               break;    // End of input file
             }
@@ -2897,24 +3906,11 @@ static inline void gsedRelease(GSEnumeratedDirectory X)
           close (destFd);
 
           return [self _proceedAccordingToHandler: handler
-					 forError: @"cannot read from file"
-					   inPath: source
-					 fromPath: source
-					   toPath: destination];
-	}
-
-      wbytes = write (destFd, buffer, rbytes);
-      if (wbytes != rbytes)
-	{
-          close (sourceFd);
-          close (destFd);
-
-          return [self _proceedAccordingToHandler: handler
-					 forError: @"cannot write to file"
+					 forError: @"cannot copy file data"
 					   inPath: destination
 					 fromPath: source
 					   toPath: destination];
-        }
+	}
     }
   close (sourceFd);
   close (destFd);
@@ -2943,6 +3939,35 @@ static inline void gsedRelease(GSEnumeratedDirectory X)
   NSString		*dirEntry;
   CREATE_AUTORELEASE_POOL(pool);
 
+#if	defined(GS_TREE_WALK)
+  if (nil == handler)
+    {
+      const char	*reason;
+      char		*bad;
+      int		err;
+
+      err = treeWalk([self fileSystemRepresentationWithPath: source],
+	[self fileSystemRepresentationWithPath: destination], &reason, &bad);
+      if (err != 0)
+	{
+	  NSString	*s;
+
+	  errno = err;
+	  s = [NSString stringWithFormat: @"%s '%@' - %@", reason,
+	    bad ? [self stringWithFileSystemRepresentation: bad
+						    length: strlen(bad)]
+	      : @"(unknown)",
+	    [NSError _last]];
+	  ASSIGN(_lastError, s);
+	  if (bad != 0)
+	    {
+	      free(bad);
+	    }
+	}
+      RELEASE(pool);
+      return (0 == err) ? YES : NO;
+    }
+#endif
   enumerator = [self enumeratorAtPath: source];
   while ((dirEntry = [enumerator nextObject]))
     {
@@ -52,10 +52,42 @@
 #include "GNUstepBase/GSIMap.h"
 
 
+/* The keys and values of the object currently being encoded, as indices
+ * of objects already written to the property list.  Once an object has
+ * more than a few keys they are also put in a hash table (mask is zero
+ * while there is none) so that duplicates are found quickly.
+ */
+typedef struct {
+  NSUInteger	*keys;
+  NSUInteger	*values;
+  NSUInteger	count;
+  NSUInteger	capacity;
+  NSUInteger	*table;
+  NSUInteger	tableCapacity;
+  NSUInteger	mask;
+} GSKeyedRecord;
+
+#define	GS_RECORD_SCAN	8
+
+#define	GS_NSKeyedArchiver_IVARS \
+  GSBinaryPLWriter	*writer;	/* Output being built.		*/ \
+  NSUInteger		*uids;		/* Property list index by UID.	*/ \
+  NSUInteger		uidCount; \
+  NSUInteger		uidCapacity; \
+  GSKeyedRecord		*records;	/* Objects being encoded.	*/ \
+  NSUInteger		depth; \
+  NSUInteger		recordCapacity; \
+  NSUInteger		*positional;	/* Indices of "$n" keys.	*/ \
+  NSUInteger		positionalCount;
+
 #define	_IN_NSKEYEDARCHIVER_M	1
 #import "Foundation/NSKeyedArchiver.h"
 #undef	_IN_NSKEYEDARCHIVER_M
 
+#define	GSInternal	NSKeyedArchiverInternal
+#include	"GSInternal.h"
+GS_PRIVATE_INTERNAL(NSKeyedArchiver)
+
 /* Exceptions */
 
 /**
@@ -101,7 +133,18 @@ setupCache(void)
     }
 }
 
+#define	CHECKWRITER \
+  if (internal->writer == 0) \
+    { \
+      [NSException raise: NSInvalidArchiveOperationException \
+		  format: @"%@, encoding finished in %@", \
+	NSStringFromClass([self class]), NSStringFromSelector(_cmd)]; \
+    }
+
 #define	CHECKKEY \
+  NSUInteger	keyRef; \
+  \
+  CHECKWRITER \
   if ([aKey isKindOfClass: [NSString class]] == NO) \
     { \
       [NSException raise: NSInvalidArgumentException \
@@ -112,28 +155,106 @@ setupCache(void)
     { \
       aKey = [@"$" stringByAppendingString: aKey]; \
     } \
-  if ([_enc objectForKey: aKey] != nil) \
+  keyRef = GSPrivateBinaryPLWriteObject(internal->writer, aKey); \
+  if (recordHasKey(internal->records + internal->depth, keyRef)) \
     { \
       [NSException raise: NSInvalidArgumentException \
 		  format: @"%@, duplicate key '%@' in %@", \
 	NSStringFromClass([self class]), aKey, NSStringFromSelector(_cmd)]; \
     }
 
-/*
- * Make a dictionary referring to the object at ref in the array of all objects.
+/* The value for a key is written as soon as it is encoded, and the
+ * record for the object only holds the indices of the key and value.
  */
-static NSDictionary *makeReference(unsigned ref)
+#define	RECORD(V) \
+  recordAdd(internal->records + internal->depth, keyRef, (V))
+
+static inline NSUInteger
+recordSlot(GSKeyedRecord *r, NSUInteger key)
 {
-  NSNumber	*n;
-  NSDictionary	*d;
+  NSUInteger	h = (key ^ (key >> 7)) & r->mask;
 
-  n = [NSNumber numberWithUnsignedInt: ref];
-  d = [NSDictionary dictionaryWithObject: n forKey:  @"CF$UID"];
-  return d;
+  while (r->table[h] != 0 && r->table[h] != key + 1)
+    {
+      h = (h + 1) & r->mask;
+    }
+  return h;
+}
+
+/* Builds the hash table from the keys, making it at least twice as large
+ * as the number of keys.
+ */
+static void
+recordRehash(GSKeyedRecord *r)
+{
+  NSUInteger	size = 32;
+  NSUInteger	i;
+
+  while (size < r->count * 4)
+    {
+      size <<= 1;
+    }
+  if (size > r->tableCapacity)
+    {
+      r->tableCapacity = size;
+      r->table = NSZoneRealloc(NSDefaultMallocZone(), r->table,
+	size * sizeof(NSUInteger));
+    }
+  r->mask = size - 1;
+  memset(r->table, 0, size * sizeof(NSUInteger));
+  for (i = 0; i < r->count; i++)
+    {
+      r->table[recordSlot(r, r->keys[i])] = r->keys[i] + 1;
+    }
+}
+
+static inline BOOL
+recordHasKey(GSKeyedRecord *r, NSUInteger key)
+{
+  NSUInteger	i;
+
+  if (r->mask != 0)
+    {
+      return (r->table[recordSlot(r, key)] != 0) ? YES : NO;
+    }
+  for (i = 0; i < r->count; i++)
+    {
+      if (r->keys[i] == key)
+	{
+	  return YES;
+	}
+    }
+  return NO;
+}
+
+static void
+recordAdd(GSKeyedRecord *r, NSUInteger key, NSUInteger value)
+{
+  if (r->count == r->capacity)
+    {
+      r->capacity = (0 == r->capacity) ? 8 : r->capacity * 2;
+      r->keys = NSZoneRealloc(NSDefaultMallocZone(), r->keys,
+	r->capacity * sizeof(NSUInteger));
+      r->values = NSZoneRealloc(NSDefaultMallocZone(), r->values,
+	r->capacity * sizeof(NSUInteger));
+    }
+  r->keys[r->count] = key;
+  r->values[r->count] = value;
+  r->count++;
+  if (r->mask != 0 && r->count * 2 <= r->mask)
+    {
+      r->table[recordSlot(r, key)] = key + 1;
+    }
+  else if (r->count > GS_RECORD_SCAN)
+    {
+      recordRehash(r);
+    }
 }
 
 @interface	NSKeyedArchiver (Private)
-- (id) _encodeObject: (id)anObject conditional: (BOOL)conditional;
+- (NSUInteger) _encodeObject: (id)anObject conditional: (BOOL)conditional;
+- (NSUInteger) _newUID: (NSUInteger)index;
+- (NSUInteger) _positionalKey;
 @end
 
 @implementation	NSKeyedArchiver (Internal)
@@ -143,52 +264,59 @@ static NSDictionary *makeReference(unsigned ref)
  */
 - (void) _encodeArrayOfObjects: (NSArray*)anArray forKey: (NSString*)aKey
 {
-  id		o;
+  GSBinaryPLWriter	*w;
   CHECKKEY
 
+  w = internal->writer;
   if (anArray == nil)
     {
-      o = makeReference(0);
+      RECORD(GSPrivateBinaryPLWriteUID(w, 0));
     }
   else
     {
-      NSMutableArray	*m;
       unsigned		c;
       unsigned		i;
 
       c = [anArray count];
-      m = [NSMutableArray arrayWithCapacity: c];
-      for (i = 0; i < c; i++)
-	{
-	  o = [self _encodeObject: [anArray objectAtIndex: i] conditional: NO];
-	  [m addObject: o];
-	}
-      o = m;
+      {
+	GS_BEGINIDBUF(objects, c);
+	GS_BEGINITEMBUF2(refs, c, NSUInteger)
+
+	[anArray getObjects: objects];
+	for (i = 0; i < c; i++)
+	  {
+	    NSUInteger	uid;
+
+	    uid = [self _encodeObject: objects[i] conditional: NO];
+	    refs[i] = GSPrivateBinaryPLWriteUID(w, uid);
+	  }
+	RECORD(GSPrivateBinaryPLWriteArray(w, refs, c));
+	GS_ENDITEMBUF2();
+	GS_ENDIDBUF();
+      }
     }
-  [_enc setObject: o forKey: aKey];
 }
 
 - (void) _encodePropertyList: (id)anObject forKey: (NSString*)aKey
 {
   CHECKKEY
-  [_enc setObject: anObject forKey: aKey];
+  RECORD(GSPrivateBinaryPLWriteObject(internal->writer, anObject));
 }
 @end
 
 @implementation	NSKeyedArchiver (Private)
 /*
  * The real workhorse of the archiving process ... this deals with all
- * archiving of objects. It returns the object to be stored in the
- * mapping dictionary (_enc).
+ * archiving of objects. It returns the UID of the encoded object, which
+ * is its position in the table of all objects.
  */
-- (id) _encodeObject: (id)anObject conditional: (BOOL)conditional
+- (NSUInteger) _encodeObject: (id)anObject conditional: (BOOL)conditional
 {
   id			original = anObject;
   GSIMapNode		node;
-  id			objectInfo = nil;	// Encoded object
-  NSMutableDictionary	*m = nil;
-  NSDictionary		*refObject;
-  unsigned		ref = 0;		// Reference to nil
+  BOOL			encoded = NO;
+  BOOL			isRecord = NO;
+  NSUInteger		ref = 0;		// Reference to nil
 
   if (anObject != nil)
     {
@@ -235,14 +363,13 @@ static NSDictionary *makeReference(unsigned ref)
 	      node = GSIMapNodeForKey(_cIdMap, (GSIMapKey)anObject);
 	      if (node == 0)
 		{
-		  ref = [_obj count];
-		  GSIMapAddPair(_cIdMap,
-		    (GSIMapKey)anObject, (GSIMapVal)(NSUInteger)ref);
 		  /*
 		   * Use the null object as a placeholder for a conditionally
 		   * encoded object.
 		   */
-		  [_obj addObject: [_obj objectAtIndex: 0]];
+		  ref = [self _newUID: internal->uids[0]];
+		  GSIMapAddPair(_cIdMap,
+		    (GSIMapKey)anObject, (GSIMapVal)ref);
 		}
 	      else
 		{
@@ -263,38 +390,39 @@ static NSDictionary *makeReference(unsigned ref)
 	        || c == [NSData class]
 		)
 		{
-		  objectInfo = anObject;
+		  isRecord = NO;
 		}
 	      else
 		{
 		  // We store a dictionary describing the object.
-		  m = [NSMutableDictionary new];
-		  objectInfo = m;
+		  isRecord = YES;
 		}
 
 	      node = GSIMapNodeForKey(_cIdMap, (GSIMapKey)anObject);
 	      if (node == 0)
 		{
 		  /*
-		   * Not encoded ... create dictionary for it.
+		   * Not encoded ... allocate a UID for it.
 		   */
-		  ref = [_obj count];
-		  GSIMapAddPair(_uIdMap,
-		    (GSIMapKey)anObject, (GSIMapVal)(NSUInteger)ref);
-		  [_obj addObject: objectInfo];
+		  ref = [self _newUID: internal->uids[0]];
 		}
 	      else
 		{
 		  /*
-		   * Conditionally encoded ... replace with actual value.
+		   * Conditionally encoded ... the actual value replaces
+		   * the placeholder.
 		   */
 		  ref = node->value.nsu;
-		  GSIMapAddPair(_uIdMap,
-		    (GSIMapKey)anObject, (GSIMapVal)(NSUInteger)ref);
 		  GSIMapRemoveKey(_cIdMap, (GSIMapKey)anObject);
-		  [_obj replaceObjectAtIndex: ref withObject: objectInfo];
 		}
-	      RELEASE(m);
+	      GSIMapAddPair(_uIdMap,
+		(GSIMapKey)anObject, (GSIMapVal)ref);
+	      if (NO == isRecord)
+		{
+		  internal->uids[ref] = GSPrivateBinaryPLWriteObject(
+		    internal->writer, anObject);
+		}
+	      encoded = YES;
 	    }
 	}
       else
@@ -304,20 +432,17 @@ static NSDictionary *makeReference(unsigned ref)
     }
 
   /*
-   * Build an object to reference the encoded value of anObject
+   * If the object is not stored directly, we write a dictionary
+   * describing it.
    */
-  refObject = makeReference(ref);
-
-  /*
-   * objectInfo is a dictionary describing the object.
-   */
-  if (objectInfo != nil && m == objectInfo)
+  if (YES == isRecord)
     {
-      NSMutableDictionary	*savedEnc = _enc;
-      unsigned			savedKeyNum = _keyNum;
-      Class			c = [anObject class];
-      NSString			*classname;
-      Class			mapped;
+      unsigned		savedKeyNum = _keyNum;
+      Class		c = [anObject class];
+      NSString		*classname;
+      Class		mapped;
+      GSKeyedRecord	*r;
+      NSUInteger	classRef;
 
       /*
        * Map the class of the object to the actual class it is encoded as.
@@ -344,14 +469,23 @@ static NSDictionary *makeReference(unsigned ref)
 	}
 
       /*
-       * At last, get the object to encode itself.  Save and restore the
-       * current object scope of course.
+       * At last, get the object to encode itself.  Each level of nesting
+       * has its own record, whose buffers are reused for later objects.
        */
-      _enc = m;
+      if (++internal->depth == internal->recordCapacity)
+	{
+	  internal->recordCapacity *= 2;
+	  internal->records = NSZoneRealloc(NSDefaultMallocZone(),
+	    internal->records, internal->recordCapacity * sizeof(GSKeyedRecord));
+	  memset(internal->records + internal->depth, 0,
+	    (internal->recordCapacity - internal->depth)
+	    * sizeof(GSKeyedRecord));
+	}
+      internal->records[internal->depth].count = 0;
+      internal->records[internal->depth].mask = 0;
       _keyNum = 0;
       [anObject encodeWithCoder: self];
       _keyNum = savedKeyNum;
-      _enc = savedEnc;
 
       /*
        * This is ugly, but it seems to be the way MacOS-X does it ...
@@ -368,63 +502,119 @@ static NSDictionary *makeReference(unsigned ref)
       node = GSIMapNodeForKey(_uIdMap, (GSIMapKey)c);
       if (node == 0)
 	{
-	  NSMutableDictionary	*cDict;
-	  NSMutableArray	*hierarchy;
-
-	  ref = [_obj count];
-	  GSIMapAddPair(_uIdMap,
-	    (GSIMapKey)c, (GSIMapVal)(NSUInteger)ref);
-	  cDict = [[NSMutableDictionary alloc] initWithCapacity: 2];
+	  GSBinaryPLWriter	*w = internal->writer;
+	  NSUInteger		keys[2];
+	  NSUInteger		values[2];
+	  NSUInteger		count = 0;
+	  Class			s;
+	  Class			next;
 
 	  /*
-	   * record class name
+	   * Record the class name and the class hierarchy for this object.
 	   */
-	  [cDict setObject: classname forKey: @"$classname"];
-
-	  /*
-	   * Record the class hierarchy for this object.
-	   */
-	  hierarchy = [NSMutableArray new];
-	  while (c != 0)
+	  for (s = c; s != 0; s = next)
 	    {
-	      Class	next = [c superclass];
-
-	      [hierarchy addObject: NSStringFromClass(c)];
-	      if (next == c)
+	      next = [s superclass];
+	      count++;
+	      if (next == s)
 		{
 		  break;
 		}
-	      c = next;
 	    }
-	  [cDict setObject: hierarchy forKey: @"$classes"];
-	  RELEASE(hierarchy);
-	  [_obj addObject: cDict];
-	  RELEASE(cDict);
+	  {
+	    NSUInteger	i;
+	    GS_BEGINITEMBUF(hierarchy, count, NSUInteger)
+
+	    for (i = 0, s = c; i < count; i++, s = [s superclass])
+	      {
+		hierarchy[i] = GSPrivateBinaryPLWriteObject(w,
+		  NSStringFromClass(s));
+	      }
+	    keys[0] = GSPrivateBinaryPLWriteObject(w, @"$classname");
+	    values[0] = GSPrivateBinaryPLWriteObject(w, classname);
+	    keys[1] = GSPrivateBinaryPLWriteObject(w, @"$classes");
+	    values[1] = GSPrivateBinaryPLWriteArray(w, hierarchy, count);
+	    GS_ENDITEMBUF();
+	  }
+	  classRef = [self _newUID:
+	    GSPrivateBinaryPLWriteDictionary(w, keys, values, 2)];
+	  GSIMapAddPair(_uIdMap,
+	    (GSIMapKey)c, (GSIMapVal)classRef);
 	}
       else
 	{
-	  ref = node->value.nsu;
+	  classRef = node->value.nsu;
 	}
 
       /*
-       * Now create a reference to the class information and store it
-       * in the object description dictionary for the object we just encoded.
+       * Now add a reference to the class information to the record
+       * for the object we just encoded, and write the record.
        */
-      [m setObject: makeReference(ref) forKey: @"$class"];
+      r = internal->records + internal->depth;
+      recordAdd(r, GSPrivateBinaryPLWriteObject(internal->writer, @"$class"),
+	GSPrivateBinaryPLWriteUID(internal->writer, classRef));
+      internal->uids[ref] = GSPrivateBinaryPLWriteDictionary(
+	internal->writer, r->keys, r->values, r->count);
+      internal->depth--;
     }
 
   /*
    * If we have encoded the object information, tell the delegaate.
    */
-  if (objectInfo != nil && _delegate != nil)
+  if (encoded == YES && _delegate != nil)
     {
       [_delegate archiver: self didEncodeObject: anObject];
     }
 
   /*
-   * Return the dictionary identifying the encoded object.
+   * Return the UID identifying the encoded object.
    */
-  return refObject;
+  return ref;
+}
+
+/*
+ * Adds an entry to the table of all objects, referring to the property
+ * list object at index.
+ */
+- (NSUInteger) _newUID: (NSUInteger)index
+{
+  if (internal->uidCount == internal->uidCapacity)
+    {
+      internal->uidCapacity *= 2;
+      internal->uids = NSZoneRealloc(NSDefaultMallocZone(), internal->uids,
+	internal->uidCapacity * sizeof(NSUInteger));
+    }
+  internal->uids[internal->uidCount] = index;
+  return internal->uidCount++;
+}
+
+/*
+ * Returns the index of the key used for the next value encoded without
+ * a key ("$0", "$1" and so on).
+ */
+- (NSUInteger) _positionalKey
+{
+  NSUInteger	n = _keyNum++;
+
+  CHECKWRITER
+  if (n >= internal->positionalCount)
+    {
+      NSUInteger	count = internal->positionalCount;
+
+      internal->positionalCount = (n < 16) ? 16 : n * 2;
+      internal->positional = NSZoneRealloc(NSDefaultMallocZone(),
+	internal->positional, internal->positionalCount * sizeof(NSUInteger));
+      while (count < internal->positionalCount)
+	{
+	  internal->positional[count++] = NSNotFound;
+	}
+    }
+  if (NSNotFound == internal->positional[n])
+    {
+      internal->positional[n] = GSPrivateBinaryPLWriteObject(internal->writer,
+	[NSString stringWithFormat: @"$%u", (unsigned)n]);
+    }
+  return internal->positional[n];
 }
 @end
 
@@ -514,8 +704,39 @@ static NSDictionary *makeReference(unsigned ref)
 
 - (void) dealloc
 {
-  RELEASE(_enc);
-  RELEASE(_obj);
+  if (GS_EXISTS_INTERNAL)
+    {
+      NSUInteger	i;
+
+      GSPrivateBinaryPLWriterFree(internal->writer);
+      if (internal->records != 0)
+	{
+	  for (i = 0; i < internal->recordCapacity; i++)
+	    {
+	      GSKeyedRecord	*r = internal->records + i;
+
+	      if (r->keys != 0)
+		{
+		  NSZoneFree(NSDefaultMallocZone(), r->keys);
+		  NSZoneFree(NSDefaultMallocZone(), r->values);
+		}
+	      if (r->table != 0)
+		{
+		  NSZoneFree(NSDefaultMallocZone(), r->table);
+		}
+	    }
+	  NSZoneFree(NSDefaultMallocZone(), internal->records);
+	}
+      if (internal->uids != 0)
+	{
+	  NSZoneFree(NSDefaultMallocZone(), internal->uids);
+	}
+      if (internal->positional != 0)
+	{
+	  NSZoneFree(NSDefaultMallocZone(), internal->positional);
+	}
+      GS_DESTROY_INTERNAL(NSKeyedArchiver);
+    }
   RELEASE(_data);
   if (_clsMap != 0)
     {
@@ -571,7 +792,7 @@ static NSDictionary *makeReference(unsigned ref)
 {
   CHECKKEY
 
-  [_enc setObject: [NSNumber  numberWithBool: aBool] forKey: aKey];
+  RECORD(GSPrivateBinaryPLWriteBool(internal->writer, aBool));
 }
 
 - (void) encodeBytes: (const uint8_t*)aPointer
@@ -580,82 +801,83 @@ static NSDictionary *makeReference(unsigned ref)
 {
   CHECKKEY
 
-  [_enc setObject: [NSData dataWithBytes: aPointer length: length]
-	   forKey: aKey];
+  RECORD(GSPrivateBinaryPLWriteBytes(internal->writer, aPointer, length));
 }
 
 - (void) encodeConditionalObject: (id)anObject
 {
-  NSString	*aKey = [NSString stringWithFormat: @"$%u", _keyNum++];
+  NSUInteger	keyRef = [self _positionalKey];
+  NSUInteger	uid = [self _encodeObject: anObject conditional: YES];
 
-  anObject = [self _encodeObject: anObject conditional: YES];
-  [_enc setObject: anObject forKey: aKey];
+  RECORD(GSPrivateBinaryPLWriteUID(internal->writer, uid));
 }
 
 - (void) encodeConditionalObject: (id)anObject forKey: (NSString*)aKey
 {
+  NSUInteger	uid;
   CHECKKEY
 
-  anObject = [self _encodeObject: anObject conditional: YES];
-  [_enc setObject: anObject forKey: aKey];
+  uid = [self _encodeObject: anObject conditional: YES];
+  RECORD(GSPrivateBinaryPLWriteUID(internal->writer, uid));
 }
 
 - (void) encodeDouble: (double)aDouble forKey: (NSString*)aKey
 {
   CHECKKEY
 
-  [_enc setObject: [NSNumber  numberWithDouble: aDouble] forKey: aKey];
+  RECORD(GSPrivateBinaryPLWriteReal(internal->writer, aDouble));
 }
 
 - (void) encodeFloat: (float)aFloat forKey: (NSString*)aKey
 {
   CHECKKEY
 
-  [_enc setObject: [NSNumber  numberWithFloat: aFloat] forKey: aKey];
+  RECORD(GSPrivateBinaryPLWriteReal(internal->writer, aFloat));
 }
 
 - (void) encodeInt: (int)anInteger forKey: (NSString*)aKey
 {
   CHECKKEY
 
-  [_enc setObject: [NSNumber  numberWithInt: anInteger] forKey: aKey];
+  RECORD(GSPrivateBinaryPLWriteInteger(internal->writer, anInteger));
 }
 
 - (void) encodeInteger: (NSInteger)anInteger forKey: (NSString*)aKey
 {
   CHECKKEY
 
-  [_enc setObject: [NSNumber  numberWithInteger: anInteger] forKey: aKey];
+  RECORD(GSPrivateBinaryPLWriteInteger(internal->writer, anInteger));
 }
 
 - (void) encodeInt32: (int32_t)anInteger forKey: (NSString*)aKey
 {
   CHECKKEY
 
-  [_enc setObject: [NSNumber  numberWithLong: anInteger] forKey: aKey];
+  RECORD(GSPrivateBinaryPLWriteInteger(internal->writer, anInteger));
 }
 
 - (void) encodeInt64: (int64_t)anInteger forKey: (NSString*)aKey
 {
   CHECKKEY
 
-  [_enc setObject: [NSNumber  numberWithLongLong: anInteger] forKey: aKey];
+  RECORD(GSPrivateBinaryPLWriteInteger(internal->writer, anInteger));
 }
 
 - (void) encodeObject: (id)anObject
 {
-  NSString	*aKey = [NSString stringWithFormat: @"$%u", _keyNum++];
+  NSUInteger	keyRef = [self _positionalKey];
+  NSUInteger	uid = [self _encodeObject: anObject conditional: NO];
 
-  anObject = [self _encodeObject: anObject conditional: NO];
-  [_enc setObject: anObject forKey: aKey];
+  RECORD(GSPrivateBinaryPLWriteUID(internal->writer, uid));
 }
 
 - (void) encodeObject: (id)anObject forKey: (NSString*)aKey
 {
+  NSUInteger	uid;
   CHECKKEY
 
-  anObject = [self _encodeObject: anObject conditional: NO];
-  [_enc setObject: anObject forKey: aKey];
+  uid = [self _encodeObject: anObject conditional: NO];
+  RECORD(GSPrivateBinaryPLWriteUID(internal->writer, uid));
 }
 
 - (void) encodePoint: (NSPoint)p
@@ -681,19 +903,18 @@ static NSDictionary *makeReference(unsigned ref)
 - (void) encodeValueOfObjCType: (const char*)type
 			    at: (const void*)address
 {
-  NSString	*aKey;
-  id		o;
+  GSBinaryPLWriter	*w;
+  NSUInteger		keyRef;
+  id			o;
 
   type = GSSkipTypeQualifierAndLayoutInfo(type);
-  if (*type == _C_ID || *type == _C_CLASS)
-    {
-      [self encodeObject: *(id*)address];
-      return;
-    }
-
-  aKey = [NSString stringWithFormat: @"$%u", _keyNum++];
   switch (*type)
     {
+      case _C_ID:
+      case _C_CLASS:
+	[self encodeObject: *(id*)address];
+	return;
+
       case _C_SEL:
 	{
 	  // Selectors are encoded by name as strings.
@@ -712,72 +933,64 @@ static NSDictionary *makeReference(unsigned ref)
 	  [self encodeObject: o];
 	}
 	return;
+    }
 
+  keyRef = [self _positionalKey];
+  w = internal->writer;
+  switch (*type)
+    {
       case _C_CHR:
-	o = [NSNumber numberWithInt: (NSInteger)*(char*)address];
-	[_enc setObject: o forKey: aKey];
+	RECORD(GSPrivateBinaryPLWriteInteger(w, *(char*)address));
 	return;
 
       case _C_UCHR:
-	o = [NSNumber numberWithInt: (NSInteger)*(unsigned char*)address];
-	[_enc setObject: o forKey: aKey];
+	RECORD(GSPrivateBinaryPLWriteInteger(w, *(unsigned char*)address));
 	return;
 
       case _C_SHT:
-	o = [NSNumber numberWithInt: (NSInteger)*(short*)address];
-	[_enc setObject: o forKey: aKey];
+	RECORD(GSPrivateBinaryPLWriteInteger(w, *(short*)address));
 	return;
 
       case _C_USHT:
-	o = [NSNumber numberWithLong: (long)*(unsigned short*)address];
-	[_enc setObject: o forKey: aKey];
+	RECORD(GSPrivateBinaryPLWriteInteger(w, *(unsigned short*)address));
 	return;
 
       case _C_INT:
-	o = [NSNumber numberWithInt: *(int*)address];
-	[_enc setObject: o forKey: aKey];
+	RECORD(GSPrivateBinaryPLWriteInteger(w, *(int*)address));
 	return;
 
       case _C_UINT:
-	o = [NSNumber numberWithUnsignedInt: *(unsigned int*)address];
-	[_enc setObject: o forKey: aKey];
+	RECORD(GSPrivateBinaryPLWriteInteger(w, *(unsigned int*)address));
 	return;
 
       case _C_LNG:
-	o = [NSNumber numberWithLong: *(long*)address];
-	[_enc setObject: o forKey: aKey];
+	RECORD(GSPrivateBinaryPLWriteInteger(w, *(long*)address));
 	return;
 
       case _C_ULNG:
-	o = [NSNumber numberWithUnsignedLong: *(unsigned long*)address];
-	[_enc setObject: o forKey: aKey];
+	RECORD(GSPrivateBinaryPLWriteInteger(w, *(unsigned long*)address));
 	return;
 
       case _C_LNG_LNG:
-	o = [NSNumber numberWithLongLong: *(long long*)address];
-	[_enc setObject: o forKey: aKey];
+	RECORD(GSPrivateBinaryPLWriteInteger(w, *(long long*)address));
 	return;
 
       case _C_ULNG_LNG:
-	o = [NSNumber numberWithUnsignedLongLong:
-	  *(unsigned long long*)address];
-	[_enc setObject: o forKey: aKey];
+	RECORD(GSPrivateBinaryPLWriteInteger(w,
+	  (long long)*(unsigned long long*)address));
 	return;
 
       case _C_FLT:
-	o = [NSNumber numberWithFloat: *(float*)address];
-	[_enc setObject: o forKey: aKey];
+	RECORD(GSPrivateBinaryPLWriteReal(w, *(float*)address));
 	return;
 
       case _C_DBL:
-	o = [NSNumber numberWithDouble: *(double*)address];
-	[_enc setObject: o forKey: aKey];
+	RECORD(GSPrivateBinaryPLWriteReal(w, *(double*)address));
 	return;
 
 #if __GNUC__ > 2 && defined(_C_BOOL)
       case _C_BOOL:
-	o = [NSNumber numberWithInt: (NSInteger)*(_Bool*)address];
-	[_enc setObject: o forKey: aKey];
+	RECORD(GSPrivateBinaryPLWriteInteger(w, *(_Bool*)address));
 	return;
 #endif
 
@@ -809,21 +1022,44 @@ static NSDictionary *makeReference(unsigned ref)
 
 - (void) finishEncoding
 {
-  NSMutableDictionary	*final;
-  NSData		*data;
-  NSString		*error;
+  GSBinaryPLWriter	*w;
+  GSKeyedRecord		*top;
+  NSMutableData		*data;
+  NSUInteger		keys[4];
+  NSUInteger		values[4];
 
+  CHECKWRITER
   [_delegate archiverWillFinish: self];
 
-  final = [NSMutableDictionary new];
-  [final setObject: NSStringFromClass([self class]) forKey: @"$archiver"];
-  [final setObject: [NSNumber numberWithInt: 100000] forKey: @"$version"];
-  [final setObject: _enc forKey: @"$top"];
-  [final setObject: _obj forKey: @"$objects"];
-  data = [NSPropertyListSerialization dataFromPropertyList: final
-						    format: _format
-					  errorDescription: &error];
-  RELEASE(final);
+  w = internal->writer;
+  top = internal->records;
+  keys[0] = GSPrivateBinaryPLWriteObject(w, @"$archiver");
+  values[0] = GSPrivateBinaryPLWriteObject(w, NSStringFromClass([self class]));
+  keys[1] = GSPrivateBinaryPLWriteObject(w, @"$version");
+  values[1] = GSPrivateBinaryPLWriteInteger(w, 100000);
+  keys[2] = GSPrivateBinaryPLWriteObject(w, @"$top");
+  values[2] = GSPrivateBinaryPLWriteDictionary(w,
+    top->keys, top->values, top->count);
+  keys[3] = GSPrivateBinaryPLWriteObject(w, @"$objects");
+  values[3] = GSPrivateBinaryPLWriteArray(w,
+    internal->uids, internal->uidCount);
+  data = GSPrivateBinaryPLWriterFinish(w,
+    GSPrivateBinaryPLWriteDictionary(w, keys, values, 4));
+  GSPrivateBinaryPLWriterFree(w);
+  internal->writer = 0;
+
+  if (_format != NSPropertyListBinaryFormat_v1_0)
+    {
+      NSString	*error;
+      id	plist;
+
+      plist = [NSPropertyListSerialization propertyListWithData: data
+	options: NSPropertyListImmutable format: 0 error: 0];
+      data = (NSMutableData*)[NSPropertyListSerialization
+	dataFromPropertyList: plist
+		      format: _format
+	    errorDescription: &error];
+    }
   [_data setData: data];
   [_delegate archiverDidFinish: self];
 }
@@ -860,9 +1096,16 @@ static NSDictionary *makeReference(unsigned ref)
       GSIMapInitWithZoneAndCapacity(_uIdMap, zone, 200);
       GSIMapInitWithZoneAndCapacity(_repMap, zone, 1);
 
-      _enc = [NSMutableDictionary new];		// Top level mapping dict
-      _obj = [NSMutableArray new];		// Array of objects.
-      [_obj addObject: @"$null"];		// Placeholder.
+      GS_CREATE_INTERNAL(NSKeyedArchiver)
+      internal->writer = GSPrivateBinaryPLWriterCreate();
+      internal->recordCapacity = 8;	// Top level mapping and nesting
+      internal->records = NSZoneCalloc(NSDefaultMallocZone(),
+	internal->recordCapacity, sizeof(GSKeyedRecord));
+      internal->uidCapacity = 256;	// Table of all objects.
+      internal->uids = NSZoneMalloc(NSDefaultMallocZone(),
+	internal->uidCapacity * sizeof(NSUInteger));
+      [self _newUID:			// Placeholder.
+	GSPrivateBinaryPLWriteObject(internal->writer, @"$null")];
 
       _format = NSPropertyListBinaryFormat_v1_0;
     }
@@ -832,10 +832,17 @@ static NSMapTable	*globalClassMap = 0;
       NSString			*error;
 
       _zone = [self zone];
-      _archive = [NSPropertyListSerialization propertyListFromData: data
-	mutabilityOption: NSPropertyListImmutable
-	format: &format
-	errorDescription: &error];
+      /* A binary archive is read lazily, so that each object record is
+       * only decoded from the data when the object itself is decoded.
+       */
+      _archive = GSPrivateLazyPropertyList(data);
+      if (_archive == nil)
+	{
+	  _archive = [NSPropertyListSerialization propertyListFromData: data
+	    mutabilityOption: NSPropertyListImmutable
+	    format: &format
+	    errorDescription: &error];
+	}
       if (_archive == nil)
 	{
 	  DESTROY(self);
@@ -43,6 +43,7 @@
 #import "Foundation/NSValue.h"
 #import "Foundation/NSFileManager.h"
 #import "Foundation/NSProcessInfo.h"
+#import "Foundation/NSUserDefaults.h"
 
 #import "GSPrivate.h"
 #import "GSNetwork.h"
@@ -99,6 +100,42 @@
 #  endif
 #endif
 
+/*
+ *	On Linux large data items may be passed as sealed memory files,
+ *	sent as descriptors over the socket, rather than copied through it.
+ *	The constants are those of the kernel, for C libraries which do not
+ *	declare them.
+ */
+#if	defined(__linux__) && defined(HAVE_MMAP)
+#  include <sys/mman.h>
+#  include <sys/syscall.h>
+#  if	defined(SYS_memfd_create) && defined(SCM_RIGHTS)
+#    define	GS_SHARED_MEMORY	1
+#    ifndef	MFD_CLOEXEC
+#      define	MFD_CLOEXEC		0x0001U
+#    endif
+#    ifndef	MFD_ALLOW_SEALING
+#      define	MFD_ALLOW_SEALING	0x0002U
+#    endif
+#    ifndef	F_ADD_SEALS
+#      define	F_ADD_SEALS		1033
+#      define	F_GET_SEALS		1034
+#    endif
+#    ifndef	F_SEAL_SEAL
+#      define	F_SEAL_SEAL		0x0001
+#      define	F_SEAL_SHRINK		0x0002
+#      define	F_SEAL_GROW		0x0004
+#      define	F_SEAL_WRITE		0x0008
+#    endif
+#    ifndef	MAP_FAILED
+#      define	MAP_FAILED	((void*)-1)
+#    endif
+#  endif
+#endif
+#ifndef	GS_SHARED_MEMORY
+#  define	GS_SHARED_MEMORY	0
+#endif
+
 @interface NSProcessInfo (private)
 + (BOOL) _exists: (int)pid;
 @end
@@ -108,6 +145,15 @@
  */
 static uint32_t	maxDataLength = 32 * 1024 * 1024;
 
+#if	GS_SHARED_MEMORY
+/*
+ * Data items of at least this size are sent in shared memory, if the
+ * receiving process supports it.  Set by the GSMessagePortSharedMemory
+ * user default, where zero turns it off.
+ */
+static NSUInteger	sharedMemoryThreshold = 64 * 1024;
+#endif
+
 #if 0
 #define	M_LOCK(X) {NSDebugMLLog(@"NSMessagePort",@"lock %@",X); [X lock];}
 #define	M_UNLOCK(X) {NSDebugMLLog(@"NSMessagePort",@"unlock %@",X); [X unlock];}
@@ -126,12 +172,16 @@ typedef	enum {
   GSP_NONE,
   GSP_PORT,		/* Simple port item.			*/
   GSP_DATA,		/* Simple data item.			*/
-  GSP_HEAD		/* Port message header + initial data.	*/
+  GSP_HEAD,		/* Port message header + initial data.	*/
+  GSP_SHM		/* Data item in a memory file.		*/
 } GSPortItemType;
 
 /*
  * The GSPortItemHeader structure defines the header for each item transmitted.
  * Its contents are transmitted in network byte order.
+ * For an item of type GSP_SHM, the length is that of the data in the memory
+ * file whose descriptor is passed along with the header, and no other bytes
+ * follow.
  */
 typedef struct {
   uint32_t	type;	/* A GSPortItemType as a 4-byte number.		*/
@@ -203,6 +253,235 @@ newDataWithEncodedPort(NSMessagePort *port)
   return data;
 }
 
+#if	GS_SHARED_MEMORY
+
+/*
+ * Data received in a memory file, which is mapped rather than copied.
+ */
+@interface	GSSharedMemoryData : NSData
+{
+  void		*bytes;
+  NSUInteger	length;
+}
+- (id) initWithMappedBytes: (void*)b length: (NSUInteger)l;
+@end
+
+@implementation	GSSharedMemoryData
+- (const void*) bytes
+{
+  return bytes;
+}
+
+- (void) dealloc
+{
+  if (bytes != 0)
+    {
+      munmap(bytes, length);
+      bytes = 0;
+    }
+  [super dealloc];
+}
+
+- (id) initWithMappedBytes: (void*)b length: (NSUInteger)l
+{
+  bytes = b;
+  length = l;
+  return self;
+}
+
+- (NSUInteger) length
+{
+  return length;
+}
+@end
+
+/*
+ * A data item to be sent as the descriptor of a memory file, rather than
+ * through the socket.
+ */
+@interface	GSSharedMemoryItem : NSObject
+{
+@public
+  NSMutableData	*header;	/* Item header to write.	*/
+  int		desc;		/* Memory file to pass with it.	*/
+}
+@end
+
+@implementation	GSSharedMemoryItem
+- (void) dealloc
+{
+  if (desc >= 0)
+    {
+      (void)close(desc);
+    }
+  RELEASE(header);
+  [super dealloc];
+}
+@end
+
+static Class	sharedMemoryItemClass;
+
+/*
+ * The sockets of ports owned by processes which can receive data items
+ * in shared memory have names ending in '.shm'.
+ */
+static BOOL
+acceptsSharedMemory(const unsigned char *portName)
+{
+  size_t	len = strlen((const char*)portName);
+
+  if (len > 4 && strcmp((const char*)portName + len - 4, ".shm") == 0)
+    {
+      return YES;
+    }
+  return NO;
+}
+
+/*
+ * Copies the data into a new memory file, sealed so that the receiver
+ * can map it without fear of it changing or shrinking, and returns an
+ * item to send it, or nil if that is not possible.
+ */
+static GSSharedMemoryItem *
+newSharedMemoryItem(NSData *data)
+{
+  GSSharedMemoryItem	*item;
+  GSPortItemHeader	*pih;
+  const char		*b = [data bytes];
+  NSUInteger		l = [data length];
+  NSUInteger		done = 0;
+  int			fd;
+
+  fd = syscall(SYS_memfd_create, "NSMessagePort",
+    MFD_CLOEXEC | MFD_ALLOW_SEALING);
+  if (fd < 0)
+    {
+      if (errno == ENOSYS || errno == EINVAL)
+	{
+	  /* The kernel is too old, so don't try again.
+	   */
+	  sharedMemoryThreshold = 0;
+	}
+      return nil;
+    }
+  if (ftruncate(fd, l) < 0)
+    {
+      (void)close(fd);
+      return nil;
+    }
+  while (done < l)
+    {
+      ssize_t	res = pwrite(fd, b + done, l - done, done);
+
+      if (res < 0)
+	{
+	  if (errno == EINTR)
+	    {
+	      continue;
+	    }
+	  (void)close(fd);
+	  return nil;
+	}
+      done += res;
+    }
+  if (fcntl(fd, F_ADD_SEALS,
+    F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) < 0)
+    {
+      (void)close(fd);
+      return nil;
+    }
+
+  item = [GSSharedMemoryItem new];
+  item->desc = fd;
+  item->header = [[NSMutableData alloc]
+    initWithLength: sizeof(GSPortItemHeader)];
+  pih = (GSPortItemHeader*)[item->header mutableBytes];
+  pih->type = GSSwapHostI32ToBig(GSP_SHM);
+  pih->length = GSSwapHostI32ToBig(l);
+  return item;
+}
+
+/*
+ * Returns data holding the first length bytes of a memory file received
+ * from another process.  If the sender sealed the file, it is mapped,
+ * otherwise its contents are copied.
+ */
+static NSData *
+newDataWithSharedMemory(int fd, uint32_t length)
+{
+  NSMutableData	*d;
+  struct stat	sb;
+  uint32_t	done = 0;
+  int		seals;
+
+  if (fstat(fd, &sb) < 0 || sb.st_size < (off_t)length)
+    {
+      return nil;
+    }
+  seals = fcntl(fd, F_GET_SEALS);
+  if (length > 0 && seals >= 0
+    && (seals & (F_SEAL_SHRINK | F_SEAL_WRITE))
+    == (F_SEAL_SHRINK | F_SEAL_WRITE))
+    {
+      void	*b = mmap(0, length, PROT_READ, MAP_SHARED, fd, 0);
+
+      if (b != MAP_FAILED)
+	{
+	  return [[GSSharedMemoryData alloc] initWithMappedBytes: b
+							  length: length];
+	}
+    }
+  d = [[NSMutableData alloc] initWithLength: length];
+  while (done < length)
+    {
+      ssize_t	res = pread(fd, [d mutableBytes] + done, length - done, done);
+
+      if (res <= 0)
+	{
+	  if (res < 0 && errno == EINTR)
+	    {
+	      continue;
+	    }
+	  RELEASE(d);
+	  return nil;
+	}
+      done += res;
+    }
+  return d;
+}
+
+/*
+ * Writes bytes to the socket, passing a descriptor along with them.
+ */
+static int
+sendDescriptor(int sock, const void *b, unsigned l, int fd)
+{
+  struct msghdr		msg;
+  struct iovec		iov;
+  struct cmsghdr	*c;
+  union {
+    struct cmsghdr	h;
+    char		buf[CMSG_SPACE(sizeof(int))];
+  } ctl;
+
+  memset(&msg, '\0', sizeof(msg));
+  memset(&ctl, '\0', sizeof(ctl));
+  iov.iov_base = (void*)b;
+  iov.iov_len = l;
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = ctl.buf;
+  msg.msg_controllen = sizeof(ctl.buf);
+  c = CMSG_FIRSTHDR(&msg);
+  c->cmsg_level = SOL_SOCKET;
+  c->cmsg_type = SCM_RIGHTS;
+  c->cmsg_len = CMSG_LEN(sizeof(int));
+  memcpy(CMSG_DATA(c), &fd, sizeof(int));
+  return sendmsg(sock, &msg, 0);
+}
+
+#endif	/* GS_SHARED_MEMORY */
+
 /* Older systems (Solaris) compatibility */
 #ifndef AF_LOCAL
 #define AF_LOCAL AF_UNIX
@@ -231,8 +510,10 @@ newDataWithEncodedPort(NSMessagePort *port)
  * GSP_PORT to tell the remote end what port is connecting to it.
  * Therafter, all communication is via port messages.  Each port message
  * consists of an item of type GSP_HEAD followed by zero or more items
- * of type GSP_PORT or GSP_DATA.  The number of items in a port message
- * is encoded in the 'nItems' field of the header.
+ * of type GSP_PORT, GSP_DATA or GSP_SHM.  The number of items in a port
+ * message is encoded in the 'nItems' field of the header.
+ * Items of type GSP_SHM are only sent to ports whose names show that
+ * their process understands them.
  */
 
 typedef enum {
@@ -246,13 +527,14 @@ typedef enum {
 {
   int			desc;		/* File descriptor for I/O.	*/
   unsigned		wItem;		/* Index of item being written.	*/
-  NSMutableData		*wData;		/* Data object being written.	*/
+  id			wData;		/* Data object being written.	*/
   unsigned		wLength;	/* Ammount written so far.	*/
   NSMutableArray	*wMsgs;		/* Message in progress.		*/
   NSMutableData		*rData;		/* Buffer for incoming data	*/
   uint32_t		rLength;	/* Amount read so far.		*/
   uint32_t		rWant;		/* Amount desired.		*/
   NSMutableArray	*rItems;	/* Message in progress.		*/
+  NSMutableData		*rDescs;	/* Descriptors received.	*/
   GSPortItemType	rType;		/* Type of data being read.	*/
   uint32_t		rId;		/* Id of incoming message.	*/
   unsigned		nItems;		/* Number of items to be read.	*/
@@ -342,8 +624,87 @@ static Class	runLoopClass;
       mutableDataClass = [NSMutableData class];
       portMessageClass = [NSPortMessage class];
       runLoopClass = [NSRunLoop class];
+#if	GS_SHARED_MEMORY
+      sharedMemoryItemClass = [GSSharedMemoryItem class];
+#endif
+    }
+}
+
+#if	GS_SHARED_MEMORY
+/*
+ * Returns the oldest descriptor received and not yet used, or -1.
+ * Descriptors arrive with the item headers they belong to, so they are
+ * used in the order in which they were received.
+ */
+- (int) _nextDescriptor
+{
+  int	fd;
+
+  if ([rDescs length] < sizeof(int))
+    {
+      return -1;
+    }
+  memcpy(&fd, [rDescs bytes], sizeof(int));
+  [rDescs replaceBytesInRange: NSMakeRange(0, sizeof(int))
+		    withBytes: 0
+		       length: 0];
+  return fd;
+}
+
+/*
+ * Reads from the socket like read(), keeping any descriptors passed
+ * along with the data.
+ */
+- (int) _receive: (void*)buf length: (unsigned)len
+{
+  struct msghdr		msg;
+  struct iovec		iov;
+  struct cmsghdr	*c;
+  union {
+    struct cmsghdr	h;
+    char		buf[CMSG_SPACE(sizeof(int) * 8)];
+  } ctl;
+  int			flags = 0;
+  int			res;
+
+#ifdef	MSG_CMSG_CLOEXEC
+  flags |= MSG_CMSG_CLOEXEC;
+#endif
+  memset(&msg, '\0', sizeof(msg));
+  iov.iov_base = buf;
+  iov.iov_len = len;
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = ctl.buf;
+  msg.msg_controllen = sizeof(ctl.buf);
+  res = recvmsg(desc, &msg, flags);
+  if (res < 0)
+    {
+      return res;
+    }
+  for (c = CMSG_FIRSTHDR(&msg); c != 0; c = CMSG_NXTHDR(&msg, c))
+    {
+      if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_RIGHTS)
+	{
+	  if (rDescs == nil)
+	    {
+	      rDescs = [mutableDataClass new];
+	    }
+	  [rDescs appendBytes: CMSG_DATA(c)
+		       length: c->cmsg_len - CMSG_LEN(0)];
+	}
+    }
+  if (msg.msg_flags & MSG_CTRUNC)
+    {
+      /* Some descriptors were discarded, so the rest no longer match
+       * the items they belong to.
+       */
+      errno = EMSGSIZE;
+      return -1;
     }
+  return res;
 }
+#endif
 
 - (void) _add: (NSRunLoop*)l
 {
@@ -471,6 +832,7 @@ static Class	runLoopClass;
   [self finalize];
   DESTROY(rData);
   DESTROY(rItems);
+  DESTROY(rDescs);
   DESTROY(wMsgs);
   DESTROY(myLock);
   [super dealloc];
@@ -492,6 +854,16 @@ static Class	runLoopClass;
   [self invalidate];
   (void)close(desc);
   desc = -1;
+#if	GS_SHARED_MEMORY
+  {
+    int	fd;
+
+    while ((fd = [self _nextDescriptor]) >= 0)
+      {
+	(void)close(fd);
+      }
+  }
+#endif
 }
 
 - (void) invalidate
@@ -596,7 +968,11 @@ static Class	runLoopClass;
        * Now try to fill the buffer with data.
        */
       bytes = [rData mutableBytes];
+#if	GS_SHARED_MEMORY
+      res = [self _receive: bytes + rLength length: want - rLength];
+#else
       res = read(desc, bytes + rLength, want - rLength);
+#endif
       if (res <= 0)
 	{
 	  if (res == 0)
@@ -725,6 +1101,56 @@ static Class	runLoopClass;
 			}
 		      rWant = l;
 		    }
+#if	GS_SHARED_MEMORY
+		  else if (rType == GSP_SHM)
+		    {
+		      NSData	*d = nil;
+		      int	fd = [self _nextDescriptor];
+
+		      if (l > maxDataLength)
+			{
+			  NSLog(@"%@ - unreasonable length (%u) for data",
+			    self, l);
+			  if (fd >= 0)
+			    {
+			      (void)close(fd);
+			    }
+			  M_UNLOCK(myLock);
+			  [self invalidate];
+			  return;
+			}
+		      /*
+		       * The data is in the memory file passed with the item
+		       * header, so the item is complete.
+		       */
+		      if (fd >= 0)
+			{
+			  d = newDataWithSharedMemory(fd, l);
+			  (void)close(fd);
+			}
+		      if (d == nil)
+			{
+			  NSLog(@"%@ - unable to get shared memory (%u) for data",
+			    self, l);
+			  M_UNLOCK(myLock);
+			  [self invalidate];
+			  return;
+			}
+		      rType = GSP_NONE;	/* ready for a new item	*/
+		      rLength -= rWant;
+		      if (rLength > 0)
+			{
+			  memmove(bytes, bytes + rWant, rLength);
+			}
+		      rWant = sizeof(GSPortItemHeader);
+		      [rItems addObject: d];
+		      RELEASE(d);
+		      if (nItems == [rItems count])
+			{
+			  shouldDispatch = YES;
+			}
+		    }
+#endif
 		  else
 		    {
 		      NSLog(@"%@ - bad data received on port handle, rType=%i",
@@ -964,9 +1390,32 @@ static Class	runLoopClass;
 		  return;
 		}
 	    }
-	  b = [wData bytes];
-	  l = [wData length];
-	  res = write(desc, b + wLength,  l - wLength);
+#if	GS_SHARED_MEMORY
+	  if ([wData isKindOfClass: sharedMemoryItemClass] == YES)
+	    {
+	      GSSharedMemoryItem	*item = (GSSharedMemoryItem*)wData;
+
+	      /*
+	       * The memory file goes with the first byte of its header.
+	       */
+	      b = [item->header bytes];
+	      l = [item->header length];
+	      if (wLength == 0)
+		{
+		  res = sendDescriptor(desc, b, l, item->desc);
+		}
+	      else
+		{
+		  res = write(desc, b + wLength,  l - wLength);
+		}
+	    }
+	  else
+#endif
+	    {
+	      b = [wData bytes];
+	      l = [wData length];
+	      res = write(desc, b + wLength,  l - wLength);
+	    }
 	  if (res < 0)
 	    {
 	      if (errno != EINTR && errno != EAGAIN)
@@ -1155,6 +1604,17 @@ typedef	struct {
 
       messagePortLock = [NSRecursiveLock new];
 
+#if	GS_SHARED_MEMORY
+      if ([[NSUserDefaults standardUserDefaults]
+	objectForKey: @"GSMessagePortSharedMemory"] != nil)
+	{
+	  NSInteger	t = [[NSUserDefaults standardUserDefaults]
+	    integerForKey: @"GSMessagePortSharedMemory"];
+
+	  sharedMemoryThreshold = (t > 0) ? t : 0;
+	}
+#endif
+
       /* It's possible that an old process, with the same process ID as
        * this one, got forcibly killed or crashed so that clean_up_sockets
        * was never called.
@@ -1201,6 +1661,7 @@ typedef	struct {
 {
   static int unique_index = 0;
   NSString	*path;
+  NSString	*format;
   NSDictionary	*attr;
 
   if (nil == (path = NSTemporaryDirectory()))
@@ -1223,9 +1684,16 @@ typedef	struct {
                                              attributes: attr
                                                   error: NULL];
 
+#if	GS_SHARED_MEMORY
+  /* Tell other processes that we can receive data in shared memory.
+   */
+  format = @"%i.%i.shm";
+#else
+  format = @"%i.%i";
+#endif
   M_LOCK(messagePortLock);
   path = [path stringByAppendingPathComponent:
-   [NSString stringWithFormat: @"%i.%i",
+   [NSString stringWithFormat: format,
 	[[NSProcessInfo processInfo] processIdentifier], unique_index++]];
   M_UNLOCK(messagePortLock);
 
@@ -1822,6 +2290,14 @@ typedef	struct {
       unsigned		c = [components count];
       unsigned		i;
       BOOL		pack = YES;
+#if	GS_SHARED_MEMORY
+      BOOL		shm = NO;
+
+      if (sharedMemoryThreshold > 0 && acceptsSharedMemory([self _name]))
+	{
+	  shm = YES;
+	}
+#endif
 
       /*
        * Ok - ensure we have space to insert header info.
@@ -1872,6 +2348,9 @@ typedef	struct {
 	      unsigned		h = sizeof(GSPortItemHeader);
 	      unsigned		l = [o length];
 	      void		*b;
+#if	GS_SHARED_MEMORY
+	      GSSharedMemoryItem	*item;
+#endif
 
 	      if (pack == YES && hLength + l + h <= NETBLOCK)
 		{
@@ -1909,6 +2388,19 @@ typedef	struct {
 		  c--;
 		  hLength += l + h;
 		}
+#if	GS_SHARED_MEMORY
+	      else if (shm == YES && l >= sharedMemoryThreshold
+		&& (item = newSharedMemoryItem(o)) != nil)
+		{
+		  /*
+		   * Large data goes in a memory file, so it is not copied
+		   * through the socket and into a buffer by the receiver.
+		   */
+		  pack = NO;
+		  [components replaceObjectAtIndex: i withObject: item];
+		  RELEASE(item);
+		}
+#endif
 	      else
 		{
 		  NSMutableData	*d;
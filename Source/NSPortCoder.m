@@ -77,11 +77,24 @@
 
 
 
+@class	GSPortCoderInterns;
+
+#define	GS_NSPortCoder_IVARS \
+  GSPortCoderInterns	*interns;	/* Compact encoding in use.	*/ \
+  NSMutableData		*defined;	/* Interned items defined.	*/
+
 #define	_IN_PORT_CODER_M
 #import "Foundation/NSPortCoder.h"
 #undef	_IN_PORT_CODER_M
 
+#define	GSInternal	NSPortCoderInternal
+#include	"GSInternal.h"
+GS_PRIVATE_INTERNAL(NSPortCoder)
+
+#import "Foundation/NSLock.h"
+#import "Foundation/NSMapTable.h"
 #import "GNUstepBase/DistributedObjects.h"
+#import "GSInvocation.h"
 
 typedef	unsigned char	uchar;
 
@@ -323,6 +336,295 @@ typeCheck(char t1, char t2)
 }
 @end
 
+/*
+ *	Messages in the compact encoding have this bit set in the system
+ *	version in their header.  Integers are written as variable length
+ *	quantities, and classes, selectors and method types are interned for
+ *	the lifetime of the connection (see GSPortCoderInterns below).
+ *	A connection only sends such messages once the other end has told it
+ *	that it understands them, and never does so if the system version has
+ *	been lowered (with the GSCoderSystemVersion user default) in order to
+ *	talk to older systems.
+ */
+#define	COMPACT_FLAG	0x40000000
+#define	COMPACT_MIN	1000000
+
+/*
+ *	Type tag for an interned method type in the compact encoding.
+ */
+#define	_GSC_TYPES	0x18
+
+static inline void
+appendVarint(NSMutableData *d, uint64_t v)
+{
+  uint8_t	buf[10];
+  unsigned	len = 0;
+
+  while (v >= 0x80)
+    {
+      buf[len++] = (uint8_t)(v | 0x80);
+      v >>= 7;
+    }
+  buf[len++] = (uint8_t)v;
+  [d appendBytes: buf length: len];
+}
+
+static inline uint64_t
+readVarint(NSData *d, unsigned *cursor)
+{
+  const uint8_t	*bytes = (const uint8_t*)[d bytes];
+  NSUInteger	length = [d length];
+  uint64_t	v = 0;
+  unsigned	shift = 0;
+
+  for (;;)
+    {
+      uint8_t	c;
+
+      if (*cursor >= length)
+	{
+	  [NSException raise: NSRangeException
+		      format: @"variable length integer past end of data"];
+	}
+      if (shift > 63)
+	{
+	  [NSException raise: NSInternalInconsistencyException
+		      format: @"overflow in variable length integer"];
+	}
+      c = bytes[(*cursor)++];
+      v |= (uint64_t)(c & 0x7f) << shift;
+      if ((c & 0x80) == 0)
+	{
+	  return v;
+	}
+      shift += 7;
+    }
+}
+
+/*
+ *	Map table callbacks for method types used as keys: the table owns a
+ *	copy of each key, which it compares by content.
+ */
+static NSUInteger
+typesHash(NSMapTable *t, const void *k)
+{
+  const unsigned char	*p = (const unsigned char*)k;
+  NSUInteger		h = 5381;
+
+  while (*p != 0)
+    {
+      h = (h << 5) + h + *p++;
+    }
+  return h;
+}
+
+static BOOL
+typesIsEqual(NSMapTable *t, const void *k1, const void *k2)
+{
+  return (strcmp((const char*)k1, (const char*)k2) == 0) ? YES : NO;
+}
+
+static void
+typesRetain(NSMapTable *t, const void *k)
+{
+  return;
+}
+
+static void
+typesRelease(NSMapTable *t, void *k)
+{
+  free(k);
+}
+
+static NSString *
+typesDescribe(NSMapTable *t, const void *k)
+{
+  return [NSString stringWithUTF8String: (const char*)k];
+}
+
+static const NSMapTableKeyCallBacks typesKeyCallBacks =
+{
+  typesHash,
+  typesIsEqual,
+  typesRetain,
+  typesRelease,
+  typesDescribe,
+  NSNotAPointerMapKey
+};
+
+@interface	GSPortCoderInterns ()
+- (BOOL) getItem: (const void**)item
+   forIdentifier: (unsigned)ident
+	   types: (BOOL)isTypes;
+- (unsigned) identifierForItem: (const void*)item known: (BOOL*)isKnown;
+- (unsigned) identifierForTypes: (const char*)types known: (BOOL*)isKnown;
+- (void) setItem: (const void*)item forIdentifier: (unsigned)ident;
+- (const char*) setTypes: (const char*)types forIdentifier: (unsigned)ident;
+@end
+
+@implementation	GSPortCoderInterns
+
+- (void) confirm: (NSData*)identifiers
+{
+  const unsigned	*ids = (const unsigned*)[identifiers bytes];
+  NSUInteger		count = [identifiers length] / sizeof(unsigned);
+
+  [lock lock];
+  while (count-- > 0)
+    {
+      if (ids[count] < size)
+	{
+	  known[ids[count]] = 1;
+	}
+    }
+  [lock unlock];
+}
+
+- (void) dealloc
+{
+  if (outItems != 0)
+    {
+      NSFreeMapTable(outItems);
+      NSFreeMapTable(outTypes);
+      NSFreeMapTable(inItems);
+      NSFreeMapTable(inTypes);
+    }
+  if (known != 0)
+    {
+      free(known);
+    }
+  RELEASE(lock);
+  [super dealloc];
+}
+
+- (BOOL) getItem: (const void**)item
+   forIdentifier: (unsigned)ident
+	   types: (BOOL)isTypes
+{
+  BOOL	found;
+
+  [lock lock];
+  found = NSMapMember(isTypes ? inTypes : inItems,
+    (const void*)(uintptr_t)ident, 0, (void**)item);
+  [lock unlock];
+  return found;
+}
+
+/* Allocates a new identifier, which is not yet known to the other end.
+ * Must be called with the lock held.
+ */
+- (unsigned) _newIdentifier
+{
+  unsigned	ident = ++next;
+
+  if (ident >= size)
+    {
+      unsigned	newSize = (size == 0) ? 64 : size * 2;
+
+      known = realloc(known, newSize);
+      if (known == 0)
+	{
+	  [NSException raise: NSMallocException
+		      format: @"unable to grow interned items"];
+	}
+      memset(known + size, 0, newSize - size);
+      size = newSize;
+    }
+  return ident;
+}
+
+- (unsigned) identifierForItem: (const void*)item known: (BOOL*)isKnown
+{
+  unsigned	ident;
+
+  [lock lock];
+  ident = (unsigned)(uintptr_t)NSMapGet(outItems, item);
+  if (ident == 0)
+    {
+      ident = [self _newIdentifier];
+      NSMapInsertKnownAbsent(outItems, item, (const void*)(uintptr_t)ident);
+    }
+  *isKnown = known[ident] ? YES : NO;
+  [lock unlock];
+  return ident;
+}
+
+- (unsigned) identifierForTypes: (const char*)types known: (BOOL*)isKnown
+{
+  unsigned	ident;
+
+  [lock lock];
+  ident = (unsigned)(uintptr_t)NSMapGet(outTypes, types);
+  if (ident == 0)
+    {
+      char	*copy = strdup(types);
+
+      if (copy == 0)
+	{
+	  [lock unlock];
+	  [NSException raise: NSMallocException
+		      format: @"unable to intern method type"];
+	}
+      ident = [self _newIdentifier];
+      NSMapInsertKnownAbsent(outTypes, copy, (const void*)(uintptr_t)ident);
+    }
+  *isKnown = known[ident] ? YES : NO;
+  [lock unlock];
+  return ident;
+}
+
+- (id) init
+{
+  if ((self = [super init]) != nil)
+    {
+      lock = [NSLock new];
+      outItems = NSCreateMapTable(NSNonOwnedPointerMapKeyCallBacks,
+	NSIntegerMapValueCallBacks, 64);
+      outTypes = NSCreateMapTable(typesKeyCallBacks,
+	NSIntegerMapValueCallBacks, 64);
+      inItems = NSCreateMapTable(NSIntegerMapKeyCallBacks,
+	NSNonOwnedPointerMapValueCallBacks, 64);
+      inTypes = NSCreateMapTable(NSIntegerMapKeyCallBacks,
+	NSOwnedPointerMapValueCallBacks, 64);
+    }
+  return self;
+}
+
+- (void) setItem: (const void*)item forIdentifier: (unsigned)ident
+{
+  [lock lock];
+  NSMapInsert(inItems, (const void*)(uintptr_t)ident, item);
+  [lock unlock];
+}
+
+/* Stores a copy of the method type defined by the other end and returns
+ * it.  Method types which have been decoded are never replaced, so the
+ * pointer stays valid for the lifetime of the connection.
+ */
+- (const char*) setTypes: (const char*)types forIdentifier: (unsigned)ident
+{
+  char	*stored;
+
+  [lock lock];
+  stored = NSMapGet(inTypes, (const void*)(uintptr_t)ident);
+  if (stored == 0)
+    {
+      stored = strdup(types);
+      if (stored == 0)
+	{
+	  [lock unlock];
+	  [NSException raise: NSMallocException
+		      format: @"unable to intern method type"];
+	}
+      NSMapInsertKnownAbsent(inTypes, (const void*)(uintptr_t)ident, stored);
+    }
+  [lock unlock];
+  return stored;
+}
+
+@end
+
+
 
 
 
@@ -340,6 +642,11 @@ typeCheck(char t1, char t2)
 		   pointers: (unsigned)p;
 @end
 
+@interface	NSPortCoder (Interns)
+- (const void*) _decodeInterned: (char)kind;
+- (void) _encodeInterned: (const void*)item kind: (char)kind;
+@end
+
 
 @implementation NSPortCoder
 
@@ -403,6 +710,12 @@ static unsigned	encodingVersion;
   RELEASE(_comp);
   RELEASE(_conn);
   RELEASE(_cInfo);
+  if (GS_EXISTS_INTERNAL)
+    {
+      RELEASE(internal->interns);
+      RELEASE(internal->defined);
+      GS_DESTROY_INTERNAL(NSPortCoder)
+    }
   if (_clsMap != 0)
     {
       GSIMapEmptyMap(_clsMap);
@@ -761,9 +1074,17 @@ scalarSize(char type)
 		  [NSException raise: NSInternalInconsistencyException
 				format: @"extra class crossref - %d", xref];
 		}
-	      (*_dDesImp)(_src, dDesSel, &c, @encode(Class), &_cursor, nil);
-	      (*_dDesImp)(_src, dDesSel, &cver, @encode(unsigned), &_cursor,
-		nil);
+	      if (internal->interns != nil)
+		{
+		  c = (Class)[self _decodeInterned: _C_CLASS];
+		  cver = (unsigned)readVarint(_src, &_cursor);
+		}
+	      else
+		{
+		  (*_dDesImp)(_src, dDesSel, &c, @encode(Class), &_cursor, nil);
+		  (*_dDesImp)(_src, dDesSel, &cver, @encode(unsigned), &_cursor,
+		    nil);
+		}
 	      if (c == 0)
 		{
 		  NSLog(@"[%s %s] decoded nil class",
@@ -817,7 +1138,14 @@ scalarSize(char type)
 		  [NSException raise: NSInternalInconsistencyException
 			      format: @"extra sel crossref - %d", xref];
 		}
-	      (*_dDesImp)(_src, dDesSel, &sel, @encode(SEL), &_cursor, nil);
+	      if (internal->interns != nil)
+		{
+		  sel = (SEL)[self _decodeInterned: _C_SEL];
+		}
+	      else
+		{
+		  (*_dDesImp)(_src, dDesSel, &sel, @encode(SEL), &_cursor, nil);
+		}
 	      GSIArrayAddItem(_ptrAry, (GSIArrayItem)sel);
 	    }
 	  *(SEL*)address = sel;
@@ -943,6 +1271,24 @@ scalarSize(char type)
 	  return;
 	}
 
+      case _GSC_TYPES:
+	{
+	  const char	*types;
+	  int		len;
+
+	  if (*type != _C_CHARPTR || internal->interns == nil)
+	    {
+	      [NSException raise: NSInternalInconsistencyException
+			  format: @"expected %s and got interned method type",
+		typeToName1(*type)];
+	    }
+	  types = (const char*)[self _decodeInterned: _C_CHARPTR];
+	  len = strlen(types);
+	  *(void**)address = GSAutoreleasedBuffer(len + 1);
+	  memcpy(*(char**)address, types, len + 1);
+	  return;
+	}
+
       case _GSC_CHR:
       case _GSC_UCHR:
 	/* Encoding of chars is not consistant across platforms, so we
@@ -959,7 +1305,8 @@ scalarSize(char type)
       case _GSC_SHT:
       case _GSC_USHT:
 	typeCheck(*type, info & _GSC_MASK);
-	if ((info & _GSC_SIZE) == scalarSize(*type))
+	if ((info & _GSC_SIZE) == scalarSize(*type)
+	  && (_version & COMPACT_FLAG) == 0)
 	  {
 	    (*_dDesImp)(_src, dDesSel, address, type, &_cursor, nil);
 	    return;
@@ -969,7 +1316,8 @@ scalarSize(char type)
       case _GSC_INT:
       case _GSC_UINT:
 	typeCheck(*type, info & _GSC_MASK);
-	if ((info & _GSC_SIZE) == scalarSize(*type))
+	if ((info & _GSC_SIZE) == scalarSize(*type)
+	  && (_version & COMPACT_FLAG) == 0)
 	  {
 	    (*_dDesImp)(_src, dDesSel, address, type, &_cursor, nil);
 	    return;
@@ -979,7 +1327,8 @@ scalarSize(char type)
       case _GSC_LNG:
       case _GSC_ULNG:
 	typeCheck(*type, info & _GSC_MASK);
-	if ((info & _GSC_SIZE) == scalarSize(*type))
+	if ((info & _GSC_SIZE) == scalarSize(*type)
+	  && (_version & COMPACT_FLAG) == 0)
 	  {
 	    (*_dDesImp)(_src, dDesSel, address, type, &_cursor, nil);
 	    return;
@@ -990,7 +1339,8 @@ scalarSize(char type)
       case _GSC_LNG_LNG:
       case _GSC_ULNG_LNG:
 	typeCheck(*type, info & _GSC_MASK);
-	if ((info & _GSC_SIZE) == scalarSize(*type))
+	if ((info & _GSC_SIZE) == scalarSize(*type)
+	  && (_version & COMPACT_FLAG) == 0)
 	  {
 	    (*_dDesImp)(_src, dDesSel, address, type, &_cursor, nil);
 	    return;
@@ -1051,7 +1401,8 @@ scalarSize(char type)
   /*
    *	We fall through to here only when we have to decode a value
    *	whose natural size on this system is not the same as on the
-   *	machine on which the archive was created.
+   *	machine on which the archive was created, or a value in the
+   *	compact encoding.
    */
 {
   uint8_t       size;
@@ -1086,7 +1437,13 @@ scalarSize(char type)
     {
       int64_t   big;
 
-      switch (info & _GSC_SIZE)
+      if (_version & COMPACT_FLAG)
+	{
+	  uint64_t	u = readVarint(_src, &_cursor);
+
+	  big = (int64_t)(u >> 1) ^ -(int64_t)(u & 1);
+	}
+      else switch (info & _GSC_SIZE)
         {
           case _GSC_I16:	/* Encoded as 16-bit	*/
             {
@@ -1157,7 +1514,11 @@ scalarSize(char type)
     {
       uint64_t  big;
 
-      switch (info & _GSC_SIZE)
+      if (_version & COMPACT_FLAG)
+	{
+	  big = readVarint(_src, &_cursor);
+	}
+      else switch (info & _GSC_SIZE)
         {
           case _GSC_I16:	/* Encoded as 16-bit	*/
             {
@@ -1474,6 +1835,23 @@ scalarSize(char type)
   [self encodeValueOfObjCType: @encode(int) at: &pos];
 }
 
+/*
+ * Every remote invocation sends a method type, so in the compact encoding
+ * method types are interned like classes and selectors.
+ */
+- (void) encodeMethodType: (const char*)types
+{
+  if (internal->interns != nil && types != 0 && _initialPass == NO)
+    {
+      (*_eTagImp)(_dst, eTagSel, _GSC_TYPES);
+      [self _encodeInterned: types kind: _C_CHARPTR];
+    }
+  else
+    {
+      [self encodeValueOfObjCType: @encode(char*) at: &types];
+    }
+}
+
 - (void) encodeObject: (id)anObject
 {
   if (anObject == nil)
@@ -1707,6 +2085,69 @@ scalarSize(char type)
 	break;
     }
 
+  /*
+   *	In the compact encoding, integers are written as variable length
+   *	quantities (zigzag encoded if they are signed) after the usual tag,
+   *	so the decoder can still convert between sizes.
+   */
+  if (_version & COMPACT_FLAG)
+    {
+      uchar	info = _GSC_NONE;
+      BOOL	isSigned = YES;
+      int64_t	s = 0;
+      uint64_t	u = 0;
+
+      switch (*type)
+	{
+	  case _C_SHT:
+	    info = _GSC_SHT | _GSC_S_SHT;
+	    s = *(short*)buf;
+	    break;
+	  case _C_USHT:
+	    info = _GSC_USHT | _GSC_S_SHT;
+	    u = *(unsigned short*)buf;
+	    isSigned = NO;
+	    break;
+	  case _C_INT:
+	    info = _GSC_INT | _GSC_S_INT;
+	    s = *(int*)buf;
+	    break;
+	  case _C_UINT:
+	    info = _GSC_UINT | _GSC_S_INT;
+	    u = *(unsigned int*)buf;
+	    isSigned = NO;
+	    break;
+	  case _C_LNG:
+	    info = _GSC_LNG | _GSC_S_LNG;
+	    s = *(long*)buf;
+	    break;
+	  case _C_ULNG:
+	    info = _GSC_ULNG | _GSC_S_LNG;
+	    u = *(unsigned long*)buf;
+	    isSigned = NO;
+	    break;
+	  case _C_LNG_LNG:
+	    info = _GSC_LNG_LNG | _GSC_S_LNG_LNG;
+	    s = *(long long*)buf;
+	    break;
+	  case _C_ULNG_LNG:
+	    info = _GSC_ULNG_LNG | _GSC_S_LNG_LNG;
+	    u = *(unsigned long long*)buf;
+	    isSigned = NO;
+	    break;
+	}
+      if (info != _GSC_NONE)
+	{
+	  if (isSigned == YES)
+	    {
+	      u = ((uint64_t)s << 1) ^ (uint64_t)(s >> 63);
+	    }
+	  (*_eTagImp)(_dst, eTagSel, info);
+	  appendVarint(_dst, u);
+	  return;
+	}
+    }
+
   switch (*type)
     {
       case _C_CLASS:
@@ -1751,8 +2192,17 @@ scalarSize(char type)
 		/*
 		 *	Encode class, and version.
 		 */
-		(*_eSerImp)(_dst, eSerSel, &c, @encode(Class), nil);
-		(*_eSerImp)(_dst, eSerSel, &version, @encode(unsigned), nil);
+		if (internal->interns != nil)
+		  {
+		    [self _encodeInterned: c kind: _C_CLASS];
+		    appendVarint(_dst, version);
+		  }
+		else
+		  {
+		    (*_eSerImp)(_dst, eSerSel, &c, @encode(Class), nil);
+		    (*_eSerImp)(_dst, eSerSel, &version, @encode(unsigned),
+		      nil);
+		  }
 		/*
 		 *	If we have a super class that has not been encoded,
 		 *	we must loop round to encode it here so that its
@@ -1798,7 +2248,14 @@ scalarSize(char type)
 		/*
 		 *	Encode selector.
 		 */
-		(*_eSerImp)(_dst, eSerSel, buf, @encode(SEL), nil);
+		if (internal->interns != nil)
+		  {
+		    [self _encodeInterned: s kind: _C_SEL];
+		  }
+		else
+		  {
+		    (*_eSerImp)(_dst, eSerSel, buf, @encode(SEL), nil);
+		  }
 	      }
 	    else
 	      {
@@ -1927,6 +2384,7 @@ scalarSize(char type)
       firstTime = YES;
       _version = [super systemVersion];
       _zone = NSDefaultMallocZone();
+      GS_CREATE_INTERNAL(NSPortCoder)
     }
   else
     {
@@ -1997,11 +2455,27 @@ scalarSize(char type)
 	      GSIMapCleanMap(_ptrMap);
 	    }
 
+	  /*
+	   *	Use the compact encoding if the connection has agreed it
+	   *	with the other end.
+	   */
+	  [internal->defined setLength: 0];
+	  if ([_conn compactCoding] == YES)
+	    {
+	      ASSIGN(internal->interns, [_conn interns]);
+	      _version = encodingVersion | COMPACT_FLAG;
+	    }
+	  else
+	    {
+	      DESTROY(internal->interns);
+	      _version = encodingVersion;
+	    }
+
 	  /*
 	   *	Write dummy header
 	   */
 	  [self _serializeHeaderAt: _cursor
-			   version: [self systemVersion]
+			   version: _version
 			   classes: 0
 			   objects: 0
 			  pointers: 0];
@@ -2052,11 +2526,19 @@ scalarSize(char type)
 			     objects: &sizeO
 			    pointers: &sizeP];
 
-	  if (_version > encodingVersion)
+	  if ((_version & ~COMPACT_FLAG) > encodingVersion)
 	    {
 	      [NSException raise: NSInvalidArgumentException
 		format: @"Message systemVersion (%u) not recognised", _version];
 	    }
+	  if (_version & COMPACT_FLAG)
+	    {
+	      ASSIGN(internal->interns, [_conn interns]);
+	    }
+	  else
+	    {
+	      DESTROY(internal->interns);
+	    }
 
 	  /*
 	   *	Allocate and initialise arrays to build crossref maps in.
@@ -2119,7 +2601,7 @@ scalarSize(char type)
 
 - (unsigned) systemVersion
 {
-  return _version;
+  return _version & ~COMPACT_FLAG;
 }
 
 - (NSInteger) versionForClassName: (NSString*)className
@@ -2170,7 +2652,7 @@ scalarSize(char type)
        *	Write sizes of crossref arrays to head of archive.
        */
       [self _serializeHeaderAt: _cursor
-		       version: [self systemVersion]
+		       version: _version
 		       classes: _clsMap->nodeCount
 		       objects: _uIdMap->nodeCount
 		      pointers: _ptrMap->nodeCount];
@@ -2180,6 +2662,128 @@ scalarSize(char type)
 
 @end
 
+@implementation	NSPortCoder (Internal)
+
++ (BOOL) compactCodingAvailable
+{
+  return (encodingVersion >= COMPACT_MIN) ? YES : NO;
+}
+
+/* Returns the identifiers of the interned items sent in full in this
+ * message, or nil if there are none.
+ */
+- (NSData*) definedInterns
+{
+  if ([internal->defined length] == 0)
+    {
+      return nil;
+    }
+  return AUTORELEASE([internal->defined copy]);
+}
+
+- (BOOL) moreToDecode
+{
+  return (_src != nil && _cursor < [_src length]) ? YES : NO;
+}
+
+@end
+
+@implementation	NSPortCoder (Interns)
+
+- (const void*) _decodeInterned: (char)kind
+{
+  GSPortCoderInterns	*t = internal->interns;
+  uint64_t		v = readVarint(_src, &_cursor);
+  unsigned		ident = (unsigned)(v >> 1);
+  const void		*item = 0;
+
+  if (v & 1)
+    {
+      /*
+       *	The item is sent in full the first few times.
+       */
+      if (kind == _C_CLASS)
+	{
+	  (*_dDesImp)(_src, dDesSel, &item, @encode(Class), &_cursor, nil);
+	  [t setItem: item forIdentifier: ident];
+	}
+      else if (kind == _C_SEL)
+	{
+	  (*_dDesImp)(_src, dDesSel, &item, @encode(SEL), &_cursor, nil);
+	  [t setItem: item forIdentifier: ident];
+	}
+      else
+	{
+	  char	*tmp = 0;
+
+	  (*_dDesImp)(_src, dDesSel, &tmp, @encode(char*), &_cursor, nil);
+	  if (tmp == 0)
+	    {
+	      [NSException raise: NSInternalInconsistencyException
+			  format: @"interned method type %u is null", ident];
+	    }
+	  item = [t setTypes: tmp forIdentifier: ident];
+	  NSZoneFree(NSDefaultMallocZone(), tmp);
+	}
+    }
+  else if ([t getItem: &item
+	forIdentifier: ident
+		types: (kind == _C_CHARPTR) ? YES : NO] == NO)
+    {
+      [NSException raise: NSInternalInconsistencyException
+		  format: @"interned %s crossref missing - %u",
+	typeToName1(kind), ident];
+    }
+  return item;
+}
+
+- (void) _encodeInterned: (const void*)item kind: (char)kind
+{
+  GSPortCoderInterns	*t = internal->interns;
+  BOOL			isKnown;
+  unsigned		ident;
+
+  if (kind == _C_CHARPTR)
+    {
+      ident = [t identifierForTypes: (const char*)item known: &isKnown];
+    }
+  else
+    {
+      ident = [t identifierForItem: item known: &isKnown];
+    }
+  if (isKnown == YES)
+    {
+      appendVarint(_dst, (uint64_t)ident << 1);
+      return;
+    }
+
+  /*
+   *	Send the item in full, and remember that this message defines it so
+   *	that the connection can mark it as known to the other end once a
+   *	reply arrives.
+   */
+  appendVarint(_dst, ((uint64_t)ident << 1) | 1);
+  if (kind == _C_CLASS)
+    {
+      (*_eSerImp)(_dst, eSerSel, &item, @encode(Class), nil);
+    }
+  else if (kind == _C_SEL)
+    {
+      (*_eSerImp)(_dst, eSerSel, &item, @encode(SEL), nil);
+    }
+  else
+    {
+      (*_eSerImp)(_dst, eSerSel, &item, @encode(char*), nil);
+    }
+  if (internal->defined == nil)
+    {
+      internal->defined = [NSMutableData new];
+    }
+  [internal->defined appendBytes: &ident length: sizeof(ident)];
+}
+
+@end
+
 @implementation	NSPortCoder (Headers)
 
 - (void) _deserializeHeaderAt: (unsigned*)pos
@@ -2285,3 +2889,11 @@ scalarSize(char type)
 
 @end
 
+@implementation	NSCoder (DistantCoding)
+
+- (void) encodeMethodType: (const char*)types
+{
+  [self encodeValueOfObjCType: @encode(char*) at: &types];
+}
+
+@end
@@ -43,6 +43,7 @@
 #import "Foundation/NSException.h"
 #import "Foundation/NSKeyValueCoding.h"
 #import "Foundation/NSNull.h"
+#import "Foundation/NSRegularExpression.h"
 #import "Foundation/NSScanner.h"
 #import "Foundation/NSValue.h"
 
@@ -51,10 +52,6 @@
 // For pow()
 #include <math.h>
 
-#if     defined(HAVE_UNICODE_UREGEX_H)
-#include <unicode/uregex.h>
-#endif
-
 /* Object to represent the expression beign evaluated.
  */
 static NSExpression	*evaluatedObjectExpression = nil;
@@ -855,38 +852,21 @@ extern void     GSPropertyListMake(id,NSDictionary*,BOOL,BOOL,unsigned,id*);
 static BOOL
 GSICUStringMatchesRegex(NSString *string, NSString *regex, NSStringCompareOptions opts)
 {
-  BOOL result = NO;
-  UErrorCode error = 0;
-  uint32_t flags = 0;
-  NSUInteger stringLength = [string length];
-  NSUInteger regexLength = [regex length];
-  unichar *stringBuffer;
-  unichar *regexBuffer;
-  URegularExpression *icuregex = NULL;  
-
-  stringBuffer = malloc(stringLength * sizeof(unichar));
-  if (NULL == stringBuffer) { return NO; }
-  regexBuffer = malloc(regexLength * sizeof(unichar));
-  if (NULL == regexBuffer) { free(stringBuffer); return NO; }
-
-  [string getCharacters: stringBuffer range: NSMakeRange(0, stringLength)];
-  [regex getCharacters: regexBuffer range: NSMakeRange(0, regexLength)];
-
-  flags |= UREGEX_DOTALL; // . is supposed to recognize newlines
-  if ((opts & NSCaseInsensitiveSearch) != 0) { flags |= UREGEX_CASE_INSENSITIVE; }
+  NSUInteger		options;
+  NSRegularExpression	*icuregex;
 
-  icuregex = uregex_open(regexBuffer, regexLength, flags, NULL, &error);
-  if (icuregex != NULL && U_SUCCESS(error))
+  // . is supposed to recognize newlines
+  options = NSRegularExpressionDotMatchesLineSeparators;
+  if ((opts & NSCaseInsensitiveSearch) != 0)
     {
-      uregex_setText(icuregex, stringBuffer, stringLength, &error);
-      result = uregex_matches(icuregex, 0, &error);
+      options |= NSRegularExpressionCaseInsensitive;
     }
-  uregex_close(icuregex);
-
-  free(stringBuffer);
-  free(regexBuffer);
-
-  return result;
+  icuregex = GSPrivateRegularExpression(regex, options);
+  if (nil == icuregex)
+    {
+      return NO;
+    }
+  return GSPrivateRegularExpressionMatches(icuregex, string);
 }
 #endif
 
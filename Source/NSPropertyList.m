@@ -458,48 +458,120 @@ foundIgnorableWhitespace: (NSString *)string
 
 @interface GSBinaryPLParser : NSObject
 {
+@public
   NSPropertyListMutabilityOptions	mutability;
-  unsigned              _length;
+  NSUInteger            _length;
   const unsigned char	*_bytes;
   NSData		*data;
   unsigned		offset_size;	// Number of bytes per table entry
   unsigned		index_size;	// Number of bytes per table entry
-  unsigned		object_count;	// Number of objects
-  unsigned		root_index;	// Index of root object
-  unsigned		table_start;	// Start address of object table
-  NSHashTable           *_stack; // The stack of objects we are currently parsing
+  NSUInteger		object_count;	// Number of objects
+  NSUInteger		root_index;	// Index of root object
+  NSUInteger		table_start;	// Start address of object table
+  NSHashTable           *_stack; // Containers being parsed (eager only)
+  BOOL			_lazy;	// Return containers which decode on demand
 }
 
 - (id) initWithData: (NSData*)plData
 	 mutability: (NSPropertyListMutabilityOptions)m;
+- (id) initWithData: (NSData*)plData
+	 mutability: (NSPropertyListMutabilityOptions)m
+	       lazy: (BOOL)lazy;
 - (id) rootObject;
 - (id) objectAtIndex: (NSUInteger)index;
+- (id) objectAtIndex: (NSUInteger)index
+		path: (const NSUInteger*)path
+	       depth: (unsigned)depth;
+- (NSUInteger) readObjectIndexAt: (NSUInteger*)counter;
+
+@end
+
+/* Containers returned by a lazy binary property list parser.
+ * They keep the parser (and so the data it is reading) alive, and
+ * decode each element the first time it is asked for.
+ */
+@interface GSBinaryPLArray : NSArray
+{
+@public
+  GSBinaryPLParser	*_parser;
+  NSUInteger		*_path;		// Indices of this and its ancestors
+  unsigned		_depth;
+  NSUInteger		_refs;		// Position of object references
+  NSUInteger		_count;
+  id			*_objects;	// Decoded elements (nil until used)
+}
+- (id) initWithParser: (GSBinaryPLParser*)parser
+		 path: (const NSUInteger*)path
+		depth: (unsigned)depth
+		index: (NSUInteger)index
+		 refs: (NSUInteger)refs
+		count: (NSUInteger)count;
+@end
 
+@interface GSBinaryPLDictionary : NSDictionary
+{
+@public
+  GSBinaryPLParser	*_parser;
+  NSUInteger		*_path;		// Indices of this and its ancestors
+  unsigned		_depth;
+  NSUInteger		_refs;		// Position of key references
+  NSUInteger		_count;
+  id			*_keys;		// Decoded keys (nil until used)
+  id			*_values;	// Decoded values (nil until used)
+  NSUInteger		*_table;	// Hash of key positions, built on demand
+}
+- (id) initWithParser: (GSBinaryPLParser*)parser
+		 path: (const NSUInteger*)path
+		depth: (unsigned)depth
+		index: (NSUInteger)index
+		 refs: (NSUInteger)refs
+		count: (NSUInteger)count;
 @end
 
+/* A slot in the generator's table of recently written strings and numbers.
+ */
+typedef struct {
+  id		object;
+  NSUInteger	index;
+} GSBinaryPLShared;
+
 @interface GSBinaryPLGenerator : NSObject
 {
-  NSMutableData *dest;
-  NSMapTable 	*objectList;
-  NSMutableArray *objectsToDoList;
-  id root;
+  NSMutableData		*dest;		// Output not yet written to stream
+  NSOutputStream	*stream;	// Destination stream (or nil)
+  unsigned long long	flushed;	// Bytes already written to stream
+  NSHashTable		*path;		// Containers currently being visited
+  NSMapTable		*objectList;	// Objects written (or counted)
+  GSBinaryPLShared	*shared;	// Strings and numbers written recently
+  BOOL			bounded;	// Use shared rather than objectList
+  NSUInteger		count;		// Number of objects written
+  NSUInteger		capacity;	// Size of offsets array
+  unsigned long long	*offsets;	// Position of each object written
+  NSUInteger		root_index;	// Index of the root object
+  id			root;
 
   // Number of bytes per object table index
-  unsigned int index_size;
+  unsigned int		index_size;
   // Number of bytes per object table entry
-  unsigned int offset_size;
+  unsigned int		offset_size;
 
-  unsigned int table_start;
-  unsigned int table_size;
-  unsigned int *table;
+  unsigned long long	table_start;
 }
 
 + (void) serializePropertyList: (id)aPropertyList
                       intoData: (NSMutableData *)destination;
++ (unsigned long long) serializePropertyList: (id)aPropertyList
+				    toStream: (NSOutputStream *)aStream
+				     bounded: (BOOL)flag;
 - (id) initWithPropertyList: (id)aPropertyList
                    intoData: (NSMutableData *)destination;
+- (id) initWithPropertyList: (id)aPropertyList
+                   toStream: (NSOutputStream *)aStream;
 - (void) generate;
-- (BOOL) storeObject: (id)object;
+- (void) storeContainer: (unsigned char)marker
+		  count: (NSUInteger)len
+		   refs: (const NSUInteger*)refs;
+- (void) storeObject: (id)object;
 - (void) cleanup;
 
 @end
@@ -2738,6 +2810,59 @@ GSPropertyListMake(id obj, NSDictionary *loc, BOOL xml,
   return result;
 }
 
++ (id) propertyListWithContentsOfMappedFile: (NSString*)path
+				    options: (NSPropertyListReadOptions)anOption
+				     format: (NSPropertyListFormat*)aFormat
+				      error: (out NSError**)error
+{
+  NSData		*data;
+  GSBinaryPLParser	*volatile p = nil;
+  id			result = nil;
+
+  data = [NSData dataWithContentsOfMappedFile: path];
+  if (nil == data)
+    {
+      if (error != NULL)
+	{
+	  *error = create_error(0, [NSString stringWithFormat:
+	    @"unable to read property list from '%@'", path]);
+	}
+      return nil;
+    }
+  if (anOption != NSPropertyListImmutable || [data length] < 8
+    || memcmp([data bytes], "bplist00", 8) != 0)
+    {
+      return [self propertyListWithData: data
+				options: anOption
+				 format: aFormat
+				  error: error];
+    }
+
+  NS_DURING
+    {
+      p = [[GSBinaryPLParser alloc] initWithData: data
+				      mutability: anOption
+					    lazy: YES];
+      result = RETAIN([p rootObject]);
+    }
+  NS_HANDLER
+    {
+      result = nil;
+    }
+  NS_ENDHANDLER
+  RELEASE(p);
+  if (nil == result && error != NULL)
+    {
+      *error = create_error(0, @"failed to parse binary property list");
+    }
+  AUTORELEASE(result);
+  if (aFormat != 0)
+    {
+      *aFormat = NSPropertyListBinaryFormat_v1_0;
+    }
+  return result;
+}
+
 + (id) propertyListWithStream: (NSInputStream*)stream
                       options: (NSPropertyListReadOptions)anOption
                        format: (NSPropertyListFormat*)aFormat
@@ -2753,12 +2878,41 @@ GSPropertyListMake(id obj, NSDictionary *loc, BOOL xml,
                         options: (NSPropertyListWriteOptions)anOption
                           error: (out NSError**)error
 {
+  NSData *data;
+
+  if (aFormat == NSPropertyListBinaryFormat_v1_0)
+    {
+      NSInteger	written = 0;
+
+      /* Binary property lists are written to the stream as they are
+       * generated rather than being built in memory first.
+       */
+      NS_DURING
+	{
+	  written = (NSInteger)[GSBinaryPLGenerator
+	    serializePropertyList: aPropertyList
+			 toStream: stream
+			  bounded: (anOption & GSPropertyListWriteBounded)
+			    ? YES : NO];
+	}
+      NS_HANDLER
+	{
+	  if (error != NULL)
+	    {
+	      *error = create_error(0, [localException reason]);
+	    }
+	  written = 0;
+	}
+      NS_ENDHANDLER
+      return written;
+    }
+
   // FIXME: The NSData operations should be implemented on top of this method, 
   // not the other way round,
-  NSData *data = [self dataWithPropertyList: aPropertyList
-                                     format: aFormat
-                                    options: 0
-                                      error: error];
+  data = [self dataWithPropertyList: aPropertyList
+                             format: aFormat
+                            options: 0
+                              error: error];
 
   return [stream write: [data bytes] maxLength: [data length]];
 }
@@ -2835,9 +2989,55 @@ GSPropertyListMake(id obj, NSDictionary *loc, BOOL xml,
 }
 @end
 
+id
+GSPrivateLazyPropertyList(NSData *data)
+{
+  GSBinaryPLParser	*volatile p = nil;
+  id			result = nil;
+
+  if ([data length] < 8 || memcmp([data bytes], "bplist00", 8) != 0)
+    {
+      return nil;
+    }
+  /* The containers read from the data on demand, so they must not
+   * see it change.
+   */
+  data = AUTORELEASE([data copy]);
+  NS_DURING
+    {
+      /* p is only set once the initialiser has returned, as one which
+       * fails has already deallocated the parser.
+       */
+      p = [[GSBinaryPLParser alloc] initWithData: data
+				      mutability: NSPropertyListImmutable
+					    lazy: YES];
+      result = RETAIN([p rootObject]);
+    }
+  NS_HANDLER
+    {
+      result = nil;
+    }
+  NS_ENDHANDLER
+  RELEASE(p);
+  return AUTORELEASE(result);
+}
+
 
 
 
+/* Reads an unsigned big-endian value of the given size (1 to 8 bytes).
+ */
+static inline unsigned long long
+readBigEndian(const unsigned char *p, unsigned size)
+{
+  unsigned long long	v = *p++;
+
+  while (--size > 0)
+    {
+      v = (v << 8) + *p++;
+    }
+  return v;
+}
 
 @implementation GSBinaryPLParser
 #define PUSH_OBJ(index) if (NO == [self _pushObject: index]) \
@@ -2857,6 +3057,13 @@ GSPropertyListMake(id obj, NSDictionary *loc, BOOL xml,
 
 - (id) initWithData: (NSData*)plData
 	 mutability: (NSPropertyListMutabilityOptions)m
+{
+  return [self initWithData: plData mutability: m lazy: NO];
+}
+
+- (id) initWithData: (NSData*)plData
+	 mutability: (NSPropertyListMutabilityOptions)m
+	       lazy: (BOOL)lazy
 {
   _length = [plData length];
   if (_length < 32)
@@ -2865,21 +3072,22 @@ GSPropertyListMake(id obj, NSDictionary *loc, BOOL xml,
     }
   else
     {
-      unsigned char postfix[32];
+      unsigned char		postfix[32];
+      unsigned long long	count;
+      unsigned long long	root;
+      unsigned long long	start;
 
       [plData getBytes: postfix range: NSMakeRange(_length - 32, 32)];
       offset_size = postfix[6];
       index_size = postfix[7];
-      // FIXME: Looks like the following are actually 8 byte values.
-      // But taking the lower 4 bytes is currently sufficient.
-      object_count = (postfix[12] << 24) + (postfix[13] << 16)
-	+ (postfix[14] << 8) + postfix[15];
-      root_index = (postfix[20] << 24) + (postfix[21] << 16)
-	+ (postfix[22] << 8) + postfix[23];
-      table_start = (postfix[28] << 24) + (postfix[29] << 16)
-	+ (postfix[30] << 8) + postfix[31];
+      /* The object count, root index and table start are stored as
+       * 64-bit big-endian values.
+       */
+      count = readBigEndian(postfix + 8, 8);
+      root = readBigEndian(postfix + 16, 8);
+      start = readBigEndian(postfix + 24, 8);
 
-      if (offset_size < 1 || offset_size > 4)
+      if (offset_size < 1 || offset_size > 8)
 	{
 	  unsigned saved = offset_size;
 
@@ -2887,7 +3095,7 @@ GSPropertyListMake(id obj, NSDictionary *loc, BOOL xml,
 	  [NSException raise: NSGenericException
 		      format: @"Unknown offset size %d", saved];
 	}
-      else if (index_size < 1 || index_size > 4)
+      else if (index_size < 1 || index_size > 8)
 	{
 	  unsigned saved = index_size;
 
@@ -2895,80 +3103,77 @@ GSPropertyListMake(id obj, NSDictionary *loc, BOOL xml,
 	  [NSException raise: NSGenericException
 		      format: @"Unknown table size %d", saved];
 	}
-      else if (table_start + object_count * offset_size > _length)
+      else if (start > _length || count > (_length - start) / offset_size)
         {
 	  DESTROY(self);	// Bad format
 	  [NSException raise: NSGenericException
 		      format: @"Table size larger than supplied data"];
         }
-      else if (root_index >= object_count)
+      else if (root >= count)
 	{
 	  DESTROY(self);	// Bad format
 	}
-      else if (table_start > _length - 32)
+      else if (start > _length - 32)
 	{
 	  DESTROY(self);	// Bad format
 	}
       else
 	{
+	  object_count = (NSUInteger)count;
+	  root_index = (NSUInteger)root;
+	  table_start = (NSUInteger)start;
 	  ASSIGN(data, plData);
 	  _bytes = (const unsigned char*)[data bytes];
 	  mutability = m;
+	  _lazy = lazy;
 	}
     }
 
   return self;
 }
 
-- (unsigned long) offsetForIndex: (unsigned)index
+- (NSUInteger) offsetForIndex: (NSUInteger)index
 {
   if (index >= object_count)
     {
       [NSException raise: NSRangeException
-		   format: @"Object table index out of bounds %d.", index];
+		   format: @"Object table index out of bounds %"PRIuPTR".",
+	index];
       return 0; /* Not reached */
     }
   else
     {
-      unsigned long     offset;
-      unsigned          count;
-      unsigned          pos;
+      unsigned long long	offset;
 
       /* An offset is stored in big-endian byte order, so we can simply
        * read it byte by byte.
        */
-      pos = table_start + index * offset_size;
-      offset = _bytes[pos++];
-      for (count = 1; count < offset_size; count++)
-        {
-          offset = (offset << 8) + _bytes[pos++];
-        }
-      return offset;
+      offset = readBigEndian(_bytes + table_start + index * offset_size,
+	offset_size);
+      if (offset >= _length - 32)
+	{
+	  [NSException raise: NSGenericException
+		       format: @"Object offset out of bounds %llu.", offset];
+	}
+      return (NSUInteger)offset;
     }
 }
 
-- (unsigned) readObjectIndexAt: (unsigned*)counter
+- (NSUInteger) readObjectIndexAt: (NSUInteger*)counter
 {
-  unsigned      index;
-  unsigned      count;
-  unsigned      pos;
+  NSUInteger	pos;
 
 NSAssert(0 != counter, NSInvalidArgumentException);
   pos = *counter;
 NSAssert(pos + index_size < _length, NSInvalidArgumentException);
-  index = _bytes[pos++];
-  for (count = 1; count < index_size; count++)
-    {
-      index = (index << 8) + _bytes[pos++];
-    }
-  *counter = pos;
-  return index;
+  *counter = pos + index_size;
+  return (NSUInteger)readBigEndian(_bytes + pos, index_size);
 }
 
-- (unsigned long) readCountAt: (unsigned*) counter
+- (NSUInteger) readCountAt: (NSUInteger*) counter
 {
-  unsigned long count;
-  unsigned      pos;
+  NSUInteger	count;
+  NSUInteger	pos;
   unsigned char c;
 
 NSAssert(0 != counter, NSInvalidArgumentException);
@@ -2976,34 +3181,26 @@ NSAssert(0 != counter, NSInvalidArgumentException);
 NSAssert(pos <= _length, NSInvalidArgumentException);
   c = _bytes[pos++];
 
-  if (c == 0x10)
-    {
-NSAssert(pos + 1 < _length, NSInvalidArgumentException);
-      count = _bytes[pos++];
-      *counter = pos;
-      return count;
-    }
-  else if (c == 0x11)
-    {
-NSAssert(pos + 2 < _length, NSInvalidArgumentException);
-      count = _bytes[pos++];
-      count = (count << 8) + _bytes[pos++];
-      *counter = pos;
-      return count;
-    }
-  // FIXME: Handling for 0x13 is wrong, but this value will only
-  // show up for incorrect old GNUstep property lists.
-  else if ((c == 0x12) || (c == 0x13))
+  if (c >= 0x10 && c <= 0x13)
     {
-      unsigned len = 4;
+      unsigned			len = 1 << (c & 0x0F);
+      unsigned long long	value;
 
-NSAssert(pos + 4 < _length, NSInvalidArgumentException);
-      count = _bytes[pos++];
-      while (--len > 0)
-        {
-          count = (count << 8) + _bytes[pos++];
-        }
-      *counter = pos;
+      /* The count is an integer of 1, 2, 4 or 8 bytes.
+       */
+      if (pos + len >= _length)
+	{
+	  [NSException raise: NSGenericException
+		      format: @"Count larger than supplied data"];
+	}
+      value = readBigEndian(_bytes + pos, len);
+      if (value > (unsigned long long)(_length - pos))
+	{
+	  [NSException raise: NSGenericException
+		      format: @"Count %llu larger than supplied data", value];
+	}
+      count = (NSUInteger)value;
+      *counter = pos + len;
       return count;
     }
   else
@@ -3020,9 +3217,16 @@ NSAssert(pos + 4 < _length, NSInvalidArgumentException);
   return [self objectAtIndex: root_index];
 }
 
+/* The stack is used to detect cycles while an eager parser decodes the
+ * whole graph in a single call on one thread.  A lazy parser is shared
+ * by the containers it returns, which may be used from several threads,
+ * so it checks the path held by each container instead.
+ */
 - (BOOL)_pushObject: (NSUInteger)index
 {
   uintptr_t val;
+
+  NSAssert(NO == _lazy, NSInternalInconsistencyException);
   if (nil == _stack)
     {
       _stack = NSCreateHashTable(NSIntegerHashCallBacks,
@@ -3043,16 +3247,72 @@ NSAssert(pos + 4 < _length, NSInvalidArgumentException);
 }
 
 - (id) objectAtIndex: (NSUInteger)index
+{
+  return [self objectAtIndex: index path: 0 depth: 0];
+}
+
+/* Decodes the object at index.  When the parser is lazy, arrays and
+ * dictionaries are returned as containers which decode their contents
+ * on first access; path holds the indices of the container being
+ * decoded and its ancestors, so that cycles can still be detected.
+ */
+- (id) objectAtIndex: (NSUInteger)index
+		path: (const NSUInteger*)path
+	       depth: (unsigned)depth
 {
   unsigned char	next;
-  unsigned counter = [self offsetForIndex: index];
+  NSUInteger	counter = [self offsetForIndex: index];
   id	        result = nil;
 
-  [data getBytes: &next range: NSMakeRange(counter,1)];
+  next = _bytes[counter];
   //NSLog(@"read object %d at index %d type %d", index, counter, next);
   counter += 1;
 
-  if (next == 0x08)
+  if (YES == _lazy && ((next & 0xF0) == 0xA0 || (next & 0xF0) == 0xD0))
+    {
+      NSUInteger	count;
+      unsigned		i;
+
+      for (i = 0; i < depth; i++)
+	{
+	  if (path[i] == index)
+	    {
+	      [NSException raise: NSGenericException
+			  format: @"Cyclic object graph"];
+	    }
+	}
+      count = next & 0x0F;
+      if (count == 0x0F)
+	{
+	  count = [self readCountAt: &counter];
+	}
+      if ((next & 0xF0) == 0xA0)
+	{
+	  if (count > (_length - counter) / index_size)
+	    {
+	      [NSException raise: NSGenericException
+			  format: @"Array larger than supplied data"];
+	    }
+	  result = [GSBinaryPLArray alloc];
+	}
+      else
+	{
+	  if (count > (_length - counter) / index_size / 2)
+	    {
+	      [NSException raise: NSGenericException
+			  format: @"Dictionary larger than supplied data"];
+	    }
+	  result = [GSBinaryPLDictionary alloc];
+	}
+      result = [result initWithParser: self
+				 path: path
+				depth: depth
+				index: index
+				 refs: counter
+				count: count];
+      return AUTORELEASE(result);
+    }
+  else if (next == 0x08)
     {
       // NO
       result = boolN;
@@ -3129,7 +3389,7 @@ NSAssert(counter + len <= _length, NSInvalidArgumentException);
   else if (next == 0x4F)
     {
       // long data
-      unsigned long len;
+      NSUInteger len;
 
       len = [self readCountAt: &counter];
 NSAssert(counter + len <= _length, NSInvalidArgumentException);
@@ -3166,7 +3426,7 @@ NSAssert(counter + len <= _length, NSInvalidArgumentException);
   else if (next == 0x5F)
     {
       NSString  *s;     // Long utf8 string
-      unsigned	len;
+      NSUInteger	len;
 
       if (mutability == NSPropertyListMutableContainersAndLeaves)
 	{
@@ -3203,8 +3463,8 @@ NSAssert(counter + len <= _length, NSInvalidArgumentException);
     }
   else if (next == 0x6F)
     {
-      NSString          *s;     // Short unicode string
-      unsigned long     len;
+      NSString          *s;     // Long unicode string
+      NSUInteger        len;
 
       if (mutability == NSPropertyListMutableContainersAndLeaves)
 	{
@@ -3220,35 +3480,27 @@ NSAssert(counter + len <= _length, NSInvalidArgumentException);
                   encoding: NSUTF16BigEndianStringEncoding];
       result = [s autorelease];
     }
-  else if (next == 0x80)
-    {
-      unsigned char	index;
-
-      [data getBytes: &index range: NSMakeRange(counter,1)];
-      result = [NSDictionary dictionaryWithObject:
-				 [NSNumber numberWithInt: index]
-			     forKey: @"CF$UID"];
-    }
-  else if (next == 0x81)
+  else if ((next >= 0x80) && (next < 0x88))
     {
-      unsigned short	index;
+      // Keyed archiver reference
+      unsigned	len = next - 0x7F;
 
-      [data getBytes: &index range: NSMakeRange(counter,2)];
-      index = NSSwapBigShortToHost(index);
+NSAssert(counter + len <= _length, NSInvalidArgumentException);
       result = [NSDictionary dictionaryWithObject:
-				 [NSNumber numberWithInt: index]
+	[NSNumber numberWithUnsignedLongLong:
+	  readBigEndian(_bytes + counter, len)]
 			     forKey: @"CF$UID"];
     }
   else if ((next >= 0xA0) && (next < 0xAF))
     {
       // short array
-      unsigned	len = next - 0xA0;
-      unsigned	i;
+      NSUInteger	len = next - 0xA0;
+      NSUInteger	i;
       id	objects[len];
       PUSH_OBJ(index);
       for (i = 0; i < len; i++)
         {
-	  int oid = [self readObjectIndexAt: &counter];
+	  NSUInteger oid = [self readObjectIndexAt: &counter];
 
 	  objects[i] = [self objectAtIndex: oid];
 	}
@@ -3266,8 +3518,8 @@ NSAssert(counter + len <= _length, NSInvalidArgumentException);
   else if (next == 0xAF)
     {
       // big array
-      unsigned	long len;
-      unsigned	i;
+      NSUInteger	len;
+      NSUInteger	i;
       id	*objects;
 
       len = [self readCountAt: &counter];
@@ -3275,7 +3527,7 @@ NSAssert(counter + len <= _length, NSInvalidArgumentException);
       PUSH_OBJ(index);
       for (i = 0; i < len; i++)
         {
-	  int oid = [self readObjectIndexAt: &counter];
+	  NSUInteger oid = [self readObjectIndexAt: &counter];
 
 	  objects[i] = [self objectAtIndex: oid];
 	}
@@ -3294,20 +3546,20 @@ NSAssert(counter + len <= _length, NSInvalidArgumentException);
   else if ((next >= 0xD0) && (next < 0xDF))
     {
       // dictionary
-      unsigned	len = next - 0xD0;
-      unsigned	i;
+      NSUInteger	len = next - 0xD0;
+      NSUInteger	i;
       id	keys[len];
       id	values[len];
       PUSH_OBJ(index);
       for (i = 0; i < len; i++)
         {
-	  int oid = [self readObjectIndexAt: &counter];
+	  NSUInteger oid = [self readObjectIndexAt: &counter];
 
 	  keys[i] = [self objectAtIndex: oid];
 	}
       for (i = 0; i < len; i++)
         {
-	  int oid = [self readObjectIndexAt: &counter];
+	  NSUInteger oid = [self readObjectIndexAt: &counter];
 
 	  values[i] = [self objectAtIndex: oid];
 	}
@@ -3330,8 +3582,8 @@ NSAssert(counter + len <= _length, NSInvalidArgumentException);
   else if (next == 0xDF)
     {
       // big dictionary
-      unsigned	long len;
-      unsigned	i;
+      NSUInteger	len;
+      NSUInteger	i;
       id	*keys;
       id	*values;
 
@@ -3341,14 +3593,14 @@ NSAssert(counter + len <= _length, NSInvalidArgumentException);
       PUSH_OBJ(index);
       for (i = 0; i < len; i++)
         {
-	  int oid = [self readObjectIndexAt: &counter];
+	  NSUInteger oid = [self readObjectIndexAt: &counter];
 
 	  keys[i] = [self objectAtIndex: oid];
 	}
 
       for (i = 0; i < len; i++)
         {
-	  int oid = [self readObjectIndexAt: &counter];
+	  NSUInteger oid = [self readObjectIndexAt: &counter];
 
 	  values[i] = [self objectAtIndex: oid];
 	}
@@ -3380,381 +3632,538 @@ NSAssert(counter + len <= _length, NSInvalidArgumentException);
 #undef POP_OBJ
 @end
 
-/* Test two items for equality ... both are objects.
- * If either is an NSNumber, we insist that they are the same class
- * so that numbers with the same numeric value but different classes
- * are not treated as the same number (that confuses OSXs decoding).
+/* Decodes the object referenced at pos by a lazy container and stores
+ * it in slot.  If another thread got there first, its object is used.
  */
-static BOOL
-isEqualFunc(const void *item1, const void *item2,
-  NSUInteger (*size)(const void *item))
+static id
+lazyDecode(GSBinaryPLParser *parser, NSUInteger pos, id *slot,
+  const NSUInteger *path, unsigned depth)
 {
-  id	o1 = (id)item1;
-  id	o2 = (id)item2;
+  NSUInteger	oid = [parser readObjectIndexAt: &pos];
+  id		o;
 
-  if ([o1 isKindOfClass: [NSNumber class]]
-    || [o2 isKindOfClass: [NSNumber class]])
+  o = RETAIN([parser objectAtIndex: oid path: path depth: depth]);
+  if (__sync_bool_compare_and_swap(slot, nil, o) == NO)
     {
-      if ([o1 class] != [o2 class])
-	{
-	  return NO;
-	}
+      RELEASE(o);
+      o = *slot;
     }
-  return [o1 isEqual: o2];
+  return o;
 }
 
-@implementation GSBinaryPLGenerator
-
-+ (void) serializePropertyList: (id)aPropertyList
-		      intoData: (NSMutableData *)destination
+static NSUInteger *
+lazyPath(const NSUInteger *path, unsigned depth, NSUInteger index)
 {
-  GSBinaryPLGenerator *gen;
+  NSUInteger	*p;
 
-  gen = [[GSBinaryPLGenerator alloc]
-    initWithPropertyList: aPropertyList intoData: destination];
-  [gen generate];
-  RELEASE(gen);
+  p = NSZoneMalloc(NSDefaultMallocZone(), (depth + 1) * sizeof(NSUInteger));
+  if (depth > 0)
+    {
+      memcpy(p, path, depth * sizeof(NSUInteger));
+    }
+  p[depth] = index;
+  return p;
 }
 
-- (id) initWithPropertyList: (id) aPropertyList
-		   intoData: (NSMutableData *)destination
+static void
+lazyFree(id *objects, NSUInteger count)
 {
-  ASSIGN(root, aPropertyList);
-  ASSIGN(dest, destination);
-  [dest setLength: 0];
+  if (objects != 0)
+    {
+      NSUInteger	i;
 
-  return self;
+      for (i = 0; i < count; i++)
+	{
+	  RELEASE(objects[i]);
+	}
+      NSZoneFree(NSDefaultMallocZone(), objects);
+    }
 }
 
-- (void) dealloc
+@implementation GSBinaryPLArray
+
+- (id) initWithParser: (GSBinaryPLParser*)parser
+		 path: (const NSUInteger*)path
+		depth: (unsigned)depth
+		index: (NSUInteger)index
+		 refs: (NSUInteger)refs
+		count: (NSUInteger)count
 {
-  DESTROY(root);
-  [self cleanup];
-  DESTROY(dest);
-  [super dealloc];
+  if (nil != (self = [super init]))
+    {
+      ASSIGN(_parser, parser);
+      _path = lazyPath(path, depth, index);
+      _depth = depth + 1;
+      _refs = refs;
+      _count = count;
+      if (count > 0)
+	{
+	  _objects = NSZoneCalloc(NSDefaultMallocZone(), count, sizeof(id));
+	}
+    }
+  return self;
 }
 
-- (NSData*) data
+- (id) copyWithZone: (NSZone*)zone
 {
-  return dest;
+  return RETAIN(self);
 }
 
-- (void) setup
+- (NSUInteger) count
 {
-  NSPointerFunctions	*k;
-  NSPointerFunctions	*v;
+  return _count;
+}
 
-  [dest setLength: 0];
-  if (index_size == 1)
-    {
-      table_size = 256;
-    }
-  else if (index_size == 2)
+- (void) dealloc
+{
+  lazyFree(_objects, _count);
+  if (_path != 0)
     {
-      table_size = 256 * 256;
+      NSZoneFree(NSDefaultMallocZone(), _path);
     }
-  else if (index_size == 3)
+  DESTROY(_parser);
+  [super dealloc];
+}
+
+- (id) objectAtIndex: (NSUInteger)index
+{
+  id	o;
+
+  if (index >= _count)
     {
-      table_size = 256 * 256 * 256;
+      [NSException raise: NSRangeException
+		  format: @"Index %"PRIuPTR" is out of range %"PRIuPTR
+	" (in '%@')", index, _count, NSStringFromSelector(_cmd)];
     }
-  else if (index_size == 4)
+  o = _objects[index];
+  if (nil == o)
     {
-      table_size = UINT_MAX;
+      o = lazyDecode(_parser, _refs + index * _parser->index_size,
+	&_objects[index], _path, _depth);
     }
+  return o;
+}
 
-  table = NSZoneMalloc(0, table_size * sizeof(int));
+@end
 
-  objectsToDoList = [[NSMutableArray alloc] init];
-  k = [NSPointerFunctions pointerFunctionsWithOptions:
-    NSPointerFunctionsObjectPersonality];
-  [k setIsEqualFunction: isEqualFunc];
-  v = [NSPointerFunctions pointerFunctionsWithOptions:
-    NSPointerFunctionsIntegerPersonality|NSPointerFunctionsOpaqueMemory];
-  objectList = [[NSMapTable alloc] initWithKeyPointerFunctions: k
-					 valuePointerFunctions: v
-						      capacity: 1000];
+/* The hash table has at least twice as many slots as there are keys.
+ */
+static inline NSUInteger
+lazyTableSize(NSUInteger count)
+{
+  NSUInteger	size = 8;
 
-  [objectsToDoList addObject: root];
-  [objectList setObject: (id)1 forKey: root];
+  while (size < count * 2)
+    {
+      size <<= 1;
+    }
+  return size;
 }
 
-- (void) cleanup
+@implementation GSBinaryPLDictionary
+
+- (id) initWithParser: (GSBinaryPLParser*)parser
+		 path: (const NSUInteger*)path
+		depth: (unsigned)depth
+		index: (NSUInteger)index
+		 refs: (NSUInteger)refs
+		count: (NSUInteger)count
 {
-  DESTROY(objectsToDoList);
-  DESTROY(objectList);
-  if (table != NULL)
-    {
-      NSZoneFree(0, table);
-      table = NULL;
+  if (nil != (self = [super init]))
+    {
+      ASSIGN(_parser, parser);
+      _path = lazyPath(path, depth, index);
+      _depth = depth + 1;
+      _refs = refs;
+      _count = count;
+      if (count > 0)
+	{
+	  _keys = NSZoneCalloc(NSDefaultMallocZone(), count * 2, sizeof(id));
+	  _values = _keys + count;
+	}
     }
+  return self;
 }
 
-- (BOOL) writeObjects
+- (id) copyWithZone: (NSZone*)zone
 {
-  id object;
-  const char *prefix = "bplist00";
+  return RETAIN(self);
+}
 
-  [dest appendBytes: prefix length: strlen(prefix)];
+- (NSUInteger) count
+{
+  NSUInteger	*order;
 
-  while ([objectsToDoList count] != 0)
+  if (0 == _count)
     {
-      object = [objectsToDoList objectAtIndex: 0];
-      if (NO == [self storeObject: object])
-        {
-          return NO;
-        }
-      [objectsToDoList removeObjectAtIndex: 0];
+      return 0;
     }
-  return YES;
+  return [self _uniqueKeys: &order];
 }
 
-- (BOOL) markOffset: (unsigned int) offset for: (id)object
+- (NSUInteger) countByEnumeratingWithState: (NSFastEnumerationState*)state
+				   objects: (__unsafe_unretained id[])stackbuf
+				     count: (NSUInteger)len
 {
-  int oid;
+  NSUInteger	*order;
+  NSUInteger	unique;
+  NSUInteger	n;
 
-  oid = (NSInteger)[objectList objectForKey: object];
-  if (oid <= 0)
+  if (0 == _count)
     {
-      [NSException raise: NSGenericException
-		   format: @"Unknown object %@.", object];
+      return 0;
     }
-  oid--;
-  if (oid >= table_size)
+  unique = [self _uniqueKeys: &order];
+  state->mutationsPtr = (unsigned long *)self;
+  if (0 == order)
     {
-      return NO;
+      state->itemsPtr = _keys + state->state;
+      n = _count - state->state;
     }
-
-  table[oid] = offset;
-  return YES;
+  else
+    {
+      n = unique - state->state;
+      if (n > len)
+	{
+	  n = len;
+	}
+      for (len = 0; len < n; len++)
+	{
+	  stackbuf[len] = _keys[order[state->state + len]];
+	}
+      state->itemsPtr = stackbuf;
+    }
+  state->state += n;
+  return n;
 }
 
-- (void) writeObjectTable
+- (void) dealloc
 {
-  unsigned int size;
-  unsigned int len;
-  unsigned int i;
-  unsigned char *buffer;
-  unsigned int last_offset;
-
-  table_start = [dest length];
-  // This is a bit too much, as the length
-  // of the last object is added.
-  last_offset = table_start;
-
-  if (last_offset < 256)
+  lazyFree(_keys, _count * 2);
+  if (_table != 0)
     {
-      offset_size = 1;
+      NSZoneFree(NSDefaultMallocZone(), _table);
     }
-  else if (last_offset < 256 * 256)
+  if (_path != 0)
     {
-      offset_size = 2;
+      NSZoneFree(NSDefaultMallocZone(), _path);
     }
-  else if (last_offset < 256 * 256 * 256)
+  DESTROY(_parser);
+  [super dealloc];
+}
+
+- (void) _decodeKeys
+{
+  unsigned	size = _parser->index_size;
+  NSUInteger	i;
+
+  for (i = 0; i < _count; i++)
     {
-      offset_size = 3;
+      if (nil == _keys[i])
+	{
+	  lazyDecode(_parser, _refs + i * size, &_keys[i], _path, _depth);
+	}
     }
-  else
-    {
-      offset_size = 4;
-    }
-
-  len = [objectList count];
-  size = offset_size * len;
+}
 
-  buffer = NSZoneMalloc(0, size);
+/* Builds the table mapping key hashes to positions the first time a
+ * key is looked up or the keys are counted.  Later duplicates of a key
+ * replace earlier ones, as they do when a dictionary is built from the
+ * same data.  The slots are followed in the same allocation by the
+ * number of distinct keys and, if there were duplicates, the positions
+ * of the keys which replaced them (in the order they appear).
+ */
+- (NSUInteger*) _lookupTable
+{
+  NSUInteger	*table = _table;
 
-  if (offset_size == 1)
+  if (0 == table)
     {
-      for (i = 0; i < len; i++)
-        {
-	  unsigned char ci;
+      NSUInteger	mask = lazyTableSize(_count) - 1;
+      NSUInteger	unique = 0;
+      NSUInteger	i;
 
-	  ci = table[i];
-	  buffer[i] = ci;
-	}
-    }
-  else if (offset_size == 2)
-    {
-      for (i = 0; i < len; i++)
-        {
-	  unsigned short si;
+      [self _decodeKeys];
+      table = NSZoneCalloc(NSDefaultMallocZone(), mask + 2 + _count,
+	sizeof(NSUInteger));
+      for (i = 0; i < _count; i++)
+	{
+	  NSUInteger	h = [_keys[i] hash] & mask;
 
-	  si = table[i];
-	  buffer[2 * i] = (si >> 8);
-	  buffer[2 * i + 1] = si % 256;
+	  while (table[h] != 0 && NO == [_keys[table[h] - 1] isEqual: _keys[i]])
+	    {
+	      h = (h + 1) & mask;
+	    }
+	  if (0 == table[h])
+	    {
+	      unique++;
+	    }
+	  table[h] = i + 1;
 	}
-    }
-  else if (offset_size == 3)
-    {
-      for (i = 0; i < len; i++)
-        {
-	  unsigned int si;
+      table[mask + 1] = unique;
+      if (unique < _count)
+	{
+	  NSUInteger	*order = table + mask + 2;
+	  NSUInteger	n = 0;
 
-	  si = table[i];
-	  buffer[3 * i] = (si >> 16);
-	  buffer[3 * i + 1] = (si >> 8) % 256;
-	  buffer[3 * i + 2] = si % 256;
-	}
-    }
-  else if (offset_size == 4)
-    {
-      for (i = 0; i < len; i++)
-        {
-	  unsigned int si;
+	  for (i = 0; i < _count; i++)
+	    {
+	      NSUInteger	h = [_keys[i] hash] & mask;
 
-	  si = table[i];
-	  buffer[4 * i] = (si >> 24);
-	  buffer[4 * i + 1] = (si >> 16) % 256;
-	  buffer[4 * i + 2] = (si >> 8) % 256;
-	  buffer[4 * i + 3] = si % 256;
+	      while (NO == [_keys[table[h] - 1] isEqual: _keys[i]])
+		{
+		  h = (h + 1) & mask;
+		}
+	      if (table[h] == i + 1)
+		{
+		  order[n++] = i;
+		}
+	    }
+	}
+      if (__sync_bool_compare_and_swap(&_table, 0, table) == NO)
+	{
+	  NSZoneFree(NSDefaultMallocZone(), table);
+	  table = _table;
 	}
     }
-
-  [dest appendBytes: buffer length: size];
-  NSZoneFree(0, buffer);
+  return table;
 }
 
-- (void) writeMetaData
+/* Returns the number of distinct keys and sets *order to the positions
+ * of those keys, or to 0 if there were no duplicates.
+ */
+- (NSUInteger) _uniqueKeys: (NSUInteger**)order
 {
-  unsigned char meta[32];
-  unsigned int i;
-  unsigned int len;
-
-  for (i = 0; i < 32; i++)
-    {
-      meta[i] = 0;
-    }
-
-  meta[6] = offset_size;
-  meta[7] = index_size;
-
-  len = [objectList count];
-  meta[12] = (len >> 24);
-  meta[13] = (len >> 16) % 256;
-  meta[14] = (len >> 8) % 256;
-  meta[15] = len % 256;
-  // root index is always 0, no need to write it
-  meta[28] = (table_start >> 24);
-  meta[29] = (table_start >> 16) % 256;
-  meta[30] = (table_start >> 8) % 256;
-  meta[31] = table_start % 256;
+  NSUInteger	*table = [self _lookupTable];
+  NSUInteger	mask = lazyTableSize(_count) - 1;
+  NSUInteger	unique = table[mask + 1];
 
-  [dest appendBytes: meta length: 32];
+  *order = (unique < _count) ? table + mask + 2 : 0;
+  return unique;
 }
 
-- (NSInteger) indexForObject: (id)object
+- (NSEnumerator*) keyEnumerator
 {
-  NSInteger index;
+  NSUInteger	*order;
+  NSUInteger	unique;
+  NSUInteger	i;
+  id		*keys;
+  NSArray	*a;
 
-  index = (NSInteger)[objectList objectForKey: object];
-  if (index <= 0)
+  if (0 == _count)
     {
-      index = [objectList count];
-      [objectList setObject: (id)(++index) forKey: object];
-      [objectsToDoList addObject: object];
+      return [[NSArray array] objectEnumerator];
     }
-
-  return index - 1;
+  unique = [self _uniqueKeys: &order];
+  if (0 == order)
+    {
+      return [[NSArray arrayWithObjects: _keys count: _count]
+	objectEnumerator];
+    }
+  keys = NSZoneMalloc(NSDefaultMallocZone(), unique * sizeof(id));
+  for (i = 0; i < unique; i++)
+    {
+      keys[i] = _keys[order[i]];
+    }
+  a = [NSArray arrayWithObjects: keys count: unique];
+  NSZoneFree(NSDefaultMallocZone(), keys);
+  return [a objectEnumerator];
 }
 
-- (void) storeIndex: (NSInteger)index
+- (id) objectForKey: (id)aKey
 {
-  if (index_size == 1)
-    {
-      unsigned char oid;
+  NSUInteger	*table;
+  NSUInteger	mask;
+  NSUInteger	h;
+  NSUInteger	i;
 
-      oid = index;
-      [dest appendBytes: &oid length: 1];
-    }
-  else if (index_size == 2)
+  if (nil == aKey || 0 == _count)
     {
-      unsigned short oid;
-
-      oid = NSSwapHostShortToBig(index);
-      [dest appendBytes: &oid length: 2];
+      return nil;
     }
-  else if (index_size == 3)
+  table = [self _lookupTable];
+  mask = lazyTableSize(_count) - 1;
+  h = [aKey hash] & mask;
+  while ((i = table[h]) != 0)
     {
-      unsigned char buffer[index_size];
-      int i;
-      unsigned num = index;
+      i--;
+      if ([_keys[i] isEqual: aKey])
+	{
+	  id	o = _values[i];
 
-      for (i = index_size - 1; i >= 0; i--)
-        {
-	  buffer[i] = num & 0xFF;
-          num >>= 8;
+	  if (nil == o)
+	    {
+	      o = lazyDecode(_parser,
+		_refs + (_count + i) * _parser->index_size,
+		&_values[i], _path, _depth);
+	    }
+	  return o;
 	}
-      [dest appendBytes: buffer length: index_size];
+      h = (h + 1) & mask;
     }
-  else if (index_size == 4)
-    {
-      unsigned int oid;
+  return nil;
+}
+
+@end
+
+/* Test two items for equality ... both are objects.
+ * If either is an NSNumber, we insist that they are the same class
+ * so that numbers with the same numeric value but different classes
+ * are not treated as the same number (that confuses OSXs decoding).
+ */
+static BOOL
+isEqualFunc(const void *item1, const void *item2,
+  NSUInteger (*size)(const void *item))
+{
+  id	o1 = (id)item1;
+  id	o2 = (id)item2;
 
-      oid = NSSwapHostIntToBig(index);
-      [dest appendBytes: &oid length: 4];
+  if ([o1 isKindOfClass: [NSNumber class]]
+    || [o2 isKindOfClass: [NSNumber class]])
+    {
+      if ([o1 class] != [o2 class])
+	{
+	  return NO;
+	}
     }
-  else
+  return [o1 isEqual: o2];
+}
+
+/* When writing to a stream, buffered output is written once it reaches
+ * this size.
+ */
+#define	PL_FLUSH_SIZE	65536
+
+/* Returns the number of bytes needed to store value (1 to 8).
+ */
+static inline unsigned
+bytesForValue(unsigned long long value)
+{
+  unsigned	n = 1;
+
+  while (n < 8 && (value >> (8 * n)) != 0)
     {
-      [NSException raise: NSGenericException
-		   format: @"Unknown table size %d", index_size];
+      n++;
     }
+  return n;
 }
 
-- (void) storeCount: (unsigned int)count
+static void
+plAppendCount(NSMutableData *dest, NSUInteger length)
 {
   unsigned char code;
 
-  if (count < 256)
+  if (length < 256)
     {
       unsigned char c;
 
       code = 0x10;
       [dest appendBytes: &code length: 1];
-      c = count;
+      c = length;
       [dest appendBytes: &c length: 1];
     }
-  else if (count < 256 * 256)
+  else if (length < 256 * 256)
     {
       unsigned short c;
 
       code = 0x11;
       [dest appendBytes: &code length: 1];
-      c = count;
+      c = length;
       c = NSSwapHostShortToBig(c);
       [dest appendBytes: &c length: 2];
     }
-  else
+  else if (length <= 0xffffffff)
     {
+      unsigned int c;
+
       code = 0x12;
       [dest appendBytes: &code length: 1];
-      count = NSSwapHostIntToBig(count);
-      [dest appendBytes: &count length: 4];
+      c = NSSwapHostIntToBig((unsigned int)length);
+      [dest appendBytes: &c length: 4];
+    }
+  else
+    {
+      unsigned long long c;
+
+      code = 0x13;
+      [dest appendBytes: &code length: 1];
+      c = NSSwapHostLongLongToBig((unsigned long long)length);
+      [dest appendBytes: &c length: 8];
     }
 }
 
-- (void) storeData: (NSData*) data
+static void
+plAppendBytes(NSMutableData *dest, const void *bytes, NSUInteger len)
 {
-  unsigned int len;
   unsigned char code;
 
-  len = [data length];
-
   if (len < 0x0F)
     {
       code = 0x40 + len;
       [dest appendBytes: &code length: 1];
-      [dest appendData: data];
     }
   else
     {
       code = 0x4F;
       [dest appendBytes: &code length: 1];
-      [self storeCount: len];
-      [dest appendData: data];
+      plAppendCount(dest, len);
     }
+  [dest appendBytes: bytes length: len];
 }
 
-- (void) storeString: (NSString*) string
+static void
+plAppendData(NSMutableData *dest, NSData *data)
+{
+  plAppendBytes(dest, [data bytes], [data length]);
+}
+
+/* Stores an integer using the smallest size which holds it.  Negative
+ * values are always stored in eight bytes.
+ */
+static void
+plAppendInteger(NSMutableData *dest, unsigned long long val)
+{
+  unsigned char	buffer[9];
+  unsigned	size;
+  int		i;
+
+  if (val < 256)
+    {
+      size = 1;
+    }
+  else if (val < 256 * 256)
+    {
+      size = 2;
+    }
+  else if (val <= UINT_MAX)
+    {
+      size = 4;
+    }
+  else
+    {
+      size = 8;
+    }
+  buffer[0] = 0x10 + (size == 1 ? 0 : (size == 2 ? 1 : (size == 4 ? 2 : 3)));
+  for (i = size; i > 0; i--)
+    {
+      buffer[i] = val & 0xFF;
+      val >>= 8;
+    }
+  [dest appendBytes: buffer length: size + 1];
+}
+
+static void
+plAppendReal(NSMutableData *dest, double d)
+{
+  unsigned char		code = 0x23;
+  NSSwappedDouble	val = NSSwapHostDoubleToBig(d);
+
+  [dest appendBytes: &code length: 1];
+  [dest appendBytes: &val length: sizeof(double)];
+}
+
+static void
+plAppendString(NSMutableData *dest, NSString *string)
 {
   unsigned int len;
   NSData        *ascii;
@@ -3776,7 +4185,7 @@ isEqualFunc(const void *item1, const void *item2,
 	{
 	  code = 0x5F;
 	  [dest appendBytes: &code length: 1];
-	  [self storeCount: len];
+	  plAppendCount(dest, len);
 	  [dest appendData: ascii];
 	}
     }
@@ -3794,7 +4203,7 @@ isEqualFunc(const void *item1, const void *item2,
         {
 	  code = 0x6F;
 	  [dest appendBytes: &code length: 1];
-	  [self storeCount: len];
+	  plAppendCount(dest, len);
 	}
 
       offset = [dest length];
@@ -3822,7 +4231,8 @@ isEqualFunc(const void *item1, const void *item2,
     }
 }
 
-- (void) storeNumber: (NSNumber*) number
+static void
+plAppendNumber(NSMutableData *dest, NSNumber *number)
 {
   const char *type;
   unsigned char code;
@@ -3857,41 +4267,9 @@ isEqualFunc(const void *item1, const void *item2,
 	      code = 0x09;
 	      [dest appendBytes: &code length: 1];
 	    }
-	  else if (val < 256)
-	    {
-	      unsigned char cval;
-
-	      code = 0x10;
-	      [dest appendBytes: &code length: 1];
-	      cval = (unsigned char) val;
-	      [dest appendBytes: &cval length: 1];
-	    }
-	  else if (val < 256 * 256)
-	    {
-	      unsigned short sval;
-
-	      code = 0x11;
-	      [dest appendBytes: &code length: 1];
-	      sval = NSSwapHostShortToBig([number unsignedShortValue]);
-	      [dest appendBytes: &sval length: 2];
-	    }
-	  else if (val <= UINT_MAX)
-	    {
-	      unsigned int ival;
-
-	      code = 0x12;
-	      [dest appendBytes: &code length: 1];
-	      ival = NSSwapHostIntToBig([number unsignedIntValue]);
-	      [dest appendBytes: &ival length: 4];
-	    }
 	  else
 	    {
-	      unsigned long long lval;
-
-	      code = 0x13;
-	      [dest appendBytes: &code length: 1];
-	      lval = NSSwapHostLongLongToBig([number unsignedLongLongValue]);
-	      [dest appendBytes: &lval length: 8];
+	      plAppendInteger(dest, val);
 	    }
 	  break;
 	}
@@ -3905,21 +4283,16 @@ isEqualFunc(const void *item1, const void *item2,
 	  break;
 	}
       case 'd':
-        {
-	  NSSwappedDouble val = NSSwapHostDoubleToBig([number doubleValue]);
-
-	  code = 0x23;
-	  [dest appendBytes: &code length: 1];
-	  [dest appendBytes: &val length: sizeof(double)];
-	  break;
-	}
+	plAppendReal(dest, [number doubleValue]);
+	break;
       default:
 	[NSException raise: NSGenericException
 		    format: @"Attempt to store number with unknown ObjC type"];
     }
 }
 
-- (void) storeDate: (NSDate*) date
+static void
+plAppendDate(NSMutableData *dest, NSDate *date)
 {
   unsigned char code;
   NSSwappedDouble out;
@@ -3930,180 +4303,990 @@ isEqualFunc(const void *item1, const void *item2,
   [dest appendBytes: &out length: sizeof(double)];
 }
 
-- (void) storeArray: (NSArray*) array
-{
-  unsigned char code;
-  unsigned int len;
-  unsigned int i;
-
-  len = [array count];
 
-  if (len < 0x0F)
-    {
-      code = 0xA0 + len;
-      [dest appendBytes: &code length: 1];
-    }
-  else
+static inline void
+plStoreBigEndian(unsigned char *p, unsigned long long value, unsigned size)
+{
+  while (size-- > 0)
     {
-      code = 0xAF;
-      [dest appendBytes: &code length: 1];
-      [self storeCount: len];
+      p[size] = value & 0xFF;
+      value >>= 8;
     }
+}
 
-  for (i = 0; i < len; i++)
-    {
-      id obj;
-      NSInteger oid;
+/* Stores a keyed archiver object reference, using as few bytes as
+ * the value needs.
+ */
+static void
+plAppendUID(NSMutableData *dest, NSUInteger uid)
+{
+  unsigned char	buffer[9];
+  unsigned	size = bytesForValue(uid);
+
+  buffer[0] = 0x80 + size - 1;
+  plStoreBigEndian(buffer + 1, uid, size);
+  [dest appendBytes: buffer length: size + 1];
+}
+
+
+/* The incremental writer used by the keyed archiver.
+ * Leaf objects are appended to the output as soon as they are written,
+ * while arrays and dictionaries are kept as lists of object indices until
+ * the writer is finished and the size of an object reference is known.
+ * Equal leaves, numbers and references are only written once.
+ */
+#define	PL_CONTAINER	((NSUInteger)1 << (sizeof(NSUInteger) * 8 - 1))
+#define	PL_RECENT	256
+
+enum {
+  PLScalarNone = 0,
+  PLScalarBool,
+  PLScalarInteger,
+  PLScalarReal,
+  PLScalarUID
+};
+
+typedef struct {
+  unsigned long long	bits;
+  NSUInteger		kind;
+  NSUInteger		index;
+} GSBinaryPLScalar;
+
+struct GSBinaryPLWriter {
+  NSMutableData		*data;		// Header and leaf objects
+  NSMapTable		*leaves;	// Indices (plus one) of leaf objects
+  struct {
+    id			object;
+    NSUInteger		index;
+  }			recent[PL_RECENT];
+  GSBinaryPLScalar	*scalars;
+  NSUInteger		scalarCount;
+  NSUInteger		scalarCapacity;
+  NSUInteger		*offsets;	// Leaf offsets or container positions
+  NSUInteger		count;
+  NSUInteger		capacity;
+  NSUInteger		*refs;		// Container headers and references
+  NSUInteger		refCount;
+  NSUInteger		refCapacity;
+};
 
-      obj = [array objectAtIndex: i];
-      oid = [self indexForObject: obj];
-      [self storeIndex: oid];
+static NSUInteger
+plWriterAdd(GSBinaryPLWriter *w, NSUInteger offset)
+{
+  if (w->count == w->capacity)
+    {
+      w->capacity *= 2;
+      w->offsets = NSZoneRealloc(NSDefaultMallocZone(), w->offsets,
+	w->capacity * sizeof(NSUInteger));
     }
+  w->offsets[w->count] = offset;
+  return w->count++;
 }
 
-- (void) storeDictionary: (NSDictionary*) dict
+/* Returns the slot for a scalar value, which has a kind of PLScalarNone
+ * if the value has not been written yet.
+ */
+static GSBinaryPLScalar *
+plWriterScalar(GSBinaryPLWriter *w, NSUInteger kind, unsigned long long bits)
 {
-  unsigned char code;
-  NSNumber *num;
-  unsigned int i;
+  NSUInteger	mask;
+  NSUInteger	i;
 
-  num = [dict objectForKey: @"CF$UID"];
-  if (num != nil)
+  if (w->scalarCount * 2 >= w->scalarCapacity)
     {
-      // Special dictionary from keyed encoding
-      unsigned int index;
-
-      index = [num intValue];
-      if (index < 256)
-        {
-	  unsigned char ci;
+      GSBinaryPLScalar	*old = w->scalars;
+      NSUInteger	oldCapacity = w->scalarCapacity;
 
-	  code = 0x80;
-	  [dest appendBytes: &code length: 1];
-	  ci = (unsigned char)index;
-	  [dest appendBytes: &ci length: 1];
+      w->scalarCapacity = (0 == oldCapacity) ? 64 : oldCapacity * 2;
+      w->scalars = NSZoneCalloc(NSDefaultMallocZone(),
+	w->scalarCapacity, sizeof(GSBinaryPLScalar));
+      w->scalarCount = 0;
+      for (i = 0; i < oldCapacity; i++)
+	{
+	  if (old[i].kind != PLScalarNone)
+	    {
+	      *plWriterScalar(w, old[i].kind, old[i].bits) = old[i];
+	      w->scalarCount++;
+	    }
 	}
-      else
-        {
-	  unsigned short si;
-
-	  code = 0x81;
-	  [dest appendBytes: &code length: 1];
-	  si = NSSwapHostShortToBig((unsigned short)index);
-	  [dest appendBytes: &si length: 2];
+      if (old != 0)
+	{
+	  NSZoneFree(NSDefaultMallocZone(), old);
 	}
     }
-  else
+  mask = w->scalarCapacity - 1;
+  i = (NSUInteger)(((bits + kind) * 0x9E3779B97F4A7C15ULL) >> 32) & mask;
+  while (w->scalars[i].kind != PLScalarNone
+    && (w->scalars[i].kind != kind || w->scalars[i].bits != bits))
     {
-      unsigned int len = [dict count];
-      NSArray *keys = [dict allKeys];
-      NSMutableArray *objects = [NSMutableArray arrayWithCapacity: len];
-      id key;
-
-      for (i = 0; i < len; i++)
-        {
-	  key = [keys objectAtIndex: i];
-	  [objects addObject: [dict objectForKey: key]];
-	}
-
-      if (len < 0x0F)
-        {
-	  code = 0xD0 + len;
-	  [dest appendBytes: &code length: 1];
-	}
-      else
-        {
-	  code = 0xDF;
-	  [dest appendBytes: &code length: 1];
-	  [self storeCount: len];
-	}
+      i = (i + 1) & mask;
+    }
+  return &w->scalars[i];
+}
 
-      for (i = 0; i < len; i++)
-        {
-	  id obj;
-	  NSInteger oid;
+static NSUInteger
+plWriterContainer(GSBinaryPLWriter *w, unsigned char marker,
+  NSUInteger count, const NSUInteger *first, const NSUInteger *second)
+{
+  NSUInteger	need = 2 + ((second != 0) ? 2 * count : count);
+  NSUInteger	pos;
 
-	  obj = [keys objectAtIndex: i];
-	  oid = [self indexForObject: obj];
-	  [self storeIndex: oid];
+  if (w->refCount + need > w->refCapacity)
+    {
+      w->refCapacity *= 2;
+      if (w->refCapacity < w->refCount + need)
+	{
+	  w->refCapacity = w->refCount + need;
 	}
+      w->refs = NSZoneRealloc(NSDefaultMallocZone(), w->refs,
+	w->refCapacity * sizeof(NSUInteger));
+    }
+  pos = w->refCount;
+  w->refs[pos] = marker;
+  w->refs[pos + 1] = count;
+  memcpy(w->refs + pos + 2, first, count * sizeof(NSUInteger));
+  if (second != 0)
+    {
+      memcpy(w->refs + pos + 2 + count, second, count * sizeof(NSUInteger));
+    }
+  w->refCount += need;
+  return plWriterAdd(w, pos | PL_CONTAINER);
+}
 
-      for (i = 0; i < len; i++)
-        {
-	  id obj;
-	  NSInteger oid;
+GSBinaryPLWriter *
+GSPrivateBinaryPLWriterCreate(void)
+{
+  GSBinaryPLWriter	*w;
+  NSPointerFunctions	*k;
+  NSPointerFunctions	*v;
 
-	  obj = [objects objectAtIndex: i];
-	  oid = [self indexForObject: obj];
-	  [self storeIndex: oid];
-	}
-    }
+  [NSPropertyListSerialization class];	// Make sure classes are set up.
+  w = NSZoneCalloc(NSDefaultMallocZone(), 1, sizeof(GSBinaryPLWriter));
+  w->data = [[NSMutableData alloc] initWithCapacity: 10240];
+  [w->data appendBytes: "bplist00" length: 8];
+  k = [NSPointerFunctions pointerFunctionsWithOptions:
+    NSPointerFunctionsObjectPersonality];
+  [k setIsEqualFunction: isEqualFunc];
+  v = [NSPointerFunctions pointerFunctionsWithOptions:
+    NSPointerFunctionsIntegerPersonality|NSPointerFunctionsOpaqueMemory];
+  w->leaves = [[NSMapTable alloc] initWithKeyPointerFunctions: k
+					valuePointerFunctions: v
+						     capacity: 1000];
+  w->capacity = 1024;
+  w->offsets = NSZoneMalloc(NSDefaultMallocZone(),
+    w->capacity * sizeof(NSUInteger));
+  w->refCapacity = 4096;
+  w->refs = NSZoneMalloc(NSDefaultMallocZone(),
+    w->refCapacity * sizeof(NSUInteger));
+  return w;
 }
 
-- (BOOL) storeObject: (id)object
+void
+GSPrivateBinaryPLWriterFree(GSBinaryPLWriter *w)
 {
-  if (NO == [self markOffset: [dest length] for: object])
-    {
-      return NO;
-    }
+  NSUInteger	i;
 
-  if ([object isKindOfClass: NSStringClass])
-    {
-      [self storeString: object];
-    }
-  else if ([object isKindOfClass: NSDataClass])
+  if (0 == w)
     {
-      [self storeData: object];
+      return;
     }
-  else if ([object isKindOfClass: NSNumberClass])
+  for (i = 0; i < PL_RECENT; i++)
     {
-      [self storeNumber: object];
+      RELEASE(w->recent[i].object);
     }
-  else if ([object isKindOfClass: NSDateClass])
+  RELEASE(w->data);
+  RELEASE(w->leaves);
+  if (w->scalars != 0)
     {
-      [self storeDate: object];
+      NSZoneFree(NSDefaultMallocZone(), w->scalars);
     }
-  else if ([object isKindOfClass: NSArrayClass])
+  if (w->offsets != 0)
     {
-      [self storeArray: object];
+      NSZoneFree(NSDefaultMallocZone(), w->offsets);
     }
-  else if ([object isKindOfClass: NSDictionaryClass])
+  if (w->refs != 0)
     {
-      [self storeDictionary: object];
+      NSZoneFree(NSDefaultMallocZone(), w->refs);
+    }
+  NSZoneFree(NSDefaultMallocZone(), w);
+}
+
+NSUInteger
+GSPrivateBinaryPLWriteArray(GSBinaryPLWriter *w,
+  const NSUInteger *refs, NSUInteger count)
+{
+  return plWriterContainer(w, 0xA0, count, refs, 0);
+}
+
+NSUInteger
+GSPrivateBinaryPLWriteBool(GSBinaryPLWriter *w, BOOL value)
+{
+  GSBinaryPLScalar	*s;
+
+  value = (value ? 1 : 0);
+  s = plWriterScalar(w, PLScalarBool, value);
+  if (PLScalarNone == s->kind)
+    {
+      unsigned char	code = 0x08 + value;
+
+      s->kind = PLScalarBool;
+      s->bits = value;
+      s->index = plWriterAdd(w, [w->data length]);
+      [w->data appendBytes: &code length: 1];
+      w->scalarCount++;
+    }
+  return s->index;
+}
+
+NSUInteger
+GSPrivateBinaryPLWriteBytes(GSBinaryPLWriter *w,
+  const void *bytes, NSUInteger length)
+{
+  NSUInteger	index = plWriterAdd(w, [w->data length]);
+
+  plAppendBytes(w->data, bytes, length);
+  return index;
+}
+
+NSUInteger
+GSPrivateBinaryPLWriteDictionary(GSBinaryPLWriter *w,
+  const NSUInteger *keys, const NSUInteger *values, NSUInteger count)
+{
+  return plWriterContainer(w, 0xD0, count, keys, values);
+}
+
+NSUInteger
+GSPrivateBinaryPLWriteInteger(GSBinaryPLWriter *w, long long value)
+{
+  GSBinaryPLScalar	*s;
+
+  s = plWriterScalar(w, PLScalarInteger, (unsigned long long)value);
+  if (PLScalarNone == s->kind)
+    {
+      s->kind = PLScalarInteger;
+      s->bits = (unsigned long long)value;
+      s->index = plWriterAdd(w, [w->data length]);
+      plAppendInteger(w->data, (unsigned long long)value);
+      w->scalarCount++;
+    }
+  return s->index;
+}
+
+NSUInteger
+GSPrivateBinaryPLWriteObject(GSBinaryPLWriter *w, id object)
+{
+  NSUInteger	slot = ((uintptr_t)object >> 4) % PL_RECENT;
+  NSUInteger	index;
+
+  /* The recently written leaves are kept as immutable copies, so a
+   * pointer match means the object is one we wrote.
+   */
+  if (w->recent[slot].object == object && object != nil)
+    {
+      return w->recent[slot].index;
+    }
+
+  if ([object isKindOfClass: NSArrayClass])
+    {
+      NSUInteger	count = [object count];
+      NSUInteger	i;
+      GS_BEGINIDBUF(objects, count);
+      GS_BEGINITEMBUF2(refs, count, NSUInteger)
+
+      [object getObjects: objects];
+      for (i = 0; i < count; i++)
+	{
+	  refs[i] = GSPrivateBinaryPLWriteObject(w, objects[i]);
+	}
+      index = GSPrivateBinaryPLWriteArray(w, refs, count);
+      GS_ENDITEMBUF2();
+      GS_ENDIDBUF();
+      return index;
+    }
+  if ([object isKindOfClass: NSDictionaryClass])
+    {
+      NSUInteger	count = [object count];
+      NSEnumerator	*e = [object keyEnumerator];
+      NSUInteger	i = 0;
+      id		k;
+      GS_BEGINITEMBUF(refs, count * 2, NSUInteger)
+
+      while (i < count && (k = [e nextObject]) != nil)
+	{
+	  refs[i] = GSPrivateBinaryPLWriteObject(w, k);
+	  refs[count + i] = GSPrivateBinaryPLWriteObject(w,
+	    [object objectForKey: k]);
+	  i++;
+	}
+      index = GSPrivateBinaryPLWriteDictionary(w, refs, refs + count, i);
+      GS_ENDITEMBUF();
+      return index;
+    }
+
+  index = (NSUInteger)[w->leaves objectForKey: object];
+  if (0 == index)
+    {
+      NSMutableData	*d = w->data;
+
+      index = plWriterAdd(w, [d length]) + 1;
+      if ([object isKindOfClass: NSStringClass])
+	{
+	  plAppendString(d, object);
+	}
+      else if ([object isKindOfClass: NSDataClass])
+	{
+	  plAppendData(d, object);
+	}
+      else if ([object isKindOfClass: NSNumberClass])
+	{
+	  plAppendNumber(d, object);
+	}
+      else if ([object isKindOfClass: NSDateClass])
+	{
+	  plAppendDate(d, object);
+	}
+      else
+	{
+	  w->count--;
+	  [NSException raise: NSInvalidArgumentException
+		      format: @"Unknown class in property list: %@",
+	    NSStringFromClass([object class])];
+	}
+      object = [object copy];
+      [w->leaves setObject: (id)index forKey: object];
+      slot = ((uintptr_t)object >> 4) % PL_RECENT;
+      RELEASE(w->recent[slot].object);
+      w->recent[slot].object = object;
+      w->recent[slot].index = index - 1;
+    }
+  return index - 1;
+}
+
+NSUInteger
+GSPrivateBinaryPLWriteReal(GSBinaryPLWriter *w, double value)
+{
+  GSBinaryPLScalar	*s;
+  union {
+    double		d;
+    unsigned long long	bits;
+  } u;
+
+  u.d = value;
+  s = plWriterScalar(w, PLScalarReal, u.bits);
+  if (PLScalarNone == s->kind)
+    {
+      s->kind = PLScalarReal;
+      s->bits = u.bits;
+      s->index = plWriterAdd(w, [w->data length]);
+      plAppendReal(w->data, value);
+      w->scalarCount++;
+    }
+  return s->index;
+}
+
+NSUInteger
+GSPrivateBinaryPLWriteUID(GSBinaryPLWriter *w, NSUInteger uid)
+{
+  GSBinaryPLScalar	*s;
+
+  s = plWriterScalar(w, PLScalarUID, uid);
+  if (PLScalarNone == s->kind)
+    {
+      s->kind = PLScalarUID;
+      s->bits = uid;
+      s->index = plWriterAdd(w, [w->data length]);
+      plAppendUID(w->data, uid);
+      w->scalarCount++;
+    }
+  return s->index;
+}
+
+NSMutableData *
+GSPrivateBinaryPLWriterFinish(GSBinaryPLWriter *w, NSUInteger root)
+{
+  NSMutableData		*d = w->data;
+  unsigned		index_size;
+  unsigned		offset_size;
+  unsigned char		*p;
+  NSUInteger		table_start;
+  NSUInteger		length;
+  NSUInteger		i;
+
+  if (0 == w->count || root >= w->count)
+    {
+      [NSException raise: NSInvalidArgumentException
+		  format: @"Bad root object for binary property list"];
+    }
+  index_size = bytesForValue(w->count - 1);
+
+  /* Now that the size of a reference is known, append the containers.
+   */
+  for (i = 0; i < w->count; i++)
+    {
+      if (w->offsets[i] & PL_CONTAINER)
+	{
+	  NSUInteger	*r = w->refs + (w->offsets[i] & ~PL_CONTAINER);
+	  unsigned char	marker = (unsigned char)r[0];
+	  NSUInteger	n = (0xD0 == marker) ? 2 * r[1] : r[1];
+	  NSUInteger	j;
+
+	  w->offsets[i] = [d length];
+	  if (r[1] < 0x0F)
+	    {
+	      marker += r[1];
+	      [d appendBytes: &marker length: 1];
+	    }
+	  else
+	    {
+	      marker += 0x0F;
+	      [d appendBytes: &marker length: 1];
+	      plAppendCount(d, r[1]);
+	    }
+	  length = [d length];
+	  [d setLength: length + n * index_size];
+	  p = (unsigned char*)[d mutableBytes] + length;
+	  for (j = 0; j < n; j++)
+	    {
+	      plStoreBigEndian(p, r[j + 2], index_size);
+	      p += index_size;
+	    }
+	}
+    }
+  NSZoneFree(NSDefaultMallocZone(), w->refs);
+  w->refs = 0;
+
+  table_start = [d length];
+  offset_size = bytesForValue(table_start);
+  [d setLength: table_start + w->count * offset_size + 32];
+  p = (unsigned char*)[d mutableBytes] + table_start;
+  for (i = 0; i < w->count; i++)
+    {
+      plStoreBigEndian(p, w->offsets[i], offset_size);
+      p += offset_size;
+    }
+  memset(p, 0, 6);
+  p[6] = offset_size;
+  p[7] = index_size;
+  plStoreBigEndian(p + 8, w->count, 8);
+  plStoreBigEndian(p + 16, root, 8);
+  plStoreBigEndian(p + 24, table_start, 8);
+
+  w->data = nil;
+  return AUTORELEASE(d);
+}
+
+
+@implementation GSBinaryPLGenerator
+
++ (void) serializePropertyList: (id)aPropertyList
+		      intoData: (NSMutableData *)destination
+{
+  GSBinaryPLGenerator *gen;
+
+  gen = [[GSBinaryPLGenerator alloc]
+    initWithPropertyList: aPropertyList intoData: destination];
+  [gen generate];
+  RELEASE(gen);
+}
+
++ (unsigned long long) serializePropertyList: (id)aPropertyList
+				    toStream: (NSOutputStream *)aStream
+				     bounded: (BOOL)flag
+{
+  GSBinaryPLGenerator	*gen;
+  unsigned long long	length;
+
+  gen = [[GSBinaryPLGenerator alloc]
+    initWithPropertyList: aPropertyList toStream: aStream];
+  gen->bounded = flag;
+  NS_DURING
+    {
+      [gen generate];
+    }
+  NS_HANDLER
+    {
+      RELEASE(gen);
+      [localException raise];
+    }
+  NS_ENDHANDLER
+  length = gen->flushed;
+  RELEASE(gen);
+  return length;
+}
+
+- (id) initWithPropertyList: (id) aPropertyList
+		   intoData: (NSMutableData *)destination
+{
+  ASSIGN(root, aPropertyList);
+  ASSIGN(dest, destination);
+  [dest setLength: 0];
+
+  return self;
+}
+
+- (id) initWithPropertyList: (id)aPropertyList
+		   toStream: (NSOutputStream *)aStream
+{
+  ASSIGN(root, aPropertyList);
+  ASSIGN(stream, aStream);
+  dest = [[NSMutableData alloc] initWithCapacity: 2 * PL_FLUSH_SIZE];
+
+  return self;
+}
+
+- (void) dealloc
+{
+  DESTROY(root);
+  [self cleanup];
+  DESTROY(dest);
+  DESTROY(stream);
+  [super dealloc];
+}
+
+- (NSData*) data
+{
+  return dest;
+}
+
+/* Normally every object is written once, however many times it (or an
+ * object equal to it) appears in the property list.  When bounded, only
+ * strings and numbers equal to one written recently are shared, using
+ * a table with a fixed number of slots, so that memory use does not
+ * grow with the size of the property list.
+ */
+#define	PL_SHARED_SIZE	4096
+
+- (void) setup
+{
+  [dest setLength: 0];
+  flushed = 0;
+  count = 0;
+  capacity = 1024;
+  offsets = NSZoneMalloc(NSDefaultMallocZone(),
+    capacity * sizeof(unsigned long long));
+  if (bounded == YES)
+    {
+      shared = NSZoneCalloc(NSDefaultMallocZone(),
+	PL_SHARED_SIZE, sizeof(GSBinaryPLShared));
     }
   else
     {
-      NSLog(@"Unknown object class %@", object);
+      NSPointerFunctions	*k;
+      NSPointerFunctions	*v;
+
+      k = [NSPointerFunctions pointerFunctionsWithOptions:
+	NSPointerFunctionsObjectPersonality];
+      [k setIsEqualFunction: isEqualFunc];
+      v = [NSPointerFunctions pointerFunctionsWithOptions:
+	NSPointerFunctionsIntegerPersonality|NSPointerFunctionsOpaqueMemory];
+      objectList = [[NSMapTable alloc] initWithKeyPointerFunctions: k
+					     valuePointerFunctions: v
+							  capacity: 1000];
     }
-  return YES;
+  path = NSCreateHashTable(NSNonOwnedPointerHashCallBacks, 32);
 }
 
-- (void) generate
+- (void) cleanup
 {
-  BOOL done = NO;
+  if (path != nil)
+    {
+      NSFreeHashTable(path);
+      path = nil;
+    }
+  DESTROY(objectList);
+  if (shared != NULL)
+    {
+      NSUInteger	i;
 
-  index_size = 1;
+      for (i = 0; i < PL_SHARED_SIZE; i++)
+	{
+	  RELEASE(shared[i].object);
+	}
+      NSZoneFree(NSDefaultMallocZone(), shared);
+      shared = NULL;
+    }
+  if (offsets != NULL)
+    {
+      NSZoneFree(NSDefaultMallocZone(), offsets);
+      offsets = NULL;
+    }
+}
 
-  while (!done && (index_size <= 4))
+/* Writes buffered output to the stream (if any).
+ */
+- (void) flush
+{
+  if (stream != nil)
     {
-      NS_DURING
+      const uint8_t	*bytes = [dest bytes];
+      NSUInteger	length = [dest length];
+      NSUInteger	done = 0;
+
+      while (done < length)
 	{
-	  [self setup];
-	  done = [self writeObjects];
+	  NSInteger	result;
+
+	  result = [stream write: bytes + done maxLength: length - done];
+	  if (result <= 0)
+	    {
+	      [NSException raise: NSGenericException
+			  format: @"Unable to write property list: %@",
+		[stream streamError]];
+	    }
+	  done += result;
 	}
-      NS_HANDLER
+      flushed += length;
+      [dest setLength: 0];
+    }
+}
+
+static inline BOOL
+isContainer(id object)
+{
+  if ([object isKindOfClass: NSArrayClass])
+    {
+      return YES;
+    }
+  if ([object isKindOfClass: NSDictionaryClass]
+    && [object objectForKey: @"CF$UID"] == nil)
+    {
+      return YES;
+    }
+  return NO;
+}
+
+/* Returns the number of objects which will be written for the property
+ * list.  Objects are numbered as they are written, so this is enough
+ * to fix the size of an object reference before anything is written.
+ * When bounded, nothing is assumed to be shared and only the containers
+ * on the way to the current one are remembered; otherwise an object
+ * equal to one already counted adds nothing.  The containers on the
+ * way to the current one are also how a cycle is found.
+ */
+- (NSUInteger) countObjects: (id)object
+{
+  NSUInteger	n = 1;
+  BOOL		container = isContainer(object);
+
+  if (container && NSHashGet(path, object) != NULL)
+    {
+      [NSException raise: NSGenericException
+		  format: @"Cyclic object graph"];
+    }
+  if (objectList != nil)
+    {
+      if ([objectList objectForKey: object] != nil)
 	{
+	  return 0;
 	}
-      NS_ENDHANDLER
-      if (NO == done)
-        {
-          [self cleanup];
-          index_size += 1;
-        }
+      [objectList setObject: (id)1 forKey: object];
+    }
+  if (container)
+    {
+      CREATE_AUTORELEASE_POOL(pool);
+      NSEnumerator	*e;
+      id		o;
+
+      NSHashInsert(path, object);
+      if ([object isKindOfClass: NSArrayClass])
+	{
+	  e = [object objectEnumerator];
+	  while ((o = [e nextObject]) != nil)
+	    {
+	      n += [self countObjects: o];
+	    }
+	}
+      else
+	{
+	  e = [object keyEnumerator];
+	  while ((o = [e nextObject]) != nil)
+	    {
+	      n += [self countObjects: o];
+	      n += [self countObjects: [object objectForKey: o]];
+	    }
+	}
+      NSHashRemove(path, object);
+      DESTROY(pool);
+    }
+  return n;
+}
+
+/* Records the position of the next object and returns its index.
+ */
+- (NSUInteger) startObject
+{
+  if (count == capacity)
+    {
+      capacity *= 2;
+      offsets = NSZoneRealloc(NSDefaultMallocZone(), offsets,
+	capacity * sizeof(unsigned long long));
+    }
+  offsets[count] = flushed + [dest length];
+  return count++;
+}
+
+/* Writes object after the objects it refers to and returns its index.
+ */
+- (NSUInteger) writeObject: (id)object
+{
+  GSBinaryPLShared	*slot = NULL;
+  NSUInteger		index;
+
+  if (objectList != nil)
+    {
+      /* Entries are one more than the index, so that zero means the
+       * object has not been written yet.
+       */
+      index = (NSUInteger)[objectList objectForKey: object];
+      if (index > 0)
+	{
+	  return index - 1;
+	}
+    }
+  else if ([object isKindOfClass: NSStringClass]
+    || [object isKindOfClass: NSNumberClass])
+    {
+      slot = &shared[[object hash] & (PL_SHARED_SIZE - 1)];
+      if (slot->object != nil && isEqualFunc(slot->object, object, 0))
+	{
+	  return slot->index;
+	}
+    }
+  if ([object isKindOfClass: NSArrayClass])
+    {
+      CREATE_AUTORELEASE_POOL(pool);
+      NSUInteger	len = [object count];
+      NSUInteger	*refs;
+      NSUInteger	i;
+
+      refs = [[NSMutableData dataWithLength: (len + 1) * sizeof(NSUInteger)]
+	mutableBytes];
+      for (i = 0; i < len; i++)
+	{
+	  refs[i] = [self writeObject: [object objectAtIndex: i]];
+	}
+      index = [self startObject];
+      [self storeContainer: 0xA0 count: len refs: refs];
+      DESTROY(pool);
+    }
+  else if (isContainer(object))
+    {
+      CREATE_AUTORELEASE_POOL(pool);
+      NSArray		*keys = [object allKeys];
+      NSUInteger	len = [keys count];
+      NSUInteger	*refs;
+      NSUInteger	i;
+
+      refs = [[NSMutableData dataWithLength: (2 * len + 1) * sizeof(NSUInteger)]
+	mutableBytes];
+      for (i = 0; i < len; i++)
+	{
+	  id	k = [keys objectAtIndex: i];
+
+	  refs[i] = [self writeObject: k];
+	  refs[len + i] = [self writeObject: [object objectForKey: k]];
+	}
+      index = [self startObject];
+      [self storeContainer: 0xD0 count: len refs: refs];
+      DESTROY(pool);
+    }
+  else
+    {
+      index = [self startObject];
+      [self storeObject: object];
+    }
+  if (objectList != nil)
+    {
+      [objectList setObject: (id)(index + 1) forKey: object];
+    }
+  else if (slot != NULL)
+    {
+      ASSIGN(slot->object, object);
+      slot->index = index;
+    }
+  if ([dest length] >= PL_FLUSH_SIZE)
+    {
+      [self flush];
+    }
+  return index;
+}
+
+- (void) writeObjectTable
+{
+  unsigned char	buffer[8];
+  NSUInteger	i;
+
+  table_start = flushed + [dest length];
+  // This is a bit too much, as the length
+  // of the last object is added.
+  offset_size = bytesForValue(table_start);
+
+  for (i = 0; i < count; i++)
+    {
+      unsigned long long	offset = offsets[i];
+      int			j;
+
+      for (j = offset_size - 1; j >= 0; j--)
+	{
+	  buffer[j] = offset & 0xFF;
+	  offset >>= 8;
+	}
+      [dest appendBytes: buffer length: offset_size];
+      if ([dest length] >= PL_FLUSH_SIZE)
+	{
+	  [self flush];
+	}
+    }
+}
+
+- (void) writeMetaData
+{
+  unsigned char		meta[32];
+  unsigned long long	len;
+  int			i;
+
+  memset(meta, 0, sizeof(meta));
+  meta[6] = offset_size;
+  meta[7] = index_size;
+
+  len = count;
+  for (i = 15; i >= 8; i--)
+    {
+      meta[i] = len & 0xFF;
+      len >>= 8;
+    }
+  len = root_index;
+  for (i = 23; i >= 16; i--)
+    {
+      meta[i] = len & 0xFF;
+      len >>= 8;
+    }
+  len = table_start;
+  for (i = 31; i >= 24; i--)
+    {
+      meta[i] = len & 0xFF;
+      len >>= 8;
+    }
+
+  [dest appendBytes: meta length: 32];
+}
+
+- (void) storeIndex: (NSUInteger)index
+{
+  unsigned char	buffer[8];
+  int		i;
+
+  for (i = index_size - 1; i >= 0; i--)
+    {
+      buffer[i] = index & 0xFF;
+      index >>= 8;
+    }
+  [dest appendBytes: buffer length: index_size];
+}
+
+- (void) storeCount: (NSUInteger)length
+{
+  plAppendCount(dest, length);
+}
+
+- (void) storeData: (NSData*) data
+{
+  plAppendData(dest, data);
+}
+
+- (void) storeString: (NSString*) string
+{
+  plAppendString(dest, string);
+}
+
+- (void) storeNumber: (NSNumber*) number
+{
+  plAppendNumber(dest, number);
+}
+
+- (void) storeDate: (NSDate*) date
+{
+  plAppendDate(dest, date);
+}
+
+/* Stores an array (marker 0xA0) or dictionary (marker 0xD0) of len
+ * elements, given the indices of the objects it refers to.  A dictionary
+ * has the indices of its keys followed by those of its values.
+ */
+- (void) storeContainer: (unsigned char)marker
+		  count: (NSUInteger)len
+		   refs: (const NSUInteger*)refs
+{
+  unsigned char	code;
+  NSUInteger	n = (0xD0 == marker) ? 2 * len : len;
+  NSUInteger	i;
+
+  if (len < 0x0F)
+    {
+      code = marker + len;
+      [dest appendBytes: &code length: 1];
+    }
+  else
+    {
+      code = marker + 0x0F;
+      [dest appendBytes: &code length: 1];
+      [self storeCount: len];
+    }
+  for (i = 0; i < n; i++)
+    {
+      [self storeIndex: refs[i]];
     }
+}
 
+- (void) storeObject: (id)object
+{
+  if ([object isKindOfClass: NSStringClass])
+    {
+      [self storeString: object];
+    }
+  else if ([object isKindOfClass: NSDataClass])
+    {
+      [self storeData: object];
+    }
+  else if ([object isKindOfClass: NSNumberClass])
+    {
+      [self storeNumber: object];
+    }
+  else if ([object isKindOfClass: NSDateClass])
+    {
+      [self storeDate: object];
+    }
+  else if ([object isKindOfClass: NSDictionaryClass])
+    {
+      NSNumber	*num = [object objectForKey: @"CF$UID"];
+
+      // Special dictionary from keyed encoding
+      plAppendUID(dest, [num unsignedIntegerValue]);
+    }
+  else
+    {
+      NSLog(@"Unknown object class %@", object);
+    }
+}
+
+/* Each object is written as soon as the objects it refers to have been,
+ * and only the offset of each object is kept until the end, where the
+ * offset table and trailer are written.  Offsets and object references
+ * use as many bytes (up to eight) as their largest value needs.
+ */
+- (void) generate
+{
+  const char	*prefix = "bplist00";
+
+  [self setup];
+  index_size = bytesForValue([self countObjects: root] - 1);
+  [objectList removeAllObjects];
+  [dest appendBytes: prefix length: strlen(prefix)];
+  root_index = [self writeObject: root];
   [self writeObjectTable];
   [self writeMetaData];
+  [self flush];
+  [self cleanup];
 }
 
 @end
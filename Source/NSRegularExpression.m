@@ -48,6 +48,9 @@
 #import "Foundation/NSCoder.h"
 #import "Foundation/NSUserDefaults.h"
 #import "Foundation/NSNotification.h"
+#import "Foundation/NSDictionary.h"
+#import "GSPrivate.h"
+#import "GSPThread.h"
 
 
 /**
@@ -99,6 +102,15 @@ NSRegularExpressionOptionsToURegexpFlags(NSRegularExpressionOptions opts)
   options: (NSRegularExpressionOptions)opts
   error: (NSError**)e
 {
+  if (self == [NSRegularExpression class])
+    {
+      NSRegularExpression	*r = GSPrivateRegularExpression(aPattern, opts);
+
+      if (nil != r)
+	{
+	  return r;
+	}
+    }
   return [[[self alloc] initWithPattern: aPattern
 				options: opts
 				  error: e] autorelease];
@@ -336,15 +348,254 @@ static int32_t _workLimit = DEFAULT_WORK_LIMIT;
 
 
 
+/* Each thread keeps a few matchers cloned from prototype regular
+ * expressions so that repeated matching with the same NSRegularExpression
+ * does not need to clone the prototype on every call.
+ * A matcher is removed from the cache while in use, so a block which
+ * re-enters the same expression simply gets a fresh clone.
+ * Each slot records the generation of its prototype's address.  When an
+ * expression is deallocated only the generation for its own address is
+ * bumped, so matchers for that address are discarded (a new prototype may
+ * reuse it) while those of other expressions stay cached.
+ */
+#define	GS_REGEX_MATCHERS	8
+#define	GS_REGEX_GENERATIONS	256
+
+typedef struct {
+  URegularExpression	*prototype;
+  URegularExpression	*matcher;
+  uint32_t		generation;
+} GSRegexMatcherSlot;
+
+typedef struct {
+  unsigned		next;
+  GSRegexMatcherSlot	slots[GS_REGEX_MATCHERS];
+} GSRegexMatcherCache;
+
+static pthread_key_t		matcherKey;
+static pthread_once_t		matcherOnce = PTHREAD_ONCE_INIT;
+static volatile uint32_t	matcherGenerations[GS_REGEX_GENERATIONS];
+
+static inline volatile uint32_t *
+generationFor(URegularExpression *regex)
+{
+  uintptr_t	h = (uintptr_t)regex;
+
+  return &matcherGenerations[((h >> 4) ^ (h >> 12)) % GS_REGEX_GENERATIONS];
+}
+
+static void
+flushMatchers(GSRegexMatcherCache *c)
+{
+  unsigned	i;
+
+  for (i = 0; i < GS_REGEX_MATCHERS; i++)
+    {
+      if (c->slots[i].matcher != NULL)
+	{
+	  uregex_close(c->slots[i].matcher);
+	}
+      c->slots[i].matcher = NULL;
+      c->slots[i].prototype = NULL;
+    }
+  c->next = 0;
+}
+
+static void
+freeMatchers(void *ptr)
+{
+  flushMatchers((GSRegexMatcherCache*)ptr);
+  free(ptr);
+}
+
+static void
+setupMatcherKey(void)
+{
+  pthread_key_create(&matcherKey, freeMatchers);
+}
+
+static URegularExpression *
+checkoutMatcher(URegularExpression *regex)
+{
+  GSRegexMatcherCache	*c;
+  UErrorCode		s = 0;
+  URegularExpression	*r;
+
+  pthread_once(&matcherOnce, setupMatcherKey);
+  c = (GSRegexMatcherCache*)pthread_getspecific(matcherKey);
+  if (c != NULL)
+    {
+      uint32_t	generation = *generationFor(regex);
+      unsigned	i;
+
+      for (i = 0; i < GS_REGEX_MATCHERS; i++)
+	{
+	  if (c->slots[i].prototype == regex && c->slots[i].matcher != NULL)
+	    {
+	      r = c->slots[i].matcher;
+	      c->slots[i].matcher = NULL;
+	      c->slots[i].prototype = NULL;
+	      if (c->slots[i].generation == generation)
+		{
+		  return r;
+		}
+	      uregex_close(r);	// Cloned from an earlier prototype.
+	    }
+	}
+    }
+  r = uregex_clone(regex, &s);
+  if (U_FAILURE(s))
+    {
+      return NULL;
+    }
+  return r;
+}
+
+static void
+checkinMatcher(URegularExpression *regex, URegularExpression *r)
+{
+  static const UChar	empty = 0;
+  GSRegexMatcherCache	*c;
+  UErrorCode		s = 0;
+  unsigned		i;
+
+  if (NULL == r)
+    {
+      return;
+    }
+  /* Drop the matcher's reference to the subject text (which may point
+   * into a string or buffer we no longer own) and to any block.
+   */
+  uregex_setText(r, &empty, 0, &s);
+  uregex_setMatchCallback(r, NULL, NULL, &s);
+  if (U_FAILURE(s))
+    {
+      uregex_close(r);
+      return;
+    }
+
+  c = (GSRegexMatcherCache*)pthread_getspecific(matcherKey);
+  if (NULL == c)
+    {
+      c = (GSRegexMatcherCache*)calloc(1, sizeof(GSRegexMatcherCache));
+      if (NULL == c)
+	{
+	  uregex_close(r);
+	  return;
+	}
+      pthread_setspecific(matcherKey, c);
+    }
+  for (i = 0; i < GS_REGEX_MATCHERS; i++)
+    {
+      if (NULL == c->slots[i].matcher)
+	{
+	  break;
+	}
+    }
+  if (GS_REGEX_MATCHERS == i)
+    {
+      i = c->next;
+      c->next = (i + 1) % GS_REGEX_MATCHERS;
+      uregex_close(c->slots[i].matcher);
+    }
+  c->slots[i].prototype = regex;
+  c->slots[i].matcher = r;
+  c->slots[i].generation = *generationFor(regex);
+}
+
+/* Configures a (possibly reused) matcher for a search.  Every setting
+ * is applied explicitly, since a reused matcher retains whatever state
+ * the previous search left in it.
+ */
+static BOOL
+configureMatcher(URegularExpression *r,
+  NSMatchingOptions options,
+  NSRange range,
+  GSRegexBlock block)
+{
+  UErrorCode	s = 0;
+
+  if (options & NSMatchingReportProgress)
+    {
+      uregex_setMatchCallback(r, callback, block, &s);
+    }
+  else
+    {
+      uregex_setMatchCallback(r, NULL, NULL, &s);
+    }
+  uregex_setRegion(r, range.location, range.location+range.length, &s);
+  uregex_useAnchoringBounds(r,
+    (options & NSMatchingWithoutAnchoringBounds) ? FALSE : TRUE, &s);
+  uregex_useTransparentBounds(r,
+    (options & NSMatchingWithTransparentBounds) ? TRUE : FALSE, &s);
+  uregex_setTimeLimit(r, _workLimit, &s);
+  return U_FAILURE(s) ? NO : YES;
+}
+
 /**
  * Sets up a libicu regex object for use.  Note: the documentation states that
  * NSRegularExpression must be thread safe.  To accomplish this, we store a
- * prototype URegularExpression in the object, and then clone it in each
- * method.  This is required because URegularExpression, unlike
+ * prototype URegularExpression in the object, and use a matcher cloned from
+ * it in each method (see checkoutMatcher() and checkinMatcher()).
+ * This is required because URegularExpression, unlike
  * NSRegularExpression, is stateful, and sharing this state between threads
  * would break concurrent calls.
  */
 #if HAVE_UREGEX_OPENUTEXT
+static Class	GSStringClass = Nil;
+
+/* Binds a UText to the string.  Immutable concrete strings are accessed
+ * in place (UTF-16 directly, 8-bit only when it is pure ASCII and so is
+ * also valid UTF-8 with identical indexes), avoiding the chunk copies
+ * made by the generic NSString UText provider.
+ * The caller must keep the string alive while the UText is in use.
+ */
+static UText *
+setupText(UText *txt, NSString *string)
+{
+  if (Nil == GSStringClass)
+    {
+      GSStringClass = [GSString class];
+    }
+  if ([string isKindOfClass: GSStringClass])
+    {
+      GSString	*str = (GSString*)string;
+      UErrorCode	s = 0;
+
+      if (str->_flags.wide)
+	{
+	  txt = utext_openUChars(txt, str->_contents.u, str->_count, &s);
+	  if (U_SUCCESS(s))
+	    {
+	      return txt;
+	    }
+	}
+      else
+	{
+	  const unsigned char	*c = str->_contents.c;
+	  unsigned		count = str->_count;
+	  unsigned		i;
+
+	  for (i = 0; i < count; i++)
+	    {
+	      if (c[i] > 127)
+		{
+		  break;
+		}
+	    }
+	  if (i == count)
+	    {
+	      txt = utext_openUTF8(txt, (const char*)c, count, &s);
+	      if (U_SUCCESS(s))
+		{
+		  return txt;
+		}
+	    }
+	}
+    }
+  return UTextInitWithNSString(txt, string);
+}
+
 static URegularExpression *
 setupRegex(URegularExpression *regex,
   NSString *string,
@@ -354,25 +605,15 @@ setupRegex(URegularExpression *regex,
   GSRegexBlock block)
 {
   UErrorCode		s = 0;
-  URegularExpression	*r = uregex_clone(regex, &s);
+  URegularExpression	*r = checkoutMatcher(regex);
 
-  if (options & NSMatchingReportProgress)
+  if (NULL == r)
     {
-      uregex_setMatchCallback(r, callback, block, &s);
+      return NULL;
     }
-  UTextInitWithNSString(txt, string);
+  setupText(txt, string);
   uregex_setUText(r, txt, &s);
-  uregex_setRegion(r, range.location, range.location+range.length, &s);
-  if (options & NSMatchingWithoutAnchoringBounds)
-    {
-      uregex_useAnchoringBounds(r, FALSE, &s);
-    }
-  if (options & NSMatchingWithTransparentBounds)
-    {
-      uregex_useTransparentBounds(r, TRUE, &s);
-    }
-  uregex_setTimeLimit(r, _workLimit, &s);
-  if (U_FAILURE(s))
+  if (U_FAILURE(s) || NO == configureMatcher(r, options, range, block))
     {
       uregex_close(r);
       return NULL;
@@ -390,25 +631,15 @@ setupRegex(URegularExpression *regex,
   GSRegexBlock block)
 {
   UErrorCode		s = 0;
-  URegularExpression	*r = uregex_clone(regex, &s);
+  URegularExpression	*r = checkoutMatcher(regex);
 
-  [string getCharacters: buffer range: NSMakeRange(0, length)];
-  if (options & NSMatchingReportProgress)
+  if (NULL == r)
     {
-      uregex_setMatchCallback(r, callback, block, &s);
+      return NULL;
     }
+  [string getCharacters: buffer range: NSMakeRange(0, length)];
   uregex_setText(r, buffer, length, &s);
-  uregex_setRegion(r, range.location, range.location+range.length, &s);
-  if (options & NSMatchingWithoutAnchoringBounds)
-    {
-      uregex_useAnchoringBounds(r, FALSE, &s);
-    }
-  if (options & NSMatchingWithTransparentBounds)
-    {
-      uregex_useTransparentBounds(r, TRUE, &s);
-    }
-  uregex_setTimeLimit(r, _workLimit, &s);
-  if (U_FAILURE(s))
+  if (U_FAILURE(s) || NO == configureMatcher(r, options, range, block))
     {
       uregex_close(r);
       return NULL;
@@ -520,7 +751,7 @@ prepareResult(NSRegularExpression *regex,
       CALL_BLOCK(block, nil, NSMatchingCompleted, &stop);
     }
   utext_close(&txt);
-  uregex_close(r);
+  checkinMatcher(regex, r);
 }
 #else
 - (void) enumerateMatchesInString: (NSString*)string
@@ -580,7 +811,7 @@ prepareResult(NSRegularExpression *regex,
     {
       CALL_BLOCK(block, nil, NSMatchingCompleted, &stop);
     }
-  uregex_close(r);
+  checkinMatcher(regex, r);
 }
 #endif
 
@@ -703,7 +934,7 @@ prepareResult(NSRegularExpression *regex,
 	}\
     }\
   utext_close(&txt);\
-  uregex_close(r);
+  checkinMatcher(regex, r);
 #else
 #define FAKE_BLOCK_HACK(failRet, code) \
   UErrorCode s = 0;\
@@ -727,7 +958,7 @@ prepareResult(NSRegularExpression *regex,
 	  code\
 	}\
     }\
-  uregex_close(r);
+  checkinMatcher(regex, r);
 #endif
 
 - (NSUInteger) numberOfMatchesInString: (NSString*)string
@@ -833,7 +1064,7 @@ prepareResult(NSRegularExpression *regex,
   output = uregex_replaceAllUText(r, &replacement, NULL, &s);
   if (0 != s)
     {
-      uregex_close(r);
+      checkinMatcher(regex, r);
       utext_close(&replacement);
       utext_close(&txt);
       DESTROY(ret);
@@ -842,7 +1073,7 @@ prepareResult(NSRegularExpression *regex,
   utext_clone(&ret->txt, output, TRUE, TRUE, &s);
   [string setString: ret];
   [ret release];
-  uregex_close(r);
+  checkinMatcher(regex, r);
 
   utext_close(&txt);
   utext_close(output);
@@ -867,14 +1098,14 @@ prepareResult(NSRegularExpression *regex,
   output = uregex_replaceAllUText(r, &replacement, NULL, &s);
   if (0 != s)
     {
-      uregex_close(r);
+      checkinMatcher(regex, r);
       utext_close(&replacement);
       utext_close(&txt);
       DESTROY(ret);
       return nil;
     }
   utext_clone(&ret->txt, output, TRUE, TRUE, &s);
-  uregex_close(r);
+  checkinMatcher(regex, r);
 
   utext_close(&txt);
   utext_close(output);
@@ -905,14 +1136,14 @@ prepareResult(NSRegularExpression *regex,
   output = uregex_replaceFirstUText(r, &replacement, NULL, &s);
   if (0 != s)
     {
-      uregex_close(r);
+      checkinMatcher(regex, r);
       utext_close(&replacement);
       utext_close(&txt);
       DESTROY(ret);
       return nil;
     }
   utext_clone(&ret->txt, output, TRUE, TRUE, &s);
-  uregex_close(r);
+  checkinMatcher(regex, r);
 
   utext_close(&txt);
   utext_close(output);
@@ -948,6 +1179,7 @@ prepareResult(NSRegularExpression *regex,
   s = 0;
   output = NSZoneMalloc(0, outLength * sizeof(unichar));
   uregex_replaceAll(r, replacement, replLength, output, outLength, &s);
+  checkinMatcher(regex, r);
   out =
     [[NSString alloc] initWithCharactersNoCopy: output
 					length: outLength
@@ -980,6 +1212,7 @@ prepareResult(NSRegularExpression *regex,
   s = 0;
   output = NSZoneMalloc(0, outLength * sizeof(unichar));
   uregex_replaceAll(r, replacement, replLength, output, outLength, &s);
+  checkinMatcher(regex, r);
   return AUTORELEASE([[NSString alloc] initWithCharactersNoCopy: output
 							 length: outLength
 						   freeWhenDone: YES]);
@@ -1012,6 +1245,7 @@ prepareResult(NSRegularExpression *regex,
   s = 0;
   output = NSZoneMalloc(0, outLength * sizeof(unichar));
   uregex_replaceFirst(r, replacement, replLength, output, outLength, &s);
+  checkinMatcher(regex, r);
   return AUTORELEASE([[NSString alloc] initWithCharactersNoCopy: output
 							 length: outLength
 						   freeWhenDone: YES]);
@@ -1031,6 +1265,9 @@ prepareResult(NSRegularExpression *regex,
 
 - (void) dealloc
 {
+  /* Invalidate per-thread matchers cloned from this prototype.
+   */
+  __sync_fetch_and_add(generationFor(regex), 1);
   uregex_close(regex);
   [super dealloc];
 }
@@ -1089,6 +1326,144 @@ prepareResult(NSRegularExpression *regex,
   return self;
 }
 @end
+
+/* Key for the cache of compiled expressions.
+ */
+@interface	GSRegexCacheKey : NSObject
+{
+@public
+  NSString			*pattern;
+  NSRegularExpressionOptions	options;
+  NSUInteger			hash;
+}
+@end
+
+@implementation	GSRegexCacheKey
+- (void) dealloc
+{
+  RELEASE(pattern);
+  [super dealloc];
+}
+
+- (NSUInteger) hash
+{
+  return hash;
+}
+
+- (BOOL) isEqual: (id)other
+{
+  GSRegexCacheKey	*o = (GSRegexCacheKey*)other;
+
+  if (o == self)
+    {
+      return YES;
+    }
+  if (NO == [o isKindOfClass: [GSRegexCacheKey class]])
+    {
+      return NO;
+    }
+  return (o->hash == hash && o->options == options
+    && [o->pattern isEqualToString: pattern]) ? YES : NO;
+}
+@end
+
+/* The cache is bounded; once full, the oldest entry is replaced.
+ */
+#define	GS_REGEX_CACHE_SIZE	64
+
+static pthread_mutex_t		cacheLock = PTHREAD_MUTEX_INITIALIZER;
+static NSMutableDictionary	*cache = nil;
+static GSRegexCacheKey		*cacheOrder[GS_REGEX_CACHE_SIZE];
+static unsigned			cacheNext = 0;
+
+NSRegularExpression *
+GSPrivateRegularExpression(NSString *pattern, NSUInteger opts)
+{
+  GSRegexCacheKey	*key;
+  NSRegularExpression	*r;
+
+  if (nil == pattern)
+    {
+      return nil;
+    }
+  key = [GSRegexCacheKey new];
+  key->pattern = [pattern copy];
+  key->options = opts;
+  key->hash = [pattern hash] ^ opts;
+
+  pthread_mutex_lock(&cacheLock);
+  r = RETAIN([cache objectForKey: key]);
+  pthread_mutex_unlock(&cacheLock);
+  if (nil != r)
+    {
+      RELEASE(key);
+      return AUTORELEASE(r);
+    }
+
+  r = [[NSRegularExpression alloc] initWithPattern: pattern
+					   options: opts
+					     error: NULL];
+  if (nil == r)
+    {
+      RELEASE(key);
+      return nil;
+    }
+
+  pthread_mutex_lock(&cacheLock);
+  if (nil == cache)
+    {
+      cache = [[NSMutableDictionary alloc]
+	initWithCapacity: GS_REGEX_CACHE_SIZE];
+    }
+  if (nil == [cache objectForKey: key])
+    {
+      if (nil != cacheOrder[cacheNext])
+	{
+	  [cache removeObjectForKey: cacheOrder[cacheNext]];
+	  RELEASE(cacheOrder[cacheNext]);
+	}
+      [cache setObject: r forKey: key];
+      cacheOrder[cacheNext] = RETAIN(key);
+      cacheNext = (cacheNext + 1) % GS_REGEX_CACHE_SIZE;
+    }
+  pthread_mutex_unlock(&cacheLock);
+  RELEASE(key);
+  return AUTORELEASE(r);
+}
+
+BOOL
+GSPrivateRegularExpressionMatches(NSRegularExpression *expression,
+  NSString *string)
+{
+  URegularExpression	*regex = expression->regex;
+  URegularExpression	*r;
+  UErrorCode		s = 0;
+  BOOL			result = NO;
+#if HAVE_UREGEX_OPENUTEXT
+  UText			txt = UTEXT_INITIALIZER;
+
+  r = setupRegex(regex, string, &txt, 0,
+    NSMakeRange(0, [string length]), 0);
+  if (NULL != r)
+    {
+      result = uregex_matches(r, -1, &s) && U_SUCCESS(s) ? YES : NO;
+      checkinMatcher(regex, r);
+    }
+  utext_close(&txt);
+#else
+  int32_t		length = [string length];
+  TEMP_BUFFER(buffer, length * sizeof(unichar));
+
+  r = setupRegex(regex, string, buffer, length, 0,
+    NSMakeRange(0, length), 0);
+  if (NULL != r)
+    {
+      result = uregex_matches(r, -1, &s) && U_SUCCESS(s) ? YES : NO;
+      checkinMatcher(regex, r);
+    }
+#endif
+  return result;
+}
 #endif //GS_ICU == 1
 
 #ifndef NSRegularExpressionWorks
@@ -100,6 +100,42 @@ typedef GSString	*ivars;
 #define	myChar(I)	myGetC((((ivars)_string)->_contents.c[I]))
 #define	myCharacter(I)	(_isUnicode ? myUnicode(I) : myChar(I))
 
+/*
+ * Return the index of the first character at or after location in the
+ * string (which must be one of our concrete classes) whose membership
+ * of the matcher's set is the same as member, or the length of the
+ * string if there is no such character (or location if that is beyond
+ * the end of the string).
+ */
+static inline unsigned
+scanForMembership(GSString *string, BOOL isUnicode, unsigned location,
+  const GSCharMatcher *m, BOOL member)
+{
+  unsigned	length = string->_count;
+
+  if (location >= length)
+    {
+      return location;
+    }
+  if (YES == isUnicode)
+    {
+      return location + GSPrivateCharMatcherScan16(m,
+	string->_contents.u + location, length - location, member);
+    }
+  if (NSISOLatin1StringEncoding == internalEncoding)
+    {
+      return location + GSPrivateCharMatcherScan8(m,
+	string->_contents.c + location, length - location, member);
+    }
+  while (location < length
+    && GSCharMatcherIsMember(m, myGetC(string->_contents.c[location]))
+    != member)
+    {
+      location++;
+    }
+  return location;
+}
+
 /*
  * Scan characters to be skipped.
  * Return YES if there are more characters to be scanned.
@@ -107,9 +143,13 @@ typedef GSString	*ivars;
  * For internal use only.
  */
 #define	skipToNextField()	({\
-  while (_scanLocation < myLength() && _charactersToBeSkipped != nil \
-    && (*_skipImp)(_charactersToBeSkipped, memSel, myCharacter(_scanLocation)))\
-    _scanLocation++;\
+  if (_charactersToBeSkipped != nil) \
+    { \
+      GSCharMatcher	_skipMatcher; \
+      _scanLocation = scanForMembership((ivars)_string, _isUnicode, \
+	_scanLocation, GSPrivateCharMatcher(_charactersToBeSkipped, \
+	&_skipMatcher), NO); \
+    } \
   (_scanLocation >= myLength()) ? NO : YES;\
 })
 
@@ -936,33 +976,11 @@ typedef GSString	*ivars;
   if (skipToNextField())
     {
       unsigned int	start;
-      BOOL		(*memImp)(NSCharacterSet*, SEL, unichar);
-
-      if (aSet == _charactersToBeSkipped)
-	memImp = _skipImp;
-      else
-	memImp = (BOOL (*)(NSCharacterSet*, SEL, unichar))
-	  [aSet methodForSelector: memSel];
+      GSCharMatcher	matcher;
 
       start = _scanLocation;
-      if (_isUnicode)
-	{
-	  while (_scanLocation < myLength())
-	    {
-	      if ((*memImp)(aSet, memSel, myUnicode(_scanLocation)) == NO)
-		break;
-	      _scanLocation++;
-	    }
-	}
-      else
-	{
-	  while (_scanLocation < myLength())
-	    {
-	      if ((*memImp)(aSet, memSel, myChar(_scanLocation)) == NO)
-		break;
-	      _scanLocation++;
-	    }
-	}
+      _scanLocation = scanForMembership((ivars)_string, _isUnicode,
+	_scanLocation, GSPrivateCharMatcher(aSet, &matcher), NO);
       if (_scanLocation != start)
 	{
 	  if (value != 0)
@@ -992,36 +1010,14 @@ typedef GSString	*ivars;
 {
   unsigned int	saveScanLocation = _scanLocation;
   unsigned int	start;
-  BOOL		(*memImp)(NSCharacterSet*, SEL, unichar);
+  GSCharMatcher	matcher;
 
   if (!skipToNextField())
     return NO;
 
-  if (aSet == _charactersToBeSkipped)
-    memImp = _skipImp;
-  else
-    memImp = (BOOL (*)(NSCharacterSet*, SEL, unichar))
-      [aSet methodForSelector: memSel];
-
   start = _scanLocation;
-  if (_isUnicode)
-    {
-      while (_scanLocation < myLength())
-	{
-	  if ((*memImp)(aSet, memSel, myUnicode(_scanLocation)) == YES)
-	    break;
-	  _scanLocation++;
-	}
-    }
-  else
-    {
-      while (_scanLocation < myLength())
-	{
-	  if ((*memImp)(aSet, memSel, myChar(_scanLocation)) == YES)
-	    break;
-	  _scanLocation++;
-	}
-    }
+  _scanLocation = scanForMembership((ivars)_string, _isUnicode,
+    _scanLocation, GSPrivateCharMatcher(aSet, &matcher), YES);
 
   if (_scanLocation == start)
     {
@@ -78,6 +78,7 @@
 #include <sys/resource.h>
 #include <netdb.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 
 #if	defined(HAVE_SYS_FILE_H)
 #  include	<sys/file.h>
@@ -131,6 +132,25 @@ static uint32_t	maxDataLength = 32 * 1024 * 1024;
 #define	GS_CONNECTION_MSG	0
 #define	NETBLOCK	8192
 
+/*
+ * Most data items written in one system call, and the scatter/gather
+ * buffer type used to write them.
+ */
+#define	NETVEC		64
+#if	defined(_WIN32)
+#define	NETBUF		WSABUF
+#define	NETBUF_BASE(B)	(B).buf
+#define	NETBUF_LEN(B)	(B).len
+#else
+#if	defined(IOV_MAX) && IOV_MAX < NETVEC
+#undef	NETVEC
+#define	NETVEC		IOV_MAX
+#endif
+#define	NETBUF		struct iovec
+#define	NETBUF_BASE(B)	(B).iov_base
+#define	NETBUF_LEN(B)	(B).iov_len
+#endif
+
 #ifndef INADDR_NONE
 #define	INADDR_NONE	-1
 #endif
@@ -202,11 +222,11 @@ typedef enum {
 {
   SOCKET		desc;		/* File descriptor for I/O.	*/
   unsigned		wItem;		/* Index of item being written.	*/
-  NSMutableData		*wData;		/* Data object being written.	*/
   unsigned		wLength;	/* Ammount written so far.	*/
-  NSMutableArray	*wMsgs;		/* Message in progress.		*/
+  NSMutableArray	*wMsgs;		/* Messages waiting to be sent.	*/
   NSMutableData		*rData;		/* Buffer for incoming data	*/
-  uint32_t		rLength;	/* Amount read so far.		*/
+  uint32_t		rStart;		/* Start of unused data.	*/
+  uint32_t		rLength;	/* Amount of unused data.	*/
   uint32_t		rWant;		/* Amount desired.		*/
   NSMutableArray	*rItems;	/* Message in progress.		*/
   GSPortItemType	rType;		/* Type of data being read.	*/
@@ -258,7 +278,7 @@ typedef enum {
  * Utility functions for encoding and decoding ports.
  */
 static NSSocketPort*
-decodePort(NSData *data, NSString *defaultAddress)
+decodePort(const void *bytes, NSString *defaultAddress)
 {
   GSPortItemHeader	*pih;
   GSPortInfo		*pi;
@@ -267,7 +287,7 @@ decodePort(NSData *data, NSString *defaultAddress)
   NSHost		*host;
   unichar		c;
 
-  pih = (GSPortItemHeader*)[data bytes];
+  pih = (GSPortItemHeader*)bytes;
   NSCAssert(GSSwapBigI32ToHost(pih->type) == GSP_PORT,
     NSInternalInconsistencyException);
   pi = (GSPortInfo*)&pih[1];
@@ -771,6 +791,10 @@ static Class	runLoopClass;
   unsigned	want;
   void	*bytes;
   int	res;
+#if	!defined(_WIN32)
+  char		extra[NETBLOCK * 8];
+  struct iovec	iov[2];
+#endif
 
   /*
    * Make sure we have a buffer big enough to hold all the data we are
@@ -785,6 +809,20 @@ static Class	runLoopClass;
     }
   else
     {
+      /*
+       * Move any data left over from the last read to the start of the
+       * buffer (items are consumed by advancing rStart, so this is done
+       * once per read rather than once per item).
+       */
+      if (rStart > 0)
+	{
+	  if (rLength > 0)
+	    {
+	      bytes = [rData mutableBytes];
+	      memmove(bytes, bytes + rStart, rLength);
+	    }
+	  rStart = 0;
+	}
       want = [rData length];
       if (want < rWant)
         {
@@ -799,10 +837,28 @@ static Class	runLoopClass;
     }
 
   /*
-   * Now try to fill the buffer with data.
+   * Now try to fill the buffer with data.  Anything which does not fit
+   * goes into a second buffer on the stack, so that a burst of small
+   * messages can be read with a single system call.
    */
   bytes = [rData mutableBytes];
+#if	defined(_WIN32)
   res = recv(desc, bytes + rLength, want - rLength, 0);
+#else
+  iov[0].iov_base = bytes + rLength;
+  iov[0].iov_len = want - rLength;
+  iov[1].iov_base = extra;
+  iov[1].iov_len = sizeof(extra);
+  res = readv(desc, iov, 2);
+  if (res > (int)(want - rLength))
+    {
+      unsigned	over = res - (want - rLength);
+
+      [rData setLength: want + over];
+      bytes = [rData mutableBytes];
+      memcpy(bytes + want, extra, over);
+    }
+#endif
   if (res <= 0)
     {
       if (res == 0)
@@ -874,11 +930,9 @@ static Class	runLoopClass;
 		       * data object and add it to the current message.
 		       */
 		      rType = GSP_NONE;	/* ready for a new item	*/
+		      rStart += rWant;
 		      rLength -= rWant;
-		      if (rLength > 0)
-		        {
-		          memmove(bytes, bytes + rWant, rLength);
-		        }
+		      bytes += rWant;
 		      rWant = sizeof(GSPortItemHeader);
 		      d = [mutableDataClass new];
 		      [rItems addObject: d];
@@ -902,11 +956,9 @@ static Class	runLoopClass;
 		       * we discard the data read so far and fill the
 		       * data object with the data item from the msg.
 		       */
+		      rStart += rWant;
 		      rLength -= rWant;
-		      if (rLength > 0)
-			{
-			  memmove(bytes, bytes + rWant, rLength);
-			}
+		      bytes += rWant;
 		      rWant = l;
 		    }
 		}
@@ -924,11 +976,9 @@ static Class	runLoopClass;
 		   * we discard the data read so far and fill the
 		   * data object with the data item from the msg.
 		   */
+		  rStart += rWant;
 		  rLength -= rWant;
-		  if (rLength > 0)
-		    {
-		      memmove(bytes, bytes + rWant, rLength);
-		    }
+		  bytes += rWant;
 	          rWant = l;
 	        }
 	      else
@@ -970,11 +1020,9 @@ static Class	runLoopClass;
 	          [rItems addObject: d];
 	          RELEASE(d);
 	          rWant += sizeof(GSPortMsgHeader);
+	          rStart += rWant;
 	          rLength -= rWant;
-	          if (rLength > 0)
-	            {
-		      memmove(bytes, bytes + rWant, rLength);
-		    }
+	          bytes += rWant;
 		  rWant = sizeof(GSPortItemHeader);
 	          if (nItems == 1)
 	            {
@@ -986,11 +1034,9 @@ static Class	runLoopClass;
 	          /*
 	           * want to read another item
 	           */
+	          rStart += rWant;
 	          rLength -= rWant;
-	          if (rLength > 0)
-	            {
-		      memmove(bytes, bytes + rWant, rLength);
-		    }
+	          bytes += rWant;
 		  rWant = sizeof(GSPortItemHeader);
 	        }
 	    }
@@ -1005,11 +1051,9 @@ static Class	runLoopClass;
 	      d = [d initWithBytes: bytes length: rWant];
 	      [rItems addObject: d];
 	      RELEASE(d);
+	      rStart += rWant;
 	      rLength -= rWant;
-	      if (rLength > 0)
-	        {
-	          memmove(bytes, bytes + rWant, rLength);
-	        }
+	      bytes += rWant;
 	      rWant = sizeof(GSPortItemHeader);
 	      if (nItems == [rItems count])
 	        {
@@ -1023,7 +1067,7 @@ static Class	runLoopClass;
 	      NSSocketPort	*p;
 
               rType = GSP_NONE;	/* ready for a new item	*/
-	      p = decodePort(rData, defaultAddress);
+	      p = decodePort(bytes, defaultAddress);
 	      if (p == nil)
 	        {
 	          NSLog(@"%@ - unable to decode remote port", self);
@@ -1033,11 +1077,9 @@ static Class	runLoopClass;
 	      /*
 	       * Set up to read another item header.
 	       */
+	      rStart += rWant;
 	      rLength -= rWant;
-	      if (rLength > 0)
-	        {
-	          memmove(bytes, bytes + rWant, rLength);
-	        }
+	      bytes += rWant;
 	      rWant = sizeof(GSPortItemHeader);
 
 	      if (state == GS_H_ACCEPT)
@@ -1096,7 +1138,7 @@ static Class	runLoopClass;
           M_LOCK(myLock);
           RELEASE(pm);
           RELEASE(rp);
-          bytes = [rData mutableBytes];
+          bytes = [rData mutableBytes] + rStart;
         }
     }
 }
@@ -1142,28 +1184,64 @@ static Class	runLoopClass;
     }
   else
     {
+      NETBUF		bufs[NETVEC];
+      unsigned		count = [wMsgs count];
+      unsigned		done;
+      unsigned		item;
+      unsigned		offset;
+      int		vec = 0;
       int		res;
-      unsigned	l;
-      const void	*b;
 
-      if (wData == nil)
-        {
-          if ([wMsgs count] > 0)
-            {
-	      NSArray	*components = [wMsgs objectAtIndex: 0];
+      if (count == 0)
+	{
+// NSLog(@"No messages to write on 0x%"PRIxPTR".", (NSUInteger)self);
+	  return;
+	}
 
-	      wData = [components objectAtIndex: wItem++];
-	      wLength = 0;
-	    }
-	  else
+      /*
+       * Gather as many of the unwritten data items of the queued
+       * messages as we can, so that a series of small messages is
+       * written with a single system call.
+       */
+      item = wItem;
+      offset = wLength;
+      for (done = 0; done < count && vec < NETVEC; done++)
+	{
+	  NSArray	*components = [wMsgs objectAtIndex: done];
+	  unsigned	c = [components count];
+
+	  while (item < c && vec < NETVEC)
 	    {
-// NSLog(@"No messages to write on 0x%"PRIxPTR".", (NSUInteger)self);
-	      return;
+	      NSData	*d = [components objectAtIndex: item++];
+	      unsigned	l = [d length];
+
+	      if (l > offset)
+		{
+		  NETBUF_BASE(bufs[vec]) = (char*)[d bytes] + offset;
+		  NETBUF_LEN(bufs[vec]) = l - offset;
+		  vec++;
+		}
+	      offset = 0;
 	    }
+	  item = 0;
 	}
-      b = [wData bytes];
-      l = [wData length];
-      res = send(desc, b + wLength,  l - wLength, 0);
+
+#if	defined(_WIN32)
+      {
+	DWORD	sent = 0;
+
+	if (WSASend(desc, bufs, vec, &sent, 0, NULL, NULL) == SOCKET_ERROR)
+	  {
+	    res = -1;
+	  }
+	else
+	  {
+	    res = (int)sent;
+	  }
+      }
+#else
+      res = writev(desc, bufs, vec);
+#endif
       if (res < 0)
         {
 #ifdef _WIN32
@@ -1186,38 +1264,45 @@ static Class	runLoopClass;
 	}
       else
         {
+	  unsigned	left = (unsigned)res;
+
           NSDebugMLLog(@"GSTcpHandle",
             @"wrote %d bytes on 0x%"PRIxPTR, res, (NSUInteger)self);
-	  wLength += res;
-          if (wLength == l)
-            {
-	      NSArray	*components;
 
-	      /*
-	       * We have completed a data item so see what is
-	       * left of the message components.
-	       */
-	      components = [wMsgs objectAtIndex: 0];
-	      wLength = 0;
-	      if ([components count] > wItem)
-	        {
-	          /*
-	           * More to write - get next item.
-	           */
-	          wData = [components objectAtIndex: wItem++];
-	        }
-	      else
-	        {
-	          /*
-	           * message completed - remove from list.
-	           */
-	          NSDebugMLLog(@"GSTcpHandle",
-	            @"completed 0x%"PRIxPTR" on 0x%"PRIxPTR,
-		    (NSUInteger)components, (NSUInteger)self);
-		  wData = nil;
-	          wItem = 0;
-	          [wMsgs removeObjectAtIndex: 0];
-	        }
+	  /*
+	   * Step past the data items we have written, and remove all
+	   * the messages we have completed from the queue at once.
+	   */
+	  for (done = 0; done < count; done++)
+	    {
+	      NSArray	*components = [wMsgs objectAtIndex: done];
+	      unsigned	c = [components count];
+
+	      while (wItem < c)
+		{
+		  unsigned	l = [[components objectAtIndex: wItem] length];
+
+		  if (l - wLength > left)
+		    {
+		      wLength += left;
+		      break;
+		    }
+		  left -= l - wLength;
+		  wLength = 0;
+		  wItem++;
+		}
+	      if (wItem < c)
+		{
+		  break;
+		}
+	      NSDebugMLLog(@"GSTcpHandle",
+		@"completed 0x%"PRIxPTR" on 0x%"PRIxPTR,
+		(NSUInteger)components, (NSUInteger)self);
+	      wItem = 0;
+	    }
+	  if (done > 0)
+	    {
+	      [wMsgs removeObjectsInRange: NSMakeRange(0, done)];
 	    }
 	}
     }
@@ -1397,6 +1482,11 @@ static Class	runLoopClass;
     }
   else
     {
+      if ([wMsgs indexOfObjectIdenticalTo: components] == 0)
+	{
+	  wItem = 0;
+	  wLength = 0;
+	}
       [wMsgs removeObjectIdenticalTo: components];
     }
   M_UNLOCK(myLock);
@@ -2386,15 +2476,18 @@ static Class		tcpPortClass;
 		{
 		  NSMutableData	*d;
 
+		  /*
+		   * The item header goes in a data object of its own,
+		   * which is written together with the item itself, so
+		   * the item does not need to be copied.
+		   */
 		  pack = NO;
-		  d = [[NSMutableData alloc] initWithLength: l + h];
-		  b = [d mutableBytes];
-		  pih = (GSPortItemHeader*)b;
-		  memcpy(b+h, [o bytes], l);
+		  d = [[NSMutableData alloc] initWithLength: h];
+		  pih = (GSPortItemHeader*)[d mutableBytes];
 		  pih->type = GSSwapHostI32ToBig(GSP_DATA);
 		  pih->length = GSSwapHostI32ToBig(l);
-		  [components replaceObjectAtIndex: i
-					withObject: d];
+		  [components insertObject: d atIndex: i++];
+		  c++;
 		  RELEASE(d);
 		}
 	    }
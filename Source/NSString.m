@@ -1400,30 +1400,15 @@ GSICUCollatorOpen(NSStringCompareOptions mask, NSLocale *locale)
 {
   unsigned char	buf[2048];
   GSStr		f;
-  unichar	fbuf[1024];
-  unichar	*fmt = fbuf;
-  size_t	len;
 
   if (NULL == format)
     [NSException raise: NSInvalidArgumentException
       format: @"[NSString-initWithFormat:locale:arguments:]: NULL format"];
-  /*
-   * First we provide an array of unichar characters containing the
-   * format string.  For performance reasons we try to use an on-stack
-   * buffer if the format string is small enough ... it almost always
-   * will be.
-   */
-  len = [format length];
-  if (len >= 1024)
-    {
-      fmt = NSZoneMalloc(NSDefaultMallocZone(), (len+1)*sizeof(unichar));
-    }
-  [format getCharacters: fmt range: ((NSRange){0, len})];
-  fmt[len] = '\0';
 
   /*
-   * Now set up 'f' as a GSMutableString object whose initial buffer is
-   * allocated on the stack.  The GSPrivateFormat function can write into it.
+   * Set up 'f' as a GSMutableString object whose initial buffer is
+   * allocated on the stack.  The GSPrivateFormatString function can
+   * write into it.
    */
   f = (GSStr)alloca(class_getInstanceSize(GSMutableStringClass));
   object_setClass(f, GSMutableStringClass);
@@ -1435,12 +1420,8 @@ GSICUCollatorOpen(NSStringCompareOptions mask, NSLocale *locale)
   f->_flags.owned = 0;
   f->_flags.unused = 0;
   f->_flags.hash = 0;
-  GSPrivateFormat(f, fmt, argList, locale);
+  GSPrivateFormatString(f, format, argList, locale);
   GSPrivateStrExternalize(f);
-  if (fmt != fbuf)
-    {
-      NSZoneFree(NSDefaultMallocZone(), fmt);
-    }
 
   /*
    * Don't use noCopy because f->_contents.u may be memory on the stack,
@@ -2340,14 +2321,30 @@ GSICUCollatorOpen(NSStringCompareOptions mask, NSLocale *locale)
   if ((mask & NSRegularExpressionSearch) == NSRegularExpressionSearch)
     {
       NSRange			r = {NSNotFound, 0};
-      NSError			*e = nil;
       NSUInteger		options = 0;
-      NSRegularExpression	*regex = [NSRegularExpression alloc];
+      NSRegularExpression	*regex;
 
       if ((mask & NSCaseInsensitiveSearch) == NSCaseInsensitiveSearch)
 	{
 	  options |= NSRegularExpressionCaseInsensitive;
 	}
+#if	GS_USE_ICU == 1
+      /* Search patterns are usually constant, so use the shared cache
+       * rather than compiling the pattern on every call.
+       */
+      regex = GSPrivateRegularExpression(aString, options);
+      if (nil != regex)
+	{
+	  options = ((mask & NSAnchoredSearch) == NSAnchoredSearch)
+	    ? NSMatchingAnchored : 0;
+	  r = [regex rangeOfFirstMatchInString: self
+				       options: options
+					 range: searchRange];
+	}
+#else
+      NSError			*e = nil;
+
+      regex = [NSRegularExpression alloc];
       regex = [regex initWithPattern: aString options: options error: &e];
       if (nil == e)
 	{
@@ -2358,6 +2355,7 @@ GSICUCollatorOpen(NSStringCompareOptions mask, NSLocale *locale)
 					 range: searchRange];
 	}
       [regex release];
+#endif
       return r;
     }
 
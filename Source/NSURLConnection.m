@@ -71,7 +71,10 @@
 {
   if (nil != (self = [super init]))
     {
-      _data = [NSMutableData new];      // Empty data unless we get an error
+      /* Empty data unless we get an error.  Chunked data avoids copying
+       * the body repeatedly as it grows.
+       */
+      _data = [[NSMutableData dataWithChunkSize: 0] retain];
     }
   return self;
 }
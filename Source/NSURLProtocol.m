@@ -881,6 +881,7 @@ static NSURLProtocol	*placeholder = nil;
                 GSTLSDebug,
                 GSTLSPriority,
                 GSTLSRemoteHosts,
+                GSTLSResumeKey,
                 GSTLSRevokeFile,
                 GSTLSServerName,
                 GSTLSVerify,
@@ -49,6 +49,10 @@ GS_PRIVATE_INTERNAL(NSXMLDocument)
   if (GS_EXISTS_INTERNAL)
     {
       [internal->MIMEType release];
+      if (internal->names != 0)
+	{
+	  NSFreeMapTable(internal->names);
+	}
     }
   [super dealloc];
 }
@@ -283,6 +287,7 @@ GS_PRIVATE_INTERNAL(NSXMLDocument)
 
   // Do our subNode housekeeping...
   [self _addSubNode: root];
+  [root _updateOwners];
 }
 
 - (void) setStandalone: (BOOL)standalone
@@ -528,6 +533,32 @@ GS_PRIVATE_INTERNAL(NSXMLDocument)
 }
 @end
 
+@implementation	NSXMLDocument (Private)
+
+/* Names parsed into the document are held in the dictionary of its
+ * libxml2 document, so each distinct name has a single address and we
+ * can keep one string per name rather than making a new string every
+ * time the name of a node is asked for.
+ */
+- (NSString *) _stringForName: (const xmlChar *)name
+{
+  NSString	*s;
+
+  if (0 == internal->names)
+    {
+      internal->names = NSCreateMapTable(NSNonOwnedPointerMapKeyCallBacks,
+	NSObjectMapValueCallBacks, 64);
+    }
+  s = NSMapGet(internal->names, name);
+  if (nil == s)
+    {
+      s = StringFromXMLStringPtr(name);
+      NSMapInsert(internal->names, name, s);
+    }
+  return AUTORELEASE(RETAIN(s));
+}
+@end
+
 #else /* HAVE_LIBXML */
 
 #import "Foundation/NSXMLDocument.h"
@@ -348,6 +348,7 @@ extern void ensure_oldNs(xmlNodePtr node);
     }
   xmlAddChild(theNode, (xmlNodePtr)attr);
   [self _addSubNode: attribute];
+  [attribute _updateOwners];
 }
 
 - (void) removeAttributeForName: (NSString*)name
@@ -719,86 +720,77 @@ extern void ensure_oldNs(xmlNodePtr node);
   [self removeChildAtIndex: index + 1];
 }
 
-static void
-joinTextNodes(xmlNodePtr nodeA, xmlNodePtr nodeB, NSMutableArray *nodesToDelete)
+static BOOL
+joinTextNodes(xmlNodePtr nodeA, xmlNodePtr nodeB)
 {
   NSXMLNode *objA = (nodeA->_private);
   NSXMLNode *objB = (nodeB->_private);
 
   xmlTextMerge(nodeA, nodeB); // merge nodeB into nodeA
+  if (nodeA->next == nodeB)
+    {
+      return NO; // libxml2 does not merge nodes of different types
+    }
 
   if (objA != nil) // objA gets the merged node
     {
       if (objB != nil) // objB is now invalid
 	{
 	  /* set it to be invalid and make sure it's not
-	   * pointing to a freed node
+	   * pointing to a freed node, then remove it from
+	   * the subNodes of the parent (if it was there).
 	   */
 	  [objB _invalidate];
-	  [nodesToDelete addObject: objB];
+	  [(NSXMLNode*)nodeA->parent->_private _removeSubNode: objB];
 	}
     }
   else if (objB != nil) // there is no objA -- objB gets the merged node
     {
       [objB _setNode: nodeA]; // nodeA is the remaining (merged) node
     }
+  return YES;
 }
 
-- (void) normalizeAdjacentTextNodesPreservingCDATA: (BOOL)preserve
+static inline BOOL
+isText(xmlNodePtr node, BOOL preserve)
 {
-  NSEnumerator *subEnum = [internal->subNodes objectEnumerator];
-  NSXMLNode *subNode = nil;
-  NSMutableArray *nodesToDelete = [NSMutableArray array];
+  return (node->type == XML_TEXT_NODE
+    || (node->type == XML_CDATA_SECTION_NODE && !preserve)) ? YES : NO;
+}
 
-  while ((subNode = [subEnum nextObject]))
-    {
-      xmlNodePtr theNode = [subNode _node];
-      xmlNodePtr prev = theNode->prev;
-      xmlNodePtr next = theNode->next;
+/* Walks the libxml2 tree rather than our subNodes, since objects are
+ * only made for the nodes which have been looked at.
+ */
+static void
+normalizeTextNodes(xmlNodePtr parent, BOOL preserve)
+{
+  xmlNodePtr	theNode = parent->children;
 
+  while (theNode != NULL)
+    {
       if (theNode->type == XML_ELEMENT_NODE)
 	{
-	  [(NSXMLElement *)subNode
-	    normalizeAdjacentTextNodesPreservingCDATA:preserve];
+	  normalizeTextNodes(theNode, preserve);
 	}
-      else if (theNode->type == XML_TEXT_NODE
-	|| (theNode->type == XML_CDATA_SECTION_NODE && !preserve))
+      else if (isText(theNode, preserve))
 	{
-	  if (next && (next->type == XML_TEXT_NODE
-	    || (next->type == XML_CDATA_SECTION_NODE && !preserve)))
-	    {
-	      //combine node & node->next
-	      joinTextNodes(theNode, theNode->next, nodesToDelete);
-	    }
-	  if (prev && (prev->type == XML_TEXT_NODE
-	    || (prev->type == XML_CDATA_SECTION_NODE && !preserve)))
+	  xmlNodePtr	next;
+
+	  while ((next = theNode->next) != NULL && isText(next, preserve)
+	    && joinTextNodes(theNode, next))
 	    {
-	      /* combine node->prev & node
-	       * join the text of both nodes
-	       * assign the joined text to the earlier of the two
-	       * nodes that has an ObjC object
-	       * unlink the other node
-	       * delete the other node's object (maybe add it to a
-	       * list of nodes to delete when we're done? --
-	       * or just set its node to null, and then remove it
-	       * from our subNodes when we're done iterating it)
-	       * (or maybe we need to turn it into an NSInvalidNode too??)
-	       */
-	      joinTextNodes(theNode->prev, theNode, nodesToDelete);
+	      continue;
 	    }
-
-	}
-    }
-  if ([nodesToDelete count] > 0)
-    {
-      subEnum = [nodesToDelete objectEnumerator];
-      while ((subNode = [subEnum nextObject]))
-	{
-	  [self _removeSubNode: subNode];
 	}
+      theNode = theNode->next;
     }
 }
 
+- (void) normalizeAdjacentTextNodesPreservingCDATA: (BOOL)preserve
+{
+  normalizeTextNodes(internal->node.node, preserve);
+}
+
 @end
 
 #endif	/* HAVE_LIBXML */
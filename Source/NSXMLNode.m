@@ -29,6 +29,7 @@
 #define GSInternal	NSXMLNodeInternal
 
 #import "Foundation/NSCharacterSet.h"
+#import "Foundation/NSThread.h"
 #import "NSXMLPrivate.h"
 #import "GSInternal.h"
 GS_PRIVATE_INTERNAL(NSXMLNode)
@@ -316,6 +317,75 @@ isEqualTree(xmlNodePtr nodeA, xmlNodePtr nodeB)
   return NO;
 }
 
+/* Sets the owner of each object made on demand for aNode or for a node
+ * below it.
+ */
+static void
+setOwners(xmlNodePtr aNode, NSXMLNode *top)
+{
+  NSXMLNode	*obj = aNode->_private;
+  xmlNodePtr	child;
+
+  if (obj != nil && obj != top && GSIVar(obj, owner) != nil)
+    {
+      ASSIGN(GSIVar(obj, owner), top);
+    }
+  if (XML_ENTITY_REF_NODE == aNode->type)
+    {
+      return;	// The children belong to the entity declaration
+    }
+  for (child = aNode->children; child != NULL; child = child->next)
+    {
+      setOwners(child, top);
+    }
+  if (XML_ELEMENT_NODE == aNode->type)
+    {
+      child = (xmlNodePtr)aNode->properties;
+      while (child != NULL)
+	{
+	  setOwners(child, top);
+	  child = child->next;
+	}
+    }
+}
+
+/* Returns YES if there is an object for aNode or for a node below it.
+ */
+static BOOL
+hasObjects(xmlNodePtr aNode)
+{
+  xmlNodePtr	child;
+
+  if (aNode->_private != NULL)
+    {
+      return YES;
+    }
+  if (XML_ENTITY_REF_NODE == aNode->type)
+    {
+      return NO;
+    }
+  for (child = aNode->children; child != NULL; child = child->next)
+    {
+      if (hasObjects(child))
+	{
+	  return YES;
+	}
+    }
+  if (XML_ELEMENT_NODE == aNode->type)
+    {
+      child = (xmlNodePtr)aNode->properties;
+      while (child != NULL)
+	{
+	  if (hasObjects(child))
+	    {
+	      return YES;
+	    }
+	  child = child->next;
+	}
+    }
+  return NO;
+}
+
 /* FIXME ... the libxml2 data structure representing a namespace has a
  * completely different layout from that of almost all other nodes, so
  * the generic xmlNode code won't work and we need to check the type
@@ -453,13 +523,19 @@ isEqualTree(xmlNodePtr nodeA, xmlNodePtr nodeB)
             {
               [doc _addSubNode: result];
             }
-          else
+          else if (node->parent != NULL)
             {
-              if (node->parent)
+              xmlNodePtr top = node->parent;
+
+              /* The new object is not retained by its parent, so it goes
+               * away when nothing uses it, but it keeps the whole tree
+               * alive until then.
+               */
+              while (top->parent != NULL)
                 {
-                  NSXMLNode *parent = [self _objectForNode: node->parent];
-                  [parent _addSubNode: result];
+                  top = top->parent;
                 }
+              GSIVar(result, owner) = RETAIN([self _objectForNode: top]);
             }
 	}
     }
@@ -469,6 +545,7 @@ isEqualTree(xmlNodePtr nodeA, xmlNodePtr nodeB)
 
 - (void) _addSubNode: (NSXMLNode *)subNode
 {
+  [self _pin];
   if (!internal->subNodes)
     internal->subNodes = [[NSMutableArray alloc] init];
   if ([internal->subNodes indexOfObjectIdenticalTo: subNode] == NSNotFound)
@@ -706,6 +783,7 @@ isEqualTree(xmlNodePtr nodeA, xmlNodePtr nodeB)
     }
 
   [self _addSubNode: child];
+  [child _updateOwners];
 }
 
 - (void) _invalidate
@@ -714,6 +792,49 @@ isEqualTree(xmlNodePtr nodeA, xmlNodePtr nodeB)
   [self _setNode: NULL];
 }
 
+/* Makes sure that the receiver is retained by its parent (and so on up
+ * to the top of the tree) rather than only by its users, so that it lasts
+ * as long as its node.  This is needed once the receiver holds anything
+ * which is not in the libxml2 node itsself.
+ */
+- (void) _pin
+{
+  if (internal->owner != nil)
+    {
+      NSXMLNode	*o = internal->owner;
+
+      internal->owner = nil;
+      [[self parent] _addSubNode: self];
+      RELEASE(o);
+    }
+}
+
+/* Called when the node of the receiver has been moved to another tree,
+ * to make the objects for the nodes below it keep the new tree alive
+ * rather than the old one.
+ */
+- (void) _updateOwners
+{
+  xmlNodePtr	theNode = internal->node.node;
+  xmlNodePtr	top = theNode;
+  NSXMLNode	*o;
+
+  if (NULL == theNode || XML_NAMESPACE_DECL == theNode->type)
+    {
+      return;
+    }
+  while (top->parent != NULL)
+    {
+      top = top->parent;
+    }
+  o = [NSXMLNode _objectForNode: top];
+  setOwners(theNode, o);
+  if (top == theNode)
+    {
+      DESTROY(internal->owner);
+    }
+}
+
 @end
 
 static void
@@ -752,36 +873,155 @@ clearPrivatePointers(xmlNodePtr aNode)
   // FIXME: Handle more node types
 }
 
-static NSArray *
-execute_xpath(xmlNodePtr node, NSString *xpath_exp, NSDictionary *constants,
-              BOOL nodesOnly, NSError **error)
+/* Holds a compiled XPath expression in the cache of the current thread.
+ */
+@interface	GSXPathExpression : NSObject
+{
+@public
+  xmlXPathCompExprPtr	comp;
+}
+@end
+
+@implementation	GSXPathExpression
+- (void) dealloc
+{
+  if (comp != NULL)
+    {
+      xmlXPathFreeCompExpr(comp);
+    }
+  [super dealloc];
+}
+@end
+
+/* Enumerates the nodes found by an XPath query, making the object for
+ * each node only as it is asked for.
+ */
+@interface	GSXPathEnumerator : NSEnumerator
+{
+  NSXMLNode		*owner;		// Keeps the tree alive
+  xmlXPathObjectPtr	result;
+  int			pos;
+}
+- (id) initWithResult: (xmlXPathObjectPtr)r owner: (NSXMLNode*)o;
+@end
+
+@implementation	GSXPathEnumerator
+- (void) dealloc
+{
+  xmlXPathFreeObject(result);
+  RELEASE(owner);
+  [super dealloc];
+}
+
+- (id) initWithResult: (xmlXPathObjectPtr)r owner: (NSXMLNode*)o
+{
+  if ((self = [super init]) != nil)
+    {
+      result = r;
+      owner = RETAIN(o);
+    }
+  else
+    {
+      xmlXPathFreeObject(r);
+    }
+  return self;
+}
+
+- (id) nextObject
+{
+  xmlNodeSetPtr	nodeset = result->nodesetval;
+
+  while (nodeset != NULL && pos < nodeset->nodeNr)
+    {
+      NSXMLNode	*obj = [NSXMLNode _objectForNode: nodeset->nodeTab[pos++]];
+
+      if (obj != nil)
+	{
+	  return obj;
+	}
+    }
+  return nil;
+}
+@end
+
+/* The number of compiled expressions kept for each thread.
+ */
+#define	XPATH_CACHE_SIZE	64
+
+static NSString	*xpathKey = @"GSXPathCache";
+
+/* Returns the compiled form of xpath_exp, compiling it only if it is not
+ * in the cache of the current thread.  Expressions are cached per thread
+ * as libxml2 does not promise that evaluating a compiled expression in
+ * several threads at once is safe.
+ */
+static xmlXPathCompExprPtr
+compiled_xpath(NSString *xpath_exp)
+{
+  NSMutableDictionary	*d = [[NSThread currentThread] threadDictionary];
+  NSMutableDictionary	*cache = [d objectForKey: xpathKey];
+  GSXPathExpression	*e;
+
+  if (nil == cache)
+    {
+      cache = [NSMutableDictionary new];
+      [d setObject: cache forKey: xpathKey];
+      RELEASE(cache);
+    }
+  e = [cache objectForKey: xpath_exp];
+  if (nil == e)
+    {
+      xmlXPathCompExprPtr	comp = xmlXPathCompile(XMLSTRING(xpath_exp));
+
+      if (NULL == comp)
+	{
+	  return NULL;
+	}
+      if ([cache count] >= XPATH_CACHE_SIZE)
+	{
+	  [cache removeAllObjects];
+	}
+      e = [GSXPathExpression new];
+      e->comp = comp;
+      [cache setObject: e forKey: xpath_exp];
+      RELEASE(e);
+    }
+  return e->comp;
+}
+
+/* Evaluates xpath_exp with node as the context node and returns the
+ * result, which the caller must free.
+ */
+static xmlXPathObjectPtr
+evaluate_xpath(xmlNodePtr node, NSString *xpath_exp, NSDictionary *constants)
 {
   xmlDocPtr doc = node->doc;
-  NSMutableArray *result = nil;
-  const xmlChar* xpathExpr = XMLSTRING(xpath_exp); 
+  xmlXPathCompExprPtr comp;
   xmlXPathContextPtr xpathCtx =  NULL; 
   xmlXPathObjectPtr xpathObj = NULL; 
   xmlNodePtr rootNode = NULL;
 
-  if (error != NULL)
-    {
-      *error = NULL;
-    }
-
   if (doc == NULL)
     {
       // FIXME: Create temporary document
-      return nil;
+      return NULL;
     }
 
-  assert(xpathExpr);
+  assert(XMLSTRING(xpath_exp));
+
+  comp = compiled_xpath(xpath_exp);
+  if (comp == NULL) 
+    {
+      NSLog(@"Error: unable to compile xpath expression \"%@\"", xpath_exp);
+      return NULL;
+    }
   
   /* Create xpath evaluation context */
   xpathCtx = xmlXPathNewContext(doc);
   if (!xpathCtx) 
     {
       NSLog(@"Error: unable to create new XPath context.");
-      return nil;
+      return NULL;
     }
     
   // provide a context for relative paths
@@ -822,11 +1062,31 @@ execute_xpath(xmlNodePtr node, NSString *xpath_exp, NSDictionary *constants,
     }
 
   /* Evaluate xpath expression */
-  xpathObj = xmlXPathEvalExpression(xpathExpr, xpathCtx);
+  xpathObj = xmlXPathCompiledEval(comp, xpathCtx);
+  if (xpathObj == NULL) 
+    {
+      NSLog(@"Error: unable to evaluate xpath expression \"%@\"", xpath_exp);
+    }
+  xmlXPathFreeContext(xpathCtx); 
+
+  return xpathObj;
+}
+
+static NSArray *
+execute_xpath(xmlNodePtr node, NSString *xpath_exp, NSDictionary *constants,
+              BOOL nodesOnly, NSError **error)
+{
+  NSMutableArray *result = nil;
+  xmlXPathObjectPtr xpathObj = NULL; 
+
+  if (error != NULL)
+    {
+      *error = NULL;
+    }
+
+  xpathObj = evaluate_xpath(node, xpath_exp, constants);
   if (xpathObj == NULL) 
     {
-      NSLog(@"Error: unable to evaluate xpath expression \"%s\"", xpathExpr);
-      xmlXPathFreeContext(xpathCtx);
       return nil;
     }
   
@@ -872,7 +1132,6 @@ execute_xpath(xmlNodePtr node, NSString *xpath_exp, NSDictionary *constants,
 
   /* Cleanup */
   xmlXPathFreeObject(xpathObj);
-  xmlXPathFreeContext(xpathCtx); 
 
   return result;
 }
@@ -1263,6 +1522,9 @@ execute_xpath(xmlNodePtr node, NSString *xpath_exp, NSDictionary *constants,
                 }
             }
         }
+      /* Must come last, as releasing the owner may free the tree.
+       */
+      RELEASE(internal->owner);
       GS_DESTROY_INTERNAL(NSXMLNode);
     }
   [super dealloc];
@@ -1309,6 +1571,7 @@ execute_xpath(xmlNodePtr node, NSString *xpath_exp, NSDictionary *constants,
 	{
 	  [parent _removeSubNode: self];
 	}
+      [self _updateOwners];
     }
 }
 
@@ -1543,6 +1806,13 @@ execute_xpath(xmlNodePtr node, NSString *xpath_exp, NSDictionary *constants,
     }
   else
     {
+      xmlDocPtr	doc = theNode->doc;
+
+      if (doc != NULL && doc->dict != NULL && doc->_private != NULL
+	&& xmlDictOwns(doc->dict, theNode->name) == 1)
+	{
+	  return [(NSXMLDocument*)doc->_private _stringForName: theNode->name];
+	}
       return StringFromXMLStringPtr(theNode->name);
     }
 }
@@ -1734,9 +2004,44 @@ execute_xpath(xmlNodePtr node, NSString *xpath_exp, NSDictionary *constants,
 - (NSString*) stringValue
 {
   xmlNodePtr theNode = internal->node.node;
-  xmlChar *content = xmlNodeGetContent(theNode);
+  xmlNodePtr text = NULL;
+  xmlChar *content;
   NSString *result = nil;
 
+  if (NULL == theNode)
+    {
+      return @"";
+    }
+
+  /* Where the content is all in one text node we make the string from
+   * it directly rather than from a copy.
+   */
+  switch (theNode->type)
+    {
+      case XML_TEXT_NODE:
+      case XML_CDATA_SECTION_NODE:
+      case XML_COMMENT_NODE:
+      case XML_PI_NODE:
+	text = theNode;
+	break;
+      case XML_ELEMENT_NODE:
+      case XML_ATTRIBUTE_NODE:
+	if (theNode->children != NULL && theNode->children->next == NULL
+	  && (theNode->children->type == XML_TEXT_NODE
+	    || theNode->children->type == XML_CDATA_SECTION_NODE))
+	  {
+	    text = theNode->children;
+	  }
+	break;
+      default:
+	break;
+    }
+  if (text != NULL)
+    {
+      return StringFromXMLStringPtr(text->content);
+    }
+
+  content = xmlNodeGetContent(theNode);
   if (NULL != content)
     {
       result = StringFromXMLStringPtr(content);
@@ -1758,6 +2063,7 @@ execute_xpath(xmlNodePtr node, NSString *xpath_exp, NSDictionary *constants,
   stringValue = [value description];
   [self setStringValue: stringValue];
 
+  [self _pin];
   ASSIGN(internal->objectValue, value);
 }
 
@@ -1873,21 +2179,21 @@ execute_xpath(xmlNodePtr node, NSString *xpath_exp, NSDictionary *constants,
     }
   else
     {
-      // Remove all child nodes except attributes
-      if (internal->subNodes)
+      xmlNodePtr child = theNode->children;
+
+      /* Remove all child nodes except attributes.  Setting the content
+       * frees the children, so any child with an object for it or for
+       * a node below it must be detached first.
+       */
+      while (child != NULL)
         {
-          NSArray *theSubNodes = [internal->subNodes copy];
-          NSEnumerator *enumerator = [theSubNodes objectEnumerator];
-          NSXMLNode *subNode;
-          
-          while ((subNode = [enumerator nextObject]) != nil)
+          xmlNodePtr next = child->next;
+
+          if (hasObjects(child))
             {
-              if ([subNode kind] != NSXMLAttributeKind)
-                {
-                  [subNode detach];
-                }
+              [[NSXMLNode _objectForNode: child] detach];
             }
-          RELEASE(theSubNodes);
+          child = next;
         }
 
       if (resolve == NO)
@@ -1903,6 +2209,7 @@ execute_xpath(xmlNodePtr node, NSString *xpath_exp, NSDictionary *constants,
           xmlMemFree(newstr);
         }
     }
+  [self _pin];
   ASSIGN(internal->objectValue, string);
 }
 
@@ -2080,7 +2387,14 @@ execute_xpath(xmlNodePtr node, NSString *xpath_exp, NSDictionary *constants,
 - (NSString*) XPath
 {
   xmlNodePtr theNode = internal->node.node;
-  return StringFromXMLStringPtr(xmlGetNodePath(theNode));
+  xmlChar *path = xmlGetNodePath(theNode);
+  NSString *result = StringFromXMLStringPtr(path);
+
+  if (path != NULL)
+    {
+      xmlFree(path);
+    }
+  return result;
 }
 
 - (NSArray*) nodesForXPath: (NSString*)anxpath error: (NSError**)error
@@ -2099,6 +2413,44 @@ execute_xpath(xmlNodePtr node, NSString *xpath_exp, NSDictionary *constants,
   return execute_xpath(theNode, anxpath, nil, YES, error);
 }
 
+- (NSEnumerator*) nodeEnumeratorForXPath: (NSString*)anxpath
+				   error: (NSError**)error
+{
+  xmlNodePtr theNode = internal->node.node;
+  xmlNodePtr top = theNode;
+  xmlXPathObjectPtr xpathObj;
+
+  if (error != NULL)
+    {
+      *error = NULL;
+    }
+  if (NSXMLInvalidKind == internal->kind)
+    {
+      return nil;
+    }
+  if (theNode->type == XML_NAMESPACE_DECL)
+    {
+      return nil;
+    }
+
+  xpathObj = evaluate_xpath(theNode, anxpath, nil);
+  if (NULL == xpathObj)
+    {
+      return nil;
+    }
+  if (xpathObj->type != XPATH_NODESET)
+    {
+      xmlXPathFreeObject(xpathObj);
+      return nil;
+    }
+  while (top->parent != NULL)
+    {
+      top = top->parent;
+    }
+  return AUTORELEASE([[GSXPathEnumerator alloc] initWithResult: xpathObj
+    owner: [NSXMLNode _objectForNode: top]]);
+}
+
  - (NSArray*) objectsForXQuery: (NSString*)xquery
 		     constants: (NSDictionary*)constants
 		         error: (NSError**)error
@@ -2374,6 +2726,12 @@ execute_xpath(xmlNodePtr node, NSString *xpath_exp, NSDictionary *constants,
   return nil;
 }
 
+- (NSEnumerator*) nodeEnumeratorForXPath: (NSString*)anxpath
+				   error: (NSError**)error
+{
+  return nil;
+}
+
  - (NSArray*) objectsForXQuery: (NSString*)xquery
 		     constants: (NSDictionary*)constants
 		         error: (NSError**)error
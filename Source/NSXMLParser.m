@@ -35,6 +35,8 @@
 #import "Foundation/NSData.h"
 #import "Foundation/NSDictionary.h"
 #import "Foundation/NSNull.h"
+#import "Foundation/NSRunLoop.h"
+#import "Foundation/NSStream.h"
 #import "GNUstepBase/GSMime.h"
 
 @interface GSMimeDocument (internal)
@@ -45,6 +47,98 @@ NSString* const NSXMLParserErrorDomain = @"NSXMLParserErrorDomain";
 
 static  NSNull  *null = nil;
 
+// Size of the pieces in which a document is read from a stream.
+#define	STREAM_CHUNK	65536
+
+/* Reads up to size bytes from stream into buf, returning the number read,
+ * zero at the end of the stream or -1 on error.  A stream with no bytes
+ * available yet (such as one reading from a socket) is scheduled in a
+ * private run loop mode which is run until it has some or is finished.
+ */
+static NSInteger
+readStream(NSInputStream *stream, uint8_t *buf, NSUInteger size)
+{
+  static NSString	*mode = @"NSXMLParserStreamMode";
+  NSRunLoop		*loop = nil;
+  NSInteger		len;
+
+  for (;;)
+    {
+      NSStreamStatus	status = [stream streamStatus];
+
+      if (NSStreamStatusAtEnd == status || NSStreamStatusClosed == status)
+	{
+	  len = 0;
+	  break;
+	}
+      if (NSStreamStatusError == status || NSStreamStatusNotOpen == status)
+	{
+	  len = -1;
+	  break;
+	}
+      /* A socket stream whose read would block says it is still reading,
+       * so we try again when it has bytes.
+       */
+      if (NSStreamStatusOpen == status || NSStreamStatusReading == status)
+	{
+	  len = [stream read: buf maxLength: size];
+	  if (len > 0)
+	    {
+	      break;
+	    }
+	  status = [stream streamStatus];
+	  if (NSStreamStatusAtEnd == status || NSStreamStatusClosed == status)
+	    {
+	      len = 0;
+	      break;
+	    }
+	  if (NSStreamStatusError == status)
+	    {
+	      len = -1;
+	      break;
+	    }
+	}
+      if (nil == loop)
+	{
+	  loop = [NSRunLoop currentRunLoop];
+	  [stream scheduleInRunLoop: loop forMode: mode];
+	}
+      [loop runMode: mode
+	 beforeDate: [NSDate dateWithTimeIntervalSinceNow: 1.0]];
+    }
+  if (nil != loop)
+    {
+      [stream removeFromRunLoop: loop forMode: mode];
+    }
+  return len;
+}
+
+/* Reads the whole of a stream into memory, returning nil on error.
+ */
+static NSData *
+readWholeStream(NSInputStream *stream)
+{
+  NSMutableData	*data = [NSMutableData dataWithCapacity: STREAM_CHUNK];
+  NSInteger	len;
+
+  if ([stream streamStatus] == NSStreamStatusNotOpen)
+    {
+      [stream open];
+    }
+  do
+    {
+      NSUInteger	used = [data length];
+
+      [data setLength: used + STREAM_CHUNK];
+      len = readStream(stream, (uint8_t*)[data mutableBytes] + used,
+	STREAM_CHUNK);
+      [data setLength: used + (len > 0 ? len : 0)];
+    }
+  while (len > 0);
+  [stream close];
+  return (len < 0) ? nil : data;
+}
+
 #if	 defined(HAVE_LIBXML)
 
 /* We support a strict libxml2 based parser ... but sometimes we need a
@@ -67,7 +161,11 @@ static  NSNull  *null = nil;
   BOOL		_shouldReportNamespacePrefixes;
   BOOL		_shouldResolveExternalEntities;
   NSMutableArray        *_namespaces;
+  NSMutableDictionary	*_qNames;	// Qualified names by prefix and name
+  NSInputStream		*_stream;	// Source for an incremental parse
+  BOOL			_stopped;	// Stop reading from the stream
 }
+- (NSString*) _qName: (NSString*)name prefix: (NSString*)prefix;
 - (void) _setOwner: (id)owner;
 @end
 
@@ -82,7 +180,9 @@ static  NSNull  *null = nil;
 - (void) dealloc
 {
   DESTROY(_namespaces);
+  DESTROY(_qNames);
   DESTROY(_lastError);
+  DESTROY(_stream);
   [super dealloc];
 }
 
@@ -114,7 +214,7 @@ static  NSNull  *null = nil;
 
   if ([prefix length] > 0)
     {
-      qName = [NSString stringWithFormat: @"%@:%@", prefix, qName];
+      qName = [self _qName: qName prefix: prefix];
     }
 
   if (elementAttributes == nil)
@@ -194,7 +294,7 @@ static  NSNull  *null = nil;
 
   if ([prefix length] > 0)
     {
-      qName = [NSString stringWithFormat: @"%@:%@", prefix, qName];
+      qName = [self _qName: qName prefix: prefix];
     }
   if (_shouldProcessNamespaces)
     {
@@ -370,6 +470,7 @@ static  NSNull  *null = nil;
 }
 - (void) fatalError: (NSString*)e
 {
+  _stopped = YES;
   [self error: e];
 }
 - (void) warning: (NSString*)e
@@ -425,6 +526,32 @@ static  NSNull  *null = nil;
   return 0;
 }
 
+/* The same few names are used over and over in a document, so we keep
+ * the qualified names we make rather than making them for every element.
+ */
+- (NSString*) _qName: (NSString*)name prefix: (NSString*)prefix
+{
+  NSMutableDictionary	*names = [_qNames objectForKey: prefix];
+  NSString		*qName = [names objectForKey: name];
+
+  if (nil == qName)
+    {
+      if (nil == names)
+	{
+	  if (nil == _qNames)
+	    {
+	      _qNames = [NSMutableDictionary new];
+	    }
+	  names = [NSMutableDictionary new];
+	  [_qNames setObject: names forKey: prefix];
+	  RELEASE(names);
+	}
+      qName = [NSString stringWithFormat: @"%@:%@", prefix, name];
+      [names setObject: qName forKey: name];
+    }
+  return qName;
+}
+
 - (void) _setOwner: (id)owner
 {
   _owner = owner;
@@ -462,6 +589,7 @@ static  NSNull  *null = nil;
 			      code: 0
 			  userInfo: d];
   ASSIGN(myHandler->_lastError, error);
+  myHandler->_stopped = YES;
   [myHandler->_delegate parser: myHandler->_owner parseErrorOccurred: error];
   [myParser abortParsing];
 }
@@ -502,11 +630,118 @@ static  NSNull  *null = nil;
   return self;
 }
 
+- (id) initWithStream: (NSInputStream*)stream
+{
+  if (nil == stream)
+    {
+      DESTROY(self);
+      return nil;
+    }
+  _handler = [NSXMLSAXHandler new];
+  [myHandler _setOwner: self];
+  myHandler->_stream = RETAIN(stream);
+  /* With no source the parser is a push parser, which we feed with
+   * pieces of the document as we read them.
+   */
+  _parser = [[GSXMLParser alloc] initWithSAXHandler: myHandler];
+  [(GSXMLParser*)_parser substituteEntities: YES];
+  return self;
+}
+
 - (BOOL) parse
 {
-  BOOL	result;
+  NSInputStream	*stream = myHandler->_stream;
+  uint8_t	*buf;
+  BOOL		done = NO;
+  BOOL		empty = YES;
+  BOOL		result = YES;
+
+  if (nil == stream)
+    {
+      result = [[myHandler parser] parse];
+      return result;
+    }
 
-  result = [[myHandler parser] parse];
+  /* A stream can only be parsed once.
+   */
+  myHandler->_stream = nil;
+  AUTORELEASE(stream);
+  if ([stream streamStatus] == NSStreamStatusNotOpen)
+    {
+      [stream open];
+    }
+  buf = NSZoneMalloc(NSDefaultMallocZone(), STREAM_CHUNK);
+  NS_DURING
+    {
+      while (NO == done && NO == myHandler->_stopped)
+	{
+	  ENTER_POOL
+	  NSInteger	len = readStream(stream, buf, STREAM_CHUNK);
+
+	  if (len > 0)
+	    {
+	      empty = NO;
+	      [myParser parse: [NSData dataWithBytesNoCopy: buf
+						     length: len
+					       freeWhenDone: NO]];
+	    }
+	  else if (0 == len)
+	    {
+	      done = YES;
+	    }
+	  else
+	    {
+	      NSError	*error = [stream streamError];
+	      NSDictionary	*d;
+
+	      d = [NSDictionary dictionaryWithObjectsAndKeys:
+		@"Unable to read from stream", NSLocalizedDescriptionKey,
+		error, NSUnderlyingErrorKey,
+		nil];
+	      error = [NSError errorWithDomain: NSXMLParserErrorDomain
+					  code: 0
+				      userInfo: d];
+	      ASSIGN(myHandler->_lastError, error);
+	      [myHandler->_delegate parser: myHandler->_owner
+			parseErrorOccurred: error];
+	      result = NO;
+	      done = YES;
+	    }
+	  LEAVE_POOL
+	}
+    }
+  NS_HANDLER
+    {
+      NSZoneFree(NSDefaultMallocZone(), buf);
+      [stream close];
+      [localException raise];
+    }
+  NS_ENDHANDLER
+  NSZoneFree(NSDefaultMallocZone(), buf);
+  [stream close];
+  if (YES == myHandler->_stopped)
+    {
+      result = NO;
+    }
+  if (YES == result && YES == empty)
+    {
+      NSError	*error;
+
+      /* Nothing was read, so libxml2 has no document to finish.
+       */
+      error = [NSError errorWithDomain: NSXMLParserErrorDomain
+				  code: NSXMLParserEmptyDocumentError
+			      userInfo: [NSDictionary dictionaryWithObject:
+	@"Document is empty" forKey: NSLocalizedDescriptionKey]];
+      ASSIGN(myHandler->_lastError, error);
+      [myHandler->_delegate parser: myHandler->_owner
+		parseErrorOccurred: error];
+      result = NO;
+    }
+  if (YES == result)
+    {
+      result = [myParser parse: nil];
+    }
   return result;
 }
 
@@ -769,6 +1004,14 @@ static SEL	foundIgnorableSel;
   return [self initWithData: [NSData dataWithContentsOfURL: anURL]];
 }
 
+- (id) initWithStream: (NSInputStream*)stream
+{
+  /* This parser works on a complete document, so we must read it all
+   * before we can start.
+   */
+  return [self initWithData: (nil == stream) ? nil : readWholeStream(stream)];
+}
+
 - (id) initWithData: (NSData *)data
 {
   if (data == nil)
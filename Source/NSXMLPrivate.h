@@ -134,14 +134,23 @@ union\
  * The 'options' field is a bitmask of options for this node.
  * The 'objectValue' is the object value set for the node.
  * The 'subNodes' array is used to retain the objects pointed to by subnodes.
+ * The 'owner' is the object for the top node of the tree, retained by an
+ * object made on demand for a node within that tree.
  *
- * When we create an Objective-C object for a node we also create objects
- * for all parents up to the root object. (Reusing existing once as we find 
- * them in the _private points of parent nodes)
- * This adds the object to the subnode array of the parent object, retaining 
- * the object in this process.
- * This means a document object will retain all the objects we have created
- * for its node tree, but we don't have to create all these objects at once.
+ * When we need an Objective-C object for a node within a tree we create it
+ * on demand and record it in the _private pointer of the node, but nothing
+ * retains it except its users, so the _private pointers act as a weak
+ * cache and a large document does not build up an object for every node
+ * that has been looked at.  Such an object retains its 'owner' instead,
+ * so the tree (and the node) stays alive as long as the object does, and
+ * clears the _private pointer when it is deallocated.
+ * Objects which are added to a tree, or which hold state that is not in
+ * the libxml2 node (such as an object value), are kept in the subnode
+ * array of the parent object instead, and so are all the parents of such
+ * an object up to the top of the tree.
+ * This means a document object will retain all the objects we need to
+ * keep for its node tree, but we don't have to create all these objects
+ * at once.
  * When we remove an object from its parent we always call the detach method.
  * Here we unlink the libxml2 node and remove the object from its parent's
  * subnode array, This will release the object.
@@ -159,7 +168,8 @@ union\
   GS_XMLNODETYPE node;  \
   NSUInteger      options; \
   id              objectValue; \
-  NSMutableArray *subNodes;
+  NSMutableArray *subNodes; \
+  NSXMLNode      *owner;
 
 
 /* When using the non-fragile ABI, the instance variables are exposed to the
@@ -182,6 +192,7 @@ union\
 #define GS_NSXMLDocument_IVARS SUPERIVARS(GS_NSXMLNode_IVARS) \
   NSString     		*MIMEType; \
   NSInteger		contentKind; \
+  NSMapTable		*names; \
 
 /* Instance variables for NSXMLDTD with/without the instance
  * variable 'inherited' from NSXMLNode.
@@ -212,6 +223,7 @@ union\
 #import "Foundation/NSDictionary.h"
 #import "Foundation/NSEnumerator.h"
 #import "Foundation/NSException.h"
+#import "Foundation/NSMapTable.h"
 #import "Foundation/NSString.h"
 #import "Foundation/NSURL.h"
 #import "Foundation/NSXMLNode.h"
@@ -233,6 +245,12 @@ union\
 - (xmlNodePtr) _childNodeAtIndex: (NSUInteger)index;
 - (void) _insertChild: (NSXMLNode*)child atIndex: (NSUInteger)index;
 - (void) _invalidate;
+- (void) _pin;
+- (void) _updateOwners;
+@end
+
+@interface NSXMLDocument (Private)
+- (NSString *) _stringForName: (const xmlChar *)name;
 @end
 
 #endif /* HAVE_LIBXML */
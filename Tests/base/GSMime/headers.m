@@ -0,0 +1,121 @@
+#if     defined(GNUSTEP_BASE_LIBRARY)
+#import <Foundation/Foundation.h>
+#import <GNUstepBase/GSMime.h>
+#import "Testing.h"
+
+/* Parse headers given all at once, or one byte at a time.
+ */
+static GSMimeDocument *
+parse(const char *text, BOOL http, BOOL bytewise)
+{
+  GSMimeParser	*parser = [[GSMimeParser new] autorelease];
+  NSData	*data;
+  unsigned	length = strlen(text);
+  unsigned	index;
+
+  if (YES == http)
+    {
+      [parser setIsHttp];
+    }
+  if (NO == bytewise)
+    {
+      data = [NSData dataWithBytes: text length: length];
+      [parser parse: data];
+    }
+  else
+    {
+      for (index = 0; index < length; index++)
+	{
+	  data = [NSData dataWithBytes: text + index length: 1];
+	  if ([parser parse: data] == NO)
+	    {
+	      break;
+	    }
+	}
+    }
+  return [parser mimeDocument];
+}
+
+int main()
+{
+  NSAutoreleasePool	*arp = [NSAutoreleasePool new];
+  const char		*text;
+  GSMimeDocument	*doc;
+  GSMimeDocument	*idoc;
+  GSMimeHeader		*hdr;
+
+  text = "HTTP/1.1 200 OK\r\n"
+    "Content-Length: 0\r\n"
+    "content-ENCODING: gzip\r\n"
+    "X-Custom-Header: some value  \r\n"
+    "Server:Apache\r\n"
+    "Set-Cookie: a=1\r\n"
+    "Set-Cookie: b=2\r\n"
+    "X-Empty:\r\n"
+    "\r\n";
+  doc = parse(text, YES, NO);
+  idoc = parse(text, YES, YES);
+  PASS_EQUAL(doc, idoc, "headers parsed in one go and bytewise are the same");
+
+  hdr = [doc headerNamed: @"http"];
+  PASS_EQUAL([hdr objectForKey: NSHTTPPropertyStatusCodeKey],
+    [NSNumber numberWithInt: 200], "http status line is parsed");
+
+  hdr = [doc headerNamed: @"content-length"];
+  PASS_EQUAL([hdr namePreservingCase: YES], @"Content-Length",
+    "well known header name keeps its case");
+  PASS_EQUAL([hdr value], @"0", "well known header value is parsed");
+
+  hdr = [doc headerNamed: @"content-encoding"];
+  PASS_EQUAL([hdr namePreservingCase: YES], @"content-ENCODING",
+    "well known header name in unusual case keeps its case");
+  PASS_EQUAL([hdr name], @"content-encoding",
+    "well known header name in unusual case is lowercase");
+
+  hdr = [doc headerNamed: @"x-custom-header"];
+  PASS_EQUAL([hdr namePreservingCase: YES], @"X-Custom-Header",
+    "other header name keeps its case");
+  PASS_EQUAL([hdr value], @"some value  ",
+    "header value keeps trailing space");
+  PASS_EQUAL([[doc headerNamed: @"server"] value], @"Apache",
+    "header value without leading space is parsed");
+  PASS([[doc headersNamed: @"set-cookie"] count] == 2,
+    "repeated headers are all kept");
+  PASS_EQUAL([[doc headerNamed: @"x-empty"] value], @"",
+    "header with empty value is parsed");
+  PASS_EQUAL([doc content], @"", "document with zero content length is empty");
+
+  text = "Subject: =?ISO-8859-1?Q?a=E9b?=\r\n"
+    "X-Folded: one\r\n two\r\n"
+    "Content-Type: text/plain; charset=utf-8\r\n"
+    "MIME-Version: 1.0\r\n"
+    "\r\n"
+    "body";
+  doc = parse(text, NO, NO);
+  idoc = parse(text, NO, YES);
+  PASS_EQUAL(doc, idoc, "mime headers parsed in one go and bytewise match");
+  PASS_EQUAL([[doc headerNamed: @"subject"] value], @"aéb",
+    "encoded word in header is decoded");
+  PASS_EQUAL([[doc headerNamed: @"x-folded"] value], @"one two",
+    "folded header is unfolded");
+  PASS_EQUAL([doc contentType], @"text", "content type is parsed");
+  PASS_EQUAL([[doc headerNamed: @"content-type"] parameterForKey: @"charset"],
+    @"utf-8", "content type parameters are parsed");
+  PASS_EQUAL([[doc headerNamed: @"mime-version"] value], @"1.0",
+    "mime version is parsed");
+
+  text = "X-Latin: caf\xe9\r\n"
+    "\r\n";
+  doc = parse(text, YES, NO);
+  PASS_EQUAL([[doc headerNamed: @"x-latin"] value], @"café",
+    "non-ascii header value is decoded");
+
+  [arp release]; arp = nil;
+  return 0;
+}
+#else
+int main(int argc,char **argv)
+{
+  return 0;
+}
+#endif
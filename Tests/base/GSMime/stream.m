@@ -0,0 +1,243 @@
+#if     defined(GNUSTEP_BASE_LIBRARY)
+#import <Foundation/Foundation.h>
+#import <GNUstepBase/GSMime.h>
+#import "Testing.h"
+
+@interface	Streamer : NSObject
+{
+@public
+  BOOL			stream;
+  NSMutableArray	*parts;		// Decoded data for each document
+  NSUInteger		finished;
+}
+@end
+
+@implementation	Streamer
+- (void) dealloc
+{
+  [parts release];
+  [super dealloc];
+}
+
+- (id) init
+{
+  if ((self = [super init]) != nil)
+    {
+      parts = [NSMutableArray new];
+    }
+  return self;
+}
+
+- (BOOL) mimeParser: (GSMimeParser*)parser
+  shouldStreamDocument: (GSMimeDocument*)doc
+{
+  if (YES == stream)
+    {
+      [parts addObject: [NSMutableData data]];
+    }
+  return stream;
+}
+
+- (void) mimeParser: (GSMimeParser*)parser
+	   document: (GSMimeDocument*)doc
+	decodedData: (NSData*)data
+{
+  [[parts lastObject] appendData: data];
+}
+
+- (void) mimeParser: (GSMimeParser*)parser
+   finishedDocument: (GSMimeDocument*)doc
+{
+  finished++;
+}
+@end
+
+/* Parse data in pieces of the given size (all at once if size is zero).
+ */
+static GSMimeDocument *
+parse(NSData *data, NSUInteger size, id delegate, BOOL http)
+{
+  GSMimeParser	*parser = [[GSMimeParser new] autorelease];
+  NSUInteger	length = [data length];
+  NSUInteger	pos = 0;
+  BOOL		more = YES;
+
+  [parser setDelegate: delegate];
+  if (YES == http)
+    {
+      [parser setIsHttp];
+    }
+  if (0 == size)
+    {
+      size = length;
+    }
+  while (YES == more && pos < length)
+    {
+      NSUInteger	len = length - pos;
+
+      if (len > size)
+	{
+	  len = size;
+	}
+      more = [parser parse: [data subdataWithRange: NSMakeRange(pos, len)]];
+      pos += len;
+    }
+  if (YES == more)
+    {
+      [parser parse: nil];
+    }
+  return ([parser isComplete] ? [parser mimeDocument] : nil);
+}
+
+int main()
+{
+  NSAutoreleasePool	*arp = [NSAutoreleasePool new];
+  NSMutableData		*binary;
+  NSMutableData		*body;
+  NSMutableString	*encoded;
+  NSData		*data;
+  GSMimeDocument	*doc;
+  GSMimeDocument	*plain;
+  Streamer		*s;
+  NSString		*b64;
+  unsigned char		bytes[256];
+  NSUInteger		i;
+  BOOL			ok;
+
+  binary = [NSMutableData data];
+  for (i = 0; i < 5000; i++)
+    {
+      unsigned char	c = (i * 7 + i / 13) & 0xff;
+
+      [binary appendBytes: &c length: 1];
+    }
+  b64 = [[[NSString alloc] initWithData: [GSMimeDocument encodeBase64: binary]
+			       encoding: NSASCIIStringEncoding] autorelease];
+  encoded = [NSMutableString string];
+  for (i = 0; i < [b64 length]; i += 76)
+    {
+      NSUInteger	l = [b64 length] - i;
+
+      [encoded appendString: [b64 substringWithRange:
+	NSMakeRange(i, l > 76 ? 76 : l)]];
+      [encoded appendString: @"\r\n"];
+    }
+
+  body = [NSMutableData data];
+  [body appendData: [[NSString stringWithFormat:
+    @"MIME-Version: 1.0\r\n"
+    @"Content-Type: multipart/mixed; boundary=\"XyZzY\"\r\n"
+    @"\r\n"
+    @"preamble\r\n"
+    @"--XyZzY\r\n"
+    @"Content-Type: text/plain\r\n"
+    @"\r\n"
+    @"first part\r\n"
+    @"--XyZzY\r\n"
+    @"Content-Type: application/octet-stream\r\n"
+    @"Content-Transfer-Encoding: base64\r\n"
+    @"\r\n"
+    @"%@"
+    @"--XyZzY\r\n"
+    @"Content-Type: text/plain\r\n"
+    @"Content-Transfer-Encoding: quoted-printable\r\n"
+    @"\r\n"
+    @"caf=C3=A9 =3D soft=\r\n"
+    @"break\r\n"
+    @"--XyZzY--\r\n", encoded]
+    dataUsingEncoding: NSASCIIStringEncoding]];
+
+  plain = parse(body, 0, nil, NO);
+  PASS([[plain content] count] == 3, "multipart document parses normally");
+  PASS_EQUAL([[[plain content] objectAtIndex: 1] content], binary,
+    "base64 part decodes normally");
+
+  s = [[Streamer new] autorelease];
+  doc = parse(body, 0, s, NO);
+  PASS_EQUAL(doc, plain,
+    "a delegate which does not stream leaves the document unchanged");
+  s = [[Streamer new] autorelease];
+  doc = parse(body, 1, s, NO);
+  PASS_EQUAL(doc, plain,
+    "a delegate which does not stream changes nothing bytewise");
+
+  s = [[Streamer new] autorelease];
+  s->stream = YES;
+  doc = parse(body, 0, s, NO);
+  PASS([[doc content] count] == 3, "streamed multipart document has parts");
+  PASS([s->parts count] == 3 && 3 == s->finished,
+    "every part is streamed and finished");
+  PASS_EQUAL([s->parts objectAtIndex: 0],
+    [@"first part" dataUsingEncoding: NSASCIIStringEncoding],
+    "plain text part is streamed");
+  PASS_EQUAL([s->parts objectAtIndex: 1], binary, "base64 part is streamed");
+  PASS_EQUAL([s->parts objectAtIndex: 2],
+    [@"café = softbreak" dataUsingEncoding: NSUTF8StringEncoding],
+    "quoted-printable part is streamed");
+  PASS(nil == [[[doc content] objectAtIndex: 1] content],
+    "streamed part is not kept in the document");
+
+  ok = YES;
+  for (i = 1; i < 100; i += 7)
+    {
+      s = [[Streamer new] autorelease];
+      s->stream = YES;
+      doc = parse(body, i, s, NO);
+      if (nil == doc || [s->parts count] != 3
+	|| NO == [[s->parts objectAtIndex: 1] isEqual: binary]
+	|| NO == [[s->parts objectAtIndex: 2] isEqual:
+	  [@"café = softbreak" dataUsingEncoding: NSUTF8StringEncoding]])
+	{
+	  ok = NO;
+	}
+    }
+  PASS(ok, "streamed parts are the same however the data is split");
+
+  data = [@"HTTP/1.1 200 OK\r\n"
+    @"Transfer-Encoding: chunked\r\n"
+    @"\r\n"
+    @"5\r\nhello\r\n"
+    @"6;ext=1\r\n world\r\n"
+    @"0\r\n"
+    @"\r\n" dataUsingEncoding: NSASCIIStringEncoding];
+  s = [[Streamer new] autorelease];
+  s->stream = YES;
+  doc = parse(data, 1, s, YES);
+  PASS_EQUAL([s->parts lastObject],
+    [@"hello world" dataUsingEncoding: NSASCIIStringEncoding],
+    "chunked body is streamed");
+  PASS(1 == s->finished, "chunked body is finished");
+  s = [[Streamer new] autorelease];
+  doc = parse(data, 0, s, YES);
+  PASS_EQUAL([doc content], @"hello world", "chunked body decodes normally");
+
+  ok = YES;
+  for (i = 0; i < sizeof(bytes); i++)
+    {
+      bytes[i] = (i * 151) & 0xff;
+    }
+  for (i = 0; i <= sizeof(bytes); i++)
+    {
+      data = [NSData dataWithBytes: bytes length: i];
+      if (NO == [[GSMimeDocument decodeBase64:
+	[GSMimeDocument encodeBase64: data]] isEqual: data])
+	{
+	  ok = NO;
+	}
+    }
+  PASS(ok, "base64 encoding and decoding round trip for all lengths");
+  PASS_EQUAL([GSMimeDocument encodeBase64String: @"abcd"], @"YWJjZA==",
+    "base64 encoding pads the last group");
+  PASS_EQUAL([GSMimeDocument decodeBase64: [encoded
+    dataUsingEncoding: NSASCIIStringEncoding]], binary,
+    "base64 decoding skips line breaks");
+
+  [arp release]; arp = nil;
+  return 0;
+}
+#else
+int main(int argc,char **argv)
+{
+  return 0;
+}
+#endif
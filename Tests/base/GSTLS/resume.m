@@ -0,0 +1,125 @@
+#import "ObjectTesting.h"
+#import "../../../Headers/GNUstepBase/config.h"
+#import "../../../Headers/Foundation/Foundation.h"
+#ifdef HAVE_GNUTLS
+#import "../../../Source/GSTLS.h"
+#include <sys/socket.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+static ssize_t
+pushFunc(gnutls_transport_ptr_t handle, const void *buffer, size_t len)
+{
+  return write((int)(intptr_t)handle, buffer, len);
+}
+
+static ssize_t
+pullFunc(gnutls_transport_ptr_t handle, void *buffer, size_t len)
+{
+  return read((int)(intptr_t)handle, buffer, len);
+}
+
+/* Connect a client session to a local server session over a socket pair,
+ * have the server send a byte (so that the client sees any session ticket)
+ * and return YES if both ends completed the handshake.
+ */
+static BOOL
+connectPair(NSDictionary *clientOptions, BOOL *resumed)
+{
+  NSAutoreleasePool     *arp = [NSAutoreleasePool new];
+  NSDictionary          *serverOptions;
+  GSTLSSession          *c;
+  GSTLSSession          *s;
+  BOOL                  cDone = NO;
+  BOOL                  sDone = NO;
+  BOOL                  ok = NO;
+  char                  buf[16];
+  int                   fds[2];
+  int                   i;
+
+  serverOptions = [NSDictionary dictionaryWithObjectsAndKeys:
+    @"testCert.pem", GSTLSCertificateFile,
+    @"testKey.pem", GSTLSCertificateKeyFile,
+    nil];
+  socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+  fcntl(fds[0], F_SETFL, O_NONBLOCK);
+  fcntl(fds[1], F_SETFL, O_NONBLOCK);
+  s = [GSTLSSession sessionWithOptions: serverOptions
+                             direction: NO
+                             transport: (void*)(intptr_t)fds[0]
+                                  push: pushFunc
+                                  pull: pullFunc];
+  c = [GSTLSSession sessionWithOptions: clientOptions
+                             direction: YES
+                             transport: (void*)(intptr_t)fds[1]
+                                  push: pushFunc
+                                  pull: pullFunc];
+  for (i = 0; i < 1000 && (NO == cDone || NO == sDone); i++)
+    {
+      if (NO == cDone) cDone = [c handshake];
+      if (NO == sDone) sDone = [s handshake];
+    }
+  if (YES == [c active] && YES == [s active])
+    {
+      [s write: "x" length: 1];
+      for (i = 0; i < 1000 && NO == ok; i++)
+        {
+          ok = ([c read: buf length: sizeof(buf)] == 1) ? YES : NO;
+        }
+      *resumed = ([c resumed] && [s resumed]) ? YES : NO;
+    }
+  [c disconnect: NO];
+  [s disconnect: NO];
+  close(fds[0]);
+  close(fds[1]);
+  [arp release];
+  return ok;
+}
+#endif
+
+int
+main()
+{
+  NSAutoreleasePool *arp = [NSAutoreleasePool new];
+START_SET("TLS session resumption")
+#ifdef HAVE_GNUTLS
+  NSMutableDictionary   *opts;
+  BOOL                  resumed = NO;
+
+  opts = [NSMutableDictionary dictionary];
+  [opts setObject: @"local:1" forKey: GSTLSResumeKey];
+  PASS(connectPair(opts, &resumed) && NO == resumed,
+    "first connection makes a new session");
+  PASS(connectPair(opts, &resumed) && YES == resumed,
+    "second connection resumes the session");
+  PASS(connectPair(opts, &resumed) && YES == resumed,
+    "resumed session can be resumed again");
+
+  [opts setObject: @"local:2" forKey: GSTLSResumeKey];
+  PASS(connectPair(opts, &resumed) && NO == resumed,
+    "connection to another place makes a new session");
+
+  [opts setObject: @"NORMAL:-VERS-TLS1.3" forKey: GSTLSPriority];
+  PASS(connectPair(opts, &resumed) && NO == resumed,
+    "connection with other settings makes a new session");
+  PASS(connectPair(opts, &resumed) && YES == resumed,
+    "TLS1.2 session is resumed");
+
+  [opts setObject: @"NORMAL:-VERS-TLS1.3:%NO_TICKETS" forKey: GSTLSPriority];
+  PASS(connectPair(opts, &resumed) && NO == resumed,
+    "connection without tickets makes a new session");
+  PASS(connectPair(opts, &resumed) && YES == resumed,
+    "session is resumed by session ID from the server cache");
+
+  [opts setObject: @"" forKey: GSTLSResumeKey];
+  PASS(connectPair(opts, &resumed) && NO == resumed,
+    "empty resume key turns resumption off");
+  PASS(connectPair(opts, &resumed) && NO == resumed,
+    "session without resume key is never resumed");
+#else
+  SKIP("TLS support disabled");
+#endif
+  END_SET("TLS session resumption");
+  DESTROY(arp);
+  return 0;
+}
@@ -0,0 +1,97 @@
+#import "ObjectTesting.h"
+#import <Foundation/NSAutoreleasePool.h>
+#import <Foundation/NSArchiver.h>
+#import <Foundation/NSArray.h>
+#import <Foundation/NSData.h>
+#import <Foundation/NSString.h>
+
+/* A node which refers to its owner without retaining it in the archive.
+ */
+@interface	Node : NSObject <NSCoding>
+{
+@public
+  NSString	*name;
+  id		owner;
+}
+@end
+
+@implementation	Node
+- (void) dealloc
+{
+  [name release];
+  [owner release];
+  [super dealloc];
+}
+
+- (void) encodeWithCoder: (NSCoder*)aCoder
+{
+  [aCoder encodeObject: name];
+  [aCoder encodeConditionalObject: owner];
+}
+
+- (id) initWithCoder: (NSCoder*)aCoder
+{
+  name = [[aCoder decodeObject] retain];
+  owner = [[aCoder decodeObject] retain];
+  return self;
+}
+@end
+
+static Node *
+node(NSString *name, id owner)
+{
+  Node	*n = [[Node new] autorelease];
+
+  n->name = [name retain];
+  n->owner = [owner retain];
+  return n;
+}
+
+int main()
+{
+  NSAutoreleasePool	*arp = [NSAutoreleasePool new];
+  NSMutableData		*md;
+  NSArchiver		*archiver;
+  NSArray		*a;
+  NSData		*d;
+  Node			*owner;
+  Node			*n;
+
+  owner = node(@"owner", nil);
+  n = node(@"child", owner);
+
+  d = [NSArchiver archivedDataWithRootObject:
+    [NSArray arrayWithObjects: owner, n, nil]];
+  a = [NSUnarchiver unarchiveObjectWithData: d];
+  PASS([a count] == 2
+    && ((Node*)[a objectAtIndex: 1])->owner == [a objectAtIndex: 0],
+    "conditional object encoded earlier is restored");
+
+  d = [NSArchiver archivedDataWithRootObject:
+    [NSArray arrayWithObjects: n, owner, nil]];
+  a = [NSUnarchiver unarchiveObjectWithData: d];
+  PASS([a count] == 2
+    && ((Node*)[a objectAtIndex: 0])->owner == [a objectAtIndex: 1],
+    "conditional object encoded later is restored");
+
+  d = [NSArchiver archivedDataWithRootObject: n];
+  n = [NSUnarchiver unarchiveObjectWithData: d];
+  PASS([n->name isEqual: @"child"] && n->owner == nil,
+    "conditional object which is never encoded is nil");
+
+  md = [NSMutableData data];
+  archiver = [[NSArchiver alloc] initForWritingWithMutableData: md];
+  [archiver encodeRootObject: [NSArray arrayWithObjects: @"one", nil]];
+  d = [[md copy] autorelease];
+  [md setLength: 0];
+  [archiver resetArchiver];
+  [archiver encodeRootObject: [NSArray arrayWithObjects: @"two", nil]];
+  [archiver release];
+  PASS_EQUAL([NSUnarchiver unarchiveObjectWithData: d],
+    [NSArray arrayWithObject: @"one"], "first archive is correct");
+  PASS_EQUAL([NSUnarchiver unarchiveObjectWithData: md],
+    [NSArray arrayWithObject: @"two"], "reset archiver can be reused");
+
+  [arp release]; arp = nil;
+  return 0;
+}
@@ -0,0 +1,104 @@
+#import "ObjectTesting.h"
+#import <Foundation/NSAutoreleasePool.h>
+#import <Foundation/NSArray.h>
+#import <Foundation/NSCharacterSet.h>
+#import <Foundation/NSScanner.h>
+#import <Foundation/NSString.h>
+
+int main()
+{
+  NSAutoreleasePool	*arp = [NSAutoreleasePool new];
+  NSCharacterSet	*punct;
+  NSCharacterSet	*space;
+  NSMutableCharacterSet	*mset;
+  NSString		*s8;
+  NSString		*s16;
+  NSString		*s;
+  NSScanner		*scn;
+  NSArray		*a;
+  NSRange		r;
+  unsigned		i;
+
+  punct = [NSCharacterSet characterSetWithCharactersInString: @",;"];
+  space = [NSCharacterSet whitespaceAndNewlineCharacterSet];
+
+  /* Matches at every offset across several vector-sized blocks.
+   */
+  for (i = 0; i < 40; i++)
+    {
+      NSMutableString	*m;
+
+      m = [NSMutableString stringWithString:
+	[@"" stringByPaddingToLength: 40 withString: @"abcd"
+	     startingAtIndex: 0]];
+      [m replaceCharactersInRange: NSMakeRange(i, 1) withString: @";"];
+      s8 = [m copy];
+      r = [s8 rangeOfCharacterFromSet: punct];
+      if (r.location != i) break;
+      [m replaceCharactersInRange: NSMakeRange(0, 1) withString: @"\u20AC"];
+      s16 = [m copy];
+      r = [s16 rangeOfCharacterFromSet: punct];
+      [s8 release];
+      [s16 release];
+      if (i > 0 && r.location != i) break;
+    }
+  PASS(i == 40, "small set found at each offset in 8 and 16-bit strings");
+
+  s = @"0123456789012345678901234567890123456789 tail";
+  r = [s rangeOfCharacterFromSet: space];
+  PASS(NSEqualRanges(r, NSMakeRange(40, 1)), "constant string search works");
+  r = [s rangeOfCharacterFromSet: space options: NSBackwardsSearch];
+  PASS(NSEqualRanges(r, NSMakeRange(40, 1)), "backwards search works");
+  r = [s rangeOfCharacterFromSet: space
+			 options: 0
+			   range: NSMakeRange(0, 40)];
+  PASS(r.location == NSNotFound, "search respects the range");
+  r = [s rangeOfCharacterFromSet: [space invertedSet]
+			 options: 0
+			   range: NSMakeRange(40, 5)];
+  PASS(NSEqualRanges(r, NSMakeRange(41, 1)), "inverted set works");
+
+  s = [[[NSString alloc] initWithBytes:
+    "\xe9\xe8\xea\xeb\xe9\xe8\xea\xeb\xe9\xe8\xea\xeb\xe9\xe8\xea\xeb\xe9\xe8,x"
+				 length: 20
+			       encoding: NSISOLatin1StringEncoding] autorelease];
+  r = [s rangeOfCharacterFromSet: punct];
+  PASS(NSEqualRanges(r, NSMakeRange(18, 1)), "Latin-1 subject searched");
+  r = [s rangeOfCharacterFromSet:
+    [[NSCharacterSet letterCharacterSet] invertedSet]];
+  PASS(NSEqualRanges(r, NSMakeRange(18, 1)), "large set matches non-ASCII");
+
+  /* A mutable set must reflect changes made after it was first used.
+   */
+  mset = [NSMutableCharacterSet characterSetWithCharactersInString: @"q"];
+  s = @"abcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyz";
+  r = [s rangeOfCharacterFromSet: mset];
+  PASS(NSEqualRanges(r, NSMakeRange(16, 1)), "mutable set works");
+  [mset addCharactersInString: @"c"];
+  r = [s rangeOfCharacterFromSet: mset];
+  PASS(NSEqualRanges(r, NSMakeRange(2, 1)), "modified mutable set works");
+
+  a = [@"a,b;;c,dddddddddddddddddddddddd,e"
+    componentsSeparatedByCharactersInSet: punct];
+  PASS([a count] == 6 && [[a objectAtIndex: 3] isEqual: @"c"]
+    && [[a objectAtIndex: 5] isEqual: @"e"],
+    "componentsSeparatedByCharactersInSet: works");
+
+  scn = [NSScanner scannerWithString:
+    @"   alpha\t\tbeta,gamma  \u20ACdelta"];
+  PASS([scn scanCharactersFromSet: [NSCharacterSet letterCharacterSet]
+		       intoString: &s] && [s isEqual: @"alpha"],
+    "scanner skips leading space and scans a word");
+  PASS([scn scanUpToCharactersFromSet: punct intoString: &s]
+    && [s isEqual: @"beta"], "scanner scans up to a small set");
+  PASS([scn scanCharactersFromSet: punct intoString: &s]
+    && [s isEqual: @","], "scanner scans members of a small set");
+  PASS([scn scanUpToCharactersFromSet: space intoString: &s]
+    && [s isEqual: @"gamma"], "scanner scans up to whitespace");
+  PASS([scn scanUpToCharactersFromSet: punct intoString: &s]
+    && [s isEqual: @"\u20ACdelta"] && [scn isAtEnd],
+    "scanner handles wide strings and reaching the end");
+
+  [arp release]; arp = nil;
+  return 0;
+}
@@ -0,0 +1,135 @@
+#import "ObjectTesting.h"
+#import <Foundation/NSAutoreleasePool.h>
+#import <Foundation/NSArray.h>
+#import <Foundation/NSConnection.h>
+#import <Foundation/NSDistantObject.h>
+#import <Foundation/NSPort.h>
+#import <Foundation/NSString.h>
+#import <GNUstepBase/DistributedObjects.h>
+
+/* No protocol is set for the proxy, so method signatures are fetched
+ * from the server.
+ */
+@interface	Echo : NSObject
+- (long long) negate: (long long)v;
+- (unsigned long long) twice: (unsigned long long)v;
+- (short) shortValue: (short)v;
+- (NSRange) range: (NSRange)r;
+- (NSString*) join: (NSString*)a with: (NSString*)b;
+- (NSArray*) pair: (id)a and: (id)b;
+- (NSString*) nameOf: (SEL)s;
+@end
+
+@interface	NSObject (Missing)
+- (void) missingMethod;
+@end
+
+@implementation	Echo
+- (long long) negate: (long long)v
+{
+  return -v;
+}
+
+- (unsigned long long) twice: (unsigned long long)v
+{
+  return v * 2;
+}
+
+- (short) shortValue: (short)v
+{
+  return v;
+}
+
+- (NSRange) range: (NSRange)r
+{
+  return NSMakeRange(r.location + 1, r.length + 1);
+}
+
+- (NSString*) join: (NSString*)a with: (NSString*)b
+{
+  return [a stringByAppendingString: b];
+}
+
+- (NSArray*) pair: (id)a and: (id)b
+{
+  return [NSArray arrayWithObjects: a, b, nil];
+}
+
+- (NSString*) nameOf: (SEL)s
+{
+  return NSStringFromSelector(s);
+}
+@end
+
+int main()
+{
+  NSAutoreleasePool	*arp = [NSAutoreleasePool new];
+  NSSocketPort		*serverPort = [[NSSocketPort new] autorelease];
+  NSSocketPort		*clientPort = [[NSSocketPort new] autorelease];
+  NSConnection		*server;
+  NSConnection		*client;
+  id			proxy;
+  BOOL			ok;
+  int			i;
+
+  server = [[NSConnection alloc] initWithReceivePort: serverPort
+					    sendPort: nil];
+  [server setRootObject: [[Echo new] autorelease]];
+  [server setRequestWorkers: 2];
+
+  client = [[NSConnection alloc] initWithReceivePort: clientPort
+					    sendPort: serverPort];
+  [client setReplyTimeout: 30.0];
+  proxy = [client rootProxy];
+  PASS(proxy != nil, "root proxy is obtained");
+  PASS([client compactCoding] == [NSPortCoder compactCodingAvailable],
+    "compact coding is negotiated when available");
+
+  /* Repeat each call, so that later messages use names which the
+   * server has already been sent.
+   */
+  ok = YES;
+  for (i = 0; i < 3; i++)
+    {
+      NSRange	r;
+
+      if ([proxy negate: -5000000000LL] != 5000000000LL
+	|| [proxy negate: 1] != -1
+	|| [proxy twice: 0x7fffffffffffffffULL] != 0xfffffffffffffffeULL
+	|| [proxy shortValue: -32768] != -32768)
+	{
+	  ok = NO;
+	}
+      r = [proxy range: NSMakeRange(0, NSNotFound - 1)];
+      if (r.location != 1 || r.length != NSNotFound)
+	{
+	  ok = NO;
+	}
+      if (NO == [[proxy join: @"abc" with: @"def"] isEqual: @"abcdef"])
+	{
+	  ok = NO;
+	}
+      if (NO == [[proxy nameOf: @selector(join:with:)] isEqual: @"join:with:"])
+	{
+	  ok = NO;
+	}
+      if (NO == [[proxy pair: @"x" and: [NSArray arrayWithObject: @"y"]]
+	isEqual: [NSArray arrayWithObjects: @"x",
+	[NSArray arrayWithObject: @"y"], nil]])
+	{
+	  ok = NO;
+	}
+    }
+  PASS(ok, "integers, structs, selectors and objects survive repeated calls");
+
+  PASS_EXCEPTION([proxy missingMethod], nil,
+    "an unknown method still raises an exception");
+  PASS([proxy negate: 7] == -7, "calls work after an exception");
+
+  [client invalidate];
+  [server invalidate];
+  [client release];
+  [server release];
+  [arp release]; arp = nil;
+  return 0;
+}
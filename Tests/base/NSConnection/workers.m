@@ -0,0 +1,124 @@
+#import "ObjectTesting.h"
+#import <Foundation/NSAutoreleasePool.h>
+#import <Foundation/NSConnection.h>
+#import <Foundation/NSDate.h>
+#import <Foundation/NSDistantObject.h>
+#import <Foundation/NSLock.h>
+#import <Foundation/NSPort.h>
+#import <Foundation/NSThread.h>
+#import <Foundation/NSValue.h>
+
+@protocol	Adder
+- (int) add: (int)a to: (int)b;
+- (BOOL) onMainThread;
+@end
+
+@interface	Adder : NSObject <Adder>
+@end
+
+@implementation	Adder
+- (int) add: (int)a to: (int)b
+{
+  return a + b;
+}
+
+- (BOOL) onMainThread
+{
+  return [NSThread isMainThread];
+}
+@end
+
+@interface	Caller : NSObject
+{
+@public
+  id<Adder>	proxy;
+  NSCondition	*done;
+  int		running;
+  int		errors;
+}
+- (void) call: (NSNumber*)base;
+@end
+
+@implementation	Caller
+- (void) call: (NSNumber*)base
+{
+  NSAutoreleasePool	*arp = [NSAutoreleasePool new];
+  int			b = [base intValue];
+  int			bad = 0;
+  int			i;
+
+  for (i = 0; i < 50; i++)
+    {
+      if ([proxy add: b to: i] != b + i)
+	{
+	  bad++;
+	}
+    }
+  [done lock];
+  errors += bad;
+  running--;
+  [done signal];
+  [done unlock];
+  [arp release];
+}
+@end
+
+int main()
+{
+  NSAutoreleasePool	*arp = [NSAutoreleasePool new];
+  NSSocketPort		*serverPort = [[NSSocketPort new] autorelease];
+  NSSocketPort		*clientPort = [[NSSocketPort new] autorelease];
+  NSConnection		*server;
+  NSConnection		*client;
+  Caller		*caller = [[Caller new] autorelease];
+  NSDate		*limit;
+  int			i;
+
+  server = [[NSConnection alloc] initWithReceivePort: serverPort
+					    sendPort: nil];
+  [server setRootObject: [[Adder new] autorelease]];
+  PASS([server requestWorkers] == 0, "connection has no workers by default");
+  [server setRequestWorkers: 4];
+  PASS([server requestWorkers] == 4, "request workers can be set");
+  PASS([server multipleThreadsEnabled], "workers enable multiple threads");
+
+  client = [[NSConnection alloc] initWithReceivePort: clientPort
+					    sendPort: serverPort];
+  [client setRequestWorkers: 1];
+  [client setReplyTimeout: 30.0];
+  caller->proxy = (id<Adder>)[client rootProxy];
+  [(NSDistantObject*)caller->proxy setProtocolForProxy: @protocol(Adder)];
+  PASS([caller->proxy add: 2 to: 3] == 5, "remote call returns its result");
+  PASS([caller->proxy onMainThread] == NO,
+    "request is handled by a worker thread");
+
+  caller->done = [[NSCondition new] autorelease];
+  caller->running = 8;
+  for (i = 0; i < 8; i++)
+    {
+      [NSThread detachNewThreadSelector: @selector(call:)
+			       toTarget: caller
+			     withObject: [NSNumber numberWithInt: i * 1000]];
+    }
+  limit = [NSDate dateWithTimeIntervalSinceNow: 60.0];
+  [caller->done lock];
+  while (caller->running > 0 && [limit timeIntervalSinceNow] > 0)
+    {
+      [caller->done waitUntilDate: limit];
+    }
+  [caller->done unlock];
+  PASS(caller->running == 0 && caller->errors == 0,
+    "concurrent calls from many threads get their own replies");
+
+  [server setRequestWorkers: 0];
+  PASS([server requestWorkers] == 0, "request workers can be removed");
+  PASS([server multipleThreadsEnabled] == NO,
+    "removing workers restores the threading setting");
+
+  [client invalidate];
+  [server invalidate];
+  [client release];
+  [server release];
+  [arp release]; arp = nil;
+  return 0;
+}
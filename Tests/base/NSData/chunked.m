@@ -0,0 +1,143 @@
+#import "Testing.h"
+#import "ObjectTesting.h"
+#import <Foundation/NSAutoreleasePool.h>
+#import <Foundation/NSData.h>
+#import <Foundation/NSException.h>
+
+# ifndef __has_feature
+# define __has_feature(x) 0
+# endif
+
+int main()
+{
+  NSAutoreleasePool	*arp = [NSAutoreleasePool new];
+  NSMutableData		*chunked;
+  NSMutableData		*plain;
+  NSData		*large;
+  NSData		*copy;
+  uint8_t		buf[1000];
+  uint8_t		*big;
+  int			i;
+
+  for (i = 0; i < 1000; i++)
+    {
+      buf[i] = (uint8_t)(i * 7);
+    }
+
+  chunked = [NSMutableData dataWithChunkSize: 256];
+  plain = [NSMutableData data];
+  PASS(chunked != nil && [chunked length] == 0,
+    "+dataWithChunkSize: returns empty data");
+
+  for (i = 0; i < 50; i++)
+    {
+      [chunked appendBytes: buf + i length: 1000 - 2 * i];
+      [plain appendBytes: buf + i length: 1000 - 2 * i];
+    }
+  PASS([chunked length] == [plain length], "appended length is correct");
+  PASS([chunked isEqual: plain], "appended content is correct");
+
+  big = malloc([plain length]);
+  [chunked getBytes: big range: NSMakeRange(123, 4567)];
+  PASS(memcmp(big, (const uint8_t*)[plain bytes] + 123, 4567) == 0,
+    "-getBytes:range: works across chunks");
+  PASS([[chunked subdataWithRange: NSMakeRange(999, 2001)]
+    isEqual: [plain subdataWithRange: NSMakeRange(999, 2001)]],
+    "-subdataWithRange: works across chunks");
+  free(big);
+
+  [chunked replaceBytesInRange: NSMakeRange(0, 1500) withBytes: 0 length: 0];
+  [plain replaceBytesInRange: NSMakeRange(0, 1500) withBytes: 0 length: 0];
+  PASS([chunked isEqual: plain], "bytes can be consumed from the start");
+
+  [chunked replaceBytesInRange: NSMakeRange(10, 5) withBytes: "abc" length: 3];
+  [plain replaceBytesInRange: NSMakeRange(10, 5) withBytes: "abc" length: 3];
+  PASS([chunked isEqual: plain], "bytes can be replaced in the middle");
+
+  [chunked setLength: 3000];
+  [plain setLength: 3000];
+  [chunked appendBytes: buf length: 600];
+  [plain appendBytes: buf length: 600];
+  PASS([chunked isEqual: plain], "content is correct after truncation");
+
+  [chunked setLength: 4000];
+  [plain setLength: 4000];
+  PASS([chunked isEqual: plain], "extending the length adds zeros");
+
+  large = [NSData dataWithBytes: buf length: 1000];
+  [chunked appendData: large];
+  [plain appendData: large];
+  [chunked appendData: chunked];
+  [plain appendData: plain];
+  PASS([chunked isEqual: plain], "data objects can be appended");
+
+  copy = [[chunked copy] autorelease];
+  [chunked resetBytesInRange: NSMakeRange(0, 10)];
+  PASS([copy isEqual: plain] && NO == [chunked isEqual: plain],
+    "a copy is independent of the original");
+  [chunked setData: plain];
+  PASS([chunked isEqual: plain], "-setData: works");
+
+  [chunked replaceBytesInRange: NSMakeRange(0, [chunked length])
+		     withBytes: 0
+			length: 0];
+  PASS([chunked length] == 0, "all bytes can be consumed");
+  [chunked appendBytes: "xyz" length: 3];
+  PASS([chunked length] == 3 && memcmp([chunked bytes], "xyz", 3) == 0,
+    "data can be appended after everything was consumed");
+
+  PASS_EXCEPTION([chunked getBytes: buf range: NSMakeRange(2, 5)],
+    NSRangeException, "-getBytes:range: checks its range");
+
+  START_SET("enumerateByteRangesUsingBlock:")
+# if __has_feature(blocks)
+  {
+    const uint8_t	*ref = buf;
+    __block NSUInteger	next = 0;
+    __block BOOL	ok = YES;
+    __block int		ranges = 0;
+
+    chunked = [NSMutableData dataWithChunkSize: 100];
+    for (i = 0; i < 10; i++)
+      {
+	[chunked appendBytes: buf length: 100];
+      }
+    [chunked enumerateByteRangesUsingBlock:
+      ^(const void *bytes, NSRange r, BOOL *stop) {
+	if (r.location != next
+	  || memcmp(bytes, ref + r.location % 100, r.length) != 0)
+	  {
+	    ok = NO;
+	  }
+	next = NSMaxRange(r);
+	ranges++;
+      }];
+    PASS(ok && next == 1000 && ranges > 1,
+      "chunked data enumerates each chunk");
+
+    ranges = 0;
+    [chunked enumerateByteRangesUsingBlock:
+      ^(const void *bytes, NSRange r, BOOL *stop) {
+	ranges++;
+	*stop = YES;
+      }];
+    PASS(ranges == 1, "enumeration stops when requested");
+
+    ranges = 0;
+    [large enumerateByteRangesUsingBlock:
+      ^(const void *bytes, NSRange r, BOOL *stop) {
+	if (bytes == [large bytes] && r.location == 0 && r.length == 1000)
+	  {
+	    ranges++;
+	  }
+      }];
+    PASS(ranges == 1, "other data enumerates a single range");
+  }
+# else
+  SKIP("No Blocks support in the compiler.")
+# endif
+  END_SET("enumerateByteRangesUsingBlock:")
+
+  [arp release]; arp = nil;
+  return 0;
+}
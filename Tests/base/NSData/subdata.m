@@ -0,0 +1,79 @@
+#import "Testing.h"
+#import "ObjectTesting.h"
+#import <Foundation/NSAutoreleasePool.h>
+#import <Foundation/NSData.h>
+#import <Foundation/NSException.h>
+#import <Foundation/NSStream.h>
+
+int main()
+{
+  NSAutoreleasePool	*arp = [NSAutoreleasePool new];
+  char			buf[256];
+  NSData		*data;
+  NSData		*sub;
+  NSData		*subsub;
+  NSMutableData		*mutable;
+  NSInputStream		*stream;
+  uint8_t		in[8];
+  int			i;
+
+  for (i = 0; i < 256; i++)
+    {
+      buf[i] = (char)i;
+    }
+  data = [[NSData alloc] initWithBytes: buf length: sizeof(buf)];
+
+  sub = [data subdataWithRange: NSMakeRange(10, 20)];
+  PASS([sub length] == 20 && memcmp([sub bytes], buf + 10, 20) == 0,
+    "-subdataWithRange: has the requested bytes");
+  PASS([sub isEqual: [NSData dataWithBytes: buf + 10 length: 20]],
+    "subdata is equal to a copy of the bytes");
+
+  subsub = [sub subdataWithRange: NSMakeRange(5, 10)];
+  PASS([subsub length] == 10 && memcmp([subsub bytes], buf + 15, 10) == 0,
+    "subdata of subdata has the requested bytes");
+
+  [sub retain];
+  [subsub retain];
+  [data release];
+  PASS(memcmp([sub bytes], buf + 10, 20) == 0
+    && memcmp([subsub bytes], buf + 15, 10) == 0,
+    "subdata remains valid after its source is released");
+  [sub release];
+  [subsub release];
+
+  data = [NSData dataWithBytes: buf length: sizeof(buf)];
+  sub = [data subdataWithRange: NSMakeRange(0, [data length])];
+  PASS([sub isEqual: data], "subdata of the full range is equal");
+  sub = [data subdataWithRange: NSMakeRange(256, 0)];
+  PASS(sub != nil && [sub length] == 0, "subdata of an empty range is empty");
+  PASS_EXCEPTION([data subdataWithRange: NSMakeRange(250, 10)],
+    NSRangeException, "subdata beyond the end raises an exception");
+
+  PASS([[NSData dataWithData: data] isEqual: data],
+    "+dataWithData: is equal to its source");
+  PASS([[[[NSData alloc] initWithData: sub] autorelease] isEqual: sub],
+    "-initWithData: is equal to its source");
+
+  mutable = [NSMutableData dataWithBytes: buf length: sizeof(buf)];
+  sub = [mutable subdataWithRange: NSMakeRange(0, 8)];
+  data = [NSData dataWithData: mutable];
+  memset([mutable mutableBytes], 0xff, 8);
+  [mutable setLength: 1];
+  PASS(memcmp([sub bytes], buf, 8) == 0,
+    "subdata of mutable data does not change with its source");
+  PASS([data length] == 256 && memcmp([data bytes], buf, 256) == 0,
+    "+dataWithData: of mutable data does not change with its source");
+
+  mutable = [NSMutableData dataWithBytes: buf length: 8];
+  stream = [NSInputStream inputStreamWithData: mutable];
+  memset([mutable mutableBytes], 0xff, 8);
+  [stream open];
+  PASS([stream read: in maxLength: sizeof(in)] == 8
+    && memcmp(in, buf, 8) == 0,
+    "an input stream reads the data it was created with");
+  [stream close];
+
+  [arp release]; arp = nil;
+  return 0;
+}
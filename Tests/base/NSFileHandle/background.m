@@ -0,0 +1,170 @@
+#import "Testing.h"
+#import "ObjectTesting.h"
+#import <Foundation/Foundation.h>
+
+@interface	Observer : NSObject
+{
+@public
+  NSMutableArray	*notes;
+}
+- (void) note: (NSNotification*)n;
+@end
+
+@implementation	Observer
+- (void) note: (NSNotification*)n
+{
+  [notes addObject: n];
+}
+@end
+
+static Observer	*obs = nil;
+
+/* Runs the run loop until count notifications have arrived (or for a
+ * few seconds at most) and returns the last one.
+ */
+static NSNotification *
+waitFor(NSUInteger count)
+{
+  NSDate	*limit = [NSDate dateWithTimeIntervalSinceNow: 10.0];
+
+  while ([obs->notes count] < count && [limit timeIntervalSinceNow] > 0)
+    {
+      [[NSRunLoop currentRunLoop] runMode: NSDefaultRunLoopMode
+			       beforeDate: limit];
+    }
+  return [obs->notes lastObject];
+}
+
+static void
+observe(NSString *name, NSFileHandle *fh)
+{
+  [[NSNotificationCenter defaultCenter] addObserver: obs
+					   selector: @selector(note:)
+					       name: name
+					     object: fh];
+}
+
+int main()
+{
+  NSAutoreleasePool	*arp = [NSAutoreleasePool new];
+  NSNotificationCenter	*nc = [NSNotificationCenter defaultCenter];
+  NSString		*path;
+  NSMutableData		*data;
+  NSFileHandle		*fh;
+  NSPipe		*pipe;
+  NSNotification	*n;
+  NSData		*d;
+  uint8_t		*b;
+  NSUInteger		length = 3 * 1024 * 1024 + 77;
+  NSUInteger		i;
+
+  /* Let background operations on pipes use an io_uring where there is
+   * one, as well as those on files.
+   */
+  [[NSUserDefaults standardUserDefaults] registerDefaults:
+    [NSDictionary dictionaryWithObject: @"YES"
+				forKey: @"GSFileHandleIOURing"]];
+  obs = [Observer new];
+  obs->notes = [NSMutableArray new];
+
+  data = [NSMutableData dataWithLength: length];
+  b = [data mutableBytes];
+  for (i = 0; i < length; i++)
+    {
+      b[i] = (uint8_t)(i * 17 + (i >> 9));
+    }
+  path = [NSTemporaryDirectory() stringByAppendingPathComponent:
+    [[NSProcessInfo processInfo] globallyUniqueString]];
+  [[NSFileManager defaultManager] createFileAtPath: path
+					  contents: nil
+					attributes: nil];
+
+  fh = [NSFileHandle fileHandleForWritingAtPath: path];
+  observe(GSFileHandleWriteCompletionNotification, fh);
+  [fh writeInBackgroundAndNotify:
+    [data subdataWithRange: NSMakeRange(0, 1000)]];
+  [fh writeInBackgroundAndNotify:
+    [data subdataWithRange: NSMakeRange(1000, length - 1000)]];
+  n = waitFor(2);
+  PASS([obs->notes count] == 2
+    && [[n userInfo] objectForKey: GSFileHandleNotificationError] == nil,
+    "queued background writes to a file complete");
+  PASS([fh offsetInFile] == length,
+    "background writes advance the file offset");
+  [fh closeFile];
+  [nc removeObserver: obs];
+  [obs->notes removeAllObjects];
+  PASS_EQUAL([NSData dataWithContentsOfFile: path], data,
+    "background writes store the data in order");
+
+  fh = [NSFileHandle fileHandleForReadingAtPath: path];
+  observe(NSFileHandleReadToEndOfFileCompletionNotification, fh);
+  [fh readToEndOfFileInBackgroundAndNotify];
+  n = waitFor(1);
+  PASS_EQUAL([[n userInfo] objectForKey: NSFileHandleNotificationDataItem],
+    data, "a file is read to its end in the background");
+  [nc removeObserver: obs];
+  [obs->notes removeAllObjects];
+
+  [fh seekToFileOffset: 5];
+  observe(NSFileHandleReadCompletionNotification, fh);
+  [fh readDataInBackgroundAndNotifyLength: 300000];
+  n = waitFor(1);
+  PASS_EQUAL([[n userInfo] objectForKey: NSFileHandleNotificationDataItem],
+    [data subdataWithRange: NSMakeRange(5, 300000)],
+    "part of a file is read in the background");
+  PASS([fh offsetInFile] == 300005,
+    "a background read advances the file offset");
+  [fh seekToFileOffset: length - 3];
+  [fh readInBackgroundAndNotify];
+  n = waitFor(2);
+  PASS_EQUAL([[n userInfo] objectForKey: NSFileHandleNotificationDataItem],
+    [data subdataWithRange: NSMakeRange(length - 3, 3)],
+    "the end of a file is read in the background");
+  [fh readInBackgroundAndNotify];
+  n = waitFor(3);
+  PASS_EQUAL([[n userInfo] objectForKey: NSFileHandleNotificationDataItem],
+    [NSData data], "a background read at the end of a file reads nothing");
+  [fh closeFile];
+  [nc removeObserver: obs];
+  [obs->notes removeAllObjects];
+
+  pipe = [NSPipe pipe];
+  fh = [pipe fileHandleForReading];
+  observe(NSFileHandleReadToEndOfFileCompletionNotification, fh);
+  observe(GSFileHandleWriteCompletionNotification,
+    [pipe fileHandleForWriting]);
+  [fh readToEndOfFileInBackgroundAndNotify];
+  [[pipe fileHandleForWriting] writeInBackgroundAndNotify: data];
+  n = waitFor(1);
+  PASS([[n name] isEqual: GSFileHandleWriteCompletionNotification],
+    "a background write to a pipe completes");
+  [[pipe fileHandleForWriting] closeFile];
+  n = waitFor(2);
+  PASS_EQUAL([[n userInfo] objectForKey: NSFileHandleNotificationDataItem],
+    data, "a pipe is read to its end in the background");
+  [nc removeObserver: obs];
+  [obs->notes removeAllObjects];
+
+  pipe = [NSPipe pipe];
+  fh = [pipe fileHandleForReading];
+  observe(NSFileHandleReadCompletionNotification, fh);
+  [fh readInBackgroundAndNotify];
+  [[NSRunLoop currentRunLoop] runMode: NSDefaultRunLoopMode
+			   beforeDate: [NSDate dateWithTimeIntervalSinceNow: 0.1]];
+  [fh closeFile];
+  n = waitFor(1);
+  PASS([[n userInfo] objectForKey: GSFileHandleNotificationError] != nil,
+    "closing a handle ends a background read with an error");
+  [[NSRunLoop currentRunLoop] runMode: NSDefaultRunLoopMode
+			   beforeDate: [NSDate dateWithTimeIntervalSinceNow: 0.1]];
+  d = [[n userInfo] objectForKey: NSFileHandleNotificationDataItem];
+  PASS(d != nil && [d length] == 0,
+    "a background read ended by closing the handle has no data");
+  [nc removeObserver: obs];
+  [obs->notes removeAllObjects];
+
+  [[NSFileManager defaultManager] removeItemAtPath: path error: NULL];
+  [arp release]; arp = nil;
+  return 0;
+}
@@ -0,0 +1,164 @@
+#import "Testing.h"
+#import "ObjectTesting.h"
+#import <Foundation/Foundation.h>
+
+@interface	Writer : NSObject
+{
+@public
+  NSFileHandle	*handle;
+  NSData	*data;
+}
+- (void) write: (id)ignored;
+@end
+
+@implementation	Writer
+- (void) write: (id)ignored
+{
+  NSAutoreleasePool	*arp = [NSAutoreleasePool new];
+  NSUInteger		length = [data length];
+  NSUInteger		pos = 0;
+
+  /* Write in uneven pieces, so the reader sees partial chunks.
+   */
+  while (pos < length)
+    {
+      NSUInteger	n = 7777 + (pos % 50000);
+
+      if (n > length - pos)
+	{
+	  n = length - pos;
+	}
+      [handle writeData: [data subdataWithRange: NSMakeRange(pos, n)]];
+      pos += n;
+    }
+  [handle closeFile];
+  [arp release];
+}
+@end
+
+static NSFileHandle *
+writeInBackground(NSData *data)
+{
+  NSPipe	*pipe = [NSPipe pipe];
+  Writer	*w = [[Writer new] autorelease];
+
+  w->handle = [[pipe fileHandleForWriting] retain];
+  w->data = [data retain];
+  [NSThread detachNewThreadSelector: @selector(write:)
+			   toTarget: w
+			 withObject: nil];
+  return [pipe fileHandleForReading];
+}
+
+@interface	Reader : NSObject
+{
+@public
+  NSData	*data;
+  BOOL		done;
+}
+- (void) read: (NSNotification*)n;
+@end
+
+@implementation	Reader
+- (void) read: (NSNotification*)n
+{
+  data = [[[n userInfo] objectForKey: NSFileHandleNotificationDataItem]
+    retain];
+  done = YES;
+}
+@end
+
+int main()
+{
+  NSAutoreleasePool	*arp = [NSAutoreleasePool new];
+  NSString		*path;
+  NSMutableData		*data;
+  NSFileHandle		*fh;
+  NSData		*d;
+  Reader		*r;
+  NSDate		*limit;
+  uint8_t		*b;
+  NSUInteger		length = 1024 * 1024 + 4321;
+  NSUInteger		i;
+
+  data = [NSMutableData dataWithLength: length];
+  b = [data mutableBytes];
+  for (i = 0; i < length; i++)
+    {
+      b[i] = (uint8_t)(i * 13 + (i >> 10));
+    }
+  path = [NSTemporaryDirectory() stringByAppendingPathComponent:
+    [[NSProcessInfo processInfo] globallyUniqueString]];
+  [data writeToFile: path atomically: NO];
+
+  fh = [NSFileHandle fileHandleForReadingAtPath: path];
+  PASS_EQUAL([fh readDataToEndOfFile], data,
+    "-readDataToEndOfFile reads a whole file");
+  PASS_EQUAL([fh readDataToEndOfFile], [NSData data],
+    "-readDataToEndOfFile at the end of a file returns no data");
+  [fh seekToFileOffset: 1000];
+  PASS_EQUAL([fh readDataOfLength: 5000],
+    [data subdataWithRange: NSMakeRange(1000, 5000)],
+    "-readDataOfLength: reads part of a file");
+  PASS_EQUAL([fh readDataOfLength: 500000],
+    [data subdataWithRange: NSMakeRange(6000, 500000)],
+    "-readDataOfLength: reads a large part of a file");
+  PASS_EQUAL([fh readDataOfLength: length],
+    [data subdataWithRange: NSMakeRange(506000, length - 506000)],
+    "-readDataOfLength: stops at the end of a file");
+  [fh seekToFileOffset: length - 10];
+  PASS_EQUAL([fh availableData],
+    [data subdataWithRange: NSMakeRange(length - 10, 10)],
+    "-availableData reads the rest of a file");
+  [fh closeFile];
+
+  fh = [NSFileHandle fileHandleForUpdatingAtPath: path];
+  [fh seekToFileOffset: length];
+  [fh writeData: [@"tail" dataUsingEncoding: NSASCIIStringEncoding]];
+  [fh seekToFileOffset: length - 2];
+  d = [fh readDataToEndOfFile];
+  PASS([d length] == 6
+    && memcmp([d bytes], b + length - 2, 2) == 0
+    && memcmp((const char*)[d bytes] + 2, "tail", 4) == 0,
+    "-readDataToEndOfFile reads data appended to a file");
+  [fh closeFile];
+
+  fh = writeInBackground(data);
+  PASS_EQUAL([fh readDataToEndOfFile], data,
+    "-readDataToEndOfFile reads everything from a pipe");
+
+  fh = writeInBackground(data);
+  PASS_EQUAL([fh readDataOfLength: 300000],
+    [data subdataWithRange: NSMakeRange(0, 300000)],
+    "-readDataOfLength: reads part of a pipe");
+  PASS_EQUAL([fh readDataOfLength: 100],
+    [data subdataWithRange: NSMakeRange(300000, 100)],
+    "-readDataOfLength: reads a little of a pipe");
+  d = [fh availableData];
+  PASS([d length] > 0 && [d isEqual: [data subdataWithRange:
+    NSMakeRange(300100, [d length])]],
+    "-availableData reads what is waiting in a pipe");
+  [fh readDataToEndOfFile];
+
+  fh = writeInBackground(data);
+  r = [[Reader new] autorelease];
+  [[NSNotificationCenter defaultCenter] addObserver: r
+    selector: @selector(read:)
+    name: NSFileHandleReadToEndOfFileCompletionNotification
+    object: fh];
+  [fh readToEndOfFileInBackgroundAndNotify];
+  limit = [NSDate dateWithTimeIntervalSinceNow: 30.0];
+  while (NO == r->done && [limit timeIntervalSinceNow] > 0)
+    {
+      [[NSRunLoop currentRunLoop] runMode: NSDefaultRunLoopMode
+			       beforeDate: limit];
+    }
+  PASS_EQUAL(r->data, data,
+    "-readToEndOfFileInBackgroundAndNotify reads everything from a pipe");
+  [[NSNotificationCenter defaultCenter] removeObserver: r];
+  [r->data release];
+
+  [[NSFileManager defaultManager] removeItemAtPath: path error: NULL];
+  [arp release]; arp = nil;
+  return 0;
+}
@@ -0,0 +1,145 @@
+#import "Testing.h"
+#import "ObjectTesting.h"
+#import <Foundation/Foundation.h>
+
+@interface	Watcher : NSObject
+{
+@public
+  int		completed;
+  NSString	*error;
+}
+- (void) written: (NSNotification*)n;
+@end
+
+@implementation	Watcher
+- (void) dealloc
+{
+  [error release];
+  [super dealloc];
+}
+
+- (void) written: (NSNotification*)n
+{
+  NSString	*e;
+
+  e = [[n userInfo] objectForKey: GSFileHandleNotificationError];
+  if (e != nil)
+    {
+      [error release];
+      error = [e copy];
+    }
+  completed++;
+}
+@end
+
+static void
+waitFor(Watcher *w, int count)
+{
+  NSDate	*limit = [NSDate dateWithTimeIntervalSinceNow: 30.0];
+
+  while (w->completed < count && [limit timeIntervalSinceNow] > 0)
+    {
+      [[NSRunLoop currentRunLoop] runMode: NSDefaultRunLoopMode
+			       beforeDate: limit];
+    }
+}
+
+int main()
+{
+  NSAutoreleasePool	*arp = [NSAutoreleasePool new];
+  NSFileManager		*mgr = [NSFileManager defaultManager];
+  NSString		*dir;
+  NSString		*src;
+  NSString		*dst;
+  NSString		*out;
+  NSMutableData		*data;
+  NSFileHandle		*in;
+  NSFileHandle		*fh;
+  NSPipe		*pipe;
+  Watcher		*w;
+  NSError		*err = nil;
+  uint8_t		*b;
+  NSUInteger		length = 3 * 1024 * 1024 + 1234;
+  NSUInteger		i;
+
+  dir = [NSTemporaryDirectory() stringByAppendingPathComponent:
+    [[NSProcessInfo processInfo] globallyUniqueString]];
+  [mgr createDirectoryAtPath: dir
+ withIntermediateDirectories: YES
+		  attributes: nil
+		       error: NULL];
+  src = [dir stringByAppendingPathComponent: @"source"];
+  dst = [dir stringByAppendingPathComponent: @"copy"];
+  out = [dir stringByAppendingPathComponent: @"transfer"];
+
+  data = [NSMutableData dataWithLength: length];
+  b = [data mutableBytes];
+  for (i = 0; i < length; i++)
+    {
+      b[i] = (uint8_t)(i * 31 + (i >> 12));
+    }
+  PASS([data writeToFile: src atomically: NO], "source file is written");
+
+  PASS([mgr copyItemAtPath: src toPath: dst error: &err],
+    "a large file can be copied");
+  PASS([[NSData dataWithContentsOfFile: dst] isEqual: data],
+    "the copy has the same content");
+
+  [mgr createFileAtPath: out contents: [NSData data] attributes: nil];
+  in = [NSFileHandle fileHandleForReadingAtPath: src];
+  fh = [NSFileHandle fileHandleForWritingAtPath: out];
+  w = [[Watcher new] autorelease];
+  [[NSNotificationCenter defaultCenter]
+    addObserver: w
+       selector: @selector(written:)
+	   name: GSFileHandleWriteCompletionNotification
+	 object: fh];
+
+  [fh writeInBackgroundAndNotify: [NSData dataWithBytes: "head" length: 4]];
+  [fh writeInBackgroundAndNotifyFromFileHandle: in
+					offset: 1000
+					length: 2 * 1024 * 1024];
+  [fh writeInBackgroundAndNotify: [NSData dataWithBytes: "tail" length: 4]];
+  waitFor(w, 3);
+  PASS(w->completed == 3 && w->error == nil,
+    "a transfer between data writes completes");
+  [fh closeFile];
+  {
+    NSMutableData	*expect = [NSMutableData dataWithBytes: "head" length: 4];
+
+    [expect appendData:
+      [data subdataWithRange: NSMakeRange(1000, 2 * 1024 * 1024)]];
+    [expect appendBytes: "tail" length: 4];
+    PASS([[NSData dataWithContentsOfFile: out] isEqual: expect],
+      "the transferred range is written in order");
+  }
+  PASS([in offsetInFile] == 0, "the source position is unchanged");
+
+  fh = [NSFileHandle fileHandleForWritingAtPath: out];
+  [[NSNotificationCenter defaultCenter]
+    addObserver: w
+       selector: @selector(written:)
+	   name: GSFileHandleWriteCompletionNotification
+	 object: fh];
+  w->completed = 0;
+  [fh writeInBackgroundAndNotifyFromFileHandle: in
+					offset: length - 10
+					length: 20];
+  waitFor(w, 1);
+  PASS(w->completed == 1 && w->error != nil,
+    "a transfer beyond the end of the source reports an error");
+  [fh closeFile];
+
+  pipe = [NSPipe pipe];
+  fh = [NSFileHandle fileHandleForWritingAtPath: out];
+  PASS_EXCEPTION([fh writeInBackgroundAndNotifyFromFileHandle:
+    [pipe fileHandleForReading] offset: 0 length: 1],
+    NSInvalidArgumentException,
+    "a transfer from a pipe is rejected");
+  [fh closeFile];
+
+  [[NSNotificationCenter defaultCenter] removeObserver: w];
+  [mgr removeItemAtPath: dir error: NULL];
+  [arp release]; arp = nil;
+  return 0;
+}
@@ -0,0 +1,136 @@
+#import "Testing.h"
+#import "ObjectTesting.h"
+#import <Foundation/NSAutoreleasePool.h>
+#import <Foundation/NSArray.h>
+#import <Foundation/NSDictionary.h>
+#import <Foundation/NSError.h>
+#import <Foundation/NSFileManager.h>
+#import <Foundation/NSSet.h>
+#import <Foundation/NSString.h>
+#import <Foundation/NSValue.h>
+
+/* Builds a tree with several levels of subdirectories, each holding
+ * a few files, so that copies and removals use several threads.
+ */
+static void
+makeTree(NSFileManager *mgr, NSString *dir, int depth)
+{
+  int	i;
+
+  [mgr createDirectoryAtPath: dir attributes: nil];
+  for (i = 0; i < 5; i++)
+    {
+      NSString	*name = [NSString stringWithFormat: @"file%d", i];
+      NSString	*path = [dir stringByAppendingPathComponent: name];
+
+      [path writeToFile: path atomically: NO];
+    }
+  if (depth > 0)
+    {
+      for (i = 0; i < 4; i++)
+	{
+	  NSString	*name = [NSString stringWithFormat: @"dir%d", i];
+
+	  makeTree(mgr, [dir stringByAppendingPathComponent: name], depth - 1);
+	}
+    }
+}
+
+static NSArray *
+listing(NSDirectoryEnumerator *e, NSString *skip)
+{
+  NSMutableArray	*a = [NSMutableArray array];
+  NSString		*s;
+
+  while ((s = [e nextObject]) != nil)
+    {
+      [a addObject: s];
+      if ([s isEqual: skip])
+	{
+	  [e skipDescendents];
+	}
+    }
+  return a;
+}
+
+int main()
+{
+  NSAutoreleasePool	*arp = [NSAutoreleasePool new];
+  NSFileManager		*mgr = [NSFileManager defaultManager];
+  NSString		*top = @"NSFileManagerTreeDir";
+  NSString		*copy = @"NSFileManagerTreeCopy";
+  NSArray		*paths;
+  NSDictionary		*attr;
+  NSError		*err;
+  NSEnumerator		*e;
+  NSString		*path;
+  BOOL			same;
+
+  [mgr removeFileAtPath: top handler: nil];
+  [mgr removeFileAtPath: copy handler: nil];
+  makeTree(mgr, top, 3);
+  [mgr createSymbolicLinkAtPath: [top stringByAppendingPathComponent: @"link"]
+		    pathContent: @"file0"];
+  [mgr changeFileAttributes: [NSDictionary dictionaryWithObject:
+    [NSNumber numberWithInt: 0640] forKey: NSFilePosixPermissions]
+    atPath: [top stringByAppendingPathComponent: @"dir1/file2"]];
+  paths = [mgr subpathsAtPath: top];
+
+  PASS_EQUAL(listing([mgr enumeratorAtPath: top prefetch: 16], nil), paths,
+    "prefetching enumerator returns the same paths in the same order");
+  PASS_EQUAL(listing([mgr enumeratorAtPath: top prefetch: 1], nil), paths,
+    "prefetching enumerator with a single entry ring works");
+  PASS_EQUAL(listing([mgr enumeratorAtPath: top prefetch: 1000], @"dir2"),
+    listing([mgr enumeratorAtPath: top], @"dir2"),
+    "prefetching enumerator skips the descendents of a directory");
+  PASS_EQUAL(listing([mgr enumeratorAtPath: top prefetch: 1000],
+    @"dir0/dir1/file1"),
+    listing([mgr enumeratorAtPath: top], @"dir0/dir1/file1"),
+    "prefetching enumerator skips the rest of a directory");
+  PASS([[mgr enumeratorAtPath: top prefetch: 4] nextObject] != nil,
+    "prefetching enumerator may be released before it is finished");
+
+  PASS([mgr copyItemAtPath: top toPath: copy error: &err],
+    "a tree is copied");
+  PASS_EQUAL([NSSet setWithArray: [mgr subpathsAtPath: copy]],
+    [NSSet setWithArray: paths], "the copy has the same contents");
+  same = YES;
+  e = [paths objectEnumerator];
+  while ((path = [e nextObject]) != nil)
+    {
+      NSString	*from = [top stringByAppendingPathComponent: path];
+      NSString	*to = [copy stringByAppendingPathComponent: path];
+
+      attr = [mgr fileAttributesAtPath: from traverseLink: NO];
+      if ([[attr fileType] isEqual: NSFileTypeRegular])
+	{
+	  if (NO == [mgr contentsEqualAtPath: from andPath: to])
+	    {
+	      same = NO;
+	    }
+	}
+      if ([attr filePosixPermissions] != [[mgr fileAttributesAtPath: to
+	traverseLink: NO] filePosixPermissions])
+	{
+	  same = NO;
+	}
+    }
+  PASS(same, "the copied files have the same data and permissions");
+  PASS_EQUAL([mgr pathContentOfSymbolicLinkAtPath:
+    [copy stringByAppendingPathComponent: @"link"]], @"file0",
+    "a symbolic link is copied");
+  PASS(NO == [mgr copyItemAtPath: top toPath: copy error: &err],
+    "a tree is not copied over an existing one");
+
+  PASS([mgr removeItemAtPath: copy error: &err]
+    && NO == [mgr fileExistsAtPath: copy],
+    "a tree is removed");
+  PASS([mgr removeFileAtPath: top handler: nil]
+    && NO == [mgr fileExistsAtPath: top],
+    "a tree is removed without a handler");
+  PASS(NO == [mgr removeItemAtPath: top error: &err] && err != nil,
+    "removing a missing tree reports an error");
+
+  [arp release]; arp = nil;
+  return 0;
+}
@@ -0,0 +1,216 @@
+#import "ObjectTesting.h"
+#import <Foundation/NSAutoreleasePool.h>
+#import <Foundation/NSArray.h>
+#import <Foundation/NSData.h>
+#import <Foundation/NSDictionary.h>
+#import <Foundation/NSException.h>
+#import <Foundation/NSKeyedArchiver.h>
+#import <Foundation/NSPropertyList.h>
+#import <Foundation/NSString.h>
+#import <Foundation/NSValue.h>
+
+@interface	Scalars : NSObject <NSCoding>
+{
+@public
+  int		i;
+  int64_t	l;
+  double	d;
+  float		f;
+  BOOL		b;
+  unsigned	u;
+  id		child;
+}
+@end
+
+@implementation	Scalars
+- (void) dealloc
+{
+  [child release];
+  [super dealloc];
+}
+
+- (void) encodeWithCoder: (NSCoder*)aCoder
+{
+  [aCoder encodeInt: i forKey: @"i"];
+  [aCoder encodeInt64: l forKey: @"l"];
+  [aCoder encodeDouble: d forKey: @"d"];
+  [aCoder encodeFloat: f forKey: @"f"];
+  [aCoder encodeBool: b forKey: @"b"];
+  [aCoder encodeBytes: (const uint8_t*)"bytes" length: 5 forKey: @"$bytes"];
+  [aCoder encodeObject: child forKey: @"child"];
+  [aCoder encodeValueOfObjCType: @encode(unsigned) at: &u];
+}
+
+- (id) initWithCoder: (NSCoder*)aCoder
+{
+  NSUInteger		len = 0;
+  const uint8_t		*bytes;
+
+  i = [aCoder decodeIntForKey: @"i"];
+  l = [aCoder decodeInt64ForKey: @"l"];
+  d = [aCoder decodeDoubleForKey: @"d"];
+  f = [aCoder decodeFloatForKey: @"f"];
+  b = [aCoder decodeBoolForKey: @"b"];
+  bytes = [aCoder decodeBytesForKey: @"$bytes" returnedLength: &len];
+  if (len != 5 || memcmp(bytes, "bytes", 5) != 0)
+    {
+      i = 0;
+    }
+  child = [[aCoder decodeObjectForKey: @"child"] retain];
+  [aCoder decodeValueOfObjCType: @encode(unsigned) at: &u];
+  return self;
+}
+@end
+
+@interface	Duplicate : NSObject <NSCoding>
+@end
+
+@implementation	Duplicate
+- (void) encodeWithCoder: (NSCoder*)aCoder
+{
+  [aCoder encodeInt: 1 forKey: @"key"];
+  [aCoder encodeInt: 2 forKey: @"key"];
+}
+
+- (id) initWithCoder: (NSCoder*)aCoder
+{
+  return self;
+}
+@end
+
+/* Encodes enough keys for duplicates to be looked up in a hash table.
+ */
+@interface	ManyKeys : NSObject <NSCoding>
+{
+@public
+  BOOL	repeat;
+  int	last;
+}
+@end
+
+@implementation	ManyKeys
+- (void) encodeWithCoder: (NSCoder*)aCoder
+{
+  int	i;
+
+  for (i = 0; i < 100; i++)
+    {
+      [aCoder encodeInt: i forKey: [NSString stringWithFormat: @"k%d", i]];
+    }
+  if (repeat)
+    {
+      [aCoder encodeInt: 0 forKey: @"k50"];
+    }
+}
+
+- (id) initWithCoder: (NSCoder*)aCoder
+{
+  last = [aCoder decodeIntForKey: @"k99"];
+  return self;
+}
+@end
+
+int main()
+{
+  NSAutoreleasePool	*arp = [NSAutoreleasePool new];
+  NSMutableDictionary	*shared;
+  NSMutableArray	*ma;
+  NSMutableData		*md;
+  NSKeyedArchiver	*archiver;
+  NSDictionary		*plist;
+  NSArray		*a;
+  NSData		*data;
+  Scalars		*s;
+  Scalars		*r;
+  ManyKeys		*m;
+  int			i;
+
+  s = [[Scalars new] autorelease];
+  s->i = -42;
+  s->l = 0x123456789LL;
+  s->d = 1.25;
+  s->f = 0.1f;
+  s->b = YES;
+  s->u = 4000000000U;
+  s->child = [[NSArray alloc] initWithObjects: @"one", @"two", nil];
+  data = [NSKeyedArchiver archivedDataWithRootObject: s];
+  PASS([data length] > 8 && memcmp([data bytes], "bplist00", 8) == 0,
+    "archive is a binary property list");
+  plist = [NSPropertyListSerialization propertyListWithData: data
+    options: NSPropertyListImmutable format: 0 error: 0];
+  PASS([[plist objectForKey: @"$archiver"] isEqual: @"NSKeyedArchiver"]
+    && [[plist objectForKey: @"$version"] intValue] == 100000
+    && [[plist objectForKey: @"$top"] objectForKey: @"root"] != nil
+    && [[[plist objectForKey: @"$objects"] objectAtIndex: 0]
+      isEqual: @"$null"], "archive has the standard layout");
+
+  r = [NSKeyedUnarchiver unarchiveObjectWithData: data];
+  PASS([r isKindOfClass: [Scalars class]], "object is unarchived");
+  PASS(r->i == -42 && r->l == 0x123456789LL && r->d == 1.25
+    && r->f == 0.1f && r->b == YES && r->u == 4000000000U,
+    "scalar values are restored");
+  PASS_EQUAL(r->child, s->child, "child object is restored");
+
+  /* Shared objects are encoded once, and enough objects to need three
+   * byte references.
+   */
+  shared = [NSMutableDictionary dictionaryWithObject: @"v" forKey: @"k"];
+  ma = [NSMutableArray array];
+  for (i = 0; i < 70000; i++)
+    {
+      [ma addObject: [NSString stringWithFormat: @"s%d", i]];
+      if (i % 10000 == 0)
+	{
+	  [ma addObject: shared];
+	}
+    }
+  data = [NSKeyedArchiver archivedDataWithRootObject: ma];
+  a = [NSKeyedUnarchiver unarchiveObjectWithData: data];
+  PASS_EQUAL(a, ma, "large archive is restored");
+  PASS([a objectAtIndex: 1] == [a objectAtIndex: 10002],
+    "shared object is restored once");
+
+  ma = [NSMutableArray array];
+  for (i = 0; i < 1000; i++)
+    {
+      [ma addObject: [@"" stringByPaddingToLength: 100
+				      withString: @"x"
+				 startingAtIndex: 0]];
+    }
+  data = [NSKeyedArchiver archivedDataWithRootObject: ma];
+  PASS([data length] < 10000, "equal strings are only written once");
+  PASS_EQUAL([NSKeyedUnarchiver unarchiveObjectWithData: data], ma,
+    "equal strings are restored");
+
+  md = [NSMutableData data];
+  archiver = [[NSKeyedArchiver alloc] initForWritingWithMutableData: md];
+  [archiver setOutputFormat: NSPropertyListXMLFormat_v1_0];
+  [archiver encodeObject: s forKey: @"root"];
+  [archiver finishEncoding];
+  PASS([md length] > 5 && memcmp([md bytes], "<?xml", 5) == 0,
+    "XML output format is supported");
+  r = [NSKeyedUnarchiver unarchiveObjectWithData: md];
+  PASS(r->i == -42 && [r->child isEqual: s->child], "XML archive is restored");
+  PASS_EXCEPTION([archiver encodeInt: 1 forKey: @"late"],
+    NSInvalidArchiveOperationException,
+    "encoding after finishing raises an exception");
+  [archiver release];
+
+  md = [NSMutableData data];
+  archiver = [[NSKeyedArchiver alloc] initForWritingWithMutableData: md];
+  PASS_EXCEPTION([archiver encodeObject: [[Duplicate new] autorelease]
+				 forKey: @"root"],
+    NSInvalidArgumentException, "duplicate keys are rejected");
+  [archiver release];
+
+  m = [[ManyKeys new] autorelease];
+  data = [NSKeyedArchiver archivedDataWithRootObject: m];
+  PASS(((ManyKeys*)[NSKeyedUnarchiver unarchiveObjectWithData: data])->last
+    == 99, "object with many keys is archived");
+  m->repeat = YES;
+  PASS_EXCEPTION([NSKeyedArchiver archivedDataWithRootObject: m],
+    NSInvalidArgumentException, "duplicate among many keys is rejected");
+
+  [arp release]; arp = nil;
+  return 0;
+}
@@ -0,0 +1,180 @@
+#import "ObjectTesting.h"
+#import <Foundation/NSAutoreleasePool.h>
+#import <Foundation/NSArray.h>
+#import <Foundation/NSConnection.h>
+#import <Foundation/NSData.h>
+#import <Foundation/NSDate.h>
+#import <Foundation/NSDistantObject.h>
+#import <Foundation/NSPort.h>
+#import <Foundation/NSPortMessage.h>
+#import <Foundation/NSPortNameServer.h>
+#import <Foundation/NSRunLoop.h>
+
+/* Collects the messages which arrive on a port.
+ */
+@interface	Collector : NSObject
+{
+@public
+  NSMutableArray	*messages;
+}
+@end
+
+@implementation	Collector
+- (void) dealloc
+{
+  [messages release];
+  [super dealloc];
+}
+
+- (void) handlePortMessage: (NSPortMessage*)m
+{
+  [messages addObject: [NSArray arrayWithObjects:
+    [NSNumber numberWithInt: [m msgid]], [m components], nil]];
+}
+
+- (id) init
+{
+  messages = [NSMutableArray new];
+  return self;
+}
+@end
+
+@protocol	Store
+- (unsigned) sum: (NSData*)d;
+- (NSData*) echo: (NSData*)d;
+@end
+
+@interface	Store : NSObject <Store>
+@end
+
+@implementation	Store
+- (unsigned) sum: (NSData*)d
+{
+  const unsigned char	*b = [d bytes];
+  NSUInteger		l = [d length];
+  unsigned		s = 0;
+
+  while (l-- > 0)
+    {
+      s += *b++;
+    }
+  return s;
+}
+
+- (NSData*) echo: (NSData*)d
+{
+  return d;
+}
+@end
+
+static NSMutableData *
+pattern(NSUInteger length, int seed)
+{
+  NSMutableData	*d = [NSMutableData dataWithLength: length];
+  unsigned char	*b = [d mutableBytes];
+  NSUInteger	i;
+
+  for (i = 0; i < length; i++)
+    {
+      b[i] = (unsigned char)(i * 31 + seed);
+    }
+  return d;
+}
+
+int main()
+{
+  NSAutoreleasePool	*arp = [NSAutoreleasePool new];
+  NSRunLoop		*loop = [NSRunLoop currentRunLoop];
+  Collector		*collector = [[Collector new] autorelease];
+  NSMessagePort		*port = [[NSMessagePort new] autorelease];
+  NSMutableArray	*sent = [NSMutableArray array];
+  NSPortNameServer	*ns = [NSMessagePortNameServer sharedInstance];
+  NSConnection		*server;
+  NSConnection		*client;
+  NSMessagePort		*serverPort;
+  NSData		*big;
+  id<Store>		proxy;
+  NSDate		*limit;
+  unsigned		sum;
+  int			i;
+
+  [port setDelegate: collector];
+  [loop addPort: port forMode: NSDefaultRunLoopMode];
+  [loop addPort: port forMode: NSConnectionReplyMode];
+
+  /* Small items are copied through the socket, large ones may be passed
+   * in shared memory, and both kinds must arrive in order.
+   */
+  for (i = 0; i < 12; i++)
+    {
+      NSMutableArray	*c = [NSMutableArray array];
+
+      [c addObject: pattern(i * 10, i)];
+      if (i % 3 == 2)
+	{
+	  [c addObject: pattern(100000 + i, i)];
+	  [c addObject: [NSData data]];
+	  [c addObject: pattern(9000, i)];
+	  [c addObject: pattern(1000000 + i, i + 1)];
+	}
+      [sent addObject: [[c copy] autorelease]];
+      PASS([port sendBeforeDate: [NSDate dateWithTimeIntervalSinceNow: 10.0]
+			  msgid: i
+		     components: c
+			   from: port
+		       reserved: 0], "message %d is sent", i);
+    }
+
+  limit = [NSDate dateWithTimeIntervalSinceNow: 10.0];
+  while ([collector->messages count] < [sent count]
+    && [limit timeIntervalSinceNow] > 0)
+    {
+      [loop runMode: NSDefaultRunLoopMode beforeDate: limit];
+    }
+  PASS([collector->messages count] == [sent count],
+    "all messages are received");
+  for (i = 0; i < (int)[collector->messages count]; i++)
+    {
+      NSArray	*m = [collector->messages objectAtIndex: i];
+
+      PASS([[m objectAtIndex: 0] intValue] == i
+	&& [[m objectAtIndex: 1] isEqual: [sent objectAtIndex: i]],
+	"message %d is received intact and in order", i);
+    }
+  [loop removePort: port forMode: NSDefaultRunLoopMode];
+  [loop removePort: port forMode: NSConnectionReplyMode];
+  [port invalidate];
+
+  /* Large arguments and results of remote messages, with the server
+   * found through the name server.
+   */
+  serverPort = [[NSMessagePort new] autorelease];
+  server = [[NSConnection alloc] initWithReceivePort: serverPort
+					    sendPort: nil];
+  [server setRootObject: [[Store new] autorelease]];
+  [server setRequestWorkers: 2];
+  PASS([ns registerPort: serverPort forName: @"SharedMemoryTest"],
+    "server port is registered");
+  client = [[NSConnection alloc]
+    initWithReceivePort: [[NSMessagePort new] autorelease]
+	       sendPort: [ns portForName: @"SharedMemoryTest"]];
+  [client setReplyTimeout: 30.0];
+  proxy = (id<Store>)[client rootProxy];
+  [(NSDistantObject*)proxy setProtocolForProxy: @protocol(Store)];
+
+  big = pattern(4 * 1024 * 1024, 7);
+  sum = [[[Store new] autorelease] sum: big];
+  PASS([proxy sum: big] == sum, "large argument arrives intact");
+  PASS([proxy sum: pattern(100, 7)] == [[[Store new] autorelease]
+    sum: pattern(100, 7)], "small argument arrives intact");
+  PASS_EQUAL([proxy echo: big], big, "large result arrives intact");
+  PASS([proxy sum: big] == sum, "large argument can be sent again");
+
+  [ns removePortForName: @"SharedMemoryTest"];
+  [client invalidate];
+  [server invalidate];
+  [client release];
+  [server release];
+  [arp release]; arp = nil;
+  return 0;
+}
@@ -0,0 +1,125 @@
+#import "ObjectTesting.h"
+#import <Foundation/NSAutoreleasePool.h>
+#import <Foundation/NSString.h>
+
+/* Large strings edited away from their end use a different internal
+ * representation, so check edits against a simple model.
+ */
+#define	LEN	200000
+
+static unichar	model[LEN * 2];
+static unsigned	modelLength;
+
+static void
+edit(NSMutableString *m, NSRange r, NSString *s)
+{
+  unsigned	l = [s length];
+
+  memmove(&model[r.location + l], &model[NSMaxRange(r)],
+    (modelLength - NSMaxRange(r)) * sizeof(unichar));
+  [s getCharacters: &model[r.location]];
+  modelLength = modelLength - r.length + l;
+  [m replaceCharactersInRange: r withString: s];
+}
+
+static BOOL
+matches(NSString *s)
+{
+  unichar	*buf;
+  BOOL		ok;
+
+  if ([s length] != modelLength)
+    {
+      return NO;
+    }
+  buf = malloc(modelLength * sizeof(unichar) + 1);
+  [s getCharacters: buf range: NSMakeRange(0, modelLength)];
+  ok = (memcmp(buf, model, modelLength * sizeof(unichar)) == 0);
+  free(buf);
+  return ok;
+}
+
+int main()
+{
+  NSAutoreleasePool	*arp = [NSAutoreleasePool new];
+  NSMutableString	*m;
+  NSString		*s;
+  unsigned		i;
+  BOOL			ok;
+
+  m = [NSMutableString stringWithCapacity: LEN];
+  for (i = 0; i < LEN / 10; i++)
+    {
+      [m appendString: @"0123456789"];
+    }
+  for (i = 0; i < LEN; i++)
+    {
+      model[i] = '0' + i % 10;
+    }
+  modelLength = LEN;
+  PASS(matches(m), "large string built by appending");
+
+  edit(m, NSMakeRange(1000, 0), @"inserted");
+  PASS([m characterAtIndex: 1000] == 'i' && [m characterAtIndex: 1008] == '0',
+    "insertion near the start of a large string");
+  PASS([m hasPrefix: @"0123456789"], "prefix unchanged by insertion");
+  PASS(matches(m), "contents correct after insertion");
+
+  edit(m, NSMakeRange(50000, 0), @"\u20AC");
+  PASS([m characterAtIndex: 50000] == 0x20AC,
+    "wide character inserted into an 8-bit string");
+  PASS([m characterAtIndex: 50001] == '2' && [m characterAtIndex: 49999] == '1',
+    "characters around the wide character are unchanged");
+
+  srandom(1);
+  ok = YES;
+  for (i = 0; i < 5000; i++)
+    {
+      NSUInteger	loc = random() % modelLength;
+      NSUInteger	len = random() % 4;
+
+      if (loc + len > modelLength)
+	{
+	  len = modelLength - loc;
+	}
+      switch (i % 4)
+	{
+	  case 0: edit(m, NSMakeRange(loc, len), @""); break;
+	  case 1: edit(m, NSMakeRange(loc, len), @"xyz"); break;
+	  case 2: edit(m, NSMakeRange(loc, 0), @"\u00E9"); break;
+	  default: edit(m, NSMakeRange(loc, len), @"\u4E2D"); break;
+	}
+      if (i % 500 == 0 && matches(m) == NO)
+	{
+	  ok = NO;
+	}
+    }
+  PASS(ok && matches(m), "many random edits give the right result");
+
+  [m deleteCharactersInRange: NSMakeRange(10, 1000)];
+  memmove(&model[10], &model[1010], (modelLength - 1010) * sizeof(unichar));
+  modelLength -= 1000;
+  PASS(matches(m), "deleting a range works");
+
+  s = [[m copy] autorelease];
+  PASS(matches(s), "copy of an edited string is correct");
+  PASS([s isEqualToString: m], "copy of an edited string is equal");
+
+  edit(m, NSMakeRange(5, 0), @"more");
+  PASS(NSEqualRanges([m rangeOfString: @"more"], NSMakeRange(5, 4)),
+    "searching an edited string works");
+  PASS(matches(m), "contents correct after searching");
+
+  edit(m, NSMakeRange(20, 0), @"again");
+  PASS(matches(m), "editing again after contiguous access works");
+  PASS_EQUAL([m substringWithRange: NSMakeRange(20, 5)], @"again",
+    "substring of an edited string works");
+
+  [m setString: @"short"];
+  PASS_EQUAL(m, @"short", "setString: replaces an edited string");
+  [m appendString: @" string"];
+  PASS_EQUAL(m, @"short string", "short string can be appended to");
+
+  [arp release]; arp = nil;
+  return 0;
+}
@@ -0,0 +1,99 @@
+#import "ObjectTesting.h"
+#import <Foundation/NSAutoreleasePool.h>
+#import <Foundation/NSRegularExpression.h>
+#import <Foundation/NSTextCheckingResult.h>
+#import <Foundation/NSPredicate.h>
+#import <Foundation/NSString.h>
+
+int main()
+{
+  NSAutoreleasePool   *arp = [NSAutoreleasePool new];
+  START_SET("NSRegularExpression cache")
+
+#if !(__APPLE__ || GS_USE_ICU)
+  SKIP("NSRegularExpression not built\nThe ICU library was not available when GNUstep-base was built")
+#else
+  NSRegularExpression	*r1;
+  NSRegularExpression	*r2;
+  NSString		*s;
+  NSRange		r;
+  unichar		u[] = { 0x00e9, 'a', 'b', 'c', 0x4e2d, 'a', 'b', 'c' };
+  int			i;
+
+  r1 = [NSRegularExpression regularExpressionWithPattern: @"b+c"
+						 options: 0
+						   error: NULL];
+  r2 = [NSRegularExpression regularExpressionWithPattern: @"b+c"
+						 options: 0
+						   error: NULL];
+  PASS_EQUAL(r1, r2, "expressions with the same pattern are equal");
+  r2 = [NSRegularExpression regularExpressionWithPattern: @"b+c"
+				 options: NSRegularExpressionCaseInsensitive
+						   error: NULL];
+  PASS([r2 options] == NSRegularExpressionCaseInsensitive,
+    "cached expressions are keyed by options as well as pattern");
+
+  /* Repeated matching reuses matchers; results must not leak from
+   * one subject string to the next.
+   */
+  for (i = 0; i < 3; i++)
+    {
+      r = [r1 rangeOfFirstMatchInString: @"aabbbcd"
+				options: 0
+				  range: NSMakeRange(0, 7)];
+      PASS(NSEqualRanges(r, NSMakeRange(2, 4)), "8-bit subject matched");
+      r = [r1 rangeOfFirstMatchInString: @"xyz"
+				options: 0
+				  range: NSMakeRange(0, 3)];
+      PASS(r.location == NSNotFound, "no stale match from previous subject");
+    }
+
+  s = [NSString stringWithCharacters: u length: 8];
+  r = [r1 rangeOfFirstMatchInString: s
+			    options: 0
+			      range: NSMakeRange(3, 5)];
+  PASS(NSEqualRanges(r, NSMakeRange(6, 2)), "16-bit subject matched");
+  s = [[NSString alloc] initWithBytes: "\xe9\xe9xbbc"
+			       length: 6
+			     encoding: NSISOLatin1StringEncoding];
+  r = [r1 rangeOfFirstMatchInString: s
+			    options: 0
+			      range: NSMakeRange(0, 6)];
+  PASS(NSEqualRanges(r, NSMakeRange(3, 3)), "non-ASCII 8-bit subject matched");
+  [s release];
+
+  PASS(NSEqualRanges([@"xxABBC" rangeOfString: @"b+c"
+    options: NSRegularExpressionSearch | NSCaseInsensitiveSearch],
+    NSMakeRange(3, 3)), "regular expression search through NSString works");
+
+  PASS([[NSPredicate predicateWithFormat: @"SELF MATCHES %@", @"a.c"]
+    evaluateWithObject: @"abc"], "MATCHES predicate matches whole string");
+  PASS(NO == [[NSPredicate predicateWithFormat: @"SELF MATCHES %@", @"a.c"]
+    evaluateWithObject: @"abcd"], "MATCHES predicate rejects partial match");
+
+#if __has_feature(blocks)
+  {
+    __block NSUInteger	inner = 0;
+    __block NSUInteger	outer = 0;
+
+    [r1 enumerateMatchesInString: @"bc bbc bbbc"
+			 options: 0
+			   range: NSMakeRange(0, 11)
+		      usingBlock: ^(NSTextCheckingResult *res,
+			NSMatchingFlags flags, BOOL *stop)
+      {
+	outer++;
+	inner += [r1 numberOfMatchesInString: @"bc bc"
+				     options: 0
+				       range: NSMakeRange(0, 5)];
+      }];
+    PASS(outer == 3 && inner == 6,
+      "expression can be re-entered from its own enumeration block");
+  }
+#endif
+#endif
+
+  END_SET("NSRegularExpression cache")
+  [arp release]; arp = nil;
+  return 0;
+}
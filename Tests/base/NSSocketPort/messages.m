@@ -0,0 +1,112 @@
+#import "ObjectTesting.h"
+#import <Foundation/NSAutoreleasePool.h>
+#import <Foundation/NSArray.h>
+#import <Foundation/NSConnection.h>
+#import <Foundation/NSData.h>
+#import <Foundation/NSDate.h>
+#import <Foundation/NSPort.h>
+#import <Foundation/NSPortMessage.h>
+#import <Foundation/NSRunLoop.h>
+
+/* Collects the messages which arrive on a port.
+ */
+@interface	Collector : NSObject
+{
+@public
+  NSMutableArray	*messages;
+}
+@end
+
+@implementation	Collector
+- (void) dealloc
+{
+  [messages release];
+  [super dealloc];
+}
+
+- (void) handlePortMessage: (NSPortMessage*)m
+{
+  [messages addObject: [NSArray arrayWithObjects:
+    [NSNumber numberWithInt: [m msgid]], [m components], nil]];
+}
+
+- (id) init
+{
+  messages = [NSMutableArray new];
+  return self;
+}
+@end
+
+static NSMutableData *
+pattern(NSUInteger length, int seed)
+{
+  NSMutableData	*d = [NSMutableData dataWithLength: length];
+  unsigned char	*b = [d mutableBytes];
+  NSUInteger	i;
+
+  for (i = 0; i < length; i++)
+    {
+      b[i] = (unsigned char)(i * 31 + seed);
+    }
+  return d;
+}
+
+int main()
+{
+  NSAutoreleasePool	*arp = [NSAutoreleasePool new];
+  NSRunLoop		*loop = [NSRunLoop currentRunLoop];
+  Collector		*collector = [[Collector new] autorelease];
+  NSSocketPort		*port = [[NSSocketPort new] autorelease];
+  NSMutableArray	*sent = [NSMutableArray array];
+  NSDate		*limit;
+  int			i;
+
+  [port setDelegate: collector];
+  [loop addPort: port forMode: NSDefaultRunLoopMode];
+  [loop addPort: port forMode: NSConnectionReplyMode];
+
+  /* A mixture of small messages, which are packed into a single item,
+   * and large ones, whose items are written separately.
+   */
+  for (i = 0; i < 20; i++)
+    {
+      NSMutableArray	*c = [NSMutableArray array];
+
+      [c addObject: pattern(i * 10, i)];
+      if (i % 5 == 4)
+	{
+	  [c addObject: pattern(100000 + i, i)];
+	  [c addObject: [NSData data]];
+	  [c addObject: pattern(9000, i)];
+	}
+      [sent addObject: [[c copy] autorelease]];
+      PASS([port sendBeforeDate: [NSDate dateWithTimeIntervalSinceNow: 10.0]
+			  msgid: i
+		     components: c
+			   from: port
+		       reserved: 0], "message %d is sent", i);
+    }
+
+  limit = [NSDate dateWithTimeIntervalSinceNow: 10.0];
+  while ([collector->messages count] < [sent count]
+    && [limit timeIntervalSinceNow] > 0)
+    {
+      [loop runMode: NSDefaultRunLoopMode beforeDate: limit];
+    }
+  PASS([collector->messages count] == [sent count],
+    "all messages are received");
+  for (i = 0; i < (int)[collector->messages count]; i++)
+    {
+      NSArray	*m = [collector->messages objectAtIndex: i];
+
+      PASS([[m objectAtIndex: 0] intValue] == i
+	&& [[m objectAtIndex: 1] isEqual: [sent objectAtIndex: i]],
+	"message %d is received intact and in order", i);
+    }
+
+  [loop removePort: port forMode: NSDefaultRunLoopMode];
+  [loop removePort: port forMode: NSConnectionReplyMode];
+  [port invalidate];
+  [arp release]; arp = nil;
+  return 0;
+}
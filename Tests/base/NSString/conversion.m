@@ -0,0 +1,119 @@
+#import <Foundation/NSString.h>
+#import <Foundation/NSData.h>
+#import "ObjectTesting.h"
+
+/* Exercise the bulk ASCII/Latin-1 conversion paths with inputs long
+ * enough to use vector code, placing a non-ASCII character at each
+ * offset so that every block boundary and tail is covered.
+ */
+int main(void)
+{
+  NSAutoreleasePool	*arp = [NSAutoreleasePool new];
+  BOOL			utf8OK = YES;
+  BOOL			latin1OK = YES;
+  BOOL			asciiOK = YES;
+  BOOL			lossyOK = YES;
+  unsigned		len = 100;
+  unsigned		pos;
+
+  START_SET("NSString + bulk conversion")
+
+  for (pos = 0; pos <= len; pos++)
+    {
+      unsigned char	bytes[len + 2];
+      unichar		chars[len + 1];
+      NSString		*str;
+      NSData		*d;
+      unsigned		i;
+
+      /* UTF-8 with a two byte sequence at pos.
+       */
+      for (i = 0; i < len; i++)
+	{
+	  bytes[i] = 'a' + i % 26;
+	  chars[i] = bytes[i];
+	}
+      if (pos < len)
+	{
+	  bytes[pos] = 0xc3;
+	  bytes[pos + 1] = 0xa9;
+	  chars[pos] = 0xe9;
+	  for (i = pos + 1; i < len; i++)
+	    {
+	      bytes[i + 1] = 'a' + i % 26;
+	    }
+	}
+      str = [[NSString alloc] initWithBytes: bytes
+				     length: (pos < len) ? len + 1 : len
+				   encoding: NSUTF8StringEncoding];
+      if (NO == [str isEqual: [NSString stringWithCharacters: chars
+						      length: len]])
+	{
+	  utf8OK = NO;
+	}
+      d = [str dataUsingEncoding: NSUTF8StringEncoding];
+      if ([d length] != ((pos < len) ? len + 1 : len)
+	|| memcmp([d bytes], bytes, [d length]) != 0)
+	{
+	  utf8OK = NO;
+	}
+
+      /* ASCII conversion must fail if there is a non-ascii character,
+       * and lossy conversion must substitute it.
+       */
+      d = [str dataUsingEncoding: NSASCIIStringEncoding];
+      if ((pos < len) != (nil == d))
+	{
+	  asciiOK = NO;
+	}
+      d = [str dataUsingEncoding: NSASCIIStringEncoding
+	    allowLossyConversion: YES];
+      if ([d length] != len
+	|| (pos < len && ((const char*)[d bytes])[pos] != '?'))
+	{
+	  lossyOK = NO;
+	}
+      [str release];
+
+      /* Latin-1 with a top-bit-set character at pos.
+       */
+      for (i = 0; i < len; i++)
+	{
+	  bytes[i] = 'A' + i % 26;
+	}
+      if (pos < len)
+	{
+	  bytes[pos] = 0xfc;
+	}
+      str = [[NSString alloc] initWithBytes: bytes
+				     length: len
+				   encoding: NSISOLatin1StringEncoding];
+      if ([str length] != len
+	|| (pos < len && [str characterAtIndex: pos] != 0xfc))
+	{
+	  latin1OK = NO;
+	}
+      d = [str dataUsingEncoding: NSISOLatin1StringEncoding];
+      if ([d length] != len || memcmp([d bytes], bytes, len) != 0)
+	{
+	  latin1OK = NO;
+	}
+      [str release];
+      str = [[NSString alloc] initWithBytes: bytes
+				     length: len
+				   encoding: NSASCIIStringEncoding];
+      if ((pos < len) != (nil == str))
+	{
+	  asciiOK = NO;
+	}
+      [str release];
+    }
+  PASS(utf8OK, "UTF-8 conversion handles non-ascii at every offset")
+  PASS(latin1OK, "Latin-1 conversion handles high characters at every offset")
+  PASS(asciiOK, "ASCII conversion rejects non-ascii at every offset")
+  PASS(lossyOK, "lossy ASCII conversion substitutes at every offset")
+
+  END_SET("NSString + bulk conversion")
+  [arp release];
+  return 0;
+}
@@ -0,0 +1,81 @@
+#import "ObjectTesting.h"
+#import <Foundation/NSAutoreleasePool.h>
+#import <Foundation/NSString.h>
+
+static NSString *
+fmt(NSString *format, ...)
+{
+  NSString	*s;
+  va_list	ap;
+
+  va_start(ap, format);
+  s = [[[NSString alloc] initWithFormat: format arguments: ap] autorelease];
+  va_end(ap);
+  return s;
+}
+
+int main()
+{
+  NSAutoreleasePool	*arp = [NSAutoreleasePool new];
+  NSMutableString	*m;
+  NSString		*f;
+  int			i;
+
+  /* Constant format strings are parsed once and reused, so make sure
+   * that repeated use with different arguments gives the right results.
+   */
+  for (i = 0; i < 3; i++)
+    {
+      PASS_EQUAL(fmt(@"%d-%s-%@", i, "x", @"y"),
+	([NSString stringWithFormat: @"%d-x-y", i]),
+	"repeated constant format with different arguments");
+      PASS_EQUAL(fmt(@"[%*d]", 5 + i, 42),
+	([@"[" stringByAppendingString:
+	  [[@"" stringByPaddingToLength: 3 + i withString: @" "
+	    startingAtIndex: 0] stringByAppendingString: @"42]"]]),
+	"width taken from the argument list is not cached");
+      PASS_EQUAL(fmt(@"%.*f", i, 1.5),
+	(i == 0 ? @"2" : (i == 1 ? @"1.5" : @"1.50")),
+	"precision taken from the argument list is not cached");
+    }
+
+  PASS_EQUAL(fmt(@"%2$@ %1$@", @"world", @"hello"), @"hello world",
+    "positional arguments work");
+  PASS_EQUAL(fmt(@"no specifiers"), @"no specifiers",
+    "format without specifiers works");
+  PASS_EQUAL(fmt(@"%%%d%%", 7), @"%7%", "percent escapes work");
+  PASS_EQUAL(fmt(@"\u20AC%d\u20AC", 123), @"\u20AC123\u20AC",
+    "non-ASCII literal text works");
+  PASS_EQUAL(fmt(@"%d %d %d %d", 0, -1, 100, 2147483647),
+    @"0 -1 100 2147483647", "decimal conversion works");
+  PASS_EQUAL(fmt(@"%llu", 18446744073709551615ULL), @"18446744073709551615",
+    "unsigned long long conversion works");
+  PASS_EQUAL(fmt(@"%lu %lx", 1234567890UL, 255UL), @"1234567890 ff",
+    "long conversion works");
+  PASS_EQUAL(fmt(@"%5.2f|%-6.1e|%g", 3.14159, 1234.5, 0.5),
+    @" 3.14|1.2e+03|0.5", "floating point conversion works");
+
+  /* A format string which is not constant is never cached.
+   */
+  f = [NSMutableString stringWithString: @"%d/%d"];
+  PASS_EQUAL(fmt(f, 1, 2), @"1/2", "non-constant format works");
+  [(NSMutableString*)f setString: @"%@"];
+  PASS_EQUAL(fmt(f, @"changed"), @"changed",
+    "modified non-constant format works");
+
+  m = [NSMutableString stringWithString: @"a"];
+  for (i = 0; i < 100; i++)
+    {
+      [m appendFormat: @"%d,", i];
+    }
+  PASS([m length] == 291 && [m hasSuffix: @"98,99,"],
+    "appendFormat: grows the string correctly");
+  [m appendFormat: @"%C", (unichar)0x20AC];
+  PASS([m characterAtIndex: [m length] - 1] == 0x20AC,
+    "appendFormat: widens the string correctly");
+  [m appendFormat: @"%d", 5];
+  PASS([m hasSuffix: @"\u20AC5"], "appendFormat: to a wide string works");
+
+  [arp release]; arp = nil;
+  return 0;
+}
@@ -0,0 +1,124 @@
+#import "ObjectTesting.h"
+#import <Foundation/NSAutoreleasePool.h>
+#import <Foundation/NSXMLDocument.h>
+#import <Foundation/NSXMLElement.h>
+#import "GNUstepBase/GSConfig.h"
+
+int main()
+{
+  NSAutoreleasePool *arp = [NSAutoreleasePool new];
+  START_SET("NSXMLDocument xpath")
+#if !GS_USE_LIBXML
+    SKIP("library built without libxml2")
+#else
+  NSAutoreleasePool *pool;
+  NSMutableString *xml;
+  NSXMLDocument *doc;
+  NSXMLElement *root;
+  NSXMLElement *elem;
+  NSXMLNode *node;
+  NSEnumerator *e;
+  NSArray *nodes;
+  NSUInteger count;
+  BOOL same;
+  unsigned i;
+
+  xml = [NSMutableString stringWithString: @"<list>"];
+  for (i = 0; i < 100; i++)
+    {
+      [xml appendFormat: @"<item n=\"%u\"><name>Item %u</name></item>", i, i];
+    }
+  [xml appendString: @"</list>"];
+  doc = [[NSXMLDocument alloc] initWithXMLString: xml options: 0 error: NULL];
+  root = [doc rootElement];
+
+  PASS([root childAtIndex: 3] == [root childAtIndex: 3],
+    "a node in use is returned as the same object");
+  PASS([[root childAtIndex: 3] parent] == root,
+    "the parent of a node in use is the same object");
+
+  nodes = [doc nodesForXPath: @"//item/name" error: NULL];
+  PASS([nodes count] == 100, "-nodesForXPath:error: finds every node");
+  PASS([[doc nodesForXPath: @"//item/name" error: NULL] isEqual: nodes],
+    "a repeated query finds the same nodes");
+  PASS_EQUAL([[nodes objectAtIndex: 7] stringValue], @"Item 7",
+    "the string value of a found node is correct");
+  PASS_EQUAL([[nodes objectAtIndex: 7] XPath], @"/list/item[8]/name",
+    "the XPath of a found node is correct");
+
+  e = [doc nodeEnumeratorForXPath: @"//item/name" error: NULL];
+  count = 0;
+  same = YES;
+  while ((node = [e nextObject]) != nil)
+    {
+      if (node != [nodes objectAtIndex: count++])
+	{
+	  same = NO;
+	}
+    }
+  PASS(100 == count && YES == same,
+    "-nodeEnumeratorForXPath:error: finds the same nodes");
+  PASS(nil == [doc nodeEnumeratorForXPath: @"count(//item)" error: NULL],
+    "there is no enumerator for a query which does not find nodes");
+  PASS(nil == [doc nodeEnumeratorForXPath: @"//item[" error: NULL],
+    "there is no enumerator for a bad query");
+
+  pool = [NSAutoreleasePool new];
+  e = [[root nodeEnumeratorForXPath: @"item[@n > 97]" error: NULL] retain];
+  [pool release];
+  PASS_EQUAL([[e nextObject] XMLString],
+    @"<item n=\"98\"><name>Item 98</name></item>",
+    "an enumerator works relative to its node");
+  [e release];
+
+  pool = [NSAutoreleasePool new];
+  [(NSXMLElement*)[root childAtIndex: 5] setObjectValue: @"five"];
+  [pool release];
+  PASS_EQUAL([[root childAtIndex: 5] objectValue], @"five",
+    "the object value of a node is kept");
+
+  pool = [NSAutoreleasePool new];
+  node = [[[doc nodesForXPath: @"//item[@n = 42]/name" error: NULL]
+    lastObject] retain];
+  [pool release];
+  pool = [NSAutoreleasePool new];
+  [[root childAtIndex: 42] setStringValue: @"gone"];
+  PASS_EQUAL([[root childAtIndex: 42] stringValue], @"gone",
+    "setting the string value replaces the children");
+  PASS_EQUAL([node stringValue], @"Item 42",
+    "a node in use survives the replacement of its parent's children");
+  PASS(nil == [node rootDocument],
+    "a node in use is removed from the document when replaced");
+  [pool release];
+  [node release];
+
+  pool = [NSAutoreleasePool new];
+  elem = [[root childAtIndex: 9] retain];
+  [doc release];
+  [pool release];
+  PASS_EQUAL([elem XMLString], @"<item n=\"9\"><name>Item 9</name></item>",
+    "a node in use outlives the release of its document");
+  PASS_EQUAL([[elem parent] name], @"list",
+    "a node in use keeps its parent");
+  [elem release];
+
+  doc = [[NSXMLDocument alloc] initWithXMLString: @"<a><b/></a>"
+					 options: 0
+					   error: NULL];
+  elem = (NSXMLElement*)[[doc rootElement] childAtIndex: 0];
+  [elem addChild: [NSXMLNode textWithStringValue: @"one"]];
+  [elem addChild: [NSXMLNode textWithStringValue: @"two"]];
+  PASS([elem childCount] == 2, "adjacent text nodes may be added");
+  [[doc rootElement] normalizeAdjacentTextNodesPreservingCDATA: NO];
+  PASS([elem childCount] == 1
+    && [[[elem childAtIndex: 0] stringValue] isEqual: @"onetwo"],
+    "adjacent text nodes are normalized");
+  [doc release];
+#endif
+
+  END_SET("NSXMLDocument xpath")
+  [arp release];
+  arp = nil;
+
+  return 0;
+}
@@ -0,0 +1,165 @@
+#import "Testing.h"
+#import "ObjectTesting.h"
+#import <Foundation/Foundation.h>
+
+@interface	Recorder : NSObject
+{
+@public
+  NSMutableArray	*text;
+  NSMutableArray	*names;
+  NSMutableArray	*qNames;
+  NSMutableArray	*kept;		// Attribute dictionaries retained
+  BOOL			abortOnText;
+}
+@end
+
+@implementation	Recorder
+- (void) dealloc
+{
+  [text release];
+  [names release];
+  [qNames release];
+  [kept release];
+  [super dealloc];
+}
+
+- (id) init
+{
+  if ((self = [super init]) != nil)
+    {
+      text = [NSMutableArray new];
+      names = [NSMutableArray new];
+      qNames = [NSMutableArray new];
+      kept = [NSMutableArray new];
+    }
+  return self;
+}
+
+- (void) parser: (NSXMLParser *)parser
+  didStartElement: (NSString *)elementName
+  namespaceURI: (NSString *)namespaceURI
+  qualifiedName: (NSString *)qName
+  attributes: (NSDictionary *)attributeDict
+{
+  [names addObject: elementName];
+  if (qName != nil)
+    {
+      [qNames addObject: qName];
+    }
+  if ([attributeDict count] > 0)
+    {
+      [kept addObject: attributeDict];
+    }
+}
+
+- (void) parser: (NSXMLParser *)parser
+  didEndElement: (NSString *)elementName
+  namespaceURI: (NSString *)namespaceURI
+  qualifiedName: (NSString *)qName
+{
+  [names addObject: [@"/" stringByAppendingString: elementName]];
+}
+
+- (void) parser: (NSXMLParser *)parser foundCharacters: (NSString *)string
+{
+  [text addObject: string];
+  if (abortOnText)
+    {
+      [parser abortParsing];
+    }
+}
+@end
+
+static Recorder *
+parse(NSString *doc, BOOL namespaces, BOOL abortOnText)
+{
+  NSXMLParser	*parser;
+  Recorder	*r = [[Recorder new] autorelease];
+
+  r->abortOnText = abortOnText;
+  parser = [[NSXMLParser alloc] initWithData:
+    [doc dataUsingEncoding: NSUTF8StringEncoding]];
+  [parser setShouldProcessNamespaces: namespaces];
+  [parser setDelegate: r];
+  [parser parse];
+  [parser release];
+  return r;
+}
+
+int main()
+{
+  NSAutoreleasePool	*arp = [NSAutoreleasePool new];
+  NSMutableString	*doc;
+  NSMutableString	*big;
+  NSDictionary		*d;
+  Recorder		*r;
+  unsigned		i;
+
+  r = parse(@"<a>one &amp; two &lt; three</a>", NO, NO);
+  PASS_EQUAL(r->text, [NSArray arrayWithObject: @"one & two < three"],
+    "text with entities is reported in one piece");
+
+  r = parse(@"<a>x<b/>y<!-- c -->z</a>", NO, NO);
+  PASS_EQUAL(r->text, ([NSArray arrayWithObjects: @"x", @"y", @"z", nil]),
+    "text separated by other items is reported separately");
+  PASS_EQUAL(r->names, ([NSArray arrayWithObjects:
+    @"a", @"b", @"/b", @"/a", nil]), "elements are reported in order");
+
+  big = [NSMutableString string];
+  for (i = 0; i < 2000; i++)
+    {
+      [big appendFormat: @"line %u &amp; more\n", i];
+    }
+  r = parse([NSString stringWithFormat: @"<a>%@</a>", big], NO, NO);
+  PASS([r->text count] == 1, "a long run of text is reported in one piece");
+  PASS_EQUAL([r->text lastObject], [big stringByReplacingOccurrencesOfString:
+    @"&amp;" withString: @"&"], "a long run of text is reported intact");
+
+  r = parse(@"<a>x<b>y</b></a>", NO, YES);
+  PASS_EQUAL(r->names, [NSArray arrayWithObject: @"a"],
+    "aborting on text stops before the next element is reported");
+
+  doc = [NSMutableString stringWithString: @"<list>"];
+  for (i = 0; i < 100; i++)
+    {
+      [doc appendFormat: @"<item n=\"%u\" kind=\"k%u\"/>", i, i % 3];
+    }
+  [doc appendString: @"</list>"];
+  r = parse(doc, NO, NO);
+  PASS([r->kept count] == 100, "every element has its attributes");
+  for (i = 0; i < 100; i++)
+    {
+      d = [r->kept objectAtIndex: i];
+      if ([d count] != 2
+	|| NO == [[d objectForKey: @"n"] isEqual:
+	  [NSString stringWithFormat: @"%u", i]]
+	|| NO == [[d objectForKey: @"kind"] isEqual:
+	  [NSString stringWithFormat: @"k%u", i % 3]])
+	{
+	  break;
+	}
+    }
+  PASS(100 == i, "retained attribute dictionaries are left intact");
+  PASS([r->names objectAtIndex: 1] == [r->names objectAtIndex: 3],
+    "a repeated element name is reported as the same string");
+
+  doc = [NSMutableString stringWithString:
+    @"<p:list xmlns:p=\"urn:x\" xmlns:q=\"urn:y\">"];
+  for (i = 0; i < 3; i++)
+    {
+      [doc appendString: @"<p:item q:n=\"1\"/><q:item/>"];
+    }
+  [doc appendString: @"</p:list>"];
+  r = parse(doc, YES, NO);
+  PASS_EQUAL(r->qNames, ([NSArray arrayWithObjects: @"p:list",
+    @"p:item", @"q:item", @"p:item", @"q:item", @"p:item", @"q:item", nil]),
+    "qualified names are reported with their prefixes");
+  PASS_EQUAL([[r->kept objectAtIndex: 1] objectForKey: @"q:n"], @"1",
+    "a prefixed attribute is keyed by its qualified name");
+  r = parse(doc, NO, NO);
+  PASS_EQUAL([r->names objectAtIndex: 1], @"p:item",
+    "an element is named with its prefix without namespace processing");
+
+  [arp release]; arp = nil;
+  return 0;
+}
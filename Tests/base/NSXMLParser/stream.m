@@ -0,0 +1,176 @@
+#import "Testing.h"
+#import "ObjectTesting.h"
+#import <Foundation/Foundation.h>
+
+/* Records the parse events as a string.  Text is gathered up until the
+ * next element event, since the parser may report it in different pieces
+ * depending on how the document was divided when it was read.
+ */
+@interface	Logger : NSObject
+{
+@public
+  NSMutableString	*log;
+  NSMutableString	*text;
+  NSUInteger		elements;
+  NSUInteger		abortAfter;
+  BOOL			failed;
+}
+- (void) flush;
+@end
+
+@implementation	Logger
+- (void) dealloc
+{
+  [log release];
+  [text release];
+  [super dealloc];
+}
+
+- (void) flush
+{
+  if ([text length] > 0)
+    {
+      [log appendFormat: @"text %@\n", text];
+      [text setString: @""];
+    }
+}
+
+- (id) init
+{
+  if ((self = [super init]) != nil)
+    {
+      log = [NSMutableString new];
+      text = [NSMutableString new];
+    }
+  return self;
+}
+
+- (void) parser: (NSXMLParser *)parser
+  didStartElement: (NSString *)elementName
+  namespaceURI: (NSString *)namespaceURI
+  qualifiedName: (NSString *)qName
+  attributes: (NSDictionary *)attributeDict
+{
+  [self flush];
+  [log appendFormat: @"start %@ %@\n", elementName,
+    [attributeDict objectForKey: @"n"]];
+  if (++elements == abortAfter)
+    {
+      [parser abortParsing];
+    }
+}
+
+- (void) parser: (NSXMLParser *)parser
+  didEndElement: (NSString *)elementName
+  namespaceURI: (NSString *)namespaceURI
+  qualifiedName: (NSString *)qName
+{
+  [self flush];
+  [log appendFormat: @"end %@\n", elementName];
+}
+
+- (void) parser: (NSXMLParser *)parser foundCharacters: (NSString *)string
+{
+  [text appendString: string];
+}
+
+- (void) parser: (NSXMLParser *)parser parseErrorOccurred: (NSError *)error
+{
+  failed = YES;
+}
+@end
+
+static Logger *
+parse(NSXMLParser *parser, BOOL *ok, NSUInteger abortAfter)
+{
+  Logger	*l = [[Logger new] autorelease];
+
+  l->abortAfter = abortAfter;
+  [parser setDelegate: l];
+  *ok = [parser parse];
+  [l flush];
+  return l;
+}
+
+int main()
+{
+  NSAutoreleasePool	*arp = [NSAutoreleasePool new];
+  NSMutableString	*doc;
+  NSString		*accented;
+  NSXMLParser		*parser;
+  NSString		*path;
+  NSData		*data;
+  Logger		*fromData;
+  Logger		*fromStream;
+  BOOL			okData;
+  BOOL			okStream;
+  unsigned		i;
+
+  PASS(nil == [[NSXMLParser alloc] initWithStream: nil],
+    "-initWithStream: returns nil for a nil stream");
+
+  /* A document much larger than the pieces the parser reads a stream in,
+   * with multibyte characters, so that elements, attributes and
+   * characters all get split between pieces.
+   */
+  accented = [NSString stringWithUTF8String: "caf\xc3\xa9 cr\xc3\xa8me"];
+  doc = [NSMutableString stringWithString: @"<?xml version=\"1.0\"?>\n<doc>"];
+  for (i = 0; i < 20000; i++)
+    {
+      [doc appendFormat:
+	@"<item n=\"%u\">%@ &amp; %u</item>\n", i, accented, i * 7];
+    }
+  [doc appendString: @"</doc>\n"];
+  data = [doc dataUsingEncoding: NSUTF8StringEncoding];
+
+  parser = [[[NSXMLParser alloc] initWithData: data] autorelease];
+  fromData = parse(parser, &okData, 0);
+  parser = [[[NSXMLParser alloc] initWithStream:
+    [NSInputStream inputStreamWithData: data]] autorelease];
+  fromStream = parse(parser, &okStream, 0);
+  PASS(okData && okStream, "a large document parses from data and stream");
+  PASS(fromStream->elements == 20001, "every element is reported");
+  PASS_EQUAL(fromStream->log, fromData->log,
+    "a stream reports the same events as data");
+
+  path = [NSTemporaryDirectory() stringByAppendingPathComponent:
+    [[NSProcessInfo processInfo] globallyUniqueString]];
+  [data writeToFile: path atomically: NO];
+  parser = [[[NSXMLParser alloc] initWithStream:
+    [NSInputStream inputStreamWithFileAtPath: path]] autorelease];
+  fromStream = parse(parser, &okStream, 0);
+  PASS(okStream && [fromStream->log isEqual: fromData->log],
+    "a document parses from a file stream");
+
+  parser = [[[NSXMLParser alloc] initWithStream:
+    [NSInputStream inputStreamWithFileAtPath: path]] autorelease];
+  fromStream = parse(parser, &okStream, 5);
+  PASS(NO == okStream && fromStream->elements == 5,
+    "aborting parsing stops reading the stream");
+  PASS([parser parserError] != nil, "an aborted parse has an error");
+  [[NSFileManager defaultManager] removeItemAtPath: path error: NULL];
+
+  data = [@"<doc><a>text</b></doc>" dataUsingEncoding: NSUTF8StringEncoding];
+  parser = [[[NSXMLParser alloc] initWithStream:
+    [NSInputStream inputStreamWithData: data]] autorelease];
+  fromStream = parse(parser, &okStream, 0);
+  PASS(NO == okStream && YES == fromStream->failed
+    && [parser parserError] != nil,
+    "a malformed document from a stream fails with an error");
+
+  parser = [[[NSXMLParser alloc] initWithStream:
+    [NSInputStream inputStreamWithFileAtPath: @"/no/such/file"]] autorelease];
+  fromStream = parse(parser, &okStream, 0);
+  PASS(NO == okStream && [parser parserError] != nil,
+    "an unreadable stream fails with an error");
+
+  parser = [[[NSXMLParser alloc] initWithStream:
+    [NSInputStream inputStreamWithData: [NSData data]]] autorelease];
+  fromStream = parse(parser, &okStream, 0);
+  PASS(NO == okStream && YES == fromStream->failed
+    && [[parser parserError] code] == NSXMLParserEmptyDocumentError,
+    "an empty stream fails with an empty document error");
+
+  [arp release]; arp = nil;
+  return 0;
+}
@@ -0,0 +1,117 @@
+#import "ObjectTesting.h"
+#import <Foundation/NSAutoreleasePool.h>
+#import <Foundation/NSArray.h>
+#import <Foundation/NSData.h>
+#import <Foundation/NSDictionary.h>
+#import <Foundation/NSPropertyList.h>
+#import <Foundation/NSStream.h>
+#import <Foundation/NSValue.h>
+
+static id
+roundTrip(id plist, NSPropertyListWriteOptions opt, NSData **out)
+{
+  NSOutputStream	*stream;
+  NSData		*data;
+  NSError		*error = nil;
+  NSInteger		written;
+
+  stream = [NSOutputStream outputStreamToMemory];
+  [stream open];
+  written = [NSPropertyListSerialization writePropertyList: plist
+						  toStream: stream
+						    format: NSPropertyListBinaryFormat_v1_0
+						   options: opt
+						     error: &error];
+  [stream close];
+  data = [stream propertyForKey: NSStreamDataWrittenToMemoryStreamKey];
+  if (written <= 0 || written != (NSInteger)[data length] || error != nil)
+    {
+      return nil;
+    }
+  if (out != 0)
+    {
+      *out = data;
+    }
+  return [NSPropertyListSerialization propertyListWithData: data
+    options: NSPropertyListImmutable format: 0 error: 0];
+}
+
+int main()
+{
+  NSAutoreleasePool	*arp = [NSAutoreleasePool new];
+  NSMutableDictionary	*md;
+  NSMutableArray	*ma;
+  NSArray		*shared;
+  NSData		*streamed;
+  NSData		*data;
+  id			plist;
+  int			i;
+
+  md = [NSMutableDictionary dictionary];
+  [md setObject: @"value" forKey: @"string"];
+  [md setObject: [NSNumber numberWithInt: 42] forKey: @"number"];
+  [md setObject: [NSNumber numberWithDouble: 1.5] forKey: @"real"];
+  [md setObject: [NSData dataWithBytes: "abc" length: 3] forKey: @"data"];
+  [md setObject: @"\u20AC and more" forKey: @"unicode"];
+  plist = roundTrip(md, 0, &streamed);
+  PASS_EQUAL(plist, md, "small property list streams correctly");
+  data = [NSPropertyListSerialization dataWithPropertyList: md
+    format: NSPropertyListBinaryFormat_v1_0 options: 0 error: 0];
+  PASS_EQUAL(streamed, data, "streamed output matches in-memory output");
+
+  /* Enough objects to need two and three byte references, with shared
+   * leaves and a container which appears more than once.
+   */
+  ma = [NSMutableArray array];
+  shared = [NSArray arrayWithObjects: @"a", @"b", nil];
+  for (i = 0; i < 70000; i++)
+    {
+      [ma addObject: [NSNumber numberWithInt: i]];
+      if (i % 1000 == 0)
+	{
+	  [ma addObject: shared];
+	  [ma addObject: @"repeated string"];
+	}
+    }
+  plist = roundTrip(ma, 0, &streamed);
+  PASS_EQUAL(plist, ma, "large property list streams correctly");
+
+  ma = [NSMutableArray array];
+  for (i = 0; i < 1000; i++)
+    {
+      [ma addObject: [@"" stringByPaddingToLength: 100
+				      withString: @"x"
+				 startingAtIndex: 0]];
+    }
+  plist = roundTrip(ma, 0, &streamed);
+  PASS_EQUAL(plist, ma, "repeated strings stream correctly");
+  PASS([streamed length] < 5000, "equal strings are only written once");
+  plist = roundTrip(ma, GSPropertyListWriteBounded, &streamed);
+  PASS_EQUAL(plist, ma, "repeated strings stream correctly when bounded");
+  PASS([streamed length] < 5000, "bounded output shares recent strings");
+
+  /* Each level refers to the one below twice, so writing every path
+   * separately would need over a million objects.
+   */
+  plist = @"leaf";
+  for (i = 0; i < 20; i++)
+    {
+      plist = [NSArray arrayWithObjects: plist, plist, nil];
+    }
+  ma = [NSMutableArray arrayWithObject: plist];
+  plist = roundTrip(ma, 0, &streamed);
+  PASS_EQUAL(plist, ma, "shared containers stream correctly");
+  PASS([streamed length] < 1000, "shared containers are only written once");
+  data = [NSPropertyListSerialization dataWithPropertyList: ma
+    format: NSPropertyListBinaryFormat_v1_0 options: 0 error: 0];
+  PASS_EQUAL(streamed, data, "shared containers match in-memory output");
+
+  ma = [NSMutableArray array];
+  [ma addObject: @"x"];
+  [ma addObject: ma];
+  PASS(roundTrip(ma, 0, 0) == nil, "cyclic property list is not written");
+  [ma removeObjectAtIndex: 1];
+
+  [arp release]; arp = nil;
+  return 0;
+}
@@ -0,0 +1,204 @@
+#import "ObjectTesting.h"
+#import <Foundation/NSAutoreleasePool.h>
+#import <Foundation/NSArray.h>
+#import <Foundation/NSData.h>
+#import <Foundation/NSDictionary.h>
+#import <Foundation/NSException.h>
+#import <Foundation/NSFileManager.h>
+#import <Foundation/NSPathUtilities.h>
+#import <Foundation/NSPropertyList.h>
+#import <Foundation/NSValue.h>
+
+/* An array whose only element is the array itself.
+ */
+static const unsigned char cyclic[] = {
+  'b', 'p', 'l', 'i', 's', 't', '0', '0',
+  0xA1, 0x00,
+  0x08,
+  0, 0, 0, 0, 0, 0, 1, 1,
+  0, 0, 0, 0, 0, 0, 0, 1,
+  0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 10
+};
+
+/* The string "a", using 8-byte offsets and object references.
+ */
+static const unsigned char wide[] = {
+  'b', 'p', 'l', 'i', 's', 't', '0', '0',
+  0x51, 'a',
+  0, 0, 0, 0, 0, 0, 0, 8,
+  0, 0, 0, 0, 0, 0, 8, 8,
+  0, 0, 0, 0, 0, 0, 0, 1,
+  0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 10
+};
+
+/* A dictionary with the key "a" twice; the second value (2) wins.
+ */
+static const unsigned char duplicate[] = {
+  'b', 'p', 'l', 'i', 's', 't', '0', '0',
+  0xD2, 0x01, 0x01, 0x02, 0x03,
+  0x51, 'a',
+  0x10, 0x01,
+  0x10, 0x02,
+  0x08, 0x0D, 0x0F, 0x11,
+  0, 0, 0, 0, 0, 0, 1, 1,
+  0, 0, 0, 0, 0, 0, 0, 4,
+  0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 19
+};
+
+/* The string "a", its length stored as an 8-byte count.
+ */
+static const unsigned char longCount[] = {
+  'b', 'p', 'l', 'i', 's', 't', '0', '0',
+  0x5F, 0x13, 0, 0, 0, 0, 0, 0, 0, 1, 'a',
+  0x08,
+  0, 0, 0, 0, 0, 0, 1, 1,
+  0, 0, 0, 0, 0, 0, 0, 1,
+  0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 19
+};
+
+static id
+readMapped(NSString *path, NSData *d, NSPropertyListReadOptions o)
+{
+  NSPropertyListFormat	format = 0;
+  NSError		*error = nil;
+  id			plist;
+
+  [d writeToFile: path atomically: YES];
+  plist = [NSPropertyListSerialization
+    propertyListWithContentsOfMappedFile: path
+				 options: o
+				  format: &format
+				   error: &error];
+  if (plist != nil && format != NSPropertyListBinaryFormat_v1_0)
+    {
+      plist = nil;
+    }
+  return plist;
+}
+
+int main()
+{
+  NSAutoreleasePool	*arp = [NSAutoreleasePool new];
+  NSString		*path;
+  NSMutableDictionary	*md;
+  NSMutableArray	*ma;
+  NSDictionary		*d;
+  NSArray		*a;
+  NSData		*data;
+  NSMutableData		*bad;
+  NSPropertyListFormat	format;
+  id			plist;
+  unsigned		count;
+  id			k;
+  int			i;
+
+  path = [NSTemporaryDirectory()
+    stringByAppendingPathComponent: @"lazy-plist-test.plist"];
+
+  ma = [NSMutableArray array];
+  md = [NSMutableDictionary dictionary];
+  for (i = 0; i < 100; i++)
+    {
+      [ma addObject: [NSString stringWithFormat: @"item%d", i]];
+      [md setObject: [NSDictionary dictionaryWithObjectsAndKeys:
+	[NSNumber numberWithInt: i], @"number",
+	[NSArray arrayWithObjects: @"x", [NSNumber numberWithInt: i], nil],
+	@"list", nil]
+	     forKey: [NSString stringWithFormat: @"key%d", i]];
+    }
+  [md setObject: ma forKey: @"array"];
+  [md setObject: [NSDictionary dictionary] forKey: @"empty"];
+
+  data = [NSPropertyListSerialization dataWithPropertyList: md
+    format: NSPropertyListBinaryFormat_v1_0 options: 0 error: 0];
+  plist = readMapped(path, data, NSPropertyListImmutable);
+  PASS([plist isKindOfClass: [NSDictionary class]]
+    && [plist count] == [md count], "lazy dictionary has the right count");
+  PASS_EQUAL([[plist objectForKey: @"key42"] objectForKey: @"number"],
+    [NSNumber numberWithInt: 42], "nested value is decoded on access");
+  PASS([plist objectForKey: @"missing"] == nil, "missing key returns nil");
+  a = [plist objectForKey: @"array"];
+  PASS([a count] == 100 && [[a objectAtIndex: 99] isEqual: @"item99"],
+    "lazy array gives indexed access");
+  PASS([a objectAtIndex: 7] == [a objectAtIndex: 7],
+    "decoded elements are kept");
+  PASS_EXCEPTION([a objectAtIndex: 100], NSRangeException,
+    "lazy array checks its bounds");
+  PASS([[plist objectForKey: @"empty"] count] == 0, "empty dictionary works");
+  count = 0;
+  for (k in plist)
+    {
+      if ([plist objectForKey: k] != nil)
+	{
+	  count++;
+	}
+    }
+  PASS(count == [md count], "fast enumeration gives every key");
+  PASS_EQUAL(plist, md, "lazy property list is equal to the original");
+  PASS([plist copy] == plist, "copying a lazy container is cheap");
+
+  plist = readMapped(path, data, NSPropertyListMutableContainers);
+  PASS([plist isKindOfClass: [NSMutableDictionary class]]
+    && [plist isEqual: md], "mutable containers are parsed eagerly");
+
+  data = [NSData dataWithBytes: wide length: sizeof(wide)];
+  plist = [NSPropertyListSerialization propertyListWithData: data
+    options: NSPropertyListImmutable format: 0 error: 0];
+  PASS_EQUAL(plist, @"a", "8-byte offsets and references are supported");
+
+  data = [NSData dataWithBytes: wide length: sizeof(wide)];
+  bad = [NSMutableData dataWithData: data];
+  ((unsigned char*)[bad mutableBytes])[sizeof(wide) - 17] = 0xFF;
+  PASS(readMapped(path, bad, NSPropertyListImmutable) == nil,
+    "lazy parser rejects a table larger than the data");
+
+  data = [NSData dataWithBytes: longCount length: sizeof(longCount)];
+  plist = [NSPropertyListSerialization propertyListWithData: data
+    options: NSPropertyListImmutable format: 0 error: 0];
+  PASS_EQUAL(plist, @"a", "8-byte counts are supported");
+
+  data = [NSData dataWithBytes: duplicate length: sizeof(duplicate)];
+  plist = readMapped(path, data, NSPropertyListImmutable);
+  PASS([plist count] == 1, "lazy dictionary counts a duplicate key once");
+  PASS_EQUAL([plist objectForKey: @"a"], [NSNumber numberWithInt: 2],
+    "lazy dictionary uses the last value of a duplicate key");
+  count = 0;
+  for (k in plist)
+    {
+      count++;
+    }
+  PASS(count == 1, "lazy dictionary enumerates a duplicate key once");
+  PASS_EQUAL([[plist keyEnumerator] allObjects], [NSArray arrayWithObject: @"a"],
+    "key enumerator gives a duplicate key once");
+
+  data = [NSData dataWithBytes: cyclic length: sizeof(cyclic)];
+  PASS_EXCEPTION([NSPropertyListSerialization propertyListWithData: data
+    options: NSPropertyListImmutable format: 0 error: 0],
+    NSGenericException, "eager parser rejects a cyclic graph");
+  plist = readMapped(path, data, NSPropertyListImmutable);
+  PASS([plist isKindOfClass: [NSArray class]] && [plist count] == 1,
+    "lazy parser opens a cyclic graph");
+  PASS_EXCEPTION([plist objectAtIndex: 0], NSGenericException,
+    "lazy parser rejects a cycle when it is reached");
+
+  d = [NSDictionary dictionaryWithObject: @"value" forKey: @"key"];
+  data = [NSPropertyListSerialization dataWithPropertyList: d
+    format: NSPropertyListXMLFormat_v1_0 options: 0 error: 0];
+  [data writeToFile: path atomically: YES];
+  format = 0;
+  plist = [NSPropertyListSerialization
+    propertyListWithContentsOfMappedFile: path
+				 options: NSPropertyListImmutable
+				  format: &format
+				   error: 0];
+  PASS(format == NSPropertyListXMLFormat_v1_0 && [plist isEqual: d],
+    "non-binary files are parsed normally");
+  [[NSFileManager defaultManager] removeItemAtPath: path error: NULL];
+
+  [arp release]; arp = nil;
+  return 0;
+}